@@ -0,0 +1,569 @@
+// Performance benchmarks for the simulation core, the game_state wire
+// formats, replay playback and the pathfinding bots. Build with -DBUILD_BENCHMARKS=ON and run
+// ./snake_bench; compare runs with Google Benchmark's tools/compare.py.
+// Recorded matches become extra workloads with --replay FILE (repeatable).
+
+#include "engine.h"
+#include "gamemessage.h"
+#include "logger.h"
+#include "replay.h"
+#include "snakebot.h"
+#include "wireformat.h"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+    #include "jansson.h"
+}
+
+namespace {
+
+// Engine over self-owned state with a clock advanced by the benchmark
+struct Sim {
+    PlayerManager players;
+    OccupancyGrid grid;
+    MatchState match;
+    Food food;
+    uint32_t clockMs;
+    SnakeEngine engine;
+    GameRng botRng;
+    bool pathBots;  // Steered by SnakeBot instead of steer()
+    SnakeBot pathfinder;
+
+    Sim(int playerCount, int width, int height, bool usePathBots = false)
+        : players(playerCount), grid(width, height), clockMs(0),
+          engine(players, grid, match, food, [this] { return clockMs; }),
+          botRng(1234), pathBots(usePathBots)
+    {
+        grid.seedRandom(42);
+        for (int i = 0; i < playerCount; i++) {
+            players.activate(i, pathBots ? SnakeBot::botClientId(i) : "bench_" + std::to_string(i));
+            players[i].snake = std::make_unique<Snake>(playerColor(i), engine.randomSpawnPosition());
+            grid.occupyBody(*players[i].snake, i);
+        }
+        food.spawn(grid);
+        match.matchStartTime = clockMs;
+    }
+
+    // Replace every body with a serpentine of `length` cells inside its own
+    // band of rows, so long snakes fit side by side
+    void layOutSnakes(int length) {
+        int active = players.activeCount();
+        int bandHeight = std::max(1, grid.getHeight() / std::max(1, active));
+        int band = 0;
+        std::vector<Position> body;
+        for (int i : players.activeIndices()) {
+            if (!players.isValid(i)) continue;
+            int cells = std::min(length, bandHeight * grid.getWidth());
+            body.clear();
+            for (int c = 0; c < cells; c++) {
+                int row = c / grid.getWidth();
+                int col = c % grid.getWidth();
+                if (row % 2 == 1) col = grid.getWidth() - 1 - col;
+                body.push_back(Position{col, band * bandHeight + row});
+            }
+            std::reverse(body.begin(), body.end());  // Head at the end of the path
+            players[i].snake->setBody(body.data(), body.size());
+            band++;
+        }
+        engine.rebuildOccupancy();
+    }
+
+    // Cheap bot: mostly straight on, turning into a free cell when blocked
+    void steer() {
+        static const Direction dirs[] = {Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT};
+        for (int i : players.activeIndices()) {
+            if (!players.isValid(i)) continue;
+            Snake& snake = *players[i].snake;
+            Position head = snake.getHead();
+            Direction current = snake.getDirection() == Direction::NONE ? Direction::RIGHT : snake.getDirection();
+
+            auto freeAhead = [&](Direction d) {
+                Position p = head;
+                switch (d) {
+                    case Direction::UP:    p.y--; break;
+                    case Direction::DOWN:  p.y++; break;
+                    case Direction::LEFT:  p.x--; break;
+                    case Direction::RIGHT: p.x++; break;
+                    case Direction::NONE:  break;
+                }
+                return !grid.isOccupied(p);
+            };
+
+            Direction choice = current;
+            if (botRng.below(8) == 0 || !freeAhead(current)) {
+                uint32_t start = botRng.below(4);
+                for (uint32_t k = 0; k < 4; k++) {
+                    Direction d = dirs[(start + k) % 4];
+                    if (freeAhead(d)) { choice = d; break; }
+                }
+            }
+            snake.setDirection(choice);
+        }
+    }
+
+    void tick() {
+        if (pathBots) {
+            pathfinder.steer(players, grid, food.getPosition());
+        } else {
+            steer();
+        }
+        engine.tick();
+        clockMs += Config::Game::INITIAL_SPEED_MS;
+    }
+
+    // Same fields a host game_state puts in a snapshot
+    void capture(WireFormat::StateSnapshot& snapshot) const {
+        snapshot.food = food.getPosition();
+        snapshot.matchStartTime = match.matchStartTime;
+        snapshot.elapsedMs = clockMs;
+        snapshot.playerCount = 0;
+        for (int i : players.activeIndices()) {
+            if (!players.isValid(i)) continue;
+            WireFormat::PlayerState& player = snapshot.addPlayer();
+            player.index = i;
+            player.alive = players[i].snake->isAlive();
+            player.inputSeq = 0;
+            player.inputAge = 0;
+            player.heading = 0;
+            player.body.clear();
+            for (const auto& segment : players[i].snake->getBody()) {
+                player.body.push_back(segment);
+            }
+        }
+    }
+
+    // The per-segment JSON game_state layout
+    json_t* buildJson() const {
+        json_t* root = json_object();
+        json_object_set_new(root, "type", json_string("game_state"));
+        json_object_set_new(root, "foodX", json_integer(food.getPosition().x));
+        json_object_set_new(root, "foodY", json_integer(food.getPosition().y));
+        json_t* playersArray = json_array();
+        for (int i : players.activeIndices()) {
+            if (!players.isValid(i)) continue;
+            json_t* playerObj = json_object();
+            json_object_set_new(playerObj, "index", json_integer(i));
+            json_object_set_new(playerObj, "alive", json_boolean(players[i].snake->isAlive()));
+            json_t* bodyArray = json_array();
+            for (const auto& segment : players[i].snake->getBody()) {
+                json_t* segmentObj = json_object();
+                json_object_set_new(segmentObj, "x", json_integer(segment.x));
+                json_object_set_new(segmentObj, "y", json_integer(segment.y));
+                json_array_append_new(bodyArray, segmentObj);
+            }
+            json_object_set_new(playerObj, "body", bodyArray);
+            json_array_append_new(playersArray, playerObj);
+        }
+        json_object_set_new(root, "players", playersArray);
+        json_object_set_new(root, "matchStartTime", json_integer(match.matchStartTime));
+        json_object_set_new(root, "elapsedMs", json_integer(clockMs));
+        return root;
+    }
+};
+
+// Default board for up to 4 players, a large arena beyond that
+ArenaSettings benchArena(int playerCount)
+{
+    ArenaSettings arena;
+    arena.maxPlayers = playerCount;
+    if (playerCount > Config::Game::DEFAULT_PLAYERS) {
+        arena.width = 250;
+        arena.height = 250;
+    }
+    return arena;
+}
+
+// Args: players, grid width, grid height
+void BM_EngineTick(benchmark::State& state)
+{
+    Sim sim((int)state.range(0), (int)state.range(1), (int)state.range(2));
+    for (auto _ : state) {
+        sim.tick();
+    }
+    state.SetItemsProcessed(state.iterations());  // items/s = ticks per second
+}
+BENCHMARK(BM_EngineTick)
+    ->ArgNames({"players", "w", "h"})
+    ->ArgsProduct({{1, 2, 4}, {40}, {30}})
+    ->Args({4, 100, 100})
+    ->Args({4, 250, 250})
+    ->Args({16, 100, 100})
+    ->Args({64, 250, 250})
+    ->Args({64, 400, 300});
+
+// Args: players, grid width, grid height, snake length
+void BM_RebuildOccupancy(benchmark::State& state)
+{
+    Sim sim((int)state.range(0), (int)state.range(1), (int)state.range(2));
+    sim.layOutSnakes((int)state.range(3));
+    for (auto _ : state) {
+        sim.engine.rebuildOccupancy();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RebuildOccupancy)
+    ->ArgNames({"players", "w", "h", "len"})
+    ->ArgsProduct({{4}, {40}, {30}, {3, 64, 256}})
+    ->Args({4, 250, 250, 4096})
+    ->Args({64, 250, 250, 256});
+
+// One round of pathfinding decisions for every snake (the board is
+// evolved by untimed ticks in between). items/s = bot decisions per second.
+// Args: players, grid width, grid height
+void BM_BotSteer(benchmark::State& state)
+{
+    Sim sim((int)state.range(0), (int)state.range(1), (int)state.range(2), true);
+    for (int i = 0; i < 50; i++) sim.tick();  // Snakes grow apart from their spawns
+    for (auto _ : state) {
+        sim.pathfinder.steer(sim.players, sim.grid, sim.food.getPosition());
+        state.PauseTiming();
+        sim.engine.tick();
+        sim.clockMs += Config::Game::INITIAL_SPEED_MS;
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * sim.players.activeCount());
+}
+BENCHMARK(BM_BotSteer)
+    ->ArgNames({"players", "w", "h"})
+    ->Args({4, 40, 30})
+    ->Args({16, 100, 100})
+    ->Args({64, 250, 250})
+    ->Args({64, 400, 300});
+
+// Host side of a binary game_state: capture, encode, base64 and wrap.
+// Args: players, snake length, delta (0 = keyframe)
+void BM_GameStateEncodeBinary(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    bool delta = state.range(2) != 0;
+
+    WireFormat::StateSnapshot base, current;
+    sim.capture(base);
+    sim.tick();
+
+    std::vector<uint8_t> bytes;
+    std::string text, payload;
+    for (auto _ : state) {
+        sim.capture(current);
+        if (!WireFormat::encodeSnapshot(current, delta ? &base : nullptr, bytes)) {
+            state.SkipWithError("snapshot not step-encodable");
+            break;
+        }
+        WireFormat::base64Encode(bytes.data(), bytes.size(), text);
+        payload.assign("{\"type\":\"game_state\",\"bin\":\"");
+        payload.append(text);
+        payload.append("\"}");
+        benchmark::DoNotOptimize(payload.data());
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)payload.size());
+    state.counters["payload_bytes"] = (double)payload.size();
+}
+BENCHMARK(BM_GameStateEncodeBinary)
+    ->ArgNames({"players", "len", "delta"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}, {0, 1}});
+
+// Client side: parse the JSON envelope, base64-decode and decode the snapshot
+void BM_GameStateDecodeBinary(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    bool delta = state.range(2) != 0;
+
+    WireFormat::SnapshotHistory history;
+    WireFormat::StateSnapshot& base = history.store(1);
+    sim.capture(base);
+    base.seq = 1;
+    sim.tick();
+
+    WireFormat::StateSnapshot current;
+    sim.capture(current);
+    current.seq = 2;
+    std::vector<uint8_t> bytes;
+    std::string text;
+    WireFormat::encodeSnapshot(current, delta ? &base : nullptr, bytes);
+    WireFormat::base64Encode(bytes.data(), bytes.size(), text);
+    std::string payload = "{\"type\":\"game_state\",\"bin\":\"" + text + "\"}";
+
+    WireFormat::StateSnapshot decoded;
+    for (auto _ : state) {
+        json_t* root = json_loadb(payload.data(), payload.size(), 0, nullptr);
+        json_t* binVal = json_object_get(root, "bin");
+        WireFormat::base64Decode(json_string_value(binVal), json_string_length(binVal), bytes);
+        WireFormat::DecodeResult result = WireFormat::decodeSnapshot(bytes.data(), bytes.size(), history, decoded);
+        json_decref(root);
+        if (result != WireFormat::DecodeResult::OK) {
+            state.SkipWithError("snapshot decode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(decoded.playerCount);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)payload.size());
+}
+BENCHMARK(BM_GameStateDecodeBinary)
+    ->ArgNames({"players", "len", "delta"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}, {0, 1}});
+
+// The JSON fallback layout, built and dumped. Args: players, snake length
+void BM_GameStateEncodeJson(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    size_t length = 0;
+    for (auto _ : state) {
+        json_t* root = sim.buildJson();
+        char* text = json_dumps(root, JSON_COMPACT);
+        length = strlen(text);
+        benchmark::DoNotOptimize(text);
+        free(text);
+        json_decref(root);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)length);
+    state.counters["payload_bytes"] = (double)length;
+}
+BENCHMARK(BM_GameStateEncodeJson)
+    ->ArgNames({"players", "len"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}});
+
+void BM_GameStateDecodeJson(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    json_t* built = sim.buildJson();
+    char* text = json_dumps(built, JSON_COMPACT);
+    std::string payload(text);
+    free(text);
+    json_decref(built);
+
+    std::vector<Position> body;
+    for (auto _ : state) {
+        json_t* root = json_loadb(payload.data(), payload.size(), 0, nullptr);
+        size_t index;
+        json_t* playerObj;
+        json_array_foreach(json_object_get(root, "players"), index, playerObj) {
+            body.clear();
+            size_t i;
+            json_t* segment;
+            json_array_foreach(json_object_get(playerObj, "body"), i, segment) {
+                body.push_back(Position{(int)json_integer_value(json_object_get(segment, "x")),
+                                        (int)json_integer_value(json_object_get(segment, "y"))});
+            }
+        }
+        json_decref(root);
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)payload.size());
+}
+BENCHMARK(BM_GameStateDecodeJson)
+    ->ArgNames({"players", "len"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}});
+
+// The received line around a game payload, as GameMessage::decode sees it
+std::string gameLine(const std::string& payload)
+{
+    return "{\"cmd\":\"game\",\"clientId\":\"bench_0\",\"messageId\":1,\"data\":" + payload + "}";
+}
+
+// BM_GameStateDecodeBinary through the streaming decoder, envelope included
+void BM_GameStateDecodeBinaryStream(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    bool delta = state.range(2) != 0;
+
+    WireFormat::SnapshotHistory history;
+    WireFormat::StateSnapshot& base = history.store(1);
+    sim.capture(base);
+    base.seq = 1;
+    sim.tick();
+
+    WireFormat::StateSnapshot current;
+    sim.capture(current);
+    current.seq = 2;
+    std::vector<uint8_t> bytes;
+    std::string text;
+    WireFormat::encodeSnapshot(current, delta ? &base : nullptr, bytes);
+    WireFormat::base64Encode(bytes.data(), bytes.size(), text);
+    std::string line = gameLine("{\"type\":\"game_state\",\"bin\":\"" + text + "\"}");
+
+    GameMessage::Decoded decoded;
+    WireFormat::StateSnapshot snapshot;
+    for (auto _ : state) {
+        if (!GameMessage::decode(line.data(), line.size(), decoded, snapshot) || !decoded.binValid ||
+            WireFormat::decodeSnapshot(decoded.bin.data(), decoded.bin.size(), history, snapshot) !=
+                WireFormat::DecodeResult::OK) {
+            state.SkipWithError("snapshot decode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(snapshot.playerCount);
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)line.size());
+}
+BENCHMARK(BM_GameStateDecodeBinaryStream)
+    ->ArgNames({"players", "len", "delta"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}, {0, 1}});
+
+// BM_GameStateDecodeJson through the streaming decoder, envelope included
+void BM_GameStateDecodeJsonStream(benchmark::State& state)
+{
+    ArenaSettings arena = benchArena((int)state.range(0));
+    Sim sim(arena.maxPlayers, arena.width, arena.height);
+    sim.layOutSnakes((int)state.range(1));
+    json_t* built = sim.buildJson();
+    char* text = json_dumps(built, JSON_COMPACT);
+    std::string line = gameLine(text);
+    free(text);
+    json_decref(built);
+
+    GameMessage::Decoded decoded;
+    WireFormat::StateSnapshot snapshot;
+    for (auto _ : state) {
+        if (!GameMessage::decode(line.data(), line.size(), decoded, snapshot)) {
+            state.SkipWithError("decode failed");
+            break;
+        }
+        benchmark::DoNotOptimize(snapshot.players.data());
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)line.size());
+}
+BENCHMARK(BM_GameStateDecodeJsonStream)
+    ->ArgNames({"players", "len"})
+    ->ArgsProduct({{1, 4, 16, 64}, {16, 256}});
+
+// Whole-match playback of a replay file, from tick 0 to the end
+void runReplay(benchmark::State& state, const Replay::File* file)
+{
+    PlayerManager players;
+    OccupancyGrid grid;
+    MatchState match;
+    Food food;
+    Replay::Player player(Replay::MatchView{players, grid, match, food});
+    if (!player.load(*file)) {
+        state.SkipWithError("replay load failed");
+        return;
+    }
+    int64_t ticks = 0;
+    for (auto _ : state) {
+        player.seek(0);
+        ticks += player.advance(file->endTick());
+    }
+    if (player.mismatches() > 0) {
+        state.SkipWithError("replay diverged from its keyframes");
+    }
+    state.SetItemsProcessed(ticks);  // items/s = ticks per second
+}
+
+// A bot match of BM_EngineTick's kind, recorded once per argument set
+std::string recordBotMatch(int playerCount, int width, int height, int ticks)
+{
+    std::string path = "/tmp/snake_bench_" + std::to_string(playerCount) + "_" + std::to_string(width) + "x" +
+                       std::to_string(height) + "_" + std::to_string(ticks) + ".hsr";
+    Sim sim(playerCount, width, height);
+    Replay::Recorder recorder(Replay::MatchView{sim.players, sim.grid, sim.match, sim.food});
+    if (!recorder.start(path, Config::Game::INITIAL_SPEED_MS)) return "";
+    for (int t = 0; t < ticks; t++) {
+        sim.steer();
+        recorder.beforeTick();
+        sim.engine.tick();
+        recorder.afterTick();
+        sim.clockMs += Config::Game::INITIAL_SPEED_MS;
+        sim.match.syncedElapsedMs = sim.clockMs;
+    }
+    recorder.stop();
+    return path;
+}
+
+// Args: players, grid width, grid height, ticks
+void BM_ReplayPlayback(benchmark::State& state)
+{
+    std::string path = recordBotMatch((int)state.range(0), (int)state.range(1), (int)state.range(2),
+                                      (int)state.range(3));
+    Replay::File file;
+    if (path.empty() || !file.open(path)) {
+        state.SkipWithError("replay recording failed");
+        return;
+    }
+    runReplay(state, &file);
+    file.close();
+    remove(path.c_str());
+}
+BENCHMARK(BM_ReplayPlayback)
+    ->ArgNames({"players", "w", "h", "ticks"})
+    ->Args({4, 40, 30, 3000})
+    ->Args({16, 100, 100, 3000})
+    ->Args({64, 250, 250, 1000});
+
+// Args: players, grid width, grid height, ticks. Random seeks, each from
+// the nearest keyframe.
+void BM_ReplaySeek(benchmark::State& state)
+{
+    std::string path = recordBotMatch((int)state.range(0), (int)state.range(1), (int)state.range(2),
+                                      (int)state.range(3));
+    Replay::File file;
+    PlayerManager players;
+    OccupancyGrid grid;
+    MatchState match;
+    Food food;
+    Replay::Player player(Replay::MatchView{players, grid, match, food});
+    if (path.empty() || !file.open(path) || !player.load(file)) {
+        state.SkipWithError("replay recording failed");
+        return;
+    }
+    GameRng rng(99);
+    for (auto _ : state) {
+        player.seek(rng.below(file.endTick()));
+        benchmark::DoNotOptimize(player.currentTick());
+    }
+    state.SetItemsProcessed(state.iterations());
+    file.close();
+    remove(path.c_str());
+}
+BENCHMARK(BM_ReplaySeek)
+    ->ArgNames({"players", "w", "h", "ticks"})
+    ->Args({4, 40, 30, 3000})
+    ->Args({64, 250, 250, 1000});
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // Deaths and respawns log at INFO; keep them out of the timings
+    Logger::init("", LogLevel::ERROR, false);
+
+    // --replay FILE: register a recorded match as BM_Replay/<file>. Taken
+    // out of argv before Google Benchmark sees it.
+    std::vector<std::unique_ptr<Replay::File>> replays;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            auto file = std::make_unique<Replay::File>();
+            if (!file->open(argv[++i])) {
+                fprintf(stderr, "Cannot load replay %s\n", argv[i]);
+                return 1;
+            }
+            benchmark::RegisterBenchmark((std::string("BM_Replay/") + argv[i]).c_str(), runReplay, file.get());
+            replays.push_back(std::move(file));
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    Logger::shutdown();
+    return 0;
+}
@@ -0,0 +1,590 @@
+// Load generator for the relay and for session hosts. Runs N headless bot
+// clients in one process, spread over a few MpReactor threads, that join
+// sessions and send player_input every tick. Each input is timed until a
+// game_state echoes its seq, and the send-to-apply latency percentiles and
+// message rates are printed to stdout as CSV.
+//
+//   ./snake_loadgen --sessions 4 --clients 64          host 4 sessions in-process
+//   ./snake_loadgen --join S1,S2 --clients 200         load someone else's sessions
+//
+// Bots ack snapshots like a real client, so hosts send deltas. Every bot
+// therefore keeps a client's snapshot history. With --steer path they also
+// play: each input comes from the SnakeBot pathfinder run over the newest
+// snapshot, so snakes grow, eat and collide the way real matches do.
+
+#include "engine.h"
+#include "logger.h"
+#include "sessionpool.h"
+#include "snakebot.h"
+#include "wireformat.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<bool> stopRequested(false);
+
+void onSignal(int)
+{
+    stopRequested = true;
+}
+
+uint64_t nowUs()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+    std::string host = Config::Network::DEFAULT_HOST;
+    int port = Config::Network::DEFAULT_PORT;
+    int clients = Config::LoadGen::DEFAULT_CLIENTS;
+    int sessions = 0;                     // Hosted in-process
+    std::vector<std::string> join;        // Or joined on the relay
+    int threads = 1;                      // Bot reactors
+    int durationS = Config::LoadGen::DEFAULT_DURATION_S;
+    int intervalS = Config::LoadGen::REPORT_INTERVAL_S;
+    int tickMs = Config::Game::INITIAL_SPEED_MS;
+    std::string script;                   // Empty = random turns
+    bool steerPath = false;               // Pathfinder instead of random turns
+    uint64_t seed = 1;
+    ArenaSettings arena;
+};
+
+// Counters for one report interval
+struct Stats {
+    uint64_t inputsSent = 0;
+    uint64_t inputsAcked = 0;
+    uint64_t messages = 0;
+    uint64_t gameStates = 0;
+    uint64_t deltas = 0;
+    uint64_t binBytes = 0;
+    uint64_t resyncs = 0;
+    std::vector<uint32_t> latencyUs;
+
+    void add(const Stats& other) {
+        inputsSent += other.inputsSent;
+        inputsAcked += other.inputsAcked;
+        messages += other.messages;
+        gameStates += other.gameStates;
+        deltas += other.deltas;
+        binBytes += other.binBytes;
+        resyncs += other.resyncs;
+        latencyUs.insert(latencyUs.end(), other.latencyUs.begin(), other.latencyUs.end());
+    }
+};
+
+struct Shard;
+
+// One headless client. After its join returns, a bot is only touched on
+// its shard's reactor thread (listener and input timer).
+struct Bot {
+    int id;
+    Shard* shard;
+    MultiplayerApi* api;
+    int timerId;
+    bool joined;
+
+    bool playing;
+    Direction heading;
+    GameRng rng;
+    size_t scriptPos;
+
+    // Bot i's seqs start at (i + 1) << SEQ_SPACE_BITS, so it can find its
+    // own snake in a snapshot without knowing the host's slot numbering
+    uint32_t seqBase;
+    uint32_t nextSeq;
+    uint32_t lastEchoed;
+    struct Sent { uint32_t seq; uint64_t atUs; };
+    std::array<Sent, Config::LoadGen::INFLIGHT_INPUTS> sent;
+
+    std::unique_ptr<WireFormat::SnapshotHistory> history;  // On the first binary game_state
+    WireFormat::StateSnapshot snapshot;
+    std::vector<uint8_t> bytes;
+    uint32_t lastAppliedSeq;
+    uint64_t lastAckUs;
+    int arenaWidth;   // From state_sync, for --steer path
+    int arenaHeight;
+
+    Bot(int botId, Shard* owner, uint64_t seed, const ArenaSettings& arena)
+        : id(botId), shard(owner), api(nullptr), timerId(-1), joined(false),
+          playing(false), heading(Direction::NONE), rng(seed + (uint64_t)botId), scriptPos(0),
+          seqBase((uint32_t)(botId + 1) << Config::LoadGen::SEQ_SPACE_BITS), nextSeq(0),
+          lastEchoed(0), sent(), lastAppliedSeq(0), lastAckUs(0),
+          arenaWidth(arena.width), arenaHeight(arena.height)
+    {
+        nextSeq = seqBase;
+    }
+
+    bool ownsSeq(uint32_t seq) const {
+        return seq >= seqBase && seq - seqBase < (1u << Config::LoadGen::SEQ_SPACE_BITS);
+    }
+};
+
+struct Shard {
+    MpReactor* reactor = nullptr;
+    std::vector<std::unique_ptr<Bot>> bots;
+    const Options* options = nullptr;
+
+    std::mutex lock;  // Reactor thread adds, the reporter swaps out
+    Stats stats;
+
+    // --steer path, on the reactor thread only
+    SnakeBot pathfinder;
+    BotBoard board;
+    std::vector<Position> heads;
+};
+
+void sendGame(Bot& bot, json_t* message)
+{
+    mp_api_game_take(bot.api, message, 0);
+}
+
+// The pathfinder's move over the newest applied snapshot; NONE until the
+// host has echoed one of our inputs (that's how the bot finds its snake)
+Direction pathDirection(Bot& bot)
+{
+    const WireFormat::StateSnapshot* snapshot = bot.history ? bot.history->find(bot.lastAppliedSeq) : nullptr;
+    if (!snapshot) return Direction::NONE;
+
+    Shard& shard = *bot.shard;
+    shard.board.reset(bot.arenaWidth, bot.arenaHeight);
+    shard.heads.clear();
+    const WireFormat::PlayerState* own = nullptr;
+    for (int p = 0; p < snapshot->playerCount; p++) {
+        const WireFormat::PlayerState& player = snapshot->players[p];
+        for (const Position& segment : player.body) shard.board.block(segment);
+        if (player.alive && !player.body.empty()) shard.heads.push_back(player.body[0]);
+        if (bot.ownsSeq(player.inputSeq)) own = &player;
+    }
+    if (!own || !own->alive || own->body.empty()) return Direction::NONE;
+
+    Direction heading = Direction::NONE;
+    if (own->body.size() >= 2) {
+        const Position& head = own->body[0];
+        const Position& neck = own->body[1];
+        if (head.x != neck.x) heading = head.x > neck.x ? Direction::RIGHT : Direction::LEFT;
+        else if (head.y != neck.y) heading = head.y > neck.y ? Direction::DOWN : Direction::UP;
+    }
+    return shard.pathfinder.choose(shard.board, own->body[0], heading, (int)own->body.size(),
+                                   snapshot->food, shard.heads);
+}
+
+Direction nextDirection(Bot& bot, const std::string& script)
+{
+    if (!script.empty()) {
+        char c = script[bot.scriptPos++ % script.size()];
+        switch (c) {
+            case 'U': return Direction::UP;
+            case 'D': return Direction::DOWN;
+            case 'L': return Direction::LEFT;
+            case 'R': return Direction::RIGHT;
+            default: return Direction::NONE;  // '.' or anything else: no input this tick
+        }
+    }
+    if (bot.shard->options->steerPath) {
+        Direction dir = pathDirection(bot);
+        if (dir != Direction::NONE) {
+            bot.heading = dir;
+            return dir;
+        }
+    }
+
+    // Mostly straight on, sometimes a quarter turn; never a reversal
+    static const Direction turns[4][2] = {
+        {Direction::LEFT, Direction::RIGHT},  // UP
+        {Direction::LEFT, Direction::RIGHT},  // DOWN
+        {Direction::UP, Direction::DOWN},     // LEFT
+        {Direction::UP, Direction::DOWN},     // RIGHT
+    };
+    if (bot.heading == Direction::NONE) {
+        bot.heading = static_cast<Direction>(bot.rng.below(4));
+    } else if (bot.rng.below(4) == 0) {
+        bot.heading = turns[static_cast<int>(bot.heading)][bot.rng.below(2)];
+    }
+    return bot.heading;
+}
+
+// Input timer, once per tick on the reactor thread
+void onInputTimer(int, void* userData)
+{
+    Bot& bot = *static_cast<Bot*>(userData);
+    if (!bot.playing) return;
+
+    Direction dir = nextDirection(bot, bot.shard->options->script);
+    if (dir == Direction::NONE) return;
+
+    uint32_t seq = bot.nextSeq++;
+    bot.sent[seq % bot.sent.size()] = {seq, nowUs()};
+
+    auto input = JsonBuilder()
+        .set("type", "player_input")
+        .set("direction", directionToString(dir))
+        .set("seq", (json_int_t)seq)
+        .build();
+    sendGame(bot, input);
+
+    std::lock_guard<std::mutex> lock(bot.shard->lock);
+    bot.shard->stats.inputsSent++;
+}
+
+// Every input up to `echoed` has been applied by the host
+void recordEcho(Bot& bot, uint32_t echoed, Stats& stats)
+{
+    if (!bot.ownsSeq(echoed) || echoed <= bot.lastEchoed) return;
+
+    uint64_t now = nowUs();
+    uint32_t first = std::max(bot.lastEchoed + 1, bot.seqBase);
+    if (echoed - first >= bot.sent.size()) first = echoed - (uint32_t)bot.sent.size() + 1;
+    for (uint32_t seq = first; seq <= echoed; seq++) {
+        const Bot::Sent& sent = bot.sent[seq % bot.sent.size()];
+        if (sent.seq != seq) continue;
+        stats.latencyUs.push_back((uint32_t)std::min<uint64_t>(now - sent.atUs, UINT32_MAX));
+        stats.inputsAcked++;
+    }
+    bot.lastEchoed = echoed;
+}
+
+void handleGameState(Bot& bot, json_t* data, Stats& stats)
+{
+    stats.gameStates++;
+
+    json_t* binVal = json_object_get(data, "bin");
+    if (!json_is_string(binVal)) {
+        // JSON layout: inputSeq per player
+        size_t index;
+        json_t* playerObj;
+        json_array_foreach(json_object_get(data, "players"), index, playerObj) {
+            recordEcho(bot, (uint32_t)json_integer_value(json_object_get(playerObj, "inputSeq")), stats);
+        }
+        return;
+    }
+
+    stats.binBytes += json_string_length(binVal);
+    if (!bot.history) {
+        bot.history = std::make_unique<WireFormat::SnapshotHistory>();
+    }
+    if (!WireFormat::base64Decode(json_string_value(binVal), json_string_length(binVal), bot.bytes)) {
+        return;
+    }
+    if (bot.bytes.size() > 1 && bot.bytes[1] == WireFormat::DELTA) {
+        stats.deltas++;
+    }
+
+    uint64_t now = nowUs();
+    const uint64_t ackIntervalUs = (uint64_t)Config::Network::STATE_ACK_INTERVAL_MS * 1000;
+    WireFormat::DecodeResult result = WireFormat::decodeSnapshot(bot.bytes.data(), bot.bytes.size(),
+                                                                 *bot.history, bot.snapshot);
+    if (result != WireFormat::DecodeResult::OK) {
+        if (now - bot.lastAckUs >= ackIntervalUs) {
+            sendGame(bot, JsonBuilder().set("type", "state_resync").build());
+            bot.lastAckUs = now;
+            stats.resyncs++;
+        }
+        return;
+    }
+    if (bot.snapshot.seq <= bot.lastAppliedSeq) return;
+
+    bot.history->store(bot.snapshot.seq).copyFrom(bot.snapshot);
+    bot.lastAppliedSeq = bot.snapshot.seq;
+    if (now - bot.lastAckUs >= ackIntervalUs) {
+        sendGame(bot, JsonBuilder().set("type", "state_ack").set("seq", (json_int_t)bot.snapshot.seq).build());
+        bot.lastAckUs = now;
+    }
+
+    for (int p = 0; p < bot.snapshot.playerCount; p++) {
+        recordEcho(bot, bot.snapshot.players[p].inputSeq, stats);
+    }
+}
+
+// Listener, on the shard's reactor thread
+void onBotEvent(const char* event, int64_t, const char*, json_t* data, void* userData)
+{
+    Bot& bot = *static_cast<Bot*>(userData);
+    Stats local;
+    local.messages = 1;
+
+    if (strcmp(event, "game") == 0) {
+        const char* type = json_string_value(json_object_get(data, "type"));
+        if (type && strcmp(type, "game_state") == 0) {
+            handleGameState(bot, data, local);
+        } else if (type && strcmp(type, "state_sync") == 0) {
+            const char* state = json_string_value(json_object_get(data, "gameState"));
+            bool playing = state && strcmp(state, "PLAYING") == 0;
+            if (state && playing != bot.playing) {
+                // Inputs outside a match would only be timed once the next one starts
+                bot.playing = playing;
+                bot.heading = Direction::NONE;
+                bot.lastEchoed = bot.nextSeq - 1;
+            }
+            json_t* arena = json_object_get(data, "arena");
+            if (json_is_object(arena)) {
+                bot.arenaWidth = (int)json_integer_value(json_object_get(arena, "w"));
+                bot.arenaHeight = (int)json_integer_value(json_object_get(arena, "h"));
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(bot.shard->lock);
+    bot.shard->stats.add(local);
+}
+
+// Joins one shard's bots, sessions round-robin in bot order
+void joinBots(Shard& shard, const Options& options, const std::vector<std::string>& sessions)
+{
+    for (auto& botPtr : shard.bots) {
+        Bot& bot = *botPtr;
+        if (stopRequested) return;
+
+        bot.api = mp_api_create_on(shard.reactor, options.host.c_str(), (uint16_t)options.port);
+        if (!bot.api) continue;
+        mp_api_start_sender(bot.api, Config::Network::SEND_QUEUE_MAX_BYTES);
+        mp_api_listen(bot.api, onBotEvent, &bot);
+
+        const std::string& sessionId = sessions[bot.id % sessions.size()];
+        char* session = nullptr;
+        char* clientId = nullptr;
+        int rc = mp_api_join(bot.api, sessionId.c_str(), nullptr, &session, &clientId, nullptr);
+        free(session);
+        free(clientId);
+        if (rc != MP_API_OK) {
+            Logger::warn("Bot ", bot.id, ": join ", sessionId, " failed (", rc, ")");
+            continue;
+        }
+
+        bot.joined = true;
+        bot.timerId = mp_reactor_add_timer(shard.reactor, (uint32_t)(bot.id % options.tickMs),
+                                           (uint32_t)options.tickMs, onInputTimer, &bot);
+    }
+}
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t rank = (size_t)(p * (double)(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void printHeader()
+{
+    std::printf("row,elapsed_s,clients,inputs_sent,inputs_acked,inputs_per_s,"
+                "p50_ms,p99_ms,p999_ms,max_ms,msgs_per_s,game_states_per_s,delta_pct,bin_kb_per_s,resyncs\n");
+}
+
+void printRow(const char* row, double elapsedS, double windowS, int clients, Stats& stats)
+{
+    std::sort(stats.latencyUs.begin(), stats.latencyUs.end());
+    double window = std::max(windowS, 0.001);
+    std::printf("%s,%.1f,%d,%llu,%llu,%.1f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%.1f,%llu\n",
+                row, elapsedS, clients,
+                (unsigned long long)stats.inputsSent, (unsigned long long)stats.inputsAcked,
+                stats.inputsSent / window,
+                percentile(stats.latencyUs, 0.50) / 1000.0,
+                percentile(stats.latencyUs, 0.99) / 1000.0,
+                percentile(stats.latencyUs, 0.999) / 1000.0,
+                (stats.latencyUs.empty() ? 0 : stats.latencyUs.back()) / 1000.0,
+                stats.messages / window, stats.gameStates / window,
+                stats.gameStates ? 100.0 * stats.deltas / stats.gameStates : 0.0,
+                stats.binBytes / 1024.0 / window,
+                (unsigned long long)stats.resyncs);
+    std::fflush(stdout);
+}
+
+void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " (--sessions N | --join ID[,ID...]) [--clients N] [--threads N]\n"
+              << "       [--host HOST] [--port PORT] [--duration S] [--interval S] [--tick-ms MS]\n"
+              << "       [--script UDLR. | --steer random|path] [--seed N] [--arena WIDTHxHEIGHT] [--players N]\n"
+              << "  --sessions hosts N sessions in-process (as HardcoreSnakeServer) for the bots;\n"
+              << "  --join loads existing sessions. --script cycles one direction per tick\n"
+              << "  ('.' = none) instead of random turns; --steer path plays with the pathfinding\n"
+              << "  bots of single player. CSV goes to stdout.\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        const char* arg = argv[i];
+        unsigned long long seed = 0;
+        if (!ok) {
+        } else if (strcmp(arg, "--host") == 0) {
+            options.host = value;
+        } else if (strcmp(arg, "--port") == 0) {
+            ok = sscanf(value, "%d", &options.port) == 1;
+        } else if (strcmp(arg, "--clients") == 0) {
+            ok = sscanf(value, "%d", &options.clients) == 1 && options.clients > 0;
+        } else if (strcmp(arg, "--sessions") == 0) {
+            ok = sscanf(value, "%d", &options.sessions) == 1 && options.sessions > 0;
+        } else if (strcmp(arg, "--join") == 0) {
+            std::string list = value;
+            size_t start = 0;
+            while (start <= list.size()) {
+                size_t comma = list.find(',', start);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > start) options.join.push_back(list.substr(start, comma - start));
+                start = comma + 1;
+            }
+            ok = !options.join.empty();
+        } else if (strcmp(arg, "--threads") == 0) {
+            ok = sscanf(value, "%d", &options.threads) == 1 && options.threads > 0;
+        } else if (strcmp(arg, "--duration") == 0) {
+            ok = sscanf(value, "%d", &options.durationS) == 1 && options.durationS > 0;
+        } else if (strcmp(arg, "--interval") == 0) {
+            ok = sscanf(value, "%d", &options.intervalS) == 1 && options.intervalS > 0;
+        } else if (strcmp(arg, "--tick-ms") == 0) {
+            ok = sscanf(value, "%d", &options.tickMs) == 1 && options.tickMs > 0;
+        } else if (strcmp(arg, "--script") == 0) {
+            options.script = value;
+        } else if (strcmp(arg, "--steer") == 0) {
+            ok = strcmp(value, "random") == 0 || strcmp(value, "path") == 0;
+            options.steerPath = strcmp(value, "path") == 0;
+        } else if (strcmp(arg, "--seed") == 0) {
+            ok = sscanf(value, "%llu", &seed) == 1;
+            options.seed = seed;
+        } else if (strcmp(arg, "--arena") == 0) {
+            ok = sscanf(value, "%dx%d", &options.arena.width, &options.arena.height) == 2;
+        } else if (strcmp(arg, "--players") == 0) {
+            ok = sscanf(value, "%d", &options.arena.maxPlayers) == 1;
+        } else {
+            ok = false;
+        }
+        if (!ok) return false;
+        i++;
+    }
+    // Exactly one source of sessions
+    return (options.sessions > 0) != !options.join.empty();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // The log has the hosts' and API's chatter; stdout stays pure CSV
+    Logger::init("snake_loadgen.log", LogLevel::INFO, false, true);
+    json_object_seed(0);
+    SDL_GetTicks();
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // Hosts first, on their own reactor and pool, so the bots measure them
+    // the way remote clients would
+    MpReactor* hostReactor = nullptr;
+    std::unique_ptr<SessionPool> pool;
+    std::vector<std::string> sessions = options.join;
+    if (options.sessions > 0) {
+        hostReactor = mp_reactor_create(0);
+        if (!hostReactor) {
+            std::cerr << "Failed to start the host reactor\n";
+            return 1;
+        }
+        pool = std::make_unique<SessionPool>(std::min(options.sessions, (int)std::max(1u, std::thread::hardware_concurrency())));
+        for (int i = 0; i < options.sessions; i++) {
+            pool->add(std::make_unique<ServerSession>(i + 1, options.host, options.port, options.arena, hostReactor));
+        }
+        pool->start();
+
+        uint64_t deadline = nowUs() + 10 * 1000000ull;
+        while (!stopRequested && (int)pool->hostedSessions().size() < options.sessions && nowUs() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        sessions = pool->hostedSessions();
+        if (sessions.empty()) {
+            std::cerr << "Could not host any session on " << options.host << ":" << options.port << "\n";
+            pool.reset();
+            mp_reactor_destroy(hostReactor);
+            Logger::shutdown();
+            return 1;
+        }
+        std::sort(sessions.begin(), sessions.end());
+    }
+
+    // Bots round-robin over the reactors; one thread per shard joins them
+    std::vector<std::unique_ptr<Shard>> shards;
+    for (int i = 0; i < std::min(options.threads, options.clients); i++) {
+        auto shard = std::make_unique<Shard>();
+        shard->reactor = mp_reactor_create(0);
+        shard->options = &options;
+        if (!shard->reactor) {
+            std::cerr << "Failed to start a bot reactor\n";
+            return 1;
+        }
+        shards.push_back(std::move(shard));
+    }
+    for (int i = 0; i < options.clients; i++) {
+        Shard* shard = shards[i % shards.size()].get();
+        shard->bots.push_back(std::make_unique<Bot>(i, shard, options.seed, options.arena.clamped()));
+    }
+
+    uint64_t startUs = nowUs();
+    {
+        std::vector<std::thread> joiners;
+        for (auto& shard : shards) {
+            joiners.emplace_back(joinBots, std::ref(*shard), std::cref(options), std::cref(sessions));
+        }
+        for (auto& joiner : joiners) joiner.join();
+    }
+
+    int joined = 0;
+    for (auto& shard : shards) {
+        for (auto& bot : shard->bots) joined += bot->joined ? 1 : 0;
+    }
+    Logger::info("snake_loadgen: ", joined, "/", options.clients, " bots joined ", sessions.size(),
+                 " sessions in ", (nowUs() - startUs) / 1000, " ms");
+
+    printHeader();
+    Stats total;
+    uint64_t runStartUs = nowUs();
+    uint64_t lastReportUs = runStartUs;
+    uint64_t endUs = runStartUs + (uint64_t)options.durationS * 1000000ull;
+    while (!stopRequested && nowUs() < endUs) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uint64_t now = nowUs();
+        if (now - lastReportUs < (uint64_t)options.intervalS * 1000000ull && now < endUs) continue;
+
+        Stats window;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard->lock);
+            window.add(shard->stats);
+            shard->stats = Stats();
+        }
+        printRow("interval", (now - runStartUs) / 1e6, (now - lastReportUs) / 1e6, joined, window);
+        total.add(window);
+        lastReportUs = now;
+    }
+    printRow("total", (lastReportUs - runStartUs) / 1e6, (lastReportUs - runStartUs) / 1e6, joined, total);
+
+    // Timers off before their bots go away
+    for (auto& shard : shards) {
+        for (auto& bot : shard->bots) {
+            if (bot->timerId > 0) mp_reactor_cancel_timer(shard->reactor, bot->timerId);
+        }
+        for (auto& bot : shard->bots) {
+            mp_api_destroy(bot->api);
+        }
+        mp_reactor_destroy(shard->reactor);
+    }
+    pool.reset();
+    if (hostReactor) mp_reactor_destroy(hostReactor);
+    Logger::shutdown();
+    return 0;
+}
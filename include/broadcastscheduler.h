@@ -0,0 +1,94 @@
+#ifndef BROADCASTSCHEDULER_H
+#define BROADCASTSCHEDULER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Host side pacing of game_state. Everything that changes during a tick
+// only marks the scheduler dirty; once the tick is done the network layer
+// asks due() and sends at most one frame carrying all of it, so a tick
+// where several snakes ate still costs a single serialization.
+//
+// The interval between frames adapts to the slowest client: each state_ack
+// names the newest frame the client applied, which gives an RTT sample
+// (ack time minus send time) and the bytes delivered since its previous
+// ack. RTT rising above the client's minimum means frames are queueing on
+// its path, and the interval backs off multiplicatively, at least to what
+// its measured goodput carries; otherwise it recovers by an eighth per ack.
+// A backed-up send queue on the host does the same for the uplink.
+class BroadcastScheduler {
+public:
+    enum Dirty : uint8_t {
+        STATE = 1,   // A tick ran
+        URGENT = 2,  // Food eaten, match start: send this tick whatever the interval
+        PAUSE = 4,   // Pause state changed: sent at once and carried by the next frames
+    };
+
+    // Per-client estimates, for logging
+    struct Link {
+        uint32_t lastAckSeq;    // 0 = no ack yet
+        uint32_t lastAckMs;
+        uint32_t srttMs;        // Smoothed RTT, 0 = no sample yet
+        uint32_t minRttMs;      // Over the last MIN_RTT_WINDOW_MS
+        uint32_t minRttSince;
+        float goodputBytesPerSec;  // Smoothed, 0 = unknown
+        uint32_t intervalMs;    // What this client can take
+    };
+
+    BroadcastScheduler();
+
+    // New connection or match: forget frames and links
+    void reset();
+
+    void mark(uint8_t flags) { dirty |= flags; }
+
+    // End of a host tick: true if the merged frame should go out now.
+    // sendQueueDepth is the connection's queued outgoing frames.
+    bool due(uint32_t nowMs, size_t sendQueueDepth);
+
+    // The frame went out as `seq`, `bytes` long (0 if unknown). Clears the
+    // dirty flags.
+    void sent(uint32_t seq, size_t bytes, uint32_t nowMs);
+
+    // The frame being built carries the pause fields: the state changed
+    // since the last frame or within the few before it (so a frame replaced
+    // in the send queue can't lose it). Frames sent while paused carry them
+    // anyway.
+    bool carriesPause() const { return (dirty & PAUSE) || pauseFramesLeft > 0; }
+    bool pausePending() const { return (dirty & PAUSE) != 0; }
+
+    // Host got state_ack `seq` from the client in `slot`
+    void onAck(int slot, uint32_t seq, uint32_t nowMs);
+    void removeClient(int slot);  // Left, or the slot is reused
+
+    uint32_t intervalMs() const;  // Current frame interval, 0 = every tick
+    bool framesFlowing(uint32_t nowMs) const;  // A frame went out within the last second
+    const std::vector<Link>& links() const { return clients; }
+
+private:
+    static constexpr uint32_t FRAME_HISTORY = 64;  // Power of two
+    static constexpr int PAUSE_REPEAT_FRAMES = 3;
+
+    struct Frame {
+        uint32_t seq;
+        uint32_t sentMs;
+        uint64_t bytesThrough;  // Bytes sent up to and including this frame
+    };
+
+    const Frame* findFrame(uint32_t seq) const;
+    uint32_t nextInterval(uint32_t current, bool congested, float goodputBytesPerSec) const;
+
+    uint8_t dirty;
+    int pauseFramesLeft;
+    uint32_t lastSentMs;
+    bool anySent;
+    uint64_t bytesSent;
+    float avgFrameBytes;  // Smoothed, of frames with a known size
+    uint32_t uplinkIntervalMs;  // Backoff for the host's own send queue
+    std::array<Frame, FRAME_HISTORY> frames;
+    std::vector<Link> clients;  // By player slot
+};
+
+#endif // BROADCASTSCHEDULER_H
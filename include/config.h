@@ -20,8 +20,15 @@ namespace Window {
 
 namespace Grid {
     constexpr int CELL_SIZE = 20;
-    constexpr int WIDTH = Window::WIDTH / CELL_SIZE;   // 40 cells
+    constexpr int WIDTH = Window::WIDTH / CELL_SIZE;   // 40 cells (default arena)
     constexpr int HEIGHT = Window::HEIGHT / CELL_SIZE; // 30 cells
+    
+    // Arena size is chosen per session by the host (--arena WxH); cells
+    // shrink to fit the window, down to 2 px at the maximum
+    constexpr int MIN_WIDTH = 10;
+    constexpr int MIN_HEIGHT = 10;
+    constexpr int MAX_WIDTH = Window::WIDTH / 2;       // 400 cells
+    constexpr int MAX_HEIGHT = Window::HEIGHT / 2;     // 300 cells
 }
 
 // ============================================================
@@ -30,8 +37,33 @@ namespace Grid {
 namespace Game {
     constexpr int INITIAL_SPEED_MS = 100;           // Snake update interval
     constexpr int MATCH_DURATION_SECONDS = 120;     // 2 minutes per match
-    constexpr int MAX_FOOD_SPAWN_ATTEMPTS = 1000;   // Max attempts to find empty cell
-    constexpr int MAX_PLAYERS = 4;                  // Maximum players in multiplayer
+    constexpr int DEFAULT_PLAYERS = 4;              // Player capacity unless the host picks one (--players N)
+    constexpr int PLAYER_LIMIT = 64;                // Upper bound for --players (one byte per cell owner)
+    constexpr int MAX_TICKS_PER_FRAME = 5;          // Catch-up limit after a stall
+}
+
+// ============================================================
+// MATCH REPLAYS (replay.h)
+// ============================================================
+// Every match played alone or hosted is recorded to replay_<date>.hsr in
+// the working directory; play one back with --replay FILE
+namespace Replay {
+    // Recording is opt-in (--record): files go to the working directory
+    constexpr const char* FILE_PATTERN = "replay_%Y%m%d_%H%M%S.hsr";  // strftime
+    constexpr uint32_t KEYFRAME_INTERVAL_TICKS = 100;  // Seek granularity (10 s at INITIAL_SPEED_MS)
+    constexpr int FLUSH_INTERVAL_MS = 250;             // Background writer batch period
+    constexpr int MAX_SPEED = 256;                     // Playback multiple of real time
+    constexpr int SEEK_SECONDS = 10;                   // Left/right arrow step
+}
+
+// ============================================================
+// COMPUTER PLAYERS (snakebot.h)
+// ============================================================
+// Fill single player slots with --bots N; snake_loadgen --steer path uses
+// the same pathfinder for its clients
+namespace Bots {
+    constexpr const char* CLIENT_ID_PREFIX = "bot_";   // Slots whose clientId starts with it are steered
+    constexpr int SEARCH_DEPTH = 40;                   // BFS layers explored per candidate move
 }
 
 // ============================================================
@@ -42,24 +74,128 @@ namespace Network {
     constexpr Uint32 CONNECTION_TIMEOUT_WARNING_MS = 15000; // Show warning after 15s
     constexpr Uint32 CONNECTION_TIMEOUT_DISCONNECT_MS = 30000; // Disconnect after 30s
     
+    // Send game_state as a packed base64 snapshot instead of per-segment JSON
+    constexpr bool BINARY_GAME_STATE = true;
+    
+    // Clients ack applied snapshots at most this often; the host sends
+    // game_state as a delta against the oldest acked snapshot
+    constexpr Uint32 STATE_ACK_INTERVAL_MS = 250;
+    
+    // Clients move their own snake ahead of the host and replay inputs the
+    // host hasn't applied yet onto each game_state; beyond MAX_PREDICTION_TICKS
+    // of lead the authoritative body is used as-is
+    constexpr bool CLIENT_PREDICTION = true;
+    constexpr int MAX_PREDICTION_TICKS = 32;
+    
+    // Clients draw remote snakes this far behind the newest game_state,
+    // walking them cell by cell between snapshots; with no newer snapshot
+    // they keep moving along their heading for at most MAX_EXTRAPOLATION_MS
+    constexpr Uint32 INTERPOLATION_DELAY_MS = 150;
+    constexpr Uint32 MAX_EXTRAPOLATION_MS = 150;
+    
+    // Lockstep: instead of game_state the host sends each tick's inputs and
+    // every peer simulates the match. Clients compare the host's state hash
+    // every LOCKSTEP_HASH_INTERVAL ticks and ask for a full resync on mismatch
+    constexpr bool LOCKSTEP = false;
+    constexpr uint32_t LOCKSTEP_HASH_INTERVAL = 20;
+    constexpr uint32_t LOCKSTEP_BUFFER_TICKS = 2;  // Clients catch up beyond this backlog
+    constexpr Uint32 LOCKSTEP_RESYNC_INTERVAL_MS = 1000;
+    
+    // Host game_state pacing (broadcastscheduler.h): one frame per tick at
+    // most, spaced further apart while a client's RTT sits more than
+    // BROADCAST_QUEUE_DELAY_MS above its minimum (or the send queue backs
+    // up), recovering an eighth (at least BROADCAST_RECOVERY_MS) per
+    // uncongested ack
+    constexpr Uint32 BROADCAST_MAX_INTERVAL_MS = 500;
+    constexpr Uint32 BROADCAST_QUEUE_DELAY_MS = 80;
+    constexpr Uint32 BROADCAST_RECOVERY_MS = 10;
+    constexpr Uint32 BROADCAST_MIN_RTT_WINDOW_MS = 10000;
+    
+    // Host state_sync (host, arena, roster): every STATE_SYNC_INTERVAL_MS,
+    // stretched to STATE_SYNC_MATCH_INTERVAL_MS while game_state frames
+    // carry the match clock and pause state
+    constexpr Uint32 STATE_SYNC_INTERVAL_MS = 1000;
+    constexpr Uint32 STATE_SYNC_MATCH_INTERVAL_MS = 5000;
+    
+    // Session resumption: a client whose connection drops reconnects and
+    // rejoins its session for up to RESUME_TIMEOUT_MS (0 = back to the menu
+    // at once); during a match peers hold a dropped player's snake, frozen,
+    // RESUME_GRACE_MS for it. Leaving on purpose sends "leave" instead.
+    constexpr Uint32 RESUME_TIMEOUT_MS = 10000;
+    constexpr Uint32 RESUME_GRACE_MS = 15000;
+    constexpr Uint32 LEAVE_FLUSH_MS = 250;  // Wait for "leave" to go out before closing
+    
+    // Resolve and connect to DEFAULT_HOST in the background at launch (and
+    // again back in the menu), so choosing Multiplayer finds a socket ready
+    constexpr bool PRECONNECT = true;
+    
+    // Session browser: the cached list is shown at once and refreshed in
+    // the background this often while the browser is open
+    constexpr Uint32 SESSION_LIST_REFRESH_MS = 5000;
+    
+    // Outgoing bytes queued per connection before sends fail
+    constexpr size_t SEND_QUEUE_MAX_BYTES = 256 * 1024;
+    
+    // Telemetry: clients ping the host through the relay for an RTT
+    // estimate; rates are sampled every TELEMETRY_SAMPLE_MS and logged
+    // every TELEMETRY_LOG_INTERVAL_MS (0 = never)
+    constexpr Uint32 PING_INTERVAL_MS = 1000;
+    constexpr Uint32 TELEMETRY_SAMPLE_MS = 1000;
+    constexpr Uint32 TELEMETRY_LOG_INTERVAL_MS = 10000;
+    
     // Default server
     constexpr const char* DEFAULT_HOST = "kontoret.onvo.se";
     constexpr int DEFAULT_PORT = 9001;
 }
 
+// ============================================================
+// DEDICATED SERVER (HardcoreSnakeServer)
+// ============================================================
+namespace Server {
+    constexpr int DEFAULT_SESSIONS = 8;             // Sessions hosted unless --sessions N
+    constexpr int MIN_PLAYERS = 2;                  // Players needed before a match starts
+    constexpr Uint32 LOBBY_START_DELAY_MS = 5000;   // Grace period for late joiners once MIN_PLAYERS are in
+    constexpr Uint32 RESULTS_MS = 10000;            // MATCH_END shown before the next lobby
+    constexpr Uint32 REOPEN_DELAY_MS = 5000;        // Retry hosting after a lost or refused connection
+    constexpr Uint32 POLL_INTERVAL_MS = 5;          // Message polling between ticks
+    constexpr Uint32 STATUS_INTERVAL_MS = 10000;    // Status line in the log
+}
+
+// ============================================================
+// LOAD GENERATOR (snake_loadgen)
+// ============================================================
+namespace LoadGen {
+    constexpr int DEFAULT_CLIENTS = 16;
+    constexpr int DEFAULT_DURATION_S = 60;
+    constexpr int REPORT_INTERVAL_S = 5;            // One CSV row per interval
+    constexpr uint32_t SEQ_SPACE_BITS = 20;         // Bot i sends inputs (i + 1) << 20 onwards
+    constexpr uint32_t INFLIGHT_INPUTS = 64;        // Sent inputs timed until a game_state echoes them
+}
+
 // ============================================================
 // RENDERING
 // ============================================================
+// Main loop profiler (profiler.h, built in unless FRAME_PROFILER=0): F4
+// shows the overlay, the summary and trace are written on exit
+namespace Profiler {
+    constexpr const char* CSV_FILE = "hardcoresnake_profile.csv";
+    constexpr const char* TRACE_FILE = "hardcoresnake_trace.json";  // chrome://tracing
+}
+
 namespace Render {
-    constexpr int TARGET_FPS = 60;
-    constexpr int FRAME_DELAY_MS = 1000 / TARGET_FPS;
+    constexpr int TARGET_FPS = 60;                  // Frame cap, 0 = uncapped (vsync only)
+    constexpr int FRAME_DELAY_MS = TARGET_FPS > 0 ? 1000 / TARGET_FPS : 0;
+    constexpr bool VSYNC = true;                    // Request SDL_RENDERER_PRESENTVSYNC
+    constexpr Uint32 IDLE_WAIT_MS = 50;             // Max event wait in menu/lobby states
+    constexpr size_t TEXT_CACHE_ENTRIES = 256;      // Whole-string textures kept without a glyph atlas
     
     // Grid colors
     constexpr SDL_Color GRID_LINE_COLOR = {50, 50, 50, 255};
     constexpr SDL_Color BACKGROUND_COLOR = {0, 0, 0, 255};
     
-    // Player colors (4 players)
-    constexpr SDL_Color PLAYER_COLORS[Config::Game::MAX_PLAYERS] = {
+    // First player colors; further players get generated hues (playerColor())
+    constexpr int PLAYER_COLOR_COUNT = 4;
+    constexpr SDL_Color PLAYER_COLORS[PLAYER_COLOR_COUNT] = {
         {0, 255, 0, 255},    // Player 1: Green
         {0, 0, 255, 255},    // Player 2: Blue
         {255, 255, 0, 255},  // Player 3: Yellow
@@ -0,0 +1,170 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "hardcoresnake.h"
+#include "occupancygrid.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Millisecond time source of the simulation. The game passes SDL_GetTicks;
+// headless runs and benchmarks pass a clock they advance themselves.
+using EngineClock = std::function<uint32_t()>;
+
+// Match timing and state management
+struct MatchState {
+    Uint32 matchStartTime;  // When match started (synced from host)
+    Uint32 syncedElapsedMs;  // Authoritative elapsed time from host
+    Uint32 totalPausedTime;  // Total accumulated time paused (milliseconds)
+    Uint32 pauseStartTime;  // When current pause started (0 if not paused)
+    int winnerIndex;  // Index of match winner, -1 if no winner
+    std::string pausedByClientId;  // ClientId of player who paused, empty if not paused
+    
+    MatchState() : matchStartTime(0), syncedElapsedMs(0), totalPausedTime(0), 
+                   pauseStartTime(0), winnerIndex(-1) {}
+    
+    bool isPaused() const { return !pausedByClientId.empty(); }
+};
+
+// Board size and player capacity of a session. The host picks them and
+// sends them with state_sync; clients resize to match.
+struct ArenaSettings {
+    int width = Config::Grid::WIDTH;
+    int height = Config::Grid::HEIGHT;
+    int maxPlayers = Config::Game::DEFAULT_PLAYERS;
+    
+    // Values outside the Config limits are clamped
+    ArenaSettings clamped() const;
+    
+    bool operator==(const ArenaSettings& o) const {
+        return width == o.width && height == o.height && maxPlayers == o.maxPlayers;
+    }
+    bool operator!=(const ArenaSettings& o) const { return !(*this == o); }
+};
+
+// Player management with proper encapsulation. Slots are looked up by
+// clientId through a hash index, and per-player loops walk activeIndices()
+// instead of every slot. Occupy and release slots through activate() and
+// deactivate() so both stay in sync with PlayerSlot::active.
+class PlayerManager {
+private:
+    std::vector<PlayerSlot> slots;
+    std::vector<int> activeSlots;  // Ascending, so every peer loops in the same order
+    std::unordered_map<std::string, int> slotByClientId;
+    int myIndex;
+    
+public:
+    explicit PlayerManager(int capacity = Config::Game::DEFAULT_PLAYERS) : myIndex(-1) {
+        resize(capacity);
+    }
+    
+    // Change the slot count; players in slots beyond it are deactivated
+    void resize(int capacity);
+    int capacity() const { return (int)slots.size(); }
+    
+    // Array-style access
+    PlayerSlot& operator[](int i) { return slots[i]; }
+    const PlayerSlot& operator[](int i) const { return slots[i]; }
+    
+    // Direct access to the slot array (occupancy rebuilds)
+    std::vector<PlayerSlot>& getSlots() { return slots; }
+    const std::vector<PlayerSlot>& getSlots() const { return slots; }
+    
+    // Convenience accessors for "my player"
+    PlayerSlot& me() { return slots[myIndex]; }
+    const PlayerSlot& me() const { return slots[myIndex]; }
+    int myPlayerIndex() const { return myIndex; }
+    void setMyPlayerIndex(int i) { myIndex = i; }
+    bool hasMe() const { return myIndex >= 0; }
+    
+    // Validation
+    bool isValid(int i) const { 
+        return i >= 0 && i < capacity() && slots[i].active && slots[i].snake; 
+    }
+    
+    // Slot occupancy. activate() leaves the snake to the caller;
+    // deactivate() drops it along with the slot's per-client state.
+    void activate(int i, const std::string& clientId);
+    void deactivate(int i);
+    void clear();  // Deactivate everyone, forget my index
+    int firstFreeSlot() const;  // -1 when full
+    
+    // Search operations
+    int findByClientId(const std::string& id) const {
+        auto it = slotByClientId.find(id);
+        return it != slotByClientId.end() ? it->second : -1;
+    }
+    
+    // Indices of active slots in ascending order
+    const std::vector<int>& activeIndices() const { return activeSlots; }
+    
+    // Iteration support (allows range-based for loops)
+    auto begin() { return slots.begin(); }
+    auto end() { return slots.end(); }
+    auto begin() const { return slots.begin(); }
+    auto end() const { return slots.end(); }
+    
+    // Utility
+    int activeCount() const { return (int)activeSlots.size(); }
+};
+
+// Resize the board and the slot array to `arena`. Snakes that no longer
+// fit are respawned and the occupancy grid is rebuilt.
+void applyArena(const ArenaSettings& arena, PlayerManager& players, OccupancyGrid& occupancy);
+
+// Game rules without rendering, networking or SDL calls: snake movement,
+// collisions, food, respawns and the match clock, over state owned by the
+// caller. Game drives it on its fixed timestep; the network layer decides
+// whether a peer runs it (host, lockstep) or follows game_state instead.
+class SnakeEngine {
+public:
+    SnakeEngine(PlayerManager& players, OccupancyGrid& occupancy, MatchState& match,
+                Food& food, EngineClock clock);
+
+    uint32_t now() const { return clock(); }
+
+    // A snake ate during tick() (the host pushes game_state immediately)
+    std::function<void()> onFoodEaten;
+
+    // One tick: move every live snake, resolve wall, body and head-on
+    // collisions against the grid as it was before the move, then eat and
+    // respawn. The occupancy grid is updated incrementally.
+    void tick();
+
+    void respawnPlayer(int playerIndex);
+    Position randomSpawnPosition() const;
+    void rebuildOccupancy();  // Full rebuild, only needed after bulk changes
+
+    // Everyone respawns with score 0, new food, match clock restarted
+    void resetMatch();
+
+    // Match time minus pauses (including a running one), kept in
+    // match.syncedElapsedMs
+    uint32_t updateMatchTime(bool paused);
+    bool matchTimeUp() const;
+
+    // Longest snake wins, ties go to the higher score; -1 without players.
+    // Also stored in match.winnerIndex.
+    int decideWinner();
+
+private:
+    struct MoveInfo {
+        Position oldHead;
+        Position oldTail;   
+        Position newHead;
+        bool willGrow;
+        bool collision;
+        bool processed;
+    };
+    
+    PlayerManager& players;
+    OccupancyGrid& occupancy;
+    MatchState& match;
+    Food& food;
+    EngineClock clock;
+    std::vector<MoveInfo> moves;  // Per slot, reused across ticks
+};
+
+#endif // ENGINE_H
@@ -3,10 +3,11 @@
 #include "hardcoresnake.h"
 #include "rendermenu.h"
 #include "multiplayer.h"
+#include "replay.h"
+#include "snakebot.h"
 #include "logger.h"
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
-#include <unordered_map>
 
 enum class GameState {
     MENU,
@@ -36,15 +37,24 @@ inline const char* gameStateToString(GameState state) {
 class Game {
     public:
 
-        Game();
+        // `bots` computer players join every single player match; `record`
+        // saves each match played alone or hosted as a replay
+        explicit Game(const ArenaSettings& arena = ArenaSettings(), int bots = 0, bool record = false);
         ~Game();
         void run();
+        
+        // Plays a recorded match instead of the menus, `speed` times real
+        // time; false if the file can't be loaded
+        bool playReplay(const std::string& path, int speed);
 
 
     private:
 
         void handleInput();
+        void handleEvent(const SDL_Event& e);
+        bool isIdleState() const;
         void update();
+        void restartTickClock();
         void render();
         void changeState(GameState newState);
         void changeState(GameState newState, bool fromNetwork);
@@ -54,28 +64,48 @@ class Game {
         
         void handleMenuInput(SDL_Keycode key);
         void handleMultiplayerInput(SDL_Keycode key);
+        void refreshSessionList();  // Background list request
+        const char* sessionBrowserStatus() const;  // Running request, nullptr if none
         void handleLobbyInput(SDL_Keycode key);
         void handlePlayingInput(SDL_Keycode key);
         void handlePausedInput(SDL_Keycode key);
         void handleMatchEndInput(SDL_Keycode key);
+        void handleReplayInput(SDL_Keycode key);
         
         void checkMatchTimer(Uint32 currentTime);
         void updatePlayers();
-        void respawnPlayer(int playerIndex);
         void resetMatch();
+        void startRecording();  // Single player and hosting only
+        void updateReplay();
+        void renderReplay();
         // Helpers
         void navigateMenu(int& selection, int maxItems, bool up);
-        Position getRandomSpawnPosition();
-        void buildCollisionMap();
         void resetGameState();
 
 private:
 
+    ArenaSettings localArena;  // Command line choice, used when hosting or playing alone
+    int botCount;  // --bots: computer players in single player
+    bool recordMatches;  // --record: write a replay of each match
     GameContext ctx;
     std::unique_ptr<MenuRender> ui;
     std::unique_ptr<NetworkManager> networkManager;
     Food food;
-    std::unordered_map<int, bool> occupiedPositions;
+    SnakeEngine engine;  // Tick rules over ctx and food
+    Replay::Recorder recorder;  // The match being played, while recording
+    SnakeBot bots;  // Steers the bot slots before each local tick
+    
+    // --replay: a recorded match drives ctx instead of the menus
+    struct ReplayPlayback {
+        Replay::File file;
+        Replay::Player player;
+        int speed;
+        bool paused;
+        
+        explicit ReplayPlayback(const Replay::MatchView& view) : player(view), speed(1), paused(false) {}
+    };
+    std::unique_ptr<ReplayPlayback> replay;
+    
     GameState state;
 
     bool quit;
@@ -85,6 +115,15 @@ private:
     int pauseMenuSelection;
     int sessionSelection;
     Uint32 countdownStartTime;
+    Uint32 tickAccumulator;  // Real time not yet consumed by simulation ticks (ms)
+    float renderAlpha;  // Progress into the next tick [0,1), for interpolation
+    bool showNetStats;  // F3: network telemetry overlay
+    bool showProfiler;  // F4: frame profiler overlay
+    
+    // Startup timings, logged from render() (SDL_GetTicks)
+    Uint32 launchTime;
+    bool firstFramePresented;
+    bool startupLogged;
 
     void (Game::*inputHandler)(SDL_Keycode);
 
@@ -0,0 +1,55 @@
+#ifndef GAMEMESSAGE_H
+#define GAMEMESSAGE_H
+
+#include "hardcoresnake.h"
+#include "wireformat.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Typed decoding of the hot game messages straight from the received line,
+// {"cmd":"game","clientId":..,"messageId":..,"data":{"type":..,...}}, on
+// jansson's streaming parser: no json_t tree and no key lookups, each field
+// lands in preallocated storage as it is read. Keys may come in any order
+// and unknown ones are skipped. Storage is reused, so once warmed up a
+// decode doesn't allocate.
+namespace GameMessage {
+
+enum class Type { OTHER, GAME_STATE, PLAYER_INPUT };
+
+struct Decoded {
+    Type type;
+    std::string clientId;  // Envelope: sender, empty if absent
+    int64_t messageId;
+
+    // game_state: "bin" is base64-decoded while parsing; without it the
+    // per-segment JSON layout went into the caller's snapshot
+    bool hasBin;
+    bool binValid;  // Valid base64
+    std::vector<uint8_t> bin;
+    bool hasFood;  // foodX and foodY both given (JSON layout)
+
+    // game_state: host pause state riding on the frame ("pausedBy" given,
+    // empty when running)
+    bool hasPause;
+    std::string pausedBy;
+    uint32_t totalPausedTime;
+    uint32_t pauseStartTime;
+
+    // player_input
+    bool hasDirection;
+    Direction direction;
+    int64_t inputSeq;  // 0 if absent
+
+    Decoded();
+};
+
+// Decodes one line into out, and a JSON-layout game_state into snapshot
+// (which is scratch: any line resets its counts and times). False if the
+// line isn't a well-formed JSON object.
+bool decode(const char* line, size_t len, Decoded& out, WireFormat::StateSnapshot& snapshot);
+
+} // namespace GameMessage
+
+#endif // GAMEMESSAGE_H
@@ -0,0 +1,41 @@
+#ifndef GAMERNG_H
+#define GAMERNG_H
+
+#include <cstdint>
+
+// Small seeded PRNG (xorshift64*) for food and spawn placement. Unlike
+// std::rand its sequence is the same on every platform and its whole state
+// is one integer, so lockstep peers can be put on the same stream.
+class GameRng {
+public:
+    explicit GameRng(uint64_t seedValue = 0x9E3779B97F4A7C15ull) { seed(seedValue); }
+
+    void seed(uint64_t seedValue) {
+        // SplitMix64 scramble so small or similar seeds still diverge; never 0
+        uint64_t z = seedValue + 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        state = z ? z : 1;
+    }
+
+    uint64_t getState() const { return state; }
+    void setState(uint64_t s) { state = s ? s : 1; }
+
+    uint32_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1Dull) >> 32);
+    }
+
+    // Uniform-enough value in [0, n), n > 0
+    uint32_t below(uint32_t n) {
+        return (uint32_t)(((uint64_t)next() * n) >> 32);
+    }
+
+private:
+    uint64_t state;
+};
+
+#endif // GAMERNG_H
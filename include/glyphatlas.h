@@ -0,0 +1,59 @@
+#ifndef GLYPHATLAS_H
+#define GLYPHATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <vector>
+
+// Printable ASCII of one font rasterized once into a single white texture.
+// Strings are drawn as textured quads tinted per call, so dynamic text costs
+// no surface or texture creation. Characters outside the range draw as '?'.
+class GlyphAtlas {
+public:
+    static constexpr int FIRST_CHAR = 32;
+    static constexpr int LAST_CHAR = 126;
+    static constexpr int SHEET_WIDTH = 512;
+
+    GlyphAtlas();
+    ~GlyphAtlas();
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    // Rasterize the font; false leaves the atlas unusable (ready() == false)
+    bool build(SDL_Renderer* renderer, TTF_Font* font);
+    void release();
+
+    // build() in two halves: rasterize() touches no renderer, so it can run
+    // on a loader thread while the atlas is unused; upload() then creates
+    // the texture on the render thread
+    bool rasterize(TTF_Font* font);
+    bool upload(SDL_Renderer* renderer);
+
+    bool ready() const { return texture != nullptr; }
+    int lineHeight() const { return height; }
+
+    // Pen advance sum, in pixels
+    int measure(const char* text) const;
+    void draw(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color);
+
+private:
+    struct Glyph {
+        SDL_Rect src;  // Location in the sheet, pen origin at src.x/src.y
+        int advance;
+    };
+
+    const Glyph& glyphFor(char c) const;
+
+    SDL_Texture* texture;
+    SDL_Surface* sheet;  // Rasterized, not uploaded yet
+    int sheetHeight;
+    int height;
+    Glyph glyphs[LAST_CHAR - FIRST_CHAR + 1];
+
+    // Reused per draw() call
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif // GLYPHATLAS_H
@@ -2,14 +2,13 @@
 #define HARDCORESNAKE_H
 
 #include "config.h"
-#include <SDL2/SDL_ttf.h>
+#include "snakebody.h"
+#include "remotetrack.h"
 #include <cstdlib>
 #include <ctime>
 #include <algorithm>
 #include <iostream>
-#include <deque>
 #include <memory>
-#include <unordered_map>
 
 enum class Direction {
     UP,
@@ -23,27 +22,26 @@ enum class Direction {
 const char* directionToString(Direction dir);
 Direction stringToDirection(const char* str);
 
-struct Position {
-    int x;
-    int y;
-    
-    bool operator==(const Position& other) const {
-        return x == other.x && y == other.y;
-    }
-};
+class OccupancyGrid;
 
 // Utility function to generate random spawn positions
-Position getRandomSpawnPositionUtil(const std::unordered_map<int, bool>& occupiedPositions);
+Position getRandomSpawnPositionUtil(const OccupancyGrid& occupancy);
+
+// Snake color of a player slot: Config::Render::PLAYER_COLORS first, then
+// hues spread by the golden angle so large arenas stay distinguishable
+SDL_Color playerColor(int playerIndex);
 
 
 class Snake {
 private:
-    std::deque<Position> body;
+    SnakeBody body;
     Direction direction;
     Direction nextDirection;
     SDL_Color color;
     bool alive;
     int score;
+    Position prevTail;  // Tail cell vacated by the last update()
+    bool moved;         // Last update() advanced the snake (prevTail is valid)
 
 public:
     Snake(SDL_Color snakeColor, Position startPos);
@@ -53,10 +51,24 @@ public:
     void grow();
     void reset(const Position& startPos);
 
-    void setBody(const std::deque<Position>& newBody);
-    const std::deque<Position>& getBody() const { return body; }
+    void setBody(const Position* segments, size_t count);
+    const SnakeBody& getBody() const { return body; }
 
     Position getHead() const { return body.front(); }
+    
+    // Where update() would put the head (the head itself if not moving)
+    Position peekNextHead() const;
+    
+    // Current and queued direction, bypassing setDirection's rules
+    // (used to restore the host's snake state before replaying inputs)
+    Direction getDirection() const { return direction; }
+    Direction getNextDirection() const { return nextDirection; }
+    void setHeading(Direction current, Direction next) { direction = current; nextDirection = next; }
+    
+    // Render interpolation: the head slides from getBody()[1] to the head,
+    // the tail from getPrevTail() to the tail
+    bool hasMoved() const { return moved; }
+    Position getPrevTail() const { return prevTail; }
     SDL_Color getColor() const { return color; }
 
     bool isAlive() const { return alive; }
@@ -71,6 +83,12 @@ struct PlayerSlot {
     bool active;
     bool paused;
     Uint32 lastMpSent;
+    uint32_t ackedSnapshot;  // Host: newest game_state seq this client applied (0 = none)
+    uint32_t lastInputSeq;   // Host: newest player_input seq applied (0 = none)
+    uint8_t inputAge;        // Host: ticks simulated since lastInputSeq was applied
+    Uint32 disconnectedAt;   // Left the session, slot held for a resume (0 = connected)
+    std::string resumeKey;   // Host: SHA-256 of the client's resume token (empty = may not resume)
+    RemoteTrack remote;      // Client: buffered bodies of a remote snake, for smooth rendering
 };
 
 class Food {
@@ -80,7 +98,7 @@ private:
     
 public:
     Food();
-    void spawn(const std::unordered_map<int, bool>& occupiedPositions);
+    void spawn(const OccupancyGrid& occupancy);
     void setPosition(const Position& newPos) { pos = newPos; }
     Position getPosition() const { return pos; }
     SDL_Color getColor() const { return color; }
@@ -0,0 +1,72 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "hardcoresnake.h"
+#include <array>
+#include <cstdint>
+#include <string>
+
+struct GameContext;
+
+// Lockstep netcode: every peer runs the full simulation and only the
+// directions applied before each tick travel over the network. The host
+// numbers the ticks and publishes one bundle per tick; clients simulate a
+// tick once its bundle has arrived.
+namespace Lockstep {
+
+constexpr int MAX_INPUTS_PER_TICK = Config::Game::PLAYER_LIMIT;  // Host ignores further inputs until the next tick
+constexpr uint32_t QUEUE_CAPACITY = 256;  // Client: buffered ticks, power of two
+
+struct Input {
+    uint8_t player;
+    Direction dir;
+};
+
+// Inputs applied, in order, before simulating `tick`. hasHash marks the
+// ticks that also carry the host's state hash at the start of the tick.
+struct TickBundle {
+    uint32_t tick;
+    bool hasHash;
+    uint32_t hash;
+    int count;
+    std::array<Input, MAX_INPUTS_PER_TICK> inputs;
+
+    void clear(uint32_t t) { tick = t; hasHash = false; hash = 0; count = 0; }
+};
+
+// Client: bundles received but not simulated yet, in tick order
+class BundleQueue {
+public:
+    BundleQueue() : head(0), tail(0) {}
+
+    void clear() { head = tail = 0; }
+    uint32_t size() const { return tail - head; }
+    bool empty() const { return head == tail; }
+
+    bool push(const TickBundle& bundle) {
+        if (size() == QUEUE_CAPACITY) return false;
+        slots[tail++ & (QUEUE_CAPACITY - 1)] = bundle;
+        return true;
+    }
+    const TickBundle& front() const { return slots[head & (QUEUE_CAPACITY - 1)]; }
+    void pop() { head++; }
+
+private:
+    std::array<TickBundle, QUEUE_CAPACITY> slots;
+    uint32_t head;
+    uint32_t tail;
+};
+
+// Inputs as "<player><U|D|L|R>" pairs, e.g. "0L2U". Players are one
+// character of 0-9A-Za-z+/, so slots 0-9 encode as digits. Decoding rejects
+// anything else.
+void encodeInputs(const TickBundle& bundle, std::string& out);
+bool decodeInputs(const char* text, TickBundle& bundle);
+
+// FNV-1a over everything the simulation depends on: tick, rng state, food
+// and each active snake's body, heading, score and alive flag
+uint32_t stateHash(const GameContext& ctx, uint32_t tick);
+
+} // namespace Lockstep
+
+#endif // LOCKSTEP_H
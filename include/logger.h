@@ -1,11 +1,13 @@
 #pragma once
 
-#include <iostream>
-#include <fstream>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
 #include <sstream>
-#include <mutex>
-#include <chrono>
-#include <iomanip>
+#include <charconv>
+#include <type_traits>
 
 enum class LogLevel {
     DEBUG = 0,
@@ -15,121 +17,130 @@ enum class LogLevel {
     FATAL = 4
 };
 
+// Calls below this level compile to nothing. Release (NDEBUG) builds drop
+// Logger::debug; override with -DLOGGER_MIN_LEVEL=<0..4>.
+#ifndef LOGGER_MIN_LEVEL
+#ifdef NDEBUG
+#define LOGGER_MIN_LEVEL 1
+#else
+#define LOGGER_MIN_LEVEL 0
+#endif
+#endif
+
 class Logger {
+public:
+    static constexpr LogLevel compileMinLevel = static_cast<LogLevel>(LOGGER_MIN_LEVEL);
+    static constexpr size_t MESSAGE_MAX = 240;     // Async mode truncates longer messages
+    static constexpr size_t RING_CAPACITY = 1024;  // Async mode, power of two
+    static constexpr int FLUSH_INTERVAL_MS = 100;  // Async writer batch period
+
+    // Message text, formatted on the calling thread. Bounded (async ring)
+    // lines never allocate and are cut at MESSAGE_MAX; sync lines carry
+    // the rest in `spill`.
+    struct LineBuffer {
+        char data[MESSAGE_MAX];
+        size_t len = 0;
+        bool truncated = false;
+        bool bounded = true;
+        std::string spill;  // Text past MESSAGE_MAX, unbounded only
+
+        void append(const char* s, size_t n) {
+            size_t room = MESSAGE_MAX - len;
+            if (n > room) {
+                if (bounded) truncated = true;
+                else spill.append(s + room, n - room);
+                n = room;
+            }
+            memcpy(data + len, s, n);
+            len += n;
+        }
+    };
+
 private:
     static LogLevel minLevel;
-    static std::ofstream logFile;
-    static std::mutex logMutex;
-    static bool consoleOutput;
-    
-    static const char* levelToString(LogLevel level) {
-        switch (level) {
-            case LogLevel::DEBUG: return "DEBUG";
-            case LogLevel::INFO:  return "INFO ";
-            case LogLevel::WARN:  return "WARN ";
-            case LogLevel::ERROR: return "ERROR";
-            case LogLevel::FATAL: return "FATAL";
-            default: return "UNKNOWN";
-        }
-    }
-    
+
     template<typename T>
-    static void writeToStream(std::ostream& stream, T&& arg) {
-        stream << std::forward<T>(arg);
-    }
-    
-    template<typename T, typename... Args>
-    static void writeToStream(std::ostream& stream, T&& arg, Args&&... args) {
-        stream << std::forward<T>(arg);
-        writeToStream(stream, std::forward<Args>(args)...);
-    }
-    
-public:
-    static void init(const std::string& filename = "", LogLevel level = LogLevel::INFO, bool console = true) {
-        minLevel = level;
-        consoleOutput = console;
-        
-        if (!filename.empty()) {
-            logFile.open(filename, std::ios::app);
-        }
-    }
-    
-    static void shutdown() {
-        if (logFile.is_open()) {
-            logFile.close();
+    static void append(LineBuffer& buf, const T& arg) {
+        using D = std::decay_t<T>;
+        if constexpr (std::is_same_v<D, bool>) {
+            buf.append(arg ? "1" : "0", 1);
+        } else if constexpr (std::is_same_v<D, char>) {
+            buf.append(&arg, 1);
+        } else if constexpr (std::is_integral_v<D>) {
+            char tmp[24];
+            auto res = std::to_chars(tmp, tmp + sizeof(tmp), arg);
+            buf.append(tmp, res.ptr - tmp);
+        } else if constexpr (std::is_floating_point_v<D>) {
+            char tmp[32];
+            int n = snprintf(tmp, sizeof(tmp), "%g", (double)arg);
+            buf.append(tmp, n > 0 ? (size_t)n : 0);
+        } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+            const char* s = arg;
+            if (!s) s = "(null)";
+            buf.append(s, strlen(s));
+        } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+            std::string_view sv(arg);
+            buf.append(sv.data(), sv.size());
+        } else {
+            // Anything else goes through its operator<<
+            std::ostringstream os;
+            os << arg;
+            const std::string s = os.str();
+            buf.append(s.data(), s.size());
         }
     }
-    
+
+    // Timestamps, queues (async) or writes (sync) one formatted message
+    static void submit(LogLevel level, const LineBuffer& buf);
+    static bool asyncActive();
+
+public:
+    // async: messages go through a lock-free ring to a writer thread that
+    // batches console and file output; otherwise every call writes and flushes
+    static void init(const std::string& filename = "", LogLevel level = LogLevel::INFO,
+                     bool console = true, bool async = false);
+
+    // Drains the async ring, stops the writer and closes the file
+    static void shutdown();
+
+    // Blocks until everything logged so far has been written
+    static void flush();
+
     template<typename... Args>
     static void log(LogLevel level, Args&&... args) {
         if (level < minLevel) return;
-        
-        std::lock_guard<std::mutex> lock(logMutex);
-        
-        // Build message
-        std::ostringstream message;
-        
-        // Timestamp
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()
-        ) % 1000;
-        
-        message << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-        message << "." << std::setfill('0') << std::setw(3) << ms.count();
-        
-        // Level
-        message << " [" << levelToString(level) << "] ";
-        
-        // Message content
-        writeToStream(message, std::forward<Args>(args)...);
-        
-        // Output to console
-        if (consoleOutput) {
-            if (level >= LogLevel::ERROR) {
-                std::cerr << message.str() << std::endl;
-            } else {
-                std::cout << message.str() << std::endl;
-            }
-        }
-        
-        // Output to file
-        if (logFile.is_open()) {
-            logFile << message.str() << std::endl;
-            logFile.flush();
-        }
+
+        LineBuffer buf;
+        buf.bounded = asyncActive();
+        (append(buf, args), ...);
+        submit(level, buf);
     }
-    
+
     // Convenience methods
     template<typename... Args>
     static void debug(Args&&... args) {
-        log(LogLevel::DEBUG, std::forward<Args>(args)...);
+        if constexpr (LogLevel::DEBUG >= compileMinLevel) log(LogLevel::DEBUG, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void info(Args&&... args) {
-        log(LogLevel::INFO, std::forward<Args>(args)...);
+        if constexpr (LogLevel::INFO >= compileMinLevel) log(LogLevel::INFO, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void warn(Args&&... args) {
-        log(LogLevel::WARN, std::forward<Args>(args)...);
+        if constexpr (LogLevel::WARN >= compileMinLevel) log(LogLevel::WARN, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void error(Args&&... args) {
-        log(LogLevel::ERROR, std::forward<Args>(args)...);
+        if constexpr (LogLevel::ERROR >= compileMinLevel) log(LogLevel::ERROR, std::forward<Args>(args)...);
     }
-    
+
     template<typename... Args>
     static void fatal(Args&&... args) {
         log(LogLevel::FATAL, std::forward<Args>(args)...);
     }
 };
 
-// Static member initialization (in cpp file)
 inline LogLevel Logger::minLevel = LogLevel::INFO;
-inline std::ofstream Logger::logFile;
-inline std::mutex Logger::logMutex;
-inline bool Logger::consoleOutput = true;
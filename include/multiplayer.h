@@ -5,14 +5,22 @@
 #include <vector>
 #include <memory>
 #include <array>
-#include <queue>
-#include <mutex>
+#include <atomic>
 #include <string>
 #include <functional>
+#include <thread>
 #include "hardcoresnake.h"
+#include "occupancygrid.h"
+#include "broadcastscheduler.h"
+#include "engine.h"
+#include "gamemessage.h"
+#include "lockstep.h"
+#include "wireformat.h"
+#include "nettelemetry.h"
 
 extern "C" {
     #include "../libs/MultiplayerApi.h"
+    #include "../libs/JsonArena.h"
     #include "../libs/jansson/jansson.h"
 }
 
@@ -61,6 +69,63 @@ public:
     }
 };
 
+// A reference to the JsonArena a received message was parsed into; the
+// arena is reset when the last reference goes. Must outlive every json_t
+// from that arena, so release the JsonPtr first.
+class JsonArenaRef {
+private:
+    JsonArena* arena;
+    
+public:
+    JsonArenaRef() : arena(nullptr) {}
+    ~JsonArenaRef() { json_arena_release(arena); }
+    
+    JsonArenaRef(const JsonArenaRef&) = delete;
+    JsonArenaRef& operator=(const JsonArenaRef&) = delete;
+    
+    JsonArenaRef(JsonArenaRef&& other) noexcept : arena(other.arena) { other.arena = nullptr; }
+    JsonArenaRef& operator=(JsonArenaRef&& other) noexcept {
+        if (this != &other) {
+            json_arena_release(arena);
+            arena = other.arena;
+            other.arena = nullptr;
+        }
+        return *this;
+    }
+    
+    // Adds a reference to the arena `value` lives in (none for heap values)
+    void retainFor(const json_t* value) {
+        reset();
+        arena = json_arena_of(value);
+        json_arena_retain(arena);
+    }
+    
+    void reset() {
+        json_arena_release(arena);
+        arena = nullptr;
+    }
+};
+
+// Builds JSON on this thread in a pooled arena for the scope's lifetime,
+// so a message's nodes and its serialization cost no malloc/free each and
+// go away in one reset. Everything built inside must be released (sent
+// with mp_api_game_take, or JsonPtr/json_decref) before the scope ends.
+class JsonArenaScope {
+private:
+    JsonArena* arena;
+    JsonArena* previous;
+    
+public:
+    JsonArenaScope() : arena(json_arena_acquire()), previous(json_arena_enter(arena)) {}
+    ~JsonArenaScope() {
+        json_arena_leave(previous);
+        json_arena_release(arena);
+    }
+    
+    JsonArenaScope(const JsonArenaScope&) = delete;
+    JsonArenaScope& operator=(const JsonArenaScope&) = delete;
+};
+
 // Fluent builder for JSON objects - eliminates boilerplate
 class JsonBuilder {
 private:
@@ -121,6 +186,7 @@ enum class NetworkMessageType {
     PLAYER_JOINED,
     PLAYER_LEFT,
     GAME_UPDATE,
+    GAME_LINE,  // Undecoded game_state / player_input line
     SYNC_REQUEST,
     HEARTBEAT,
     HOST_DISCONNECT
@@ -129,32 +195,91 @@ enum class NetworkMessageType {
 struct NetworkMessage {
     NetworkMessageType type;
     std::string clientId;
-    std::string jsonData;  // Serialized JSON as string
+    int64_t messageId;
+    JsonArenaRef arena;  // Where data was parsed; declared first so it is destroyed last
+    JsonPtr data;  // Parsed payload, ownership handed over from the receive thread
+    std::string line;  // GAME_LINE: the received line, decoded on the game thread
+    uint64_t queuedAtMicros;  // NetTelemetry::nowMicros() when the listener queued it
+    
+    NetworkMessage() : type(NetworkMessageType::HEARTBEAT), messageId(0), queuedAtMicros(0) {}
+    NetworkMessage(NetworkMessage&&) = default;
+    
+    // The old payload goes before the arena it may live in
+    NetworkMessage& operator=(NetworkMessage&& other) noexcept {
+        data = std::move(other.data);
+        arena = std::move(other.arena);
+        type = other.type;
+        clientId = std::move(other.clientId);
+        line = std::move(other.line);
+        messageId = other.messageId;
+        queuedAtMicros = other.queuedAtMicros;
+        return *this;
+    }
 };
 
+// Bounded lock-free single-producer/single-consumer ring.
+// Producer: the API receive thread. Consumer: the game thread.
+// Messages are moved in and out; head/tail are the only shared state.
+// A full ring drops the new message (counted, reported by the consumer).
 class NetworkMessageQueue {
+public:
+    static constexpr size_t CAPACITY = 1024;  // Power of two
+    
 private:
-    std::queue<NetworkMessage> messages;
-    std::mutex mutex;
+    std::vector<NetworkMessage> slots;
+    alignas(64) std::atomic<size_t> head;  // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> tail;  // Next slot to push (producer)
+    std::atomic<size_t> dropped;
     
 public:
-    void push(const NetworkMessage& msg) {
-        std::lock_guard<std::mutex> lock(mutex);
-        messages.push(msg);
+    NetworkMessageQueue() : slots(CAPACITY), head(0), tail(0), dropped(0) {}
+    
+    NetworkMessageQueue(const NetworkMessageQueue&) = delete;
+    NetworkMessageQueue& operator=(const NetworkMessageQueue&) = delete;
+    
+    bool push(NetworkMessage&& msg) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[t & (CAPACITY - 1)] = std::move(msg);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
     }
     
     bool pop(NetworkMessage& msg) {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (messages.empty()) return false;
-        msg = messages.front();
-        messages.pop();
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        msg = std::move(slots[h & (CAPACITY - 1)]);
+        head.store(h + 1, std::memory_order_release);
         return true;
     }
     
-    size_t size() {
-        std::lock_guard<std::mutex> lock(mutex);
-        return messages.size();
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    
+    // Exact on the producer side, a lower bound elsewhere
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
     }
+    
+    // Messages dropped since the last call
+    size_t takeDropped() {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+};
+
+// One entry of the relay's session list; fields the relay leaves out stay
+// unknown (-1 / empty)
+struct SessionInfo {
+    std::string id;
+    int players;
+    int maxPlayers;
+    std::string state;
+    
+    SessionInfo() : players(-1), maxPlayers(-1) {}
 };
 
 // Network layer - handles all communication
@@ -163,90 +288,104 @@ struct NetworkContext {
     std::string sessionId;
     std::string myClientId;  // My client ID from API
     std::string hostClientId;  // ClientId of the session host (for host disconnect detection)
+    std::string resumeFrom;  // Client: clientId before a resume, until the host maps the new one
+    std::string resumeToken;  // Client: proves a resume is ours; the host only knows its SHA-256
     bool isHost;  // True if this client is hosting the session
+    bool dedicatedHost;  // Host without a snake of its own (HardcoreSnakeServer)
+    bool matchRunning;  // PLAYING or PAUSED: players that drop keep their slot for a resume
     NetworkMessageQueue messageQueue;  // Thread-safe queue for network events
-    std::vector<std::string> availableSessions;
+    std::vector<SessionInfo> availableSessions;  // Last list received, kept across reconnects
+    Uint32 sessionsUpdatedAt;  // When availableSessions arrived, 0 = never
+    Uint32 sessionsRequestedAt;  // Last list request on this connection, 0 = none
     Uint32 lastStateSyncSent;  // Host: last time full state was broadcast
+    BroadcastScheduler broadcast;  // Host: game_state pacing and per-client link estimates
     Uint32 lastMessageReceived;  // Last time we received any message from server
     Uint32 connectionWarningTime;  // Time when we first detected connection issue
     bool connectionLost;  // Flag to trigger safe shutdown on next frame
     
-    NetworkContext() : api(nullptr), isHost(false), lastStateSyncSent(0),
-                       lastMessageReceived(0), connectionWarningTime(0), connectionLost(false) {}
-};
-
-// Match timing and state management
-struct MatchState {
-    Uint32 matchStartTime;  // When match started (synced from host)
-    Uint32 syncedElapsedMs;  // Authoritative elapsed time from host
-    Uint32 totalPausedTime;  // Total accumulated time paused (milliseconds)
-    Uint32 pauseStartTime;  // When current pause started (0 if not paused)
-    int winnerIndex;  // Index of match winner, -1 if no winner
-    std::string pausedByClientId;  // ClientId of player who paused, empty if not paused
-    
-    MatchState() : matchStartTime(0), syncedElapsedMs(0), totalPausedTime(0), 
-                   pauseStartTime(0), winnerIndex(-1) {}
-    
-    bool isPaused() const { return !pausedByClientId.empty(); }
-};
-
-// Player management with proper encapsulation
-class PlayerManager {
-private:
-    std::array<PlayerSlot, Config::Game::MAX_PLAYERS> slots;
-    int myIndex;
-    
-public:
-    PlayerManager() : myIndex(-1) {}
-    
-    // Array-style access
-    PlayerSlot& operator[](int i) { return slots[i]; }
-    const PlayerSlot& operator[](int i) const { return slots[i]; }
-    
-    // Direct access to underlying array (for render functions that need it)
-    std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& getSlots() { return slots; }
-    const std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& getSlots() const { return slots; }
-    
-    // Convenience accessors for "my player"
-    PlayerSlot& me() { return slots[myIndex]; }
-    const PlayerSlot& me() const { return slots[myIndex]; }
-    int myPlayerIndex() const { return myIndex; }
-    void setMyPlayerIndex(int i) { myIndex = i; }
-    bool hasMe() const { return myIndex >= 0; }
-    
-    // Validation
-    bool isValid(int i) const { 
-        return i >= 0 && i < Config::Game::MAX_PLAYERS && slots[i].active && slots[i].snake; 
-    }
-    
-    // Search operations
-    int findByClientId(const std::string& id) const {
-        for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-            if (slots[i].active && slots[i].clientId == id) return i;
-        }
-        return -1;
+    // Traffic, queue depth, dispatch delay and RTT; clients ping the host
+    // every PING_INTERVAL_MS and the host answers with a pong
+    NetTelemetry telemetry;
+    Uint32 lastPingSent;
+    Uint32 lastTelemetrySample;
+    Uint32 lastTelemetryLog;
+    
+    // game_state sequencing for delta snapshots
+    WireFormat::SnapshotHistory snapshotHistory;  // Host: sent snapshots, client: applied ones
+    uint32_t nextSnapshotSeq;  // Host: seq of the next game_state
+    bool forceKeyframe;  // Host: a client asked for a full snapshot
+    uint32_t lastAppliedSeq;  // Client: newest snapshot applied
+    Uint32 lastAckSent;  // Client: last time state_ack was sent
+    Uint32 lastResyncRequest;  // Client: last time state_resync was sent
+    bool resyncPending;  // Client: ack the next snapshot immediately
+    
+    // Client-side prediction of the local snake. Each sent player_input is
+    // kept until the host echoes a newer one, with the prediction tick that
+    // first simulated it (0 = not simulated yet).
+    struct PendingInput {
+        uint32_t seq;
+        Direction dir;
+        uint32_t tick;
+    };
+    static constexpr uint32_t PENDING_INPUT_CAPACITY = 64;
+    std::array<PendingInput, PENDING_INPUT_CAPACITY> pendingInputs;
+    uint32_t nextInputSeq;  // Client: seq of the next player_input
+    uint32_t predictionTick;  // Client: local simulation ticks this match
+    
+    // Client: host match time minus local SDL_GetTicks(), from the least
+    // delayed game_state seen; maps local time onto remote snake tracks
+    int64_t hostClockOffset;
+    bool hostClockValid;
+    
+    // Lockstep mode, chosen by the host; clients follow on lockstep_state
+    bool lockstep;
+    uint32_t lockstepTick;  // Host: last tick published, client: last tick simulated
+    uint32_t lockstepQueuedTick;  // Client: last tick accepted into receivedBundles
+    Lockstep::TickBundle pendingBundle;  // Host: inputs for the next tick, applied when it begins
+    Lockstep::BundleQueue receivedBundles;  // Client: ticks waiting to be simulated
+    Uint32 lastDesyncReport;  // Client: last time lockstep_desync was sent
+    
+    // Client: decode target of game_state / lockstep_state, reused across packets
+    WireFormat::StateSnapshot receivedSnapshot;
+    std::vector<uint8_t> receivedBytes;  // Base64-decoded "bin" of the last game_state
+    GameMessage::Decoded decodedLine;  // Fields of the last GAME_LINE
+    
+    NetworkContext() : api(nullptr), isHost(false), dedicatedHost(false), matchRunning(false), sessionsUpdatedAt(0),
+                       sessionsRequestedAt(0), lastStateSyncSent(0),
+                       lastMessageReceived(0), connectionWarningTime(0),
+                       connectionLost(false), lastPingSent(0), lastTelemetrySample(0), lastTelemetryLog(0) {
+        resetSnapshotSync();
     }
     
-    // Iteration support (allows range-based for loops)
-    auto begin() { return slots.begin(); }
-    auto end() { return slots.end(); }
-    auto begin() const { return slots.begin(); }
-    auto end() const { return slots.end(); }
-    
-    // Utility
-    int activeCount() const {
-        int count = 0;
-        for (const auto& slot : slots) {
-            if (slot.active) count++;
-        }
-        return count;
+    void resetSnapshotSync() {
+        snapshotHistory.clear();
+        broadcast.reset();
+        nextSnapshotSeq = 1;
+        forceKeyframe = false;
+        lastAppliedSeq = 0;
+        lastAckSent = 0;
+        lastResyncRequest = 0;
+        resyncPending = false;
+        pendingInputs.fill(PendingInput{0, Direction::NONE, 0});
+        nextInputSeq = 1;
+        predictionTick = 0;
+        hostClockOffset = 0;
+        hostClockValid = false;
+        lockstep = false;
+        lockstepTick = 0;
+        lockstepQueuedTick = 0;
+        pendingBundle.clear(1);
+        receivedBundles.clear();
+        lastDesyncReport = 0;
     }
 };
 
 struct GameContext {
     NetworkContext network;
     MatchState match;
+    ArenaSettings arena;  // Current session's board and capacity (host's choice)
     PlayerManager players;
+    OccupancyGrid occupancy;  // Shared by collisions, food and spawn placement
     Food* food;
     std::function<void(int)> onStateChange;
     
@@ -254,30 +393,96 @@ struct GameContext {
 };
 
 class NetworkManager {
+public:
+    enum class RequestKind { NONE, HOST, LIST, JOIN, RESUME };
+    using RequestDone = std::function<void(bool ok)>;
+    
 private:
     GameContext* ctx;
     
+    // The host/list/join running on a helper thread, if any
+    struct PendingRequest;
+    std::unique_ptr<PendingRequest> pending;
+    
+    // mp_api_preconnect on a helper thread; done once it returned
+    std::thread preconnectThread;
+    std::atomic<bool> preconnectDone;
+    
+    bool startRequest(RequestKind kind, const std::string& sessionId, RequestDone onComplete);
+    void finishRequest();
+    bool applyHost(int rc, const char* session, const char* clientId);
+    bool applyList(int rc, json_t* sessionList);
+    bool applyJoin(int rc, const char* session, const char* clientId);
+    bool applyResume(int rc, const char* clientId);
+    void connectionClosed();
+    
+    // Reused game_state encoding buffers
+    std::vector<uint8_t> snapshotBytes;
+    std::string snapshotText;
+    std::string snapshotPayload;
+    
+    bool sendBinaryGameState();
+    void sendJsonGameState();
+    
 public:
-    explicit NetworkManager(GameContext* context) : ctx(context) {}
+    explicit NetworkManager(GameContext* context);
     ~NetworkManager();
     
-    [[nodiscard]] bool initialize(const std::string& host, int port);
+    // reactor: drive the connection on a shared MpReactor (not owned)
+    // instead of the process-wide default one
+    [[nodiscard]] bool initialize(const std::string& host, int port, MpReactor* reactor = nullptr);
     void shutdown();
     bool isConnected() const;
     
+    // Resolves and connects to host:port on a helper thread (happy
+    // eyeballs across IPv6/IPv4), where the next initialize() for it picks
+    // the socket up; logs the timings. No-op while one is running, with a
+    // socket still open, or without Config::Network::PRECONNECT.
+    void preconnect(const std::string& host, int port);
+    size_t sendQueueDepth() const;  // Frames waiting in the API send queue
+    
     [[nodiscard]] bool hostSession();
     [[nodiscard]] bool listSessions();
     [[nodiscard]] bool joinSession(const std::string& sessionId);
     
+    // The same without blocking the caller: the request (and the connect
+    // before the first one) runs on a helper thread, and onComplete is
+    // called from processMessages() on the caller's thread once the result
+    // is applied. Network events wait in the queue meanwhile. False if not
+    // connected or another request is still pending.
+    bool hostSessionAsync(RequestDone onComplete);
+    bool listSessionsAsync(RequestDone onComplete = nullptr);
+    bool joinSessionAsync(const std::string& sessionId, RequestDone onComplete);
+    RequestKind pendingRequest() const;
+    
+    // A client whose connection drops rejoins its session in the
+    // background (Config::Network::RESUME_TIMEOUT_MS) and keeps its slot;
+    // the match goes on locally meanwhile
+    bool resuming() const { return pendingRequest() == RequestKind::RESUME; }
+    
     void processMessages();
     
     void sendPauseState(bool paused, const std::string& clientId);
     void sendGameMessage(json_t* message);
     
     void sendPlayerInput(Direction direction);
-    void broadcastGameState(bool critical = false);
+    void predictLocalTick();  // Client: advance the local snake one tick
+    void updateRemoteTracks(Uint32 tickMs);  // Client: per-frame remote snake display state
+    
+    // Host game_state: changes during a tick only mark the scheduler
+    // (BroadcastScheduler::Dirty); once the tick is done flushBroadcast()
+    // sends them as one frame, unless the scheduler holds it back
+    void markBroadcastDirty(uint8_t flags);
+    void flushBroadcast();
     void sendPeriodicStateSync();
     
+    // Lockstep (Config::Network::LOCKSTEP)
+    bool lockstepActive() const { return isConnected() && ctx->network.lockstep; }
+    void startLockstep();  // Host: new match, publish the starting state
+    void sendLockstepInput(Direction direction);  // Local key press
+    bool beginLockstepTick();  // Before each tick; false while a client waits for the host
+    uint32_t lockstepBacklog() const;  // Client: ticks received but not simulated
+    
     NetworkContext& getNetworkContext() { return ctx->network; }
     bool isHost() const { return isConnected() && ctx->network.isHost; }
     const NetworkContext& getNetworkContext() const { return ctx->network; }
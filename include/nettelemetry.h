@@ -0,0 +1,101 @@
+#ifndef NETTELEMETRY_H
+#define NETTELEMETRY_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Network health counters for one connection, so lag reports can be pinned
+// on the relay (RTT), the host (RTT minus our own dispatch delay) or this
+// client (dispatch delay, queue depth). Traffic and queue depth are written
+// from the API's threads through relaxed atomics; dispatch delay and RTT
+// are game-thread only. sample() turns the running totals into the
+// per-second Report the HUD overlay and the log dump read.
+class NetTelemetry {
+public:
+    enum class Kind {
+        STATE_SYNC,
+        GAME_STATE,
+        TIME_SYNC,
+        PLAYER_INPUT,
+        PING,   // ping and pong
+        OTHER,  // Remaining game types and relay commands
+        COUNT
+    };
+    static constexpr size_t KIND_COUNT = (size_t)Kind::COUNT;
+
+    enum Direction { IN = 0, OUT = 1 };
+
+    NetTelemetry();
+
+    NetTelemetry(const NetTelemetry&) = delete;
+    NetTelemetry& operator=(const NetTelemetry&) = delete;
+
+    static Kind classify(const char* gameType);
+    static const char* kindName(Kind kind);
+
+    // Monotonic microseconds, for stamping queued messages
+    static uint64_t nowMicros();
+
+    // MpTrafficHook; user_data is the NetTelemetry
+    static void trafficHook(int outgoing, const char* cmd, const char* type, size_t bytes, void* user_data);
+
+    // Any thread
+    void recordTraffic(Direction dir, Kind kind, size_t bytes);
+    void recordQueueDepth(size_t depth);
+
+    // Game thread
+    void recordDispatch(uint64_t queuedAtMicros);
+    void recordRtt(uint32_t rttMs);
+
+    struct Report {
+        struct Traffic {
+            uint64_t messages;     // Since reset()
+            uint64_t bytes;
+            float messagesPerSec;  // Over the last sample interval
+            float kbPerSec;
+        };
+        std::array<std::array<Traffic, KIND_COUNT>, 2> traffic;  // [Direction][Kind]
+        size_t queueHighWater;      // Since reset()
+        size_t queueIntervalPeak;   // Over the last sample interval
+        float dispatchAvgMs;        // Over the last sample interval
+        float dispatchMaxMs;
+        uint32_t rttMs;             // Latest ping, 0 = none yet
+        float rttSmoothedMs;
+        uint32_t rttMaxMs;          // Since reset()
+    };
+
+    // Game thread: fold the totals since the last call into report()
+    void sample(uint32_t nowMs);
+    const Report& report() const { return current; }
+
+    // report() for the log, as two lines that each fit Logger::MESSAGE_MAX:
+    // the link summary, then msgs/s in/out of each type that saw traffic
+    std::string describe() const;
+    std::string describeRates() const;
+
+    // Game thread, with no traffic in flight (new connection)
+    void reset();
+
+private:
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> messages{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+    std::array<std::array<Counter, KIND_COUNT>, 2> counters;
+    std::atomic<size_t> queueHighWater;
+    std::atomic<size_t> queueIntervalPeak;
+
+    // Game thread only
+    uint64_t dispatchCount;
+    uint64_t dispatchTotalMicros;
+    uint64_t dispatchMaxMicros;
+    std::array<std::array<uint64_t, KIND_COUNT>, 2> lastMessages;
+    std::array<std::array<uint64_t, KIND_COUNT>, 2> lastBytes;
+    uint32_t lastSampleMs;
+    Report current;
+};
+
+#endif // NETTELEMETRY_H
@@ -0,0 +1,162 @@
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include "hardcoresnake.h"
+#include "gamerng.h"
+#include <cstdint>
+#include <vector>
+
+// Set of cell indices with O(1) insert, erase and uniform random pick.
+// Members live in a dense array; erase swaps the last member into the hole
+// and a reverse index maps each cell to its array slot (-1 when absent).
+class CellIndexSet {
+public:
+    explicit CellIndexSet(int cellCount = 0) { resize(cellCount); }
+
+    void resize(int cellCount) {
+        members.clear();
+        members.reserve(cellCount);
+        slotOf.assign(cellCount, -1);
+    }
+
+    bool contains(int cell) const { return slotOf[cell] >= 0; }
+    bool empty() const { return members.empty(); }
+    int size() const { return (int)members.size(); }
+    int at(int i) const { return members[i]; }
+
+    void insert(int cell) {
+        if (slotOf[cell] >= 0) return;
+        slotOf[cell] = (int)members.size();
+        members.push_back(cell);
+    }
+
+    void erase(int cell) {
+        int slot = slotOf[cell];
+        if (slot < 0) return;
+        int last = members.back();
+        members[slot] = last;
+        slotOf[last] = slot;
+        members.pop_back();
+        slotOf[cell] = -1;
+    }
+
+    void clear() {
+        for (int cell : members) slotOf[cell] = -1;
+        members.clear();
+    }
+
+    const std::vector<int>& order() const { return members; }
+
+    // Same members in the given order; false (and unchanged) unless order
+    // holds exactly the current members
+    bool reorder(const std::vector<int>& order) {
+        if (order.size() != members.size()) return false;
+        std::vector<bool> seen(slotOf.size(), false);
+        for (int cell : order) {
+            if (cell < 0 || cell >= (int)slotOf.size() || slotOf[cell] < 0 || seen[cell]) return false;
+            seen[cell] = true;
+        }
+        members = order;
+        for (int i = 0; i < (int)members.size(); i++) slotOf[members[i]] = i;
+        return true;
+    }
+
+private:
+    std::vector<int> members;
+    std::vector<int> slotOf;
+};
+
+// Dense per-cell occupancy map shared by collision checks, food placement
+// and spawn selection. Each cell stores the owning player (index + 1), or
+// EMPTY (so player indices stay below Config::Game::PLAYER_LIMIT). The grid
+// is kept up to date incrementally from snake head/tail deltas; rebuild()
+// is only needed after bulk changes (match reset, arena resize, etc).
+//
+// Two free-cell indices are maintained alongside the cells so placement is
+// constant time and never fails while a valid cell exists:
+// - freeCells: every empty cell (food placement)
+// - spawnAnchors: cells (x,y) where x, x-1 and x-2 are all empty, i.e. room
+//   for a fresh 3-segment snake extending left
+//
+// Random picks draw from the grid's own GameRng. Member order in the
+// indices depends on the insert/erase history, so identical picks on two
+// peers need the same rng state and a grid rebuilt the same way.
+class OccupancyGrid {
+public:
+    static constexpr uint8_t EMPTY = 0;
+    static constexpr int SPAWN_LENGTH = 3;
+
+    OccupancyGrid(int width = Config::Grid::WIDTH, int height = Config::Grid::HEIGHT);
+
+    // New dimensions; the grid comes back empty (rebuild() afterwards)
+    void resize(int newWidth, int newHeight);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    bool inBounds(const Position& p) const {
+        return p.x >= 0 && p.x < width && p.y >= 0 && p.y < height;
+    }
+
+    // Out-of-bounds cells count as occupied (walls)
+    bool isOccupied(const Position& p) const {
+        return !inBounds(p) || cells[index(p)] != EMPTY;
+    }
+
+    // Owning player index, or -1 for empty / out-of-bounds cells
+    int ownerAt(const Position& p) const {
+        return inBounds(p) ? (int)cells[index(p)] - 1 : -1;
+    }
+
+    // Raw owners of row y, `getWidth()` cells (bitboard builds)
+    const uint8_t* row(int y) const { return cells.data() + (size_t)y * width; }
+
+    void occupy(const Position& p, int playerIndex);
+    void release(const Position& p, int playerIndex);  // No-op unless owned by playerIndex
+
+    void occupyBody(const Snake& snake, int playerIndex);
+    void releaseBody(const Snake& snake, int playerIndex);
+
+    void clear();
+    void rebuild(const PlayerSlot* slots, int slotCount);
+
+    // Bumped by every clear() (so by resize() and rebuild() too): the
+    // free-cell index order started over
+    uint32_t clearCount() const { return clears; }
+
+    // Member order of the two indices, which decides every random pick.
+    // setIndexOrder() restores orders saved from a grid with the same cells
+    // (replay keyframes); false if they don't fit this grid.
+    const std::vector<int>& freeCellOrder() const { return freeCells.order(); }
+    const std::vector<int>& spawnAnchorOrder() const { return spawnAnchors.order(); }
+    bool setIndexOrder(const std::vector<int>& freeOrder, const std::vector<int>& anchorOrder) {
+        return freeCells.reorder(freeOrder) && spawnAnchors.reorder(anchorOrder);
+    }
+
+    // Free-cell queries, O(1). Return false when no suitable cell exists.
+    int freeCellCount() const { return freeCells.size(); }
+    bool randomFreeCell(Position& out) const;
+    bool randomSpawnAnchor(Position& out) const;  // out and the 2 cells left of it are free
+
+    void seedRandom(uint64_t seed) { rng.seed(seed); }
+    uint64_t randomState() const { return rng.getState(); }
+    void setRandomState(uint64_t state) { rng.setState(state); }
+
+private:
+    int index(const Position& p) const { return p.y * width + p.x; }
+    Position positionOf(int cell) const { return Position{cell % width, cell / width}; }
+
+    void onCellFreed(const Position& p);
+    void onCellTaken(const Position& p);
+    bool isAnchor(int x, int y) const;
+
+    int width;
+    int height;
+    std::vector<uint8_t> cells;
+    CellIndexSet freeCells;
+    CellIndexSet spawnAnchors;
+    uint32_t clears;
+    mutable GameRng rng;  // Advanced by the const random picks
+};
+
+#endif // OCCUPANCYGRID_H
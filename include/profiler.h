@@ -0,0 +1,126 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Built in unless compiled with -DFRAME_PROFILER=0, which turns every
+// PROFILE_SCOPE into nothing (CMake: -DFRAME_PROFILER=OFF).
+#ifndef FRAME_PROFILER
+#define FRAME_PROFILER 1
+#endif
+
+// Main loop profiler. PROFILE_SCOPE(PHASE) times the rest of the enclosing
+// block on the monotonic clock; the duration goes into the phase's
+// fixed-bucket histogram and into a preallocated ring of trace events, so
+// nothing allocates while recording. Scopes are no-ops until enable(),
+// which only the game calls: headless hosts share the engine code but not
+// the profiler, which is single-threaded.
+class Profiler {
+public:
+    enum class Phase {
+        FRAME,
+        HANDLE_INPUT,
+        PROCESS_MESSAGES,
+        UPDATE_PLAYERS,
+        COLLISIONS,
+        BROADCAST,
+        RENDER,
+        PRESENT,
+        COUNT
+    };
+    static constexpr size_t PHASE_COUNT = (size_t)Phase::COUNT;
+    static constexpr size_t HISTORY_FRAMES = 240;   // Frame-time graph
+    static constexpr size_t TRACE_CAPACITY = 65536;  // Newest events kept for the trace dump
+
+    // Log-linear microsecond buckets: exact below 8 us, then four per
+    // power of two up to ~16 s, so percentiles are within 25 %
+    class Histogram {
+    public:
+        static constexpr int SUB_BUCKETS = 4;
+        static constexpr int BUCKET_COUNT = 8 + 21 * SUB_BUCKETS;
+
+        Histogram();
+        void record(uint64_t micros);
+        void clear();
+
+        uint64_t count() const { return samples; }
+        uint64_t maxMicros() const { return max; }
+        double meanMicros() const { return samples ? (double)total / (double)samples : 0.0; }
+        uint64_t percentileMicros(double fraction) const;  // Bucket upper bound
+
+        static int bucketFor(uint64_t micros);
+        static uint64_t bucketUpperBound(int bucket);
+
+    private:
+        std::array<uint32_t, BUCKET_COUNT> buckets;
+        uint64_t samples;
+        uint64_t total;
+        uint64_t max;
+    };
+
+    static Profiler& instance();
+    static const char* phaseName(Phase phase);
+    static uint64_t nowMicros();
+
+    void enable();  // Allocates the trace ring
+    bool active() const { return enabled; }
+
+    void record(Phase phase, uint64_t startMicros, uint64_t endMicros);
+
+    const Histogram& histogram(Phase phase) const { return histograms[(size_t)phase]; }
+
+    // FRAME durations, newest last; fewer than HISTORY_FRAMES at startup
+    size_t frameHistorySize() const;
+    float frameHistoryMs(size_t index) const;
+
+    // Per-phase summary, and the trace ring in Chrome's trace event format
+    // (chrome://tracing, Perfetto). False if the file can't be written.
+    bool writeCsv(const char* path) const;
+    bool writeChromeTrace(const char* path) const;
+
+    class Scope {
+    public:
+        explicit Scope(Phase phase)
+            : phase(phase), on(instance().active()), start(on ? nowMicros() : 0) {}
+        ~Scope() {
+            if (on) instance().record(phase, start, nowMicros());
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Phase phase;
+        bool on;
+        uint64_t start;
+    };
+
+private:
+    Profiler();
+
+    struct TraceEvent {
+        uint64_t startMicros;
+        uint32_t durationMicros;
+        Phase phase;
+    };
+
+    bool enabled;
+    uint64_t epochMicros;  // Trace timestamps are relative to enable()
+    std::array<Histogram, PHASE_COUNT> histograms;
+    std::array<float, HISTORY_FRAMES> frameHistory;
+    size_t framesRecorded;
+    std::vector<TraceEvent> trace;
+    size_t traceRecorded;
+};
+
+#if FRAME_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(Profiler::Phase::phase)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,61 @@
+#ifndef REMOTETRACK_H
+#define REMOTETRACK_H
+
+#include "snakebody.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Recent game_state bodies of one remote snake, ordered by server messageId
+// and stamped with host match time. sample() reconstructs the body at a
+// host time between two snapshots by walking the snake along the cells it
+// advanced, so remote snakes move one cell per host tick instead of jumping
+// when a packet arrives. Past the newest snapshot it extrapolates along the
+// last heading for a bounded time, if the snake was moving.
+class RemoteTrack {
+public:
+    static constexpr int CAPACITY = 8;
+    static constexpr size_t MAX_ADVANCE = 64;  // Cells searched when matching two bodies
+
+    RemoteTrack();
+
+    void clear();
+
+    // Duplicates and ids older than the window are dropped; host time going
+    // backwards (new match) restarts the track.
+    void push(int64_t messageId, uint32_t hostTimeMs, const std::vector<Position>& body, bool alive);
+
+    // Display state at host time renderTimeMs. False (and inactive) when
+    // the authoritative body should be drawn instead.
+    bool sample(int64_t renderTimeMs, uint32_t tickMs, uint32_t maxExtrapolationMs,
+                int gridWidth, int gridHeight);
+
+    bool active() const { return hasDisplay; }
+    const std::vector<Position>& displayBody() const { return display; }
+    Position displayPrevTail() const { return prevTail; }
+    float displayAlpha() const { return alpha; }  // Head/tail progress like MenuRender's alpha
+
+private:
+    struct Sample {
+        int64_t messageId;
+        uint32_t hostTimeMs;
+        bool alive;
+        std::vector<Position> body;
+    };
+
+    // Show the snake `progress` cells along path, where path[0..advance) are
+    // the cells it moves into and path[advance..] the body it starts from
+    void walk(size_t advance, float progress, size_t startLength, const std::vector<Position>* endBody);
+    void show(const std::vector<Position>& body);
+
+    std::array<Sample, CAPACITY> samples;  // [0, count) ascending messageId
+    int count;
+
+    std::vector<Position> path;  // Reused per sample()
+    std::vector<Position> display;
+    Position prevTail;
+    float alpha;
+    bool hasDisplay;
+};
+
+#endif // REMOTETRACK_H
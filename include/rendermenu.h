@@ -5,12 +5,20 @@
 #include <SDL2/SDL_ttf.h>
 #include <vector>
 #include <memory>
-#include <map>
+#include <list>
+#include <unordered_map>
 #include <string>
 #include <array>
 #include <atomic>
 #include <mutex>
+#include <thread>
 #include "hardcoresnake.h"
+#include "glyphatlas.h"
+#include "nettelemetry.h"
+#include "profiler.h"
+
+class PlayerManager;
+struct SessionInfo;
 
 class MenuRender
 {
@@ -19,22 +27,48 @@ class MenuRender
         ~MenuRender();
         
         // Game rendering methods (merged from GameRender)
-        void renderGame(const struct GameContext& ctx, bool matchEnded);
-        void renderPlayers(const std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& players);
+        // alpha: progress into the next simulation tick, for interpolated movement
+        void renderGame(const struct GameContext& ctx, bool matchEnded, float alpha = 1.0f);
+        void renderPlayers(const PlayerManager& players, float alpha = 1.0f);
         void renderFood(const Food& food);
         void renderHUD(int score, int remainingSeconds, const std::string& sessionId);
         void clearScreen();
         void present();
+        
+        // Redraw the cached playfield background on next use; texturesLost
+        // after SDL_RENDER_DEVICE_RESET, when every texture has to be recreated
+        void invalidateRenderCaches(bool texturesLost = false);
+        
+        // Fonts load in the background; frames before that have no text
+        bool textReady() const { return !fontsPending; }
 
         void renderText(const char* text, int x, int y, SDL_Color color, TTF_Font* textFont = nullptr, bool cache = false);
+        int measureText(const char* text, TTF_Font* textFont = nullptr);
 
         // Menu screens for different game states
         void renderMenu(int menuSelection);           // Main menu (MENU state)
-        void renderSessionBrowser(const std::vector<std::string>& sessions, int selectedIndex, bool isConnected);  // Session browser
-        void renderLobby(const std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& players, bool isHost);  // LOBBY state
+        // Session browser; busy names the request in flight (spinner), updatedAt
+        // is when the list arrived (0 = never)
+        void renderSessionBrowser(const std::vector<SessionInfo>& sessions, int selectedIndex, bool isConnected,
+                                  const char* busy, Uint32 updatedAt);
+        void renderLobby(const PlayerManager& players, bool isHost);  // LOBBY state
         void renderCountdown(int seconds);            // COUNTDOWN state
         void renderPauseMenu(int selection);         // Pause overlay during PLAYING
-        void renderMatchEnd(int winnerIndex, const std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& players);  // MATCH_END state
+        void renderMatchEnd(int winnerIndex, const PlayerManager& players);  // MATCH_END state
+        
+        // One line across the top of any screen, e.g. while reconnecting
+        void renderBanner(const char* text);
+        
+        // Network telemetry overlay (F3), drawn over any screen while connected
+        void renderNetStats(const NetTelemetry::Report& report, size_t sendQueueDepth);
+        
+        // --replay: position, speed and keys along the bottom; mismatches
+        // are keyframes where playback disagreed with the recording
+        void renderReplayStatus(uint32_t tick, uint32_t endTick, uint32_t tickMs, int speed, bool paused,
+                                uint32_t mismatches);
+        
+        // Profiler overlay (F4): per-phase p50/p99 and a frame-time graph
+        void renderProfiler(const Profiler& profiler);
         
         
         SDL_Renderer* getRenderer() { return renderer; }
@@ -52,12 +86,90 @@ class MenuRender
         static std::atomic<bool> sdlInitialized;
         static std::mutex sdlInitMutex;
 
-        // Cached textures for static text
-        std::map<std::string, SDL_Texture*> textureCache;
+        // Glyph atlases for font and titleFont; all text is drawn from these
+        GlyphAtlas textAtlas;
+        GlyphAtlas titleAtlas;
+        GlyphAtlas* atlasFor(TTF_Font* textFont);
+        void buildGlyphAtlases();
+        
+        // fontLoader opens the fonts and rasterizes the atlases while the
+        // first frames go out; adoptFonts() takes them over on the render
+        // thread at the next frame once fontsLoaded is set
+        std::thread fontLoader;
+        std::atomic<bool> fontsLoaded;
+        bool fontsPending;
+        TTF_Font* loadedFont;
+        TTF_Font* loadedTitleFont;
+        void loadFonts();
+        void adoptFonts();
+
+        // Whole-string text textures, used only when an atlas is unavailable.
+        // Bounded: the least recently drawn go beyond TEXT_CACHE_ENTRIES.
+        struct TextKey {
+            uint64_t textHash;
+            uint32_t rgba;
+            bool title;
+            
+            bool operator==(const TextKey& o) const {
+                return textHash == o.textHash && rgba == o.rgba && title == o.title;
+            }
+        };
+        struct TextKeyHash {
+            size_t operator()(const TextKey& k) const {
+                return (size_t)(k.textHash ^ ((uint64_t)k.rgba << 1) ^ (uint64_t)k.title);
+            }
+        };
+        struct CachedText {
+            TextKey key;
+            std::string text;  // Tells hash collisions apart
+            SDL_Texture* texture;
+        };
+        std::list<CachedText> textLru;  // Most recently drawn first
+        std::unordered_map<TextKey, std::list<CachedText>::iterator, TextKeyHash> textIndex;
+        void clearTextCache();
+        
+        // Menu screens and overlays, composed once into a target texture and
+        // redrawn only when the hash of what they show changes
+        enum ScreenId { SCREEN_MENU, SCREEN_SESSIONS, SCREEN_LOBBY, SCREEN_PAUSE, SCREEN_MATCH_END, SCREEN_COUNT };
+        struct CachedScreen {
+            SDL_Texture* texture;
+            uint64_t inputs;
+            bool valid;
+        };
+        std::array<CachedScreen, SCREEN_COUNT> screens;
+        bool screenTargetsFailed;  // No render targets: draw every frame
+        // overlay: drawn over the game, transparent where draw() leaves it
+        template <typename Draw>
+        void drawScreen(ScreenId id, uint64_t inputs, bool overlay, Draw draw);
+        void releaseScreens();
+        
+        // Playfield background + grid, rendered once into a target texture
+        SDL_Texture* backgroundTexture;
+        bool backgroundDirty;
+        void drawPlayfield();
+        void renderBackground();
+        
+        // Arena being drawn; cells are scaled so the whole board fits the window
+        int gridWidth;
+        int gridHeight;
+        int cellSize;
+        void setGridLayout(int width, int height);
+        
+        // Reused rect batches for SDL_RenderFillRects
+        std::vector<SDL_Rect> rectBatch;
+        struct HeadRect {
+            SDL_Rect rect;
+            SDL_Color color;
+        };
+        std::vector<HeadRect> headBatch;
 
         // Helper to create and cache texture
         SDL_Texture* createTextTexture(const char* text, SDL_Color color, TTF_Font* textFont);
         SDL_Texture* getCachedTexture(const char* text, SDL_Color color, TTF_Font* textFont);
+        
+        // Session browser minus the live status line
+        void drawSessionList(const std::vector<SessionInfo>& sessions, int selectedIndex, bool isConnected,
+                             Uint32 updatedAt);
 
 };
 
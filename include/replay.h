@@ -0,0 +1,198 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "engine.h"
+#include "wireformat.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Binary match replays. The simulation is deterministic given its inputs
+// (see lockstep.h), so a replay stores only what changed between ticks plus
+// periodic keyframes to seek from, and playback runs the same SnakeEngine.
+//
+// Layout (little-endian):
+//   header  "HSRP", u8 version, u8 maxPlayers, u16 width, u16 height,
+//           u16 tickMs, u32 startTime (Unix seconds)
+//   record  u8 kind, u32 tick, u32 length, then length bytes:
+//   - INPUTS:   per snake whose heading changed since the end of the last
+//               tick: u8 index, u8 heading (current | next << 4), u8 flags
+//               (bit0 = body reversed, setDirection's first turn)
+//   - KEYFRAME: u64 rng state, u32 elapsedMs, u8 flags (bit0 = resync),
+//               u8 playerCount, per player u8 index, i32 score; the grid's
+//               free-cell and spawn-anchor orders, each a u32 count and
+//               that many cells (u16, u32 above 65536 cells); then a
+//               WireFormat keyframe (bodies, alive flags, headings, food)
+//   - END:      no payload; tick = ticks recorded
+//
+// Records of a tick come in that order and are applied before it is
+// simulated; a keyframe is the state after that tick's inputs. Recording
+// only reads the match: the index orders are stored rather than rebuilt,
+// since they decide every later food and spawn pick. Keyframes
+// are written every KEYFRAME_INTERVAL_TICKS, and flagged resync whenever
+// something outside tick() changed the state (match start, players joining
+// or leaving, a grid rebuild). A file without END (the game crashed) plays
+// up to its last record.
+namespace Replay {
+
+constexpr uint32_t MAGIC = 0x50525348;  // "HSRP"
+constexpr uint8_t VERSION = 2;
+constexpr size_t HEADER_SIZE = 16;
+constexpr size_t RECORD_HEADER_SIZE = 9;
+
+enum RecordKind : uint8_t { INPUTS = 1, KEYFRAME = 2, END = 3 };
+
+// The state a replay is recorded from or played into, owned by the caller
+// (as for SnakeEngine)
+struct MatchView {
+    PlayerManager& players;
+    OccupancyGrid& occupancy;
+    MatchState& match;
+    Food& food;
+};
+
+// Appends a match to a file. Records are assembled on the game thread and
+// written by a background thread every FLUSH_INTERVAL_MS, so a tick never
+// waits on the disk.
+class Recorder {
+public:
+    explicit Recorder(const MatchView& view);
+    ~Recorder();
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+
+    // Ends any current recording and starts one; false if the file can't
+    // be created
+    bool start(const std::string& path, uint32_t tickMs);
+    void stop();  // Writes END and waits for the writer
+    bool recording() const { return file != nullptr; }
+
+    // Around every SnakeEngine::tick() of the recorded match
+    void beforeTick();
+    void afterTick();
+
+private:
+    struct Heading {
+        uint8_t packed;
+        Position head;  // Moves between ticks only when setDirection reverses the body
+        bool known;
+    };
+
+    void writeKeyframe(bool resync);
+    void beginRecord(RecordKind kind, size_t length);
+    void submit();  // Hands the staged records to the writer
+    void writerMain();
+
+    MatchView view;
+    uint32_t tick;
+    uint32_t lastKeyframe;
+    uint32_t lastClearCount;
+    std::vector<int> lastActive;
+    std::vector<Heading> headings;  // Per slot, as at the end of the last tick
+    std::vector<uint8_t> staged;  // This tick's records
+    WireFormat::StateSnapshot snapshot;
+    std::vector<uint8_t> snapshotBytes;
+
+    FILE* file;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<uint8_t> pending;  // Guarded by mutex, swapped out by the writer
+    bool stopping;
+};
+
+// A replay file mapped read-only, with its records indexed once on open
+class File {
+public:
+    struct Keyframe {
+        uint32_t tick;
+        size_t offset;  // Of the record header
+    };
+
+    File();
+    ~File();
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    // False (and an error in the log) if the file can't be mapped or its
+    // header is wrong. A damaged record ends the replay there.
+    bool open(const std::string& path);
+    void close();
+
+    ArenaSettings arena() const { return settings; }
+    uint32_t tickMs() const { return tickInterval; }
+    uint32_t startTime() const { return startUnix; }
+    uint32_t endTick() const { return lastTick; }  // Ticks that can be played
+    bool complete() const { return hasEnd; }  // Ends with END
+
+    const std::vector<Keyframe>& keyframes() const { return index; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return validSize; }  // Bytes of complete records
+
+private:
+    const uint8_t* base;
+    size_t mappedSize;
+    size_t validSize;
+    ArenaSettings settings;
+    uint32_t tickInterval;
+    uint32_t startUnix;
+    uint32_t lastTick;
+    bool hasEnd;
+    std::vector<Keyframe> index;
+};
+
+// Runs a replay on the engine, headless: seek() restores the nearest
+// keyframe at or before a tick and simulates forward, step() plays one
+// tick. Periodic keyframes met while stepping are checked against the
+// simulated state; a mismatch means the recording and this build disagree
+// (mismatches() counts them), and either way the recorded state is taken.
+class Player {
+public:
+    explicit Player(const MatchView& view);
+
+    // Sizes the view's players and grid to the replay; plays from tick 0
+    bool load(const File& file);
+
+    bool seek(uint32_t tick);
+    bool step();  // False at the end
+    uint32_t advance(uint32_t ticks);  // Steps played
+
+    uint32_t currentTick() const { return tick; }
+    bool atEnd() const { return !file || tick >= file->endTick(); }
+    uint32_t mismatches() const { return mismatchCount; }
+
+private:
+    void applyRecordsOfTick();
+    bool applyKeyframe(const uint8_t* payload, size_t length, uint32_t keyTick);
+
+    MatchView view;
+    SnakeEngine engine;
+    const File* file;
+    size_t cursor;  // Next record to read
+    uint32_t tick;
+    uint32_t keyTick;  // Of the keyframe the match clock counts from
+    uint32_t keyElapsedMs;
+    uint32_t mismatchCount;
+    WireFormat::SnapshotHistory noHistory;  // Keyframes don't reference one
+    WireFormat::StateSnapshot snapshot;
+    std::vector<uint8_t> encoded;  // Simulated state, for the keyframe check
+    std::vector<int> freeOrder;  // Grid index orders of the keyframe being applied
+    std::vector<int> anchorOrder;
+    std::vector<Position> reversedBody;
+};
+
+// Encodes the view's state as a KEYFRAME payload (also used by Player to
+// check its simulated state). snapshot is scratch.
+bool encodeKeyframe(const MatchView& view, bool resync, WireFormat::StateSnapshot& snapshot,
+                    std::vector<uint8_t>& out);
+
+} // namespace Replay
+
+#endif // REPLAY_H
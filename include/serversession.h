@@ -0,0 +1,77 @@
+#ifndef SERVERSESSION_H
+#define SERVERSESSION_H
+
+#include "multiplayer.h"
+#include "engine.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// One match hosted by HardcoreSnakeServer: its own GameContext, engine and
+// relay connection, with the NetworkManager acting as a dedicated host
+// (no snake of its own). Matches cycle LOBBY -> PLAYING -> MATCH_END ->
+// LOBBY without anyone pressing a key.
+//
+// Not thread-safe. The pool worker that owns a session is the only thread
+// calling it; the reactor thread reaches it only through the network
+// message queue.
+class ServerSession {
+public:
+    enum class Phase {
+        CLOSED,     // Not hosting, or waiting for the host reply; open() is retried after REOPEN_DELAY_MS
+        LOBBY,
+        PLAYING,
+        MATCH_END
+    };
+
+    // reactor: shared by all sessions of the server, outlives them
+    ServerSession(int id, const std::string& host, int port, const ArenaSettings& arena, MpReactor* reactor);
+    ~ServerSession();
+
+    ServerSession(const ServerSession&) = delete;
+    ServerSession& operator=(const ServerSession&) = delete;
+
+    // Run whatever is due at `now` (SDL_GetTicks): reconnect, messages,
+    // simulation ticks, phase changes. Returns when it wants to run next.
+    uint32_t poll(uint32_t now);
+
+    int id() const { return sessionNumber; }
+    Phase phase() const { return currentPhase; }
+    const std::string& sessionId() const { return ctx.network.sessionId; }
+    int playerCount() const { return ctx.players.activeCount(); }
+    uint64_t tickCount() const { return ticks; }
+
+private:
+    bool open(uint32_t now);  // Starts connecting and hosting in the background
+    void opened(bool ok);     // The host reply, from processMessages()
+    void retryOpen(uint32_t now);
+    void close(uint32_t now);
+    void onNetworkState(int state);
+
+    void updateLobby(uint32_t now);
+    void updatePlaying(uint32_t now);
+    void startMatch(uint32_t now);
+    void endMatch(uint32_t now);
+    void sendPhase(const char* gameState);
+
+    int sessionNumber;
+    std::string serverHost;
+    int serverPort;
+    MpReactor* reactor;
+
+    GameContext ctx;
+    Food food;
+    SnakeEngine engine;
+    std::unique_ptr<NetworkManager> network;
+
+    Phase currentPhase;
+    bool paused;
+    uint32_t reopenAt;
+    uint32_t lobbyReadyAt;  // 0 until MIN_PLAYERS are in
+    uint32_t matchEndedAt;
+    uint32_t lastTick;
+    uint32_t tickAccumulator;
+    uint64_t ticks;
+};
+
+#endif // SERVERSESSION_H
@@ -0,0 +1,70 @@
+#ifndef SESSIONPOOL_H
+#define SESSIONPOOL_H
+
+#include "serversession.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool for HardcoreSnakeServer. Sessions are sharded
+// round-robin over the workers when added; a worker owns its shard for the
+// pool's lifetime and polls each session when it is due, sleeping until
+// the earliest one. Workers share nothing: a session's only cross-thread
+// input is its own network message queue, and the shard counters below
+// are written by their worker and only read for status output.
+class SessionPool {
+public:
+    explicit SessionPool(int workerCount);
+    ~SessionPool();
+
+    SessionPool(const SessionPool&) = delete;
+    SessionPool& operator=(const SessionPool&) = delete;
+
+    // Before start() only
+    void add(std::unique_ptr<ServerSession> session);
+
+    void start();
+    void stop();  // Joins the workers; sessions are closed with the pool
+
+    int workerCount() const { return (int)shards.size(); }
+
+    struct Status {
+        int sessions;  // Hosting (not CLOSED)
+        int playing;   // In a match
+        int players;
+        uint64_t ticks;
+    };
+    Status status() const;
+
+    // Relay session IDs currently hosted, in no particular order
+    std::vector<std::string> hostedSessions() const;
+
+private:
+    struct alignas(64) Shard {
+        std::vector<std::unique_ptr<ServerSession>> sessions;
+        std::vector<uint32_t> due;  // Next poll time per session
+        std::thread worker;
+
+        // Published by the worker after each pass
+        std::atomic<int> hosting{0};
+        std::atomic<int> playing{0};
+        std::atomic<int> players{0};
+        std::atomic<uint64_t> ticks{0};
+
+        // Session IDs, republished by the worker only when they change
+        std::vector<std::string> ids;
+        mutable std::mutex idsLock;
+    };
+
+    void run(Shard& shard);
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t nextShard;
+    std::atomic<bool> running;
+};
+
+#endif // SESSIONPOOL_H
@@ -0,0 +1,16 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <string>
+
+// SHA-256 (FIPS 180-4). Used for resume keys: the relay broadcasts every
+// game message, so a client only ever publishes the hash of its resume
+// token and reveals the token itself when it comes back.
+namespace Sha256 {
+
+// Lowercase hex digest of data
+std::string hex(const std::string& data);
+
+}
+
+#endif // SHA256_H
@@ -0,0 +1,154 @@
+#ifndef SNAKEBODY_H
+#define SNAKEBODY_H
+
+#include <cstddef>
+#include <vector>
+
+struct Position {
+    int x;
+    int y;
+
+    bool operator==(const Position& other) const {
+        return x == other.x && y == other.y;
+    }
+};
+
+// Contiguous ring buffer holding a snake body, head first.
+//
+// Capacity is a power of two so logical -> physical index mapping is a mask.
+// All per-tick operations (advance head, drop tail, grow, reverse) are O(1)
+// and never allocate. Storage only grows (by doubling) when a snake outgrows
+// it and is never released, so reset() and assign() reuse it.
+//
+// Reversal just flips the read direction: element i lives at
+// (start + i) & mask normally, or (start - i) & mask when reversed.
+class SnakeBody {
+public:
+    // Span-style view over contiguous storage
+    struct Run {
+        const Position* data;
+        size_t size;
+    };
+
+    class const_iterator {
+    public:
+        const_iterator(const SnakeBody* body, size_t index) : body(body), index(index) {}
+        const Position& operator*() const { return (*body)[index]; }
+        const Position* operator->() const { return &(*body)[index]; }
+        const_iterator& operator++() { ++index; return *this; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+    private:
+        const SnakeBody* body;
+        size_t index;
+    };
+
+    explicit SnakeBody(size_t initialCapacity = 64)
+        : storage(roundUpPow2(initialCapacity)), mask(storage.size() - 1),
+          start(0), count(0), reversed(false) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return storage.size(); }
+
+    const Position& operator[](size_t i) const { return storage[physical(i)]; }
+    const Position& front() const { return storage[start]; }
+    const Position& back() const { return storage[physical(count - 1)]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+
+    void clear() {
+        start = 0;
+        count = 0;
+        reversed = false;
+    }
+
+    void reserve(size_t n) {
+        if (n > storage.size()) regrow(n);
+    }
+
+    // New head (O(1))
+    void pushFront(const Position& p) {
+        if (count == storage.size()) regrow(count + 1);
+        start = reversed ? ((start + 1) & mask) : ((start - 1) & mask);
+        storage[start] = p;
+        count++;
+    }
+
+    // New tail segment (O(1))
+    void pushBack(const Position& p) {
+        if (count == storage.size()) regrow(count + 1);
+        storage[physical(count)] = p;
+        count++;
+    }
+
+    void popBack() {
+        if (count > 0) count--;
+    }
+
+    // Head becomes tail (O(1))
+    void reverse() {
+        if (count == 0) return;
+        start = physical(count - 1);
+        reversed = !reversed;
+    }
+
+    // Bulk replace, reusing existing storage
+    void assign(const Position* segments, size_t n) {
+        if (n > storage.size()) regrow(n);
+        for (size_t i = 0; i < n; i++) {
+            storage[i] = segments[i];
+        }
+        start = 0;
+        count = n;
+        reversed = false;
+    }
+
+    // Storage-order view as at most two contiguous runs, for consumers that
+    // don't care about segment order (rendering, occupancy). Returns the
+    // number of runs written to out.
+    int runs(Run out[2]) const {
+        if (count == 0) return 0;
+        size_t first = reversed ? physical(count - 1) : start;  // lowest address of the body
+        size_t firstLen = storage.size() - first;
+        if (firstLen >= count) {
+            out[0] = {&storage[first], count};
+            return 1;
+        }
+        out[0] = {&storage[first], firstLen};
+        out[1] = {&storage[0], count - firstLen};
+        return 2;
+    }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t cap = 1;
+        while (cap < n) cap <<= 1;
+        return cap;
+    }
+
+    size_t physical(size_t i) const {
+        return (reversed ? (start - i) : (start + i)) & mask;
+    }
+
+    // Rare path: copy out in logical order into a larger buffer
+    void regrow(size_t minCapacity) {
+        std::vector<Position> bigger(roundUpPow2(minCapacity));
+        for (size_t i = 0; i < count; i++) {
+            bigger[i] = (*this)[i];
+        }
+        storage.swap(bigger);
+        mask = storage.size() - 1;
+        start = 0;
+        reversed = false;
+    }
+
+    std::vector<Position> storage;
+    size_t mask;
+    size_t start;     // Physical index of the head
+    size_t count;
+    bool reversed;    // Read direction
+};
+
+#endif // SNAKEBODY_H
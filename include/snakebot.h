@@ -0,0 +1,94 @@
+#ifndef SNAKEBOT_H
+#define SNAKEBOT_H
+
+#include "engine.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Free cells of the board as bitmasks, one bit per cell and 64 cells per
+// word. Each row is padded with a zero word on both sides and the board with
+// a zero row above and below, so flood fills shift whole rows without edge
+// checks: anything shifted past the border lands on a blocked bit.
+class BotBoard {
+public:
+    BotBoard() : width(0), height(0), stride(0) {}
+
+    // Every cell free
+    void reset(int newWidth, int newHeight);
+    // Free where the grid is empty
+    void build(const OccupancyGrid& occupancy);
+    void block(const Position& p);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int wordsPerRow() const { return stride; }  // Padding included
+
+    bool isFree(const Position& p) const {
+        return p.x >= 0 && p.x < width && p.y >= 0 && p.y < height &&
+               (free[wordIndex(p)] >> (p.x & 63) & 1) != 0;
+    }
+
+    // Padded row y + 1 holds board row y
+    const uint64_t* row(int paddedRow) const { return free.data() + (size_t)paddedRow * stride; }
+    size_t wordIndex(const Position& p) const { return (size_t)(p.y + 1) * stride + 1 + (p.x >> 6); }
+
+private:
+    int width;
+    int height;
+    int stride;
+    std::vector<uint64_t> free;
+};
+
+// Computer player. Every decision runs bitboard BFS floods, one layer per
+// step: the frontier spreads left and right by shifting its row words, up
+// and down by reading the neighbouring rows, masked by the free cells and
+// the cells already reached. One flood from the food gives the step count
+// to each cell the head could enter; one flood per such cell tells whether
+// the room behind it can hold the snake (a closed-off region smaller than
+// the snake is a trap). Moves are ranked by room first, then by staying
+// clear of cells another head could enter this tick, then by food
+// distance, and going straight on breaks ties.
+//
+// Floods stop after Config::Bots::SEARCH_DEPTH layers, or as soon as they
+// answered their question, and only walk the rows and words the frontier
+// can have reached, so a decision costs microseconds whatever the board
+// size. Not thread-safe: the scratch bitmasks are reused across decisions,
+// so use one SnakeBot per thread.
+class SnakeBot {
+public:
+    // Best move for a snake whose head is at `head`, heading `heading`
+    // (NONE at rest); NONE when every neighbouring cell is blocked.
+    // Rival heads equal to `head` are skipped, so the caller may pass
+    // every live head.
+    Direction choose(const BotBoard& board, const Position& head, Direction heading, int length,
+                     const Position& food, const std::vector<Position>& rivalHeads);
+
+    // Steers every active bot slot through Snake::setDirection, like
+    // keyboard input; call before the tick
+    void steer(PlayerManager& players, const OccupancyGrid& occupancy, const Position& food);
+
+    static bool isBot(const PlayerSlot& slot);
+    static std::string botClientId(int slot);
+
+private:
+    struct Flood {
+        int area;        // Cells reached, the start included; only counted if enclosed
+        bool enclosed;   // The region ran out before the flood stopped
+    };
+
+    // BFS from `start`, at most SEARCH_DEPTH layers. probeSteps[i] gets the
+    // layer that reached probes[i] (-1 if none did). Stops early once every
+    // probe is reached and at least `minArea` cells are.
+    Flood flood(const BotBoard& board, const Position& start, int minArea,
+                const Position* probes, int probeCount, int* probeSteps);
+    void fitScratch(const BotBoard& board);
+
+    BotBoard board;  // steer(): the grid as of this tick
+    std::vector<Position> heads;
+    std::vector<uint64_t> visited;
+    std::vector<uint64_t> frontier;
+    std::vector<uint64_t> next;
+};
+
+#endif // SNAKEBOT_H
@@ -0,0 +1,107 @@
+#ifndef WIREFORMAT_H
+#define WIREFORMAT_H
+
+#include "snakebody.h"
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Packed binary encoding of game_state snapshots.
+//
+// Layout (little-endian):
+//   header  u8 version, u8 kind (0 = keyframe, 1 = delta), u32 seq,
+//           u32 baseSeq (0 for keyframes), u8 playerCount, u16 foodX,
+//           u16 foodY, u32 matchStartTime, u32 elapsedMs
+//   player  u8 index, u8 flags (bit0 = alive, bit1 = delta, bit2 = input),
+//           if input: u32 inputSeq, u8 inputAge, u8 heading; then either
+//   - full:  u16 chainLength, u8 tailRepeat, u16 headX, u16 headY,
+//            ceil((chainLength - 1) / 4) bytes of 2-bit step codes
+//   - delta: u8 headAdvance, u16 tailTrim, u8 tailRepeat,
+//            ceil(headAdvance / 4) bytes of 2-bit step codes
+//
+// A full body is sent as the head plus one step code per following segment
+// (each segment is adjacent to the previous one). grow() duplicates the
+// tail cell, so trailing duplicates are sent as a repeat count instead.
+//
+// A delta is relative to the snapshot baseSeq that every client has
+// acknowledged: the new head cells are stepped outwards from the old head,
+// tailTrim cells are dropped from the old tail and tailRepeat copies of the
+// new last cell are appended. Players that can't be described that way
+// (respawn, reversal) fall back to a full record inside the delta.
+//
+// The input block lets a client reconcile its predicted snake: inputSeq is
+// the newest player_input the host applied for that player, inputAge the
+// host ticks simulated since then, heading the snake's current (low nibble)
+// and queued (high nibble) direction.
+//
+// The snapshot travels base64-encoded in the "bin" field of game_state.
+namespace WireFormat {
+
+constexpr uint8_t VERSION = 3;
+
+enum SnapshotKind : uint8_t { KEYFRAME = 0, DELTA = 1 };
+
+enum class DecodeResult {
+    OK,
+    MALFORMED,
+    MISSING_BASE  // Delta against a snapshot we no longer (or never) had
+};
+
+struct PlayerState {
+    int index;
+    bool alive;
+    uint32_t inputSeq;  // 0 = no input block
+    uint8_t inputAge;
+    uint8_t heading;
+    std::vector<Position> body;  // Storage reused across decodes
+};
+
+struct StateSnapshot {
+    uint32_t seq;  // 0 = unused
+    Position food;
+    uint32_t matchStartTime;
+    uint32_t elapsedMs;
+    int playerCount;
+    std::vector<PlayerState> players;  // First playerCount entries are valid
+
+    StateSnapshot() : seq(0), food{0, 0}, matchStartTime(0), elapsedMs(0), playerCount(0) {}
+
+    // Next player entry, reusing its storage
+    PlayerState& addPlayer();
+    const PlayerState* findPlayer(int index) const;
+    void copyFrom(const StateSnapshot& other);  // Reuses body storage
+};
+
+// Most recent snapshots, indexed by sequence number. The host keeps what it
+// sent, clients keep what they applied; deltas may only reference a base
+// still inside the window.
+class SnapshotHistory {
+public:
+    static constexpr uint32_t CAPACITY = 64;
+
+    // Slot for seq, overwriting whatever was CAPACITY snapshots ago
+    StateSnapshot& store(uint32_t seq);
+    const StateSnapshot* find(uint32_t seq) const;
+    void clear();
+
+private:
+    std::array<StateSnapshot, CAPACITY> slots;
+};
+
+// Encodes current as a keyframe (base == nullptr) or as a delta against base.
+// Returns false if a body can't be step-encoded.
+bool encodeSnapshot(const StateSnapshot& current, const StateSnapshot* base,
+                    std::vector<uint8_t>& out);
+
+// Decodes into a full snapshot, resolving deltas through history
+DecodeResult decodeSnapshot(const uint8_t* data, size_t length,
+                            const SnapshotHistory& history, StateSnapshot& out);
+
+void base64Encode(const uint8_t* data, size_t length, std::string& out);
+bool base64Decode(const char* text, size_t length, std::vector<uint8_t>& out);
+
+} // namespace WireFormat
+
+#endif // WIREFORMAT_H
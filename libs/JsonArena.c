@@ -0,0 +1,220 @@
+#include "JsonArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/* Varje allokering börjar med ett huvud som säger varifrån den kom, så
+   free kan skilja arenaminne (gör inget) från heapminne */
+typedef struct AllocHeader {
+    JsonArena *arena;  /* NULL = heapen */
+    size_t reserved;   /* håller datat 16‑bytesjusterat */
+} AllocHeader;
+
+#define HEADER_SIZE 16
+_Static_assert(sizeof(AllocHeader) <= HEADER_SIZE, "AllocHeader ryms inte");
+
+#define ALIGN_UP(n) (((n) + 15) & ~(size_t)15)
+
+#define CHUNK_SIZE (16 * 1024)            /* vanligt block */
+#define LARGE_ALLOC (CHUNK_SIZE / 4)      /* större får ett eget block */
+#define RETAIN_BYTES (64 * 1024)          /* behålls över en återställning */
+#define POOL_MAX 64                       /* lediga arenor som sparas */
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t size;  /* användbara bytes efter huvudet */
+} ArenaChunk;
+
+#define CHUNK_HEADER ALIGN_UP(sizeof(ArenaChunk))
+
+struct JsonArena {
+    JsonArena *next_free;  /* i poolen */
+    atomic_int refs;
+    ArenaChunk *chunks;    /* det första är det som fylls på */
+    ArenaChunk *spare;     /* vanliga block sparade från förra återställningen */
+    char *cur;
+    char *end;
+};
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static JsonArena *pool_head = NULL;
+static int pool_count = 0;
+
+static _Thread_local JsonArena *current_arena = NULL;
+
+static char *chunk_data(ArenaChunk *chunk) {
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+static ArenaChunk *new_chunk(size_t size) {
+    ArenaChunk *chunk = (ArenaChunk *)malloc(CHUNK_HEADER + size);
+    if (!chunk) return NULL;
+    chunk->next = NULL;
+    chunk->size = size;
+    return chunk;
+}
+
+static void *arena_alloc(JsonArena *arena, size_t size) {
+    size = ALIGN_UP(size);
+
+    /* Stora allokeringar läggs bakom det aktuella blocket, så det som är
+       kvar av det inte går förlorat */
+    if (size > LARGE_ALLOC) {
+        ArenaChunk *chunk = new_chunk(size);
+        if (!chunk) return NULL;
+        if (arena->chunks) {
+            chunk->next = arena->chunks->next;
+            arena->chunks->next = chunk;
+        } else {
+            arena->chunks = chunk;
+            arena->cur = arena->end = chunk_data(chunk) + size;
+        }
+        return chunk_data(chunk);
+    }
+
+    if ((size_t)(arena->end - arena->cur) < size) {
+        ArenaChunk *chunk = arena->spare;
+        if (chunk) {
+            arena->spare = chunk->next;
+        } else {
+            chunk = new_chunk(CHUNK_SIZE);
+            if (!chunk) return NULL;
+        }
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->cur = chunk_data(chunk);
+        arena->end = arena->cur + CHUNK_SIZE;
+    }
+    void *ptr = arena->cur;
+    arena->cur += size;
+    return ptr;
+}
+
+/* Sparar vanliga block upp till RETAIN_BYTES och frigör resten */
+static void arena_reset(JsonArena *arena) {
+    size_t kept_bytes = 0;
+    for (ArenaChunk *chunk = arena->spare; chunk; chunk = chunk->next) {
+        kept_bytes += CHUNK_SIZE;
+    }
+    ArenaChunk *chunk = arena->chunks;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        if (chunk->size == CHUNK_SIZE && kept_bytes + CHUNK_SIZE <= RETAIN_BYTES) {
+            chunk->next = arena->spare;
+            arena->spare = chunk;
+            kept_bytes += CHUNK_SIZE;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    arena->chunks = NULL;
+    arena->cur = NULL;
+    arena->end = NULL;
+}
+
+static void free_chunks(ArenaChunk *chunk) {
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+static void arena_destroy(JsonArena *arena) {
+    free_chunks(arena->chunks);
+    free_chunks(arena->spare);
+    free(arena);
+}
+
+/* --- janssons allokator --- */
+
+static void *arena_json_malloc(size_t size) {
+    JsonArena *arena = current_arena;
+    AllocHeader *header = arena ? (AllocHeader *)arena_alloc(arena, HEADER_SIZE + size)
+                                : (AllocHeader *)malloc(HEADER_SIZE + size);
+    if (!header) return NULL;
+    header->arena = arena;
+    return (char *)header + HEADER_SIZE;
+}
+
+static void arena_json_free(void *ptr) {
+    AllocHeader *header = (AllocHeader *)((char *)ptr - HEADER_SIZE);
+    if (!header->arena) {
+        free(header);
+    }
+}
+
+/* Före main, så inget jansson‑minne hinner allokeras utan huvud */
+__attribute__((constructor))
+static void install_alloc_funcs(void) {
+    json_set_alloc_funcs(arena_json_malloc, arena_json_free);
+}
+
+/* --- Publikt API --- */
+
+JsonArena *json_arena_acquire(void) {
+    pthread_mutex_lock(&pool_lock);
+    JsonArena *arena = pool_head;
+    if (arena) {
+        pool_head = arena->next_free;
+        pool_count--;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!arena) {
+        arena = (JsonArena *)calloc(1, sizeof(JsonArena));
+        if (!arena) return NULL;
+    }
+    arena->next_free = NULL;
+    atomic_init(&arena->refs, 1);
+    return arena;
+}
+
+void json_arena_retain(JsonArena *arena) {
+    if (arena) atomic_fetch_add_explicit(&arena->refs, 1, memory_order_relaxed);
+}
+
+void json_arena_release(JsonArena *arena) {
+    if (!arena) return;
+    if (atomic_fetch_sub_explicit(&arena->refs, 1, memory_order_acq_rel) != 1) return;
+
+    arena_reset(arena);
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_count < POOL_MAX) {
+        arena->next_free = pool_head;
+        pool_head = arena;
+        pool_count++;
+        arena = NULL;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (arena) arena_destroy(arena);
+}
+
+JsonArena *json_arena_enter(JsonArena *arena) {
+    JsonArena *previous = current_arena;
+    current_arena = arena;
+    return previous;
+}
+
+void json_arena_leave(JsonArena *previous) {
+    current_arena = previous;
+}
+
+JsonArena *json_arena_of(const json_t *value) {
+    if (!value) return NULL;
+    const AllocHeader *header = (const AllocHeader *)((const char *)value - HEADER_SIZE);
+    return header->arena;
+}
+
+void json_free_text(char *text) {
+    if (!text) return;
+    json_free_t free_fn;
+    json_get_alloc_funcs(NULL, &free_fn);
+    free_fn(text);
+}
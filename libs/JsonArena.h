@@ -0,0 +1,47 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <stddef.h>
+#include "jansson/jansson.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Arenor för janssons minne: json_set_alloc_funcs pekas om (innan main)
+   till en allokator som tar minne från trådens aktuella arena, eller från
+   heapen när ingen är aktiv. Frigöranden i en arena är gratis; allt släpps
+   i en enda återställning när arenans sista referens lämnas tillbaka.
+
+   Ett meddelande tolkas alltså in i en egen arena, som följer med det tills
+   den som hanterar det är klar, och ett meddelande som byggs för att
+   skickas byggs i en arena som återställs efter sändningen. Inget
+   jansson‑värde från en arena får leva kvar efter att den återställts. */
+typedef struct JsonArena JsonArena;
+
+/* En tom arena ur poolen, med en referens. NULL vid minnesbrist. */
+JsonArena *json_arena_acquire(void);
+
+/* Referensräkningen är trådsäker; sista json_arena_release återställer
+   arenan och lämnar den till poolen. NULL ignoreras. */
+void json_arena_retain(JsonArena *arena);
+void json_arena_release(JsonArena *arena);
+
+/* Gör arena (eller NULL = heapen) till trådens aktuella och returnerar den
+   förra, som ska ges till json_arena_leave. Bara en tråd åt gången får
+   allokera ur en arena. */
+JsonArena *json_arena_enter(JsonArena *arena);
+void json_arena_leave(JsonArena *previous);
+
+/* Arenan som ett json_t (objekt, array, sträng eller tal, inte
+   true/false/null) allokerades i, eller NULL för heapen. */
+JsonArena *json_arena_of(const json_t *value);
+
+/* Frigör text från json_dumps med janssons allokator (inte free). */
+void json_free_text(char *text);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_ARENA_H */
@@ -1,736 +1,2183 @@
-#include "MultiplayerApi.h"
-
-#include <stdlib.h>
-#include <string.h>
-#include <stdio.h>
-#include <errno.h>
-
-#include <unistd.h>
-#include <pthread.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <arpa/inet.h>
-
-typedef struct ListenerNode {
-    int id;
-    MultiplayerListener cb;
-    void *user_data;
-    struct ListenerNode *next;
-} ListenerNode;
-
-typedef struct ListenerSnapshot {
-    MultiplayerListener cb;
-    void *user_data;
-} ListenerSnapshot;
-
-struct MultiplayerApi {
-    char *server_host;
-    uint16_t server_port;
-    int sockfd;
-    char *session_id;
-
-    pthread_t recv_thread;
-    int recv_thread_started;
-    int running;
-
-    pthread_mutex_t lock;
-    ListenerNode *listeners;
-    int next_listener_id;
-};
-
-static int connect_to_server(const char *host, uint16_t port);
-static int ensure_connected(MultiplayerApi *api);
-static int send_all(int fd, const char *buf, size_t len);
-static int send_json_line(MultiplayerApi *api, json_t *obj); /* tar över ägarskap */
-static int read_line(int fd, char **out_line);
-static void *recv_thread_main(void *arg);
-static void process_line(MultiplayerApi *api, const char *line);
-static int start_recv_thread(MultiplayerApi *api);
-
-MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port) {
-    MultiplayerApi *api = (MultiplayerApi *)calloc(1, sizeof(MultiplayerApi));
-    if (!api) {
-        return NULL;
-    }
-
-    if (server_host) {
-        api->server_host = strdup(server_host);
-    } else {
-        api->server_host = strdup("127.0.0.1");
-    }
-
-    if (!api->server_host) {
-        free(api);
-        return NULL;
-    }
-
-    api->server_port = server_port;
-    api->sockfd = -1;
-    api->session_id = NULL;
-    api->recv_thread_started = 0;
-    api->running = 0;
-    api->listeners = NULL;
-    api->next_listener_id = 1;
-
-    if (pthread_mutex_init(&api->lock, NULL) != 0) {
-        free(api->server_host);
-        free(api);
-        return NULL;
-    }
-
-    return api;
-}
-
-void mp_api_destroy(MultiplayerApi *api) {
-    if (!api) return;
-
-    if (api->recv_thread_started && api->sockfd >= 0) {
-        fprintf(stderr, "[MultiplayerApi] Shutting down socket (fd=%d)...\n", api->sockfd);
-        shutdown(api->sockfd, SHUT_RDWR);
-        pthread_join(api->recv_thread, NULL);
-    }
-
-    if (api->sockfd >= 0) {
-        close(api->sockfd);
-        fprintf(stderr, "[MultiplayerApi] Socket closed (fd=%d)\n", api->sockfd);
-        api->sockfd = -1;
-    }
-
-    pthread_mutex_lock(&api->lock);
-    ListenerNode *node = api->listeners;
-    api->listeners = NULL;
-    pthread_mutex_unlock(&api->lock);
-
-    while (node) {
-        ListenerNode *next = node->next;
-        free(node);
-        node = next;
-    }
-
-    if (api->session_id) {
-        free(api->session_id);
-    }
-    if (api->server_host) {
-        free(api->server_host);
-    }
-
-    pthread_mutex_destroy(&api->lock);
-    free(api);
-}
-
-int mp_api_host(MultiplayerApi *api,
-                char **out_session,
-                char **out_clientId,
-                json_t **out_data) {
-    if (!api) return MP_API_ERR_ARGUMENT;
-    if (api->session_id) return MP_API_ERR_STATE;
-
-    int rc = ensure_connected(api);
-    if (rc != MP_API_OK) return rc;
-
-    json_t *root = json_object();
-    if (!root) return MP_API_ERR_IO;
-
-    json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
-    json_object_set_new(root, "session", json_null());
-    json_object_set_new(root, "cmd", json_string("host"));
-    json_object_set_new(root, "data", json_object());
-
-    rc = send_json_line(api, root);
-    if (rc != MP_API_OK) {
-        return rc;
-    }
-
-    char *line = NULL;
-    rc = read_line(api->sockfd, &line);
-    if (rc != MP_API_OK) {
-        return rc;
-    }
-
-    json_error_t jerr;
-    json_t *resp = json_loads(line, 0, &jerr);
-    free(line);
-    if (!resp || !json_is_object(resp)) {
-        if (resp) json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
-    json_t *cmd_val = json_object_get(resp, "cmd");
-    if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "host") != 0) {
-        json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
-    json_t *sess_val = json_object_get(resp, "session");
-    if (!json_is_string(sess_val)) {
-        json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-    const char *session = json_string_value(sess_val);
-
-    json_t *cid_val = json_object_get(resp, "clientId");
-    const char *clientId = json_is_string(cid_val) ? json_string_value(cid_val) : NULL;
-
-    json_t *data_val = json_object_get(resp, "data");
-    json_t *data_obj = NULL;
-    if (json_is_object(data_val)) {
-        data_obj = data_val;
-        json_incref(data_obj);
-    }
-
-    api->session_id = strdup(session);
-    if (!api->session_id) {
-        if (data_obj) json_decref(data_obj);
-        json_decref(resp);
-        return MP_API_ERR_IO;
-    }
-
-    if (out_session) {
-        *out_session = strdup(session);
-    }
-    if (out_clientId && clientId) {
-        *out_clientId = strdup(clientId);
-    }
-    if (out_data) {
-        *out_data = data_obj;
-    } else if (data_obj) {
-        json_decref(data_obj);
-    }
-
-    json_decref(resp);
-
-    rc = start_recv_thread(api);
-    if (rc != MP_API_OK) {
-        return rc;
-    }
-
-    return MP_API_OK;
-}
-
-int mp_api_list(MultiplayerApi *api, json_t **out_list)
-{
-	if (!api || !out_list) return MP_API_ERR_ARGUMENT;
-
-	int rc = ensure_connected(api);
-	if (rc != MP_API_OK) return rc;
-
-	json_t *root = json_object();
-	if (!root) return MP_API_ERR_IO;
-
-	json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
-	json_object_set_new(root, "cmd", json_string("list"));
-
-	rc = send_json_line(api, root);
-	if (rc != MP_API_OK) {
-		return rc;
-	}
-
-	char *line = NULL;
-	rc = read_line(api->sockfd, &line);
-	if (rc != MP_API_OK) {
-		return rc;
-	}
-
-	json_error_t jerr;
-	json_t *resp = json_loads(line, 0, &jerr);
-	free(line);
-	if (!resp || !json_is_object(resp)) {
-		if (resp) json_decref(resp);
-		return MP_API_ERR_PROTOCOL;
-	}
-
-	json_t *cmd_val = json_object_get(resp, "cmd");
-	if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "list") != 0) {
-		json_decref(resp);
-		return MP_API_ERR_PROTOCOL;
-	}
-
-	json_t *list_val = json_object_get(resp, "data");
-	if (!json_is_object(list_val)) {
-		json_decref(resp);
-		return MP_API_ERR_PROTOCOL;
-	}
-
-	json_t *list_obj = json_object_get(list_val, "list");
-	if (!json_is_array(list_obj)) {
-		json_decref(resp);
-		return MP_API_ERR_PROTOCOL;
-	}
-
-	*out_list = list_obj;
-	json_incref(*out_list);
-
-	json_decref(resp);
-	return MP_API_OK;
-}
-
-int mp_api_join(MultiplayerApi *api,
-                const char *sessionId,
-                json_t *data,
-                char **out_session,
-                char **out_clientId,
-                json_t **out_data) {
-    if (!api || !sessionId) return MP_API_ERR_ARGUMENT;
-    if (api->session_id) return MP_API_ERR_STATE;
-
-    int rc = ensure_connected(api);
-    if (rc != MP_API_OK) return rc;
-
-    json_t *root = json_object();
-    if (!root) return MP_API_ERR_IO;
-
-    json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
-    json_object_set_new(root, "session", json_string(sessionId));
-    json_object_set_new(root, "cmd", json_string("join"));
-
-    json_t *data_copy;
-    if (data && json_is_object(data)) {
-        data_copy = json_deep_copy(data);
-    } else {
-        data_copy = json_object();
-    }
-    json_object_set_new(root, "data", data_copy);
-
-    rc = send_json_line(api, root);
-    if (rc != MP_API_OK) {
-        return rc;
-    }
-
-    char *line = NULL;
-    rc = read_line(api->sockfd, &line);
-    if (rc != MP_API_OK) {
-        return rc;
-    }
-
-    json_error_t jerr;
-    json_t *resp = json_loads(line, 0, &jerr);
-    free(line);
-    if (!resp || !json_is_object(resp)) {
-        if (resp) json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
-    json_t *cmd_val = json_object_get(resp, "cmd");
-    if (!json_is_string(cmd_val) || strcmp(json_string_value(cmd_val), "join") != 0) {
-        json_decref(resp);
-        return MP_API_ERR_PROTOCOL;
-    }
-
-    json_t *sess_val = json_object_get(resp, "session");
-    const char *session = NULL;
-    if (json_is_string(sess_val)) {
-        session = json_string_value(sess_val);
-    }
-
-    json_t *cid_val = json_object_get(resp, "clientId");
-    const char *clientId = json_is_string(cid_val) ? json_string_value(cid_val) : NULL;
-
-    json_t *data_val = json_object_get(resp, "data");
-    json_t *data_obj = NULL;
-    if (json_is_object(data_val)) {
-        data_obj = data_val;
-        json_incref(data_obj);
-    }
-
-    int joinAccepted = 1;
-    if (data_obj) {
-        json_t *status_val = json_object_get(data_obj, "status");
-        if (json_is_string(status_val) &&
-            strcmp(json_string_value(status_val), "error") == 0) {
-            joinAccepted = 0;
-        }
-    }
-
-    if (joinAccepted && session) {
-        api->session_id = strdup(session);
-        if (!api->session_id) {
-            if (data_obj) json_decref(data_obj);
-            json_decref(resp);
-            return MP_API_ERR_IO;
-        }
-    }
-
-    if (out_session && session) {
-        *out_session = strdup(session);
-    }
-    if (out_clientId && clientId) {
-        *out_clientId = strdup(clientId);
-    }
-    if (out_data) {
-        *out_data = data_obj;
-    } else if (data_obj) {
-        json_decref(data_obj);
-    }
-
-    json_decref(resp);
-
-    if (joinAccepted && api->session_id) {
-        rc = start_recv_thread(api);
-        if (rc != MP_API_OK) {
-            return rc;
-        }
-    }
-
-    return joinAccepted ? MP_API_OK : MP_API_ERR_REJECTED;
-}
-
-int mp_api_game(MultiplayerApi *api, json_t *data) {
-    if (!api || !data) return MP_API_ERR_ARGUMENT;
-    if (api->sockfd < 0 || !api->session_id) return MP_API_ERR_STATE;
-
-    json_t *root = json_object();
-    if (!root) return MP_API_ERR_IO;
-
-    json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
-    json_object_set_new(root, "session", json_string(api->session_id));
-    json_object_set_new(root, "cmd", json_string("game"));
-
-    json_t *data_copy;
-    if (json_is_object(data)) {
-        data_copy = json_deep_copy(data);
-    } else {
-        data_copy = json_object();
-    }
-    json_object_set_new(root, "data", data_copy);
-
-    return send_json_line(api, root);
-}
-
-int mp_api_listen(MultiplayerApi *api,
-                  MultiplayerListener cb,
-                  void *user_data) {
-    if (!api || !cb) return -1;
-
-    ListenerNode *node = (ListenerNode *)malloc(sizeof(ListenerNode));
-    if (!node) return -1;
-
-    node->cb = cb;
-    node->user_data = user_data;
-
-    pthread_mutex_lock(&api->lock);
-    node->id = api->next_listener_id++;
-    node->next = api->listeners;
-    api->listeners = node;
-    pthread_mutex_unlock(&api->lock);
-
-    return node->id;
-}
-
-void mp_api_unlisten(MultiplayerApi *api, int listener_id) {
-    if (!api || listener_id <= 0) return;
-
-    pthread_mutex_lock(&api->lock);
-    ListenerNode *prev = NULL;
-    ListenerNode *cur = api->listeners;
-    while (cur) {
-        if (cur->id == listener_id) {
-            if (prev) {
-                prev->next = cur->next;
-            } else {
-                api->listeners = cur->next;
-            }
-            free(cur);
-            break;
-        }
-        prev = cur;
-        cur = cur->next;
-    }
-    pthread_mutex_unlock(&api->lock);
-}
-
-/* --- Interna hjälpfunktioner --- */
-
-static int connect_to_server(const char *host, uint16_t port) {
-    if (!host) host = "127.0.0.1";
-
-    char port_str[16];
-    snprintf(port_str, sizeof(port_str), "%u", (unsigned int)port);
-
-    struct addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;      /* IPv4 eller IPv6 */
-    hints.ai_socktype = SOCK_STREAM;
-
-    struct addrinfo *res = NULL;
-    int err = getaddrinfo(host, port_str, &hints, &res);
-    if (err != 0) {
-        return -1;
-    }
-
-    int fd = -1;
-    for (struct addrinfo *rp = res; rp != NULL; rp = rp->ai_next) {
-        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        if (fd == -1) continue;
-        if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
-            break;
-        }
-        close(fd);
-        fd = -1;
-    }
-
-    freeaddrinfo(res);
-    return fd;
-}
-
-static int ensure_connected(MultiplayerApi *api) {
-    if (!api) return MP_API_ERR_ARGUMENT;
-    if (api->sockfd >= 0) return MP_API_OK;
-
-    int fd = connect_to_server(api->server_host, api->server_port);
-    if (fd < 0) {
-        return MP_API_ERR_CONNECT;
-    }
-    api->sockfd = fd;
-    return MP_API_OK;
-}
-
-static int send_all(int fd, const char *buf, size_t len) {
-    size_t sent = 0;
-    while (sent < len) {
-        ssize_t n = send(fd, buf + sent, len - sent, 0);
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            return -1;
-        }
-        if (n == 0) {
-            return -1;
-        }
-        sent += (size_t)n;
-    }
-    return 0;
-}
-
-static int send_json_line(MultiplayerApi *api, json_t *obj) {
-    if (!api || api->sockfd < 0 || !obj) return MP_API_ERR_ARGUMENT;
-
-    char *text = json_dumps(obj, JSON_COMPACT);
-    if (!text) {
-        json_decref(obj);
-        return MP_API_ERR_IO;
-    }
-
-    size_t len = strlen(text);
-    int fd = api->sockfd;
-
-    int rc = 0;
-    if (send_all(fd, text, len) != 0 || send_all(fd, "\n", 1) != 0) {
-        rc = MP_API_ERR_IO;
-    }
-
-    free(text);
-    json_decref(obj);
-
-    return rc;
-}
-
-static int read_line(int fd, char **out_line) {
-    if (!out_line) return MP_API_ERR_ARGUMENT;
-
-    size_t cap = 256;
-    size_t len = 0;
-    char *buf = (char *)malloc(cap);
-    if (!buf) return MP_API_ERR_IO;
-
-    for (;;) {
-        char c;
-        ssize_t n = recv(fd, &c, 1, 0);
-        if (n < 0) {
-            if (errno == EINTR) continue;
-            free(buf);
-            return MP_API_ERR_IO;
-        }
-        if (n == 0) {
-            free(buf);
-            return MP_API_ERR_IO;
-        }
-
-        if (c == '\n') {
-            break;
-        }
-
-        if (len + 1 >= cap) {
-            cap *= 2;
-            char *tmp = (char *)realloc(buf, cap);
-            if (!tmp) {
-                free(buf);
-                return MP_API_ERR_IO;
-            }
-            buf = tmp;
-        }
-
-        buf[len++] = c;
-    }
-
-    buf[len] = '\0';
-    *out_line = buf;
-    return MP_API_OK;
-}
-
-static void process_line(MultiplayerApi *api, const char *line) {
-    if (!api || !line || !*line) return;
-
-    json_error_t jerr;
-    json_t *root = json_loads(line, 0, &jerr);
-    if (!root || !json_is_object(root)) {
-        if (root) json_decref(root);
-        return;
-    }
-
-    json_t *cmd_val = json_object_get(root, "cmd");
-    if (!json_is_string(cmd_val)) {
-        json_decref(root);
-        return;
-    }
-
-    const char *cmd = json_string_value(cmd_val);
-    if (!cmd) {
-        json_decref(root);
-        return;
-    }
-
-    if (strcmp(cmd, "joined") != 0 &&
-        strcmp(cmd, "leaved") != 0 &&
-        strcmp(cmd, "game") != 0) {
-        json_decref(root);
-        return;
-    }
-
-    json_int_t msgId = 0;
-    json_t *mid_val = json_object_get(root, "messageId");
-    if (json_is_integer(mid_val)) {
-        msgId = json_integer_value(mid_val);
-    }
-
-    const char *clientId = NULL;
-    json_t *cid_val = json_object_get(root, "clientId");
-    if (json_is_string(cid_val)) {
-        clientId = json_string_value(cid_val);
-    }
-
-    json_t *data_val = json_object_get(root, "data");
-    json_t *data_obj;
-    if (json_is_object(data_val)) {
-        data_obj = data_val;
-        json_incref(data_obj);
-    } else {
-        data_obj = json_object();
-    }
-
-    pthread_mutex_lock(&api->lock);
-    int count = 0;
-    ListenerNode *node = api->listeners;
-    while (node) {
-        if (node->cb) count++;
-        node = node->next;
-    }
-
-    if (count == 0) {
-        pthread_mutex_unlock(&api->lock);
-        json_decref(data_obj);
-        json_decref(root);
-        return;
-    }
-
-    ListenerSnapshot *snapshot = (ListenerSnapshot *)malloc(sizeof(ListenerSnapshot) * count);
-    if (!snapshot) {
-        pthread_mutex_unlock(&api->lock);
-        json_decref(data_obj);
-        json_decref(root);
-        return;
-    }
-
-    int idx = 0;
-    node = api->listeners;
-    while (node) {
-        if (node->cb) {
-            snapshot[idx].cb = node->cb;
-            snapshot[idx].user_data = node->user_data;
-            idx++;
-        }
-        node = node->next;
-    }
-    pthread_mutex_unlock(&api->lock);
-
-    for (int i = 0; i < count; ++i) {
-        snapshot[i].cb(cmd, (int64_t)msgId, clientId, data_obj, snapshot[i].user_data);
-    }
-
-    free(snapshot);
-    json_decref(data_obj);
-    json_decref(root);
-}
-
-static void *recv_thread_main(void *arg) {
-    MultiplayerApi *api = (MultiplayerApi *)arg;
-    char buffer[1024];
-    char *acc = NULL;
-    size_t acc_len = 0;
-    size_t acc_cap = 0;
-
-    while (1) {
-        ssize_t n = recv(api->sockfd, buffer, sizeof(buffer), 0);
-        if (n <= 0) {
-            break;
-        }
-
-        for (ssize_t i = 0; i < n; ++i) {
-            char ch = buffer[i];
-            if (ch == '\n') {
-                if (acc_len > 0) {
-                    char *line = (char *)malloc(acc_len + 1);
-                    if (!line) {
-                        acc_len = 0;
-                        continue;
-                    }
-                    memcpy(line, acc, acc_len);
-                    line[acc_len] = '\0';
-
-                    acc_len = 0;
-                    process_line(api, line);
-                    free(line);
-                } else {
-                    acc_len = 0;
-                }
-            } else {
-                if (acc_len + 1 >= acc_cap) {
-                    size_t new_cap = acc_cap == 0 ? 256 : acc_cap * 2;
-                    char *tmp = (char *)realloc(acc, new_cap);
-                    if (!tmp) {
-                        free(acc);
-                        acc = NULL;
-                        acc_len = 0;
-                        acc_cap = 0;
-                        break;
-                    }
-                    acc = tmp;
-                    acc_cap = new_cap;
-                }
-                acc[acc_len++] = ch;
-            }
-        }
-    }
-
-    if (acc) {
-        free(acc);
-    }
-
-    return NULL;
-}
-
-static int start_recv_thread(MultiplayerApi *api) {
-    if (!api) return MP_API_ERR_ARGUMENT;
-    if (api->recv_thread_started) {
-        return MP_API_OK;
-    }
-
-    api->running = 1;
-    int rc = pthread_create(&api->recv_thread, NULL, recv_thread_main, api);
-    if (rc != 0) {
-        api->running = 0;
-        return MP_API_ERR_IO;
-    }
-
-    api->recv_thread_started = 1;
-    return MP_API_OK;
-}
+#include "MultiplayerApi.h"
+#include "JsonArena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+typedef struct ListenerNode {
+    int id;
+    MultiplayerListener cb;
+    void *user_data;
+    struct ListenerNode *next;
+} ListenerNode;
+
+typedef struct ListenerSnapshot {
+    MultiplayerListener cb;
+    void *user_data;
+} ListenerSnapshot;
+
+/* En serialiserad rad ("...\n") i sändkön */
+typedef struct SendFrame {
+    struct SendFrame *next;
+    char *data;
+    size_t len;
+    int flags;
+} SendFrame;
+
+/* Något reaktortråden ska göra åt en annan tråd. Ligger inbäddat i
+   MultiplayerApi, så att köa en åtgärd aldrig allokerar. */
+typedef struct ReactorOp {
+    struct ReactorOp *next;
+    int type;
+    MultiplayerApi *api;
+} ReactorOp;
+
+enum {
+    REACTOR_OP_FLUSH = 1,  /* skriv ut sändkön */
+    REACTOR_OP_DETACH = 2  /* ta bort anslutningen ur epoll */
+};
+
+#define LINE_FIELD_MAX 32
+
+/* Ett inkommande event på väg till en dispatch‑tråd */
+typedef struct DispatchItem {
+    struct DispatchItem *next;
+    MultiplayerApi *api;
+    json_t *root;                /* NULL för en otolkad rad i raw */
+    char type[LINE_FIELD_MAX];   /* radens "type" i data, för raw */
+    size_t raw_len;
+    char raw[];
+} DispatchItem;
+
+typedef struct DispatchWorker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  /* nytt event i kön, eller ett event levererat */
+    DispatchItem *head;
+    DispatchItem *tail;
+    int stop;
+} DispatchWorker;
+
+typedef struct ReactorTimer {
+    int id;
+    uint64_t due_ms;
+    uint32_t interval_ms;  /* 0 = engångs */
+    MpTimerCallback cb;
+    void *user_data;
+} ReactorTimer;
+
+struct MpReactor {
+    int epfd;
+    int wakefd;  /* eventfd: väcker epoll_wait för ops och nya timers */
+    pthread_t thread;
+    int thread_started;
+
+    /* Skyddar ops, timers och räknarna nedan */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  /* en åtgärd utförd, eller en timer‑callback klar */
+    ReactorOp *ops_head;
+    ReactorOp *ops_tail;
+    int stop;
+
+    /* Min‑heap på due_ms */
+    ReactorTimer *timers;
+    int timer_count;
+    int timer_cap;
+    int next_timer_id;
+    int running_timer;  /* timern vars callback körs just nu, annars 0 */
+
+    DispatchWorker *workers;
+    int worker_count;
+    int next_worker;
+};
+
+struct MultiplayerApi {
+    char *server_host;
+    uint16_t server_port;
+    int sockfd;
+    char *session_id;
+    char *client_id;          /* vårt klient‑ID i sessionen, för mp_api_resume */
+
+    /* Förserialiserat kuvert för "game": prefix + data + suffix */
+    char *game_prefix;
+    size_t game_prefix_len;
+
+    /* Reaktorn som driver socketen. registered: socketen ligger i dess
+       epoll; detached (under reactor->lock): den har tagits bort igen. */
+    MpReactor *reactor;
+    int uses_default_reactor;
+    int registered;
+    int detached;
+    int worker;               /* dispatch‑tråd, om reaktorn har sådana */
+    size_t dispatch_pending;  /* events i den trådens kö, under dess lock */
+    ReactorOp flush_op;
+    ReactorOp detach_op;
+    int flush_queued;         /* under reactor->lock */
+
+    pthread_mutex_t lock;
+    ListenerNode *listeners;
+    int next_listener_id;
+
+    /* Ett synkront anrop (host/join/list) väntar på svaret med pending_cmd;
+       reaktorn lämnar det i reply. closed: anslutningen har brutits. */
+    pthread_cond_t reply_cond;
+    const char *pending_cmd;
+    json_t *reply;
+    int closed;
+    int cancelled;            /* mp_api_cancel: ingen ny anslutning heller */
+
+    /* Mottagningsbuffert, bara reaktortråden läser och skriver den.
+       Oläst data: rbuf[rbuf_start..rbuf_end). */
+    char *rbuf;
+    size_t rbuf_start;
+    size_t rbuf_end;
+    size_t rbuf_cap;
+
+    /* Sändkö, skyddad av send_lock. Den som håller låset får skriva till
+       socketen; send_offset är hur mycket av send_head som redan gått. */
+    pthread_mutex_t send_lock;
+    SendFrame *send_head;
+    SendFrame *send_tail;
+    size_t send_offset;
+    size_t send_frames;
+    size_t send_bytes;
+    size_t send_max_bytes;
+    uint64_t send_dropped;
+    int send_async;
+    int send_failed;
+    int resuming;             /* mp_api_resume pågår: bara dess förfrågningar går ut */
+
+    /* Trafikräkning, sätts innan anslutningen används */
+    MpTrafficHook traffic_hook;
+    void *traffic_user_data;
+
+    /* Tar emot speldata otolkad, sätts innan anslutningen används */
+    MultiplayerRawListener raw_listener;
+    void *raw_user_data;
+};
+
+#define RBUF_INITIAL_CAP 4096
+#define REACTOR_MAX_EVENTS 64
+#define CONNECT_TIMEOUT_MS 10000
+#define REQUEST_TIMEOUT_MS 10000  /* Svar på host/list/join */
+#define CONNECT_POLL_MS 100   /* Så ofta en pågående connect ser efter mp_api_cancel */
+#define CONNECT_ATTEMPT_DELAY_MS 250  /* Happy eyeballs: nästa adress om ingen svarat (RFC 8305) */
+#define CONNECT_MAX_ADDRESSES 16
+#define RESUME_BACKOFF_MIN_MS 250
+#define RESUME_BACKOFF_MAX_MS 2000
+
+/* Intern flagga för send_line: en förfrågan från request(), som får gå
+   ut medan mp_api_resume pågår */
+#define SEND_REQUEST 0x100
+
+/* Processgemensam reaktor för mp_api_create, skapas vid första
+   anslutningen och rivs när den sista förstörs */
+static pthread_mutex_t default_reactor_lock = PTHREAD_MUTEX_INITIALIZER;
+static MpReactor *default_reactor = NULL;
+static int default_reactor_refs = 0;
+
+/* Förhandsanslutning (mp_api_preconnect): en socket åt gången, som
+   nästa connect_to_server mot samma server tar över */
+static pthread_mutex_t preconnect_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t preconnect_cond = PTHREAD_COND_INITIALIZER;
+static char *preconnect_host = NULL;
+static uint16_t preconnect_port = 0;
+static int preconnect_fd = -1;
+static int preconnect_running = 0;
+static int preconnect_cancelled = 0;
+
+static MultiplayerApi *create_api(MpReactor *reactor, const char *server_host, uint16_t server_port);
+static int connect_to_server(MultiplayerApi *api);
+static int connect_host(const char *host, uint16_t port, int (*stop)(void *), void *stop_arg,
+                        MpConnectStats *stats);
+static int take_preconnected(MultiplayerApi *api);
+static int is_cancelled(MultiplayerApi *api);
+static int ensure_connected(MultiplayerApi *api);
+static void reset_connection(MultiplayerApi *api);
+static int join_session(MultiplayerApi *api, const char *sessionId, json_t *data,
+                        char **out_session, char **out_clientId, json_t **out_data);
+static int request(MultiplayerApi *api, json_t *req, const char *cmd, json_t **out_resp); /* tar över ägarskap */
+static int send_json_line(MultiplayerApi *api, json_t *obj, int flags); /* tar över ägarskap */
+static int send_game_payload(MultiplayerApi *api, const char *payload, size_t len, int flags, const char *type);
+static int send_line(MultiplayerApi *api, char *line, size_t len, int flags); /* tar över ägarskap */
+static int set_session(MultiplayerApi *api, const char *session);
+static int flush_send_queue(MultiplayerApi *api);
+static void deliver_event(MultiplayerApi *api, json_t *root);
+static void deliver_raw(MultiplayerApi *api, const char *type, const char *line, size_t len);
+static void dispatch_item(MultiplayerApi *api, DispatchItem *item);
+static json_t *parse_line(const char *line, size_t len);
+static void release_line(json_t *root, JsonArena *arena);
+static uint64_t now_ms(void);
+static void deadline_after(struct timespec *until, uint32_t ms);
+static int on_reactor_thread(MpReactor *reactor);
+static void reactor_wake(MpReactor *reactor);
+static void reactor_post(MpReactor *reactor, ReactorOp *op);
+static void reactor_detach(MultiplayerApi *api);
+static void *reactor_main(void *arg);
+static void *dispatch_main(void *arg);
+
+/* --- Reaktor --- */
+
+MpReactor *mp_reactor_create(int dispatch_workers) {
+    if (dispatch_workers < 0) return NULL;
+
+    MpReactor *reactor = (MpReactor *)calloc(1, sizeof(MpReactor));
+    if (!reactor) return NULL;
+
+    reactor->epfd = epoll_create1(EPOLL_CLOEXEC);
+    reactor->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reactor->next_timer_id = 1;
+    if (reactor->epfd < 0 || reactor->wakefd < 0) {
+        if (reactor->epfd >= 0) close(reactor->epfd);
+        if (reactor->wakefd >= 0) close(reactor->wakefd);
+        free(reactor);
+        return NULL;
+    }
+
+    /* data.ptr == NULL betyder wakefd, annars en MultiplayerApi */
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, reactor->wakefd, &ev) != 0 ||
+        pthread_mutex_init(&reactor->lock, NULL) != 0) {
+        close(reactor->epfd);
+        close(reactor->wakefd);
+        free(reactor);
+        return NULL;
+    }
+    if (pthread_cond_init(&reactor->cond, NULL) != 0) {
+        pthread_mutex_destroy(&reactor->lock);
+        close(reactor->epfd);
+        close(reactor->wakefd);
+        free(reactor);
+        return NULL;
+    }
+
+    if (dispatch_workers > 0) {
+        reactor->workers = (DispatchWorker *)calloc((size_t)dispatch_workers, sizeof(DispatchWorker));
+        if (!reactor->workers) {
+            mp_reactor_destroy(reactor);
+            return NULL;
+        }
+        for (int i = 0; i < dispatch_workers; i++) {
+            DispatchWorker *w = &reactor->workers[i];
+            pthread_mutex_init(&w->lock, NULL);
+            pthread_cond_init(&w->cond, NULL);
+            if (pthread_create(&w->thread, NULL, dispatch_main, w) != 0) {
+                pthread_cond_destroy(&w->cond);
+                pthread_mutex_destroy(&w->lock);
+                mp_reactor_destroy(reactor);
+                return NULL;
+            }
+            reactor->worker_count++;
+        }
+    }
+
+    /* Sätts före start så att tråden själv ser det */
+    reactor->thread_started = 1;
+    if (pthread_create(&reactor->thread, NULL, reactor_main, reactor) != 0) {
+        reactor->thread_started = 0;
+        mp_reactor_destroy(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+void mp_reactor_destroy(MpReactor *reactor) {
+    if (!reactor) return;
+
+    if (reactor->thread_started) {
+        pthread_mutex_lock(&reactor->lock);
+        reactor->stop = 1;
+        pthread_mutex_unlock(&reactor->lock);
+        reactor_wake(reactor);
+        pthread_join(reactor->thread, NULL);
+    }
+
+    for (int i = 0; i < reactor->worker_count; i++) {
+        DispatchWorker *w = &reactor->workers[i];
+        pthread_mutex_lock(&w->lock);
+        w->stop = 1;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+
+        DispatchItem *item = w->head;
+        while (item) {
+            DispatchItem *next = item->next;
+            if (item->root) release_line(item->root, json_arena_of(item->root));
+            free(item);
+            item = next;
+        }
+        pthread_cond_destroy(&w->cond);
+        pthread_mutex_destroy(&w->lock);
+    }
+    free(reactor->workers);
+    free(reactor->timers);
+
+    close(reactor->wakefd);
+    close(reactor->epfd);
+    pthread_cond_destroy(&reactor->cond);
+    pthread_mutex_destroy(&reactor->lock);
+    free(reactor);
+}
+
+static void timer_swap(ReactorTimer *timers, int a, int b) {
+    ReactorTimer tmp = timers[a];
+    timers[a] = timers[b];
+    timers[b] = tmp;
+}
+
+static void timer_sift_up(MpReactor *reactor, int i) {
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (reactor->timers[parent].due_ms <= reactor->timers[i].due_ms) break;
+        timer_swap(reactor->timers, parent, i);
+        i = parent;
+    }
+}
+
+static void timer_sift_down(MpReactor *reactor, int i) {
+    for (;;) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int smallest = i;
+        if (left < reactor->timer_count && reactor->timers[left].due_ms < reactor->timers[smallest].due_ms) {
+            smallest = left;
+        }
+        if (right < reactor->timer_count && reactor->timers[right].due_ms < reactor->timers[smallest].due_ms) {
+            smallest = right;
+        }
+        if (smallest == i) break;
+        timer_swap(reactor->timers, smallest, i);
+        i = smallest;
+    }
+}
+
+/* Anropas med reactor->lock */
+static int timer_push(MpReactor *reactor, const ReactorTimer *timer) {
+    if (reactor->timer_count == reactor->timer_cap) {
+        int new_cap = reactor->timer_cap == 0 ? 16 : reactor->timer_cap * 2;
+        ReactorTimer *tmp = (ReactorTimer *)realloc(reactor->timers, sizeof(ReactorTimer) * (size_t)new_cap);
+        if (!tmp) return -1;
+        reactor->timers = tmp;
+        reactor->timer_cap = new_cap;
+    }
+    reactor->timers[reactor->timer_count] = *timer;
+    timer_sift_up(reactor, reactor->timer_count++);
+    return 0;
+}
+
+/* Anropas med reactor->lock */
+static void timer_remove_at(MpReactor *reactor, int i) {
+    reactor->timer_count--;
+    if (i == reactor->timer_count) return;
+    reactor->timers[i] = reactor->timers[reactor->timer_count];
+    timer_sift_down(reactor, i);
+    timer_sift_up(reactor, i);
+}
+
+int mp_reactor_add_timer(MpReactor *reactor,
+                         uint32_t delay_ms,
+                         uint32_t interval_ms,
+                         MpTimerCallback cb,
+                         void *user_data) {
+    if (!reactor || !cb) return -1;
+
+    pthread_mutex_lock(&reactor->lock);
+    ReactorTimer timer;
+    timer.id = reactor->next_timer_id++;
+    timer.due_ms = now_ms() + delay_ms;
+    timer.interval_ms = interval_ms;
+    timer.cb = cb;
+    timer.user_data = user_data;
+    if (timer_push(reactor, &timer) != 0) {
+        pthread_mutex_unlock(&reactor->lock);
+        return -1;
+    }
+    /* Ny tidigaste timer: epoll_wait måste räkna om sin timeout */
+    int earliest = reactor->timers[0].id == timer.id;
+    pthread_mutex_unlock(&reactor->lock);
+
+    if (earliest && !on_reactor_thread(reactor)) {
+        reactor_wake(reactor);
+    }
+    return timer.id;
+}
+
+void mp_reactor_cancel_timer(MpReactor *reactor, int timer_id) {
+    if (!reactor || timer_id <= 0) return;
+
+    pthread_mutex_lock(&reactor->lock);
+    for (int i = 0; i < reactor->timer_count; i++) {
+        if (reactor->timers[i].id == timer_id) {
+            timer_remove_at(reactor, i);
+            break;
+        }
+    }
+    /* Körs callbacken just nu får den bli klar först */
+    if (!on_reactor_thread(reactor)) {
+        while (reactor->running_timer == timer_id) {
+            pthread_cond_wait(&reactor->cond, &reactor->lock);
+        }
+    }
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+/* Kör alla timers som förfallit. Returnerar epoll_wait‑timeout till nästa
+   timer i ms, eller -1 om inga finns. */
+static int reactor_run_timers(MpReactor *reactor) {
+    pthread_mutex_lock(&reactor->lock);
+    uint64_t now = now_ms();
+    while (reactor->timer_count > 0 && reactor->timers[0].due_ms <= now) {
+        ReactorTimer timer = reactor->timers[0];
+        timer_remove_at(reactor, 0);
+        if (timer.interval_ms > 0) {
+            /* Tillbaka i heapen före callbacken, så den kan avregistrera sig;
+               missade perioder slås ihop i stället för att köras ikapp */
+            timer.due_ms += timer.interval_ms;
+            if (timer.due_ms <= now) timer.due_ms = now + timer.interval_ms;
+            timer_push(reactor, &timer);
+        }
+
+        reactor->running_timer = timer.id;
+        pthread_mutex_unlock(&reactor->lock);
+        timer.cb(timer.id, timer.user_data);
+        pthread_mutex_lock(&reactor->lock);
+        reactor->running_timer = 0;
+        pthread_cond_broadcast(&reactor->cond);
+        now = now_ms();
+    }
+
+    int timeout = -1;
+    if (reactor->timer_count > 0) {
+        uint64_t wait = reactor->timers[0].due_ms - now;
+        timeout = wait > INT_MAX ? INT_MAX : (int)wait;
+    }
+    pthread_mutex_unlock(&reactor->lock);
+    return timeout;
+}
+
+static void reactor_wake(MpReactor *reactor) {
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(reactor->wakefd, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+}
+
+static int on_reactor_thread(MpReactor *reactor) {
+    return reactor->thread_started && pthread_equal(pthread_self(), reactor->thread);
+}
+
+static void reactor_post(MpReactor *reactor, ReactorOp *op) {
+    pthread_mutex_lock(&reactor->lock);
+    op->next = NULL;
+    if (reactor->ops_tail) {
+        reactor->ops_tail->next = op;
+    } else {
+        reactor->ops_head = op;
+    }
+    reactor->ops_tail = op;
+    pthread_mutex_unlock(&reactor->lock);
+    reactor_wake(reactor);
+}
+
+/* Anslutningen är bruten: väck ett väntande synkront anrop och låt
+   sändningar misslyckas. Socketen ligger kvar tills mp_api_destroy. */
+static void connection_closed(MultiplayerApi *api) {
+    epoll_ctl(api->reactor->epfd, EPOLL_CTL_DEL, api->sockfd, NULL);
+
+    pthread_mutex_lock(&api->lock);
+    api->closed = 1;
+    pthread_cond_broadcast(&api->reply_cond);
+    pthread_mutex_unlock(&api->lock);
+
+    pthread_mutex_lock(&api->send_lock);
+    api->send_failed = 1;
+    pthread_mutex_unlock(&api->send_lock);
+}
+
+/* Släpper ett tolkat meddelande och arenan det tolkades in i */
+static void release_line(json_t *root, JsonArena *arena) {
+    json_decref(root);
+    json_arena_release(arena);
+}
+
+/* Tolkar en rad in i en egen arena, som följer med meddelandet tills sista
+   lyssnaren (eller den som köat det vidare) släppt den. NULL om raden inte
+   är ett JSON‑objekt. */
+static json_t *parse_line(const char *line, size_t len) {
+    JsonArena *arena = json_arena_acquire();
+    JsonArena *previous = json_arena_enter(arena);
+    json_error_t jerr;
+    json_t *root = json_loadb(line, len, 0, &jerr);
+    json_arena_leave(previous);
+    if (!root || !json_is_object(root)) {
+        release_line(root, arena);
+        return NULL;
+    }
+    return root;
+}
+
+/* Det som behövs för att välja väg för en rad innan den tolkas: "cmd" och
+   "type" i dess data. Tomma om de saknas eller inte får plats. */
+typedef struct LineHeader {
+    char cmd[LINE_FIELD_MAX];
+    char type[LINE_FIELD_MAX];
+    int depth;    /* nuvarande nästlingsnivå, 1 = radens objekt */
+    int field;    /* vart nästa värde ska */
+    int in_data;  /* inne i radens "data" */
+} LineHeader;
+
+enum { HEADER_SKIP, HEADER_CMD, HEADER_DATA, HEADER_TYPE };
+
+static int key_is(const char *key, size_t len, const char *name) {
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+static int header_object_start(void *data) {
+    LineHeader *h = (LineHeader *)data;
+    if (h->depth == 1 && h->field == HEADER_DATA) h->in_data = 1;
+    h->depth++;
+    h->field = HEADER_SKIP;
+    return 0;
+}
+
+static int header_array_start(void *data) {
+    LineHeader *h = (LineHeader *)data;
+    h->depth++;
+    h->field = HEADER_SKIP;
+    return 0;
+}
+
+static int header_end(void *data) {
+    LineHeader *h = (LineHeader *)data;
+    h->depth--;
+    if (h->depth == 1) h->in_data = 0;
+    return 0;
+}
+
+static int header_key(const char *key, size_t len, void *data) {
+    LineHeader *h = (LineHeader *)data;
+    h->field = HEADER_SKIP;
+    if (h->depth == 1) {
+        if (key_is(key, len, "cmd")) h->field = HEADER_CMD;
+        else if (key_is(key, len, "data")) h->field = HEADER_DATA;
+    } else if (h->depth == 2 && h->in_data && key_is(key, len, "type")) {
+        h->field = HEADER_TYPE;
+    }
+    return 0;
+}
+
+/* Avbryter så fort båda är kända; resten av raden läses inte */
+static int header_string(const char *value, size_t len, void *data) {
+    LineHeader *h = (LineHeader *)data;
+    char *dest = h->field == HEADER_CMD ? h->cmd : h->field == HEADER_TYPE ? h->type : NULL;
+    if (dest && len < LINE_FIELD_MAX) {
+        memcpy(dest, value, len);
+        dest[len] = '\0';
+    }
+    h->field = HEADER_SKIP;
+    return h->cmd[0] && h->type[0];
+}
+
+static int header_scalar(void *data) {
+    ((LineHeader *)data)->field = HEADER_SKIP;
+    return 0;
+}
+
+static int header_integer(json_int_t value, void *data) {
+    (void)value;
+    return header_scalar(data);
+}
+
+static int header_real(double value, void *data) {
+    (void)value;
+    return header_scalar(data);
+}
+
+static int header_boolean(int value, void *data) {
+    (void)value;
+    return header_scalar(data);
+}
+
+static const json_sax_callbacks_t header_callbacks = {
+    header_object_start, header_end, header_array_start, header_end,
+    header_key, header_string, header_integer, header_real,
+    header_boolean, header_scalar
+};
+
+static void scan_line_header(const char *line, size_t len, LineHeader *header) {
+    memset(header, 0, sizeof(*header));
+    json_error_t jerr;
+    if (json_sax_loadb(line, len, 0, &header_callbacks, header, &jerr) != 0 &&
+        !(header->cmd[0] && header->type[0])) {
+        header->cmd[0] = '\0';  /* trasig rad, får samma väg som förut */
+    }
+}
+
+/* Ger en otolkad spelrad till den råa lyssnaren, eller tolkar den och
+   levererar den som vanligt om lyssnaren inte vill ha den */
+static void deliver_raw(MultiplayerApi *api, const char *type, const char *line, size_t len) {
+    if (api->raw_listener(type, line, len, api->raw_user_data)) return;
+
+    json_t *root = parse_line(line, len);
+    if (root) deliver_event(api, root);
+}
+
+static void handle_line(MultiplayerApi *api, const char *line, size_t len) {
+    /* Speldata med en typ går till en rå lyssnare innan något tolkats till
+       json_t; bara huvudet läses här */
+    if (api->raw_listener) {
+        LineHeader header;
+        scan_line_header(line, len, &header);
+        if (strcmp(header.cmd, "game") == 0 && header.type[0]) {
+            if (api->traffic_hook) {
+                api->traffic_hook(0, header.cmd, header.type, len + 1, api->traffic_user_data);
+            }
+            if (api->reactor->worker_count == 0) {
+                deliver_raw(api, header.type, line, len);
+                return;
+            }
+            DispatchItem *item = (DispatchItem *)malloc(sizeof(DispatchItem) + len + 1);
+            if (!item) return;
+            item->root = NULL;
+            memcpy(item->type, header.type, sizeof(item->type));
+            memcpy(item->raw, line, len);
+            item->raw[len] = '\0';
+            item->raw_len = len;
+            dispatch_item(api, item);
+            return;
+        }
+    }
+
+    json_t *root = parse_line(line, len);
+    if (!root) return;
+    JsonArena *arena = json_arena_of(root);
+
+    json_t *cmd_val = json_object_get(root, "cmd");
+    const char *cmd = json_is_string(cmd_val) ? json_string_value(cmd_val) : NULL;
+    if (!cmd) {
+        release_line(root, arena);
+        return;
+    }
+
+    if (api->traffic_hook) {
+        json_t *type_val = json_object_get(json_object_get(root, "data"), "type");
+        api->traffic_hook(0, cmd, json_is_string(type_val) ? json_string_value(type_val) : NULL,
+                          len + 1, api->traffic_user_data);
+    }
+
+    /* Svar på ett synkront anrop går till den som väntar. Anroparen
+       behåller delar av svaret, så det kopieras ut ur arenan. */
+    pthread_mutex_lock(&api->lock);
+    if (api->pending_cmd && !api->reply && strcmp(cmd, api->pending_cmd) == 0) {
+        api->reply = json_deep_copy(root);
+        if (!api->reply) api->reply = json_pack("{s:s}", "cmd", cmd); /* blir ett protokollfel */
+        pthread_cond_broadcast(&api->reply_cond);
+        pthread_mutex_unlock(&api->lock);
+        release_line(root, arena);
+        return;
+    }
+    pthread_mutex_unlock(&api->lock);
+
+    if (strcmp(cmd, "joined") != 0 &&
+        strcmp(cmd, "leaved") != 0 &&
+        strcmp(cmd, "game") != 0) {
+        release_line(root, arena);
+        return;
+    }
+
+    if (api->reactor->worker_count == 0) {
+        deliver_event(api, root);
+        return;
+    }
+
+    DispatchItem *item = (DispatchItem *)malloc(sizeof(DispatchItem));
+    if (!item) {
+        release_line(root, arena);
+        return;
+    }
+    item->root = root;
+    dispatch_item(api, item);
+}
+
+/* Köar ett event på anslutningens dispatch‑tråd */
+static void dispatch_item(MultiplayerApi *api, DispatchItem *item) {
+    item->next = NULL;
+    item->api = api;
+
+    DispatchWorker *w = &api->reactor->workers[api->worker];
+    pthread_mutex_lock(&w->lock);
+    if (w->tail) {
+        w->tail->next = item;
+    } else {
+        w->head = item;
+    }
+    w->tail = item;
+    api->dispatch_pending++;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+}
+
+/* Läser allt socketen har (kantutlöst epoll) och hanterar varje hel rad.
+   Returnerar -1 när anslutningen är stängd eller trasig. */
+static int read_available(MultiplayerApi *api) {
+    for (;;) {
+        if (api->rbuf_end == api->rbuf_cap) {
+            if (api->rbuf_start > 0) {
+                /* Flytta en påbörjad rad till början */
+                size_t avail = api->rbuf_end - api->rbuf_start;
+                memmove(api->rbuf, api->rbuf + api->rbuf_start, avail);
+                api->rbuf_start = 0;
+                api->rbuf_end = avail;
+            } else {
+                size_t new_cap = api->rbuf_cap == 0 ? RBUF_INITIAL_CAP : api->rbuf_cap * 2;
+                char *tmp = (char *)realloc(api->rbuf, new_cap);
+                if (!tmp) return -1;
+                api->rbuf = tmp;
+                api->rbuf_cap = new_cap;
+            }
+        }
+
+        ssize_t n = recv(api->sockfd, api->rbuf + api->rbuf_end, api->rbuf_cap - api->rbuf_end, MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        api->rbuf_end += (size_t)n;
+
+        for (;;) {
+            char *start = api->rbuf + api->rbuf_start;
+            size_t avail = api->rbuf_end - api->rbuf_start;
+            char *nl = (char *)memchr(start, '\n', avail);
+            if (!nl) break;
+            *nl = '\0';
+            size_t len = (size_t)(nl - start);
+            api->rbuf_start += len + 1;
+            if (len > 0) {
+                handle_line(api, start, len);
+            }
+        }
+        if (api->rbuf_start == api->rbuf_end) {
+            api->rbuf_start = 0;
+            api->rbuf_end = 0;
+        }
+    }
+}
+
+static void handle_connection_event(MultiplayerApi *api, uint32_t events) {
+    int failed = 0;
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+        failed = read_available(api) != 0;
+    }
+    if (!failed && (events & EPOLLOUT)) {
+        pthread_mutex_lock(&api->send_lock);
+        failed = flush_send_queue(api) != 0;
+        pthread_mutex_unlock(&api->send_lock);
+    }
+    if (failed) {
+        connection_closed(api);
+    }
+}
+
+static void reactor_run_ops(MpReactor *reactor) {
+    pthread_mutex_lock(&reactor->lock);
+    ReactorOp *op = reactor->ops_head;
+    reactor->ops_head = NULL;
+    reactor->ops_tail = NULL;
+
+    while (op) {
+        ReactorOp *next = op->next;
+        MultiplayerApi *api = op->api;
+        if (op->type == REACTOR_OP_FLUSH) {
+            api->flush_queued = 0;
+            pthread_mutex_unlock(&reactor->lock);
+            pthread_mutex_lock(&api->send_lock);
+            int failed = !api->send_failed && flush_send_queue(api) != 0;
+            pthread_mutex_unlock(&api->send_lock);
+            if (failed) connection_closed(api);
+            pthread_mutex_lock(&reactor->lock);
+        } else if (op->type == REACTOR_OP_DETACH) {
+            epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, api->sockfd, NULL);
+            api->detached = 1;
+            pthread_cond_broadcast(&reactor->cond);
+        }
+        op = next;
+    }
+    pthread_mutex_unlock(&reactor->lock);
+}
+
+static void *reactor_main(void *arg) {
+    MpReactor *reactor = (MpReactor *)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    for (;;) {
+        int timeout = reactor_run_timers(reactor);
+
+        pthread_mutex_lock(&reactor->lock);
+        int stop = reactor->stop;
+        pthread_mutex_unlock(&reactor->lock);
+        if (stop) break;
+
+        int n = epoll_wait(reactor->epfd, events, REACTOR_MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL) {
+                uint64_t count;
+                while (read(reactor->wakefd, &count, sizeof(count)) > 0) {}
+                continue;
+            }
+            handle_connection_event((MultiplayerApi *)events[i].data.ptr, events[i].events);
+        }
+
+        /* Efter eventen: en DETACH här gör att socketen aldrig syns i nästa
+           epoll_wait, och inget event ovan kan gälla en förstörd anslutning */
+        reactor_run_ops(reactor);
+    }
+
+    return NULL;
+}
+
+static void *dispatch_main(void *arg) {
+    DispatchWorker *w = (DispatchWorker *)arg;
+
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->head && !w->stop) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        if (w->stop) break;
+
+        DispatchItem *item = w->head;
+        w->head = item->next;
+        if (!w->head) w->tail = NULL;
+        pthread_mutex_unlock(&w->lock);
+
+        MultiplayerApi *api = item->api;
+        if (item->root) {
+            deliver_event(api, item->root);
+        } else {
+            deliver_raw(api, item->type, item->raw, item->raw_len);
+        }
+        free(item);
+
+        pthread_mutex_lock(&w->lock);
+        api->dispatch_pending--;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* Tar bort anslutningen ur reaktorn. När funktionen returnerat rör varken
+   reaktorn eller dess dispatch‑trådar api igen. */
+static void reactor_detach(MultiplayerApi *api) {
+    MpReactor *reactor = api->reactor;
+
+    if (on_reactor_thread(reactor)) {
+        /* Från en timer‑callback: inget event är under behandling, men en
+           köad FLUSH får inte köras efteråt */
+        epoll_ctl(reactor->epfd, EPOLL_CTL_DEL, api->sockfd, NULL);
+        pthread_mutex_lock(&reactor->lock);
+        ReactorOp *prev = NULL;
+        for (ReactorOp *op = reactor->ops_head; op; op = op->next) {
+            if (op->api != api) {
+                prev = op;
+                continue;
+            }
+            if (prev) {
+                prev->next = op->next;
+            } else {
+                reactor->ops_head = op->next;
+            }
+            if (reactor->ops_tail == op) reactor->ops_tail = prev;
+        }
+        pthread_mutex_unlock(&reactor->lock);
+    } else {
+        api->detach_op.type = REACTOR_OP_DETACH;
+        api->detach_op.api = api;
+        reactor_post(reactor, &api->detach_op);
+
+        pthread_mutex_lock(&reactor->lock);
+        while (!api->detached) {
+            pthread_cond_wait(&reactor->cond, &reactor->lock);
+        }
+        pthread_mutex_unlock(&reactor->lock);
+    }
+
+    if (reactor->worker_count > 0) {
+        DispatchWorker *w = &reactor->workers[api->worker];
+        pthread_mutex_lock(&w->lock);
+        while (api->dispatch_pending > 0) {
+            pthread_cond_wait(&w->cond, &w->lock);
+        }
+        pthread_mutex_unlock(&w->lock);
+    }
+}
+
+/* --- Anslutningar --- */
+
+MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port) {
+    pthread_mutex_lock(&default_reactor_lock);
+    if (!default_reactor) {
+        default_reactor = mp_reactor_create(0);
+    }
+    MpReactor *reactor = default_reactor;
+    MultiplayerApi *api = reactor ? create_api(reactor, server_host, server_port) : NULL;
+    if (api) {
+        api->uses_default_reactor = 1;
+        default_reactor_refs++;
+    } else if (reactor && default_reactor_refs == 0) {
+        mp_reactor_destroy(reactor);
+        default_reactor = NULL;
+    }
+    pthread_mutex_unlock(&default_reactor_lock);
+    return api;
+}
+
+MultiplayerApi *mp_api_create_on(MpReactor *reactor, const char *server_host, uint16_t server_port) {
+    if (!reactor) return NULL;
+    return create_api(reactor, server_host, server_port);
+}
+
+static MultiplayerApi *create_api(MpReactor *reactor, const char *server_host, uint16_t server_port) {
+    MultiplayerApi *api = (MultiplayerApi *)calloc(1, sizeof(MultiplayerApi));
+    if (!api) {
+        return NULL;
+    }
+
+    if (server_host) {
+        api->server_host = strdup(server_host);
+    } else {
+        api->server_host = strdup("127.0.0.1");
+    }
+
+    if (!api->server_host) {
+        free(api);
+        return NULL;
+    }
+
+    api->server_port = server_port;
+    api->sockfd = -1;
+    api->session_id = NULL;
+    api->reactor = reactor;
+    api->listeners = NULL;
+    api->next_listener_id = 1;
+    api->send_max_bytes = SIZE_MAX;
+
+    /* Varje anslutning stannar på en dispatch‑tråd, så dess events
+       levereras i ordning */
+    pthread_mutex_lock(&reactor->lock);
+    api->worker = reactor->worker_count > 0 ? reactor->next_worker++ % reactor->worker_count : 0;
+    pthread_mutex_unlock(&reactor->lock);
+
+    if (pthread_mutex_init(&api->lock, NULL) != 0) {
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
+
+    if (pthread_cond_init(&api->reply_cond, NULL) != 0) {
+        pthread_mutex_destroy(&api->lock);
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&api->send_lock, NULL) != 0) {
+        pthread_cond_destroy(&api->reply_cond);
+        pthread_mutex_destroy(&api->lock);
+        free(api->server_host);
+        free(api);
+        return NULL;
+    }
+
+    return api;
+}
+
+void mp_api_destroy(MultiplayerApi *api) {
+    if (!api) return;
+
+    if (api->registered) {
+        fprintf(stderr, "[MultiplayerApi] Shutting down socket (fd=%d)...\n", api->sockfd);
+        shutdown(api->sockfd, SHUT_RDWR);
+        reactor_detach(api);
+    }
+
+    /* Det som ligger kvar i sändkön kastas */
+    SendFrame *frame = api->send_head;
+    while (frame) {
+        SendFrame *next = frame->next;
+        free(frame->data);
+        free(frame);
+        frame = next;
+    }
+
+    if (api->sockfd >= 0) {
+        close(api->sockfd);
+        fprintf(stderr, "[MultiplayerApi] Socket closed (fd=%d)\n", api->sockfd);
+        api->sockfd = -1;
+    }
+
+    pthread_mutex_lock(&api->lock);
+    ListenerNode *node = api->listeners;
+    api->listeners = NULL;
+    pthread_mutex_unlock(&api->lock);
+
+    while (node) {
+        ListenerNode *next = node->next;
+        free(node);
+        node = next;
+    }
+
+    if (api->reply) {
+        json_decref(api->reply);
+    }
+    if (api->session_id) {
+        free(api->session_id);
+    }
+    free(api->client_id);
+    free(api->game_prefix);
+    if (api->server_host) {
+        free(api->server_host);
+    }
+
+    free(api->rbuf);
+
+    pthread_mutex_destroy(&api->send_lock);
+    pthread_cond_destroy(&api->reply_cond);
+    pthread_mutex_destroy(&api->lock);
+
+    int uses_default_reactor = api->uses_default_reactor;
+    free(api);
+
+    if (uses_default_reactor) {
+        pthread_mutex_lock(&default_reactor_lock);
+        if (--default_reactor_refs == 0) {
+            mp_reactor_destroy(default_reactor);
+            default_reactor = NULL;
+        }
+        pthread_mutex_unlock(&default_reactor_lock);
+    }
+}
+
+void mp_api_cancel(MultiplayerApi *api) {
+    if (!api) return;
+    pthread_mutex_lock(&api->lock);
+    api->closed = 1;
+    api->cancelled = 1;
+    pthread_cond_broadcast(&api->reply_cond);
+    pthread_mutex_unlock(&api->lock);
+}
+
+int mp_api_host(MultiplayerApi *api,
+                char **out_session,
+                char **out_clientId,
+                json_t **out_data) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (api->session_id) return MP_API_ERR_STATE;
+
+    int rc = ensure_connected(api);
+    if (rc != MP_API_OK) return rc;
+
+    json_t *root = json_object();
+    if (!root) return MP_API_ERR_IO;
+
+    json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
+    json_object_set_new(root, "session", json_null());
+    json_object_set_new(root, "cmd", json_string("host"));
+    json_object_set_new(root, "data", json_object());
+
+    json_t *resp = NULL;
+    rc = request(api, root, "host", &resp);
+    if (rc != MP_API_OK) {
+        return rc;
+    }
+
+    json_t *sess_val = json_object_get(resp, "session");
+    if (!json_is_string(sess_val)) {
+        json_decref(resp);
+        return MP_API_ERR_PROTOCOL;
+    }
+    const char *session = json_string_value(sess_val);
+
+    json_t *cid_val = json_object_get(resp, "clientId");
+    const char *clientId = json_is_string(cid_val) ? json_string_value(cid_val) : NULL;
+
+    json_t *data_val = json_object_get(resp, "data");
+    json_t *data_obj = NULL;
+    if (json_is_object(data_val)) {
+        data_obj = data_val;
+        json_incref(data_obj);
+    }
+
+    if (set_session(api, session) != MP_API_OK) {
+        if (data_obj) json_decref(data_obj);
+        json_decref(resp);
+        return MP_API_ERR_IO;
+    }
+    free(api->client_id);
+    api->client_id = clientId ? strdup(clientId) : NULL;
+
+    if (out_session) {
+        *out_session = strdup(session);
+    }
+    if (out_clientId && clientId) {
+        *out_clientId = strdup(clientId);
+    }
+    if (out_data) {
+        *out_data = data_obj;
+    } else if (data_obj) {
+        json_decref(data_obj);
+    }
+
+    json_decref(resp);
+    return MP_API_OK;
+}
+
+int mp_api_list(MultiplayerApi *api, json_t **out_list)
+{
+	if (!api || !out_list) return MP_API_ERR_ARGUMENT;
+
+	int rc = ensure_connected(api);
+	if (rc != MP_API_OK) return rc;
+
+	json_t *root = json_object();
+	if (!root) return MP_API_ERR_IO;
+
+	json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
+	json_object_set_new(root, "cmd", json_string("list"));
+
+	json_t *resp = NULL;
+	rc = request(api, root, "list", &resp);
+	if (rc != MP_API_OK) {
+		return rc;
+	}
+
+	json_t *list_val = json_object_get(resp, "data");
+	if (!json_is_object(list_val)) {
+		json_decref(resp);
+		return MP_API_ERR_PROTOCOL;
+	}
+
+	json_t *list_obj = json_object_get(list_val, "list");
+	if (!json_is_array(list_obj)) {
+		json_decref(resp);
+		return MP_API_ERR_PROTOCOL;
+	}
+
+	*out_list = list_obj;
+	json_incref(*out_list);
+
+	json_decref(resp);
+	return MP_API_OK;
+}
+
+int mp_api_join(MultiplayerApi *api,
+                const char *sessionId,
+                json_t *data,
+                char **out_session,
+                char **out_clientId,
+                json_t **out_data) {
+    if (!api || !sessionId) return MP_API_ERR_ARGUMENT;
+    if (api->session_id) return MP_API_ERR_STATE;
+    return join_session(api, sessionId, data, out_session, out_clientId, out_data);
+}
+
+static int join_session(MultiplayerApi *api, const char *sessionId, json_t *data,
+                        char **out_session, char **out_clientId, json_t **out_data) {
+    int rc = ensure_connected(api);
+    if (rc != MP_API_OK) return rc;
+
+    json_t *root = json_object();
+    if (!root) return MP_API_ERR_IO;
+
+    json_object_set_new(root, "identifier", json_string("HardcoreSnakeClient"));
+    json_object_set_new(root, "session", json_string(sessionId));
+    json_object_set_new(root, "cmd", json_string("join"));
+
+    json_t *data_copy;
+    if (data && json_is_object(data)) {
+        data_copy = json_deep_copy(data);
+    } else {
+        data_copy = json_object();
+    }
+    json_object_set_new(root, "data", data_copy);
+
+    json_t *resp = NULL;
+    rc = request(api, root, "join", &resp);
+    if (rc != MP_API_OK) {
+        return rc;
+    }
+
+    json_t *sess_val = json_object_get(resp, "session");
+    const char *session = NULL;
+    if (json_is_string(sess_val)) {
+        session = json_string_value(sess_val);
+    }
+
+    json_t *cid_val = json_object_get(resp, "clientId");
+    const char *clientId = json_is_string(cid_val) ? json_string_value(cid_val) : NULL;
+
+    json_t *data_val = json_object_get(resp, "data");
+    json_t *data_obj = NULL;
+    if (json_is_object(data_val)) {
+        data_obj = data_val;
+        json_incref(data_obj);
+    }
+
+    int joinAccepted = 1;
+    if (data_obj) {
+        json_t *status_val = json_object_get(data_obj, "status");
+        if (json_is_string(status_val) &&
+            strcmp(json_string_value(status_val), "error") == 0) {
+            joinAccepted = 0;
+        }
+    }
+
+    if (joinAccepted && session) {
+        if (set_session(api, session) != MP_API_OK) {
+            if (data_obj) json_decref(data_obj);
+            json_decref(resp);
+            return MP_API_ERR_IO;
+        }
+        free(api->client_id);
+        api->client_id = clientId ? strdup(clientId) : NULL;
+    }
+
+    if (out_session && session) {
+        *out_session = strdup(session);
+    }
+    if (out_clientId && clientId) {
+        *out_clientId = strdup(clientId);
+    }
+    if (out_data) {
+        *out_data = data_obj;
+    } else if (data_obj) {
+        json_decref(data_obj);
+    }
+
+    json_decref(resp);
+
+    return joinAccepted ? MP_API_OK : MP_API_ERR_REJECTED;
+}
+
+int mp_api_is_closed(MultiplayerApi *api) {
+    if (!api) return 1;
+    pthread_mutex_lock(&api->lock);
+    int closed = api->closed;
+    pthread_mutex_unlock(&api->lock);
+    return closed;
+}
+
+int mp_api_resume(MultiplayerApi *api,
+                  uint32_t timeout_ms,
+                  json_t *data,
+                  char **out_clientId,
+                  json_t **out_data) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (!api->session_id) return MP_API_ERR_STATE;
+
+    /* Sessionen står kvar (game‑prefixet används av sändande trådar),
+       så en kopia räcker för återanslutningen */
+    char *session = strdup(api->session_id);
+    json_t *payload = (data && json_is_object(data)) ? json_deep_copy(data) : json_object();
+    if (!session || !payload) {
+        free(session);
+        if (payload) json_decref(payload);
+        return MP_API_ERR_IO;
+    }
+    if (api->client_id) {
+        json_object_set_new(payload, "resume", json_string(api->client_id));
+    }
+
+    pthread_mutex_lock(&api->send_lock);
+    api->resuming = 1;
+    pthread_mutex_unlock(&api->send_lock);
+
+    uint64_t deadline = now_ms() + timeout_ms;
+    uint32_t backoff = RESUME_BACKOFF_MIN_MS;
+    int rc;
+    for (;;) {
+        reset_connection(api);
+        rc = join_session(api, session, payload, NULL, out_clientId, out_data);
+        if (rc == MP_API_OK || rc == MP_API_ERR_REJECTED || is_cancelled(api)) break;
+        if (now_ms() + backoff >= deadline) break;
+
+        /* I korta steg, så att mp_api_cancel inte får vänta ut pausen */
+        uint64_t wake = now_ms() + backoff;
+        while (!is_cancelled(api) && now_ms() < wake) {
+            usleep(CONNECT_POLL_MS * 1000);
+        }
+        if (is_cancelled(api)) break;
+        backoff = backoff * 2 > RESUME_BACKOFF_MAX_MS ? RESUME_BACKOFF_MAX_MS : backoff * 2;
+    }
+
+    pthread_mutex_lock(&api->send_lock);
+    api->resuming = 0;
+    pthread_mutex_unlock(&api->send_lock);
+
+    json_decref(payload);
+    free(session);
+    return rc;
+}
+
+int mp_api_game(MultiplayerApi *api, json_t *data) {
+    return mp_api_game_ex(api, data, 0);
+}
+
+int mp_api_game_ex(MultiplayerApi *api, json_t *data, int flags) {
+    if (!api || !data) return MP_API_ERR_ARGUMENT;
+    if (api->sockfd < 0 || !api->session_id) return MP_API_ERR_STATE;
+
+    /* Serialiseras direkt in i kuvertet; ingen kopia av data */
+    if (!json_is_object(data)) {
+        return send_game_payload(api, "{}", 2, flags, NULL);
+    }
+    char *text = json_dumps(data, JSON_COMPACT);
+    if (!text) return MP_API_ERR_IO;
+
+    int rc = send_game_payload(api, text, strlen(text), flags,
+                               json_string_value(json_object_get(data, "type")));
+    json_free_text(text);
+    return rc;
+}
+
+int mp_api_game_take(MultiplayerApi *api, json_t *data, int flags) {
+    if (!data) return MP_API_ERR_ARGUMENT;
+    int rc = mp_api_game_ex(api, data, flags);
+    json_decref(data);
+    return rc;
+}
+
+int mp_api_game_raw(MultiplayerApi *api, const char *payload, size_t len, int flags) {
+    if (!api || !payload || len == 0) return MP_API_ERR_ARGUMENT;
+
+    /* Trafikräkningen vill ha typen; förserialiserade meddelanden börjar
+       med den, så ingen parsning behövs */
+    char type[32];
+    const char *type_ptr = NULL;
+    static const char type_key[] = "{\"type\":\"";
+    size_t key_len = sizeof(type_key) - 1;
+    if (api->traffic_hook && len > key_len && memcmp(payload, type_key, key_len) == 0) {
+        const char *end = (const char *)memchr(payload + key_len, '"', len - key_len);
+        if (end && (size_t)(end - payload - key_len) < sizeof(type)) {
+            size_t type_len = (size_t)(end - payload - key_len);
+            memcpy(type, payload + key_len, type_len);
+            type[type_len] = '\0';
+            type_ptr = type;
+        }
+    }
+    return send_game_payload(api, payload, len, flags, type_ptr);
+}
+
+static int send_game_payload(MultiplayerApi *api, const char *payload, size_t len, int flags, const char *type) {
+    if (api->sockfd < 0 || !api->session_id || !api->game_prefix) return MP_API_ERR_STATE;
+
+    /* prefix + payload + "}\n" */
+    size_t total = api->game_prefix_len + len + 2;
+    char *line = (char *)malloc(total + 1);
+    if (!line) return MP_API_ERR_IO;
+
+    memcpy(line, api->game_prefix, api->game_prefix_len);
+    memcpy(line + api->game_prefix_len, payload, len);
+    line[total - 2] = '}';
+    line[total - 1] = '\n';
+    line[total] = '\0';
+
+    if (api->traffic_hook) {
+        api->traffic_hook(1, "game", type, total, api->traffic_user_data);
+    }
+    return send_line(api, line, total, flags);
+}
+
+int mp_api_start_sender(MultiplayerApi *api, size_t max_queued_bytes) {
+    if (!api || max_queued_bytes == 0) return MP_API_ERR_ARGUMENT;
+
+    pthread_mutex_lock(&api->send_lock);
+    if (!api->send_async) {
+        api->send_max_bytes = max_queued_bytes;
+        api->send_async = 1;
+    }
+    pthread_mutex_unlock(&api->send_lock);
+    return MP_API_OK;
+}
+
+size_t mp_api_send_queue_depth(MultiplayerApi *api) {
+    if (!api) return 0;
+    pthread_mutex_lock(&api->send_lock);
+    size_t frames = api->send_frames;
+    pthread_mutex_unlock(&api->send_lock);
+    return frames;
+}
+
+size_t mp_api_send_queue_bytes(MultiplayerApi *api) {
+    if (!api) return 0;
+    pthread_mutex_lock(&api->send_lock);
+    size_t bytes = api->send_bytes;
+    pthread_mutex_unlock(&api->send_lock);
+    return bytes;
+}
+
+uint64_t mp_api_send_dropped(MultiplayerApi *api) {
+    if (!api) return 0;
+    pthread_mutex_lock(&api->send_lock);
+    uint64_t dropped = api->send_dropped;
+    pthread_mutex_unlock(&api->send_lock);
+    return dropped;
+}
+
+int mp_api_listen(MultiplayerApi *api,
+                  MultiplayerListener cb,
+                  void *user_data) {
+    if (!api || !cb) return -1;
+
+    ListenerNode *node = (ListenerNode *)malloc(sizeof(ListenerNode));
+    if (!node) return -1;
+
+    node->cb = cb;
+    node->user_data = user_data;
+
+    pthread_mutex_lock(&api->lock);
+    node->id = api->next_listener_id++;
+    node->next = api->listeners;
+    api->listeners = node;
+    pthread_mutex_unlock(&api->lock);
+
+    return node->id;
+}
+
+void mp_api_unlisten(MultiplayerApi *api, int listener_id) {
+    if (!api || listener_id <= 0) return;
+
+    pthread_mutex_lock(&api->lock);
+    ListenerNode *prev = NULL;
+    ListenerNode *cur = api->listeners;
+    while (cur) {
+        if (cur->id == listener_id) {
+            if (prev) {
+                prev->next = cur->next;
+            } else {
+                api->listeners = cur->next;
+            }
+            free(cur);
+            break;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+    pthread_mutex_unlock(&api->lock);
+}
+
+void mp_api_set_traffic_hook(MultiplayerApi *api, MpTrafficHook hook, void *user_data) {
+    if (!api) return;
+    api->traffic_hook = hook;
+    api->traffic_user_data = user_data;
+}
+
+void mp_api_set_raw_listener(MultiplayerApi *api, MultiplayerRawListener cb, void *user_data) {
+    if (!api) return;
+    api->raw_listener = cb;
+    api->raw_user_data = user_data;
+}
+
+/* --- Interna hjälpfunktioner --- */
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)(ts.tv_nsec / 1000000);
+}
+
+/* Absolut tid för pthread_cond_timedwait (CLOCK_REALTIME) om ms */
+static void deadline_after(struct timespec *until, uint32_t ms) {
+    clock_gettime(CLOCK_REALTIME, until);
+    until->tv_sec += ms / 1000;
+    until->tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (until->tv_nsec >= 1000000000L) {
+        until->tv_sec++;
+        until->tv_nsec -= 1000000000L;
+    }
+}
+
+static int is_cancelled(MultiplayerApi *api) {
+    pthread_mutex_lock(&api->lock);
+    int cancelled = api->cancelled;
+    pthread_mutex_unlock(&api->lock);
+    return cancelled;
+}
+
+static int api_cancelled(void *arg) {
+    return is_cancelled((MultiplayerApi *)arg);
+}
+
+static int preconnect_stopped(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&preconnect_lock);
+    int stopped = preconnect_cancelled;
+    pthread_mutex_unlock(&preconnect_lock);
+    return stopped;
+}
+
+/* Påbörjar en icke‑blockerande connect. fd, eller −1 om adressen redan
+   avvisats; *done sätts om den anslöt direkt. */
+static int start_attempt(const struct addrinfo *ai, int *done) {
+    *done = 0;
+    int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, ai->ai_protocol);
+    if (fd < 0) return -1;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+        *done = 1;
+        return fd;
+    }
+    if (errno == EINPROGRESS) return fd;
+    close(fd);
+    return -1;
+}
+
+/* Slår upp host och ansluter enligt happy eyeballs (RFC 8305):
+   adresserna turas om mellan IPv6 och IPv4 i getaddrinfo‑ordning, och
+   nästa försök startar när det förra misslyckats eller efter
+   CONNECT_ATTEMPT_DELAY_MS utan svar, medan de tidigare får fortsätta.
+   Den första som ansluter vinner och resten stängs. stop tittas på var
+   CONNECT_POLL_MS. Returnerar en icke‑blockerande fd, eller −1. */
+static int connect_host(const char *host, uint16_t port, int (*stop)(void *), void *stop_arg,
+                        MpConnectStats *stats) {
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%u", (unsigned int)port);
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;      /* IPv4 eller IPv6 */
+    hints.ai_socktype = SOCK_STREAM;
+
+    MpConnectStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    uint64_t started = now_ms();
+    struct addrinfo *res = NULL;
+    if (getaddrinfo(host, port_str, &hints, &res) != 0) {
+        return -1;
+    }
+    uint64_t resolved = now_ms();
+    stats->resolve_ms = (uint32_t)(resolved - started);
+
+    /* Turas om mellan familjerna, med det första svarets familj först */
+    const struct addrinfo *order[CONNECT_MAX_ADDRESSES];
+    int count = 0;
+    int first_family = res ? res->ai_family : AF_UNSPEC;
+    const struct addrinfo *same = res;
+    const struct addrinfo *other = res;
+    while (count < CONNECT_MAX_ADDRESSES) {
+        while (same && same->ai_family != first_family) same = same->ai_next;
+        while (other && other->ai_family == first_family) other = other->ai_next;
+        if (!same && !other) break;
+        if (same) {
+            order[count++] = same;
+            same = same->ai_next;
+        }
+        if (other && count < CONNECT_MAX_ADDRESSES) {
+            order[count++] = other;
+            other = other->ai_next;
+        }
+    }
+
+    struct pollfd pending[CONNECT_MAX_ADDRESSES];
+    int pending_family[CONNECT_MAX_ADDRESSES];
+    int in_flight = 0;
+    int next = 0;
+    int fd = -1;
+    int winner_family = AF_UNSPEC;
+    uint64_t deadline = resolved + CONNECT_TIMEOUT_MS;
+    uint64_t next_start = resolved;
+
+    while (fd < 0) {
+        uint64_t now = now_ms();
+        if (stop(stop_arg) || now >= deadline) break;
+
+        /* Nästa adress: direkt om inget försök är igång, annars efter en stund */
+        if (next < count && (in_flight == 0 || now >= next_start)) {
+            int done = 0;
+            int attempt = start_attempt(order[next], &done);
+            int family = order[next]->ai_family;
+            next++;
+            stats->attempts++;
+            if (attempt < 0) continue;
+            if (done) {
+                fd = attempt;
+                winner_family = family;
+                break;
+            }
+            pending[in_flight].fd = attempt;
+            pending[in_flight].events = POLLOUT;
+            pending[in_flight].revents = 0;
+            pending_family[in_flight] = family;
+            in_flight++;
+            next_start = now + CONNECT_ATTEMPT_DELAY_MS;
+        }
+        if (in_flight == 0) break;  /* Alla adresser avvisade */
+
+        int wait = CONNECT_POLL_MS;
+        if (next < count && next_start - now < (uint64_t)wait) wait = (int)(next_start - now);
+        int n = poll(pending, (nfds_t)in_flight, wait);
+        if (n < 0 && errno != EINTR) break;
+
+        for (int i = 0; n > 0 && i < in_flight; ) {
+            if (!pending[i].revents) {
+                i++;
+                continue;
+            }
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (fd < 0 && getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                fd = pending[i].fd;
+                winner_family = pending_family[i];
+            } else {
+                close(pending[i].fd);
+                next_start = 0;  /* Ett misslyckat försök släpper fram nästa direkt */
+            }
+            pending[i] = pending[in_flight - 1];
+            pending_family[i] = pending_family[in_flight - 1];
+            in_flight--;
+        }
+    }
+
+    for (int i = 0; i < in_flight; i++) {
+        close(pending[i].fd);
+    }
+    freeaddrinfo(res);
+
+    if (fd >= 0) {
+        stats->connect_ms = (uint32_t)(now_ms() - resolved);
+        stats->ipv6 = winner_family == AF_INET6;
+    }
+    return fd;
+}
+
+/* Inte stängd av servern: inget EOF eller fel att läsa */
+static int socket_open(int fd) {
+    char byte;
+    ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+int mp_api_preconnect(const char *server_host, uint16_t server_port, MpConnectStats *stats) {
+    if (!server_host) return MP_API_ERR_ARGUMENT;
+    if (stats) memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&preconnect_lock);
+    if (preconnect_running) {
+        pthread_mutex_unlock(&preconnect_lock);
+        return MP_API_ERR_STATE;
+    }
+    if (preconnect_fd >= 0 && strcmp(preconnect_host, server_host) == 0 &&
+        preconnect_port == server_port && socket_open(preconnect_fd)) {
+        pthread_mutex_unlock(&preconnect_lock);
+        return MP_API_OK;
+    }
+    char *host = strdup(server_host);
+    if (!host) {
+        pthread_mutex_unlock(&preconnect_lock);
+        return MP_API_ERR_IO;
+    }
+    if (preconnect_fd >= 0) {
+        close(preconnect_fd);
+        preconnect_fd = -1;
+    }
+    free(preconnect_host);
+    preconnect_host = host;
+    preconnect_port = server_port;
+    preconnect_running = 1;
+    preconnect_cancelled = 0;
+    pthread_mutex_unlock(&preconnect_lock);
+
+    int fd = connect_host(server_host, server_port, preconnect_stopped, NULL, stats);
+
+    pthread_mutex_lock(&preconnect_lock);
+    if (fd >= 0 && preconnect_cancelled) {
+        close(fd);
+        fd = -1;
+    }
+    preconnect_fd = fd;
+    preconnect_running = 0;
+    pthread_cond_broadcast(&preconnect_cond);
+    pthread_mutex_unlock(&preconnect_lock);
+    return fd >= 0 ? MP_API_OK : MP_API_ERR_CONNECT;
+}
+
+void mp_api_preconnect_cancel(void) {
+    pthread_mutex_lock(&preconnect_lock);
+    preconnect_cancelled = 1;
+    if (preconnect_fd >= 0) {
+        close(preconnect_fd);
+        preconnect_fd = -1;
+    }
+    pthread_mutex_unlock(&preconnect_lock);
+}
+
+/* Den förhandsanslutna socketen om den gäller samma server (efter att ha
+   väntat in ett pågående försök), annars −1. En socket som servern redan
+   stängt kastas. */
+static int take_preconnected(MultiplayerApi *api) {
+    pthread_mutex_lock(&preconnect_lock);
+    int fd = -1;
+    while (preconnect_host && strcmp(preconnect_host, api->server_host) == 0 &&
+           preconnect_port == api->server_port) {
+        if (!preconnect_running) {
+            fd = preconnect_fd;
+            preconnect_fd = -1;
+            break;
+        }
+        pthread_mutex_unlock(&preconnect_lock);
+        int cancelled = is_cancelled(api);
+        pthread_mutex_lock(&preconnect_lock);
+        if (cancelled) break;
+
+        struct timespec until;
+        deadline_after(&until, CONNECT_POLL_MS);
+        pthread_cond_timedwait(&preconnect_cond, &preconnect_lock, &until);
+    }
+    pthread_mutex_unlock(&preconnect_lock);
+
+    if (fd >= 0 && !socket_open(fd)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+static int connect_to_server(MultiplayerApi *api) {
+    const char *host = api->server_host ? api->server_host : "127.0.0.1";
+    int fd = take_preconnected(api);
+    if (fd >= 0 || is_cancelled(api)) return fd;
+    return connect_host(host, api->server_port, api_cancelled, api, NULL);
+}
+
+/* Kastar en bruten anslutning (socket, läsbuffert, sändkö och ett
+   eventuellt svar) så att nästa ensure_connected ansluter på nytt.
+   Sessionen står kvar. Inte från reaktortråden. */
+static void reset_connection(MultiplayerApi *api) {
+    if (api->registered) {
+        shutdown(api->sockfd, SHUT_RDWR);
+        reactor_detach(api);
+        api->registered = 0;
+        pthread_mutex_lock(&api->reactor->lock);
+        api->detached = 0;
+        pthread_mutex_unlock(&api->reactor->lock);
+    }
+    if (api->sockfd >= 0) {
+        close(api->sockfd);
+        api->sockfd = -1;
+    }
+    api->rbuf_start = 0;
+    api->rbuf_end = 0;
+
+    pthread_mutex_lock(&api->send_lock);
+    SendFrame *frame = api->send_head;
+    while (frame) {
+        SendFrame *next = frame->next;
+        free(frame->data);
+        free(frame);
+        frame = next;
+    }
+    api->send_head = NULL;
+    api->send_tail = NULL;
+    api->send_offset = 0;
+    api->send_frames = 0;
+    api->send_bytes = 0;
+    api->send_failed = 0;
+    pthread_mutex_unlock(&api->send_lock);
+
+    pthread_mutex_lock(&api->lock);
+    if (!api->cancelled) api->closed = 0;
+    if (api->reply) {
+        json_decref(api->reply);
+        api->reply = NULL;
+    }
+    pthread_mutex_unlock(&api->lock);
+}
+
+/* Ansluter (blockerande för anroparen, men mp_api_cancel avbryter) och
+   lämnar sedan socketen, icke‑blockerande, åt reaktorn */
+static int ensure_connected(MultiplayerApi *api) {
+    if (!api) return MP_API_ERR_ARGUMENT;
+    if (api->sockfd >= 0) {
+        pthread_mutex_lock(&api->lock);
+        int closed = api->closed;
+        pthread_mutex_unlock(&api->lock);
+        return closed ? MP_API_ERR_IO : MP_API_OK;
+    }
+    if (is_cancelled(api)) return MP_API_ERR_IO;
+
+    int fd = connect_to_server(api);
+    if (fd < 0) {
+        return MP_API_ERR_CONNECT;
+    }
+
+    int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) != 0) {
+        close(fd);
+        return MP_API_ERR_IO;
+    }
+
+    /* Kantutlöst: reaktorn läser tills EAGAIN, och EPOLLOUT kommer bara
+       när en skrivning som fick EAGAIN kan fortsätta */
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = api;
+    api->sockfd = fd;
+    if (epoll_ctl(api->reactor->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        api->sockfd = -1;
+        return MP_API_ERR_IO;
+    }
+    api->registered = 1;
+    return MP_API_OK;
+}
+
+/* Skickar en förfrågan och väntar tills reaktorn lämnat över svaret med
+   samma cmd, högst REQUEST_TIMEOUT_MS (sedan MP_API_ERR_IO; ett senare
+   svar kastas). Ett anrop åt gången per anslutning. */
+static int request(MultiplayerApi *api, json_t *req, const char *cmd, json_t **out_resp) {
+    pthread_mutex_lock(&api->lock);
+    if (api->pending_cmd) {
+        pthread_mutex_unlock(&api->lock);
+        json_decref(req);
+        return MP_API_ERR_STATE;
+    }
+    api->pending_cmd = cmd;
+    pthread_mutex_unlock(&api->lock);
+
+    int rc = send_json_line(api, req, SEND_REQUEST);
+
+    struct timespec until;
+    deadline_after(&until, REQUEST_TIMEOUT_MS);
+    pthread_mutex_lock(&api->lock);
+    while (rc == MP_API_OK && !api->reply && !api->closed) {
+        if (pthread_cond_timedwait(&api->reply_cond, &api->lock, &until) == ETIMEDOUT) break;
+    }
+    json_t *resp = api->reply;
+    api->reply = NULL;
+    api->pending_cmd = NULL;
+    pthread_mutex_unlock(&api->lock);
+
+    if (rc != MP_API_OK || !resp) {
+        if (resp) json_decref(resp);
+        return rc != MP_API_OK ? rc : MP_API_ERR_IO;
+    }
+    *out_resp = resp;
+    return MP_API_OK;
+}
+
+static int send_json_line(MultiplayerApi *api, json_t *obj, int flags) {
+    if (!api || api->sockfd < 0 || !obj) return MP_API_ERR_ARGUMENT;
+
+    char *text = json_dumps(obj, JSON_COMPACT);
+    if (text && api->traffic_hook) {
+        api->traffic_hook(1, json_string_value(json_object_get(obj, "cmd")), NULL,
+                          strlen(text) + 1, api->traffic_user_data);
+    }
+    json_decref(obj);
+    if (!text) {
+        return MP_API_ERR_IO;
+    }
+
+    /* Texten kan ligga i en arena, så raden (med radslut, för att gå i
+       ett anrop) kopieras till en egen buffert */
+    size_t len = strlen(text);
+    char *line = (char *)malloc(len + 2);
+    if (!line) {
+        json_free_text(text);
+        return MP_API_ERR_IO;
+    }
+    memcpy(line, text, len);
+    json_free_text(text);
+    line[len++] = '\n';
+    line[len] = '\0';
+
+    return send_line(api, line, len, flags);
+}
+
+/* Sparar sessionen och bygger game‑kuvertets prefix en gång, så varje
+   skickat meddelande bara behöver kopiera in sin data */
+static int set_session(MultiplayerApi *api, const char *session) {
+    /* Samma session igen (mp_api_resume): prefixet kan vara i bruk */
+    if (api->session_id && strcmp(api->session_id, session) == 0) return MP_API_OK;
+
+    json_t *sess = json_string(session);
+    char *sess_text = sess ? json_dumps(sess, JSON_ENCODE_ANY) : NULL;
+    if (sess) json_decref(sess);
+    if (!sess_text) return MP_API_ERR_IO;
+
+    const char *fmt = "{\"identifier\":\"HardcoreSnakeClient\",\"session\":%s,\"cmd\":\"game\",\"data\":";
+    int prefix_len = snprintf(NULL, 0, fmt, sess_text);
+    char *prefix = prefix_len > 0 ? (char *)malloc((size_t)prefix_len + 1) : NULL;
+    char *session_id = strdup(session);
+    if (!prefix || !session_id) {
+        free(prefix);
+        free(session_id);
+        json_free_text(sess_text);
+        return MP_API_ERR_IO;
+    }
+    snprintf(prefix, (size_t)prefix_len + 1, fmt, sess_text);
+    json_free_text(sess_text);
+
+    free(api->session_id);
+    free(api->game_prefix);
+    api->session_id = session_id;
+    api->game_prefix = prefix;
+    api->game_prefix_len = (size_t)prefix_len;
+    return MP_API_OK;
+}
+
+static void unlink_frame(MultiplayerApi *api, SendFrame *prev, SendFrame *frame) {
+    if (prev) {
+        prev->next = frame->next;
+    } else {
+        api->send_head = frame->next;
+    }
+    if (api->send_tail == frame) {
+        api->send_tail = prev;
+    }
+    api->send_frames--;
+    api->send_bytes -= frame->len;
+    api->send_dropped++;
+    free(frame->data);
+    free(frame);
+}
+
+/* Köar raden (tar över ägarskap av den) och skriver. Utan sändare skrivs
+   kön direkt på anroparens tråd, icke‑blockerande; det socketen inte tar
+   emot skriver reaktorn vid EPOLLOUT. Med sändare skriver bara reaktorn. */
+static int send_line(MultiplayerApi *api, char *line, size_t len, int flags) {
+    SendFrame *frame = (SendFrame *)malloc(sizeof(SendFrame));
+    if (!frame) {
+        free(line);
+        return MP_API_ERR_IO;
+    }
+    frame->next = NULL;
+    frame->data = line;
+    frame->len = len;
+    frame->flags = flags;
+
+    pthread_mutex_lock(&api->send_lock);
+
+    if (api->send_failed || (api->resuming && !(flags & SEND_REQUEST))) {
+        pthread_mutex_unlock(&api->send_lock);
+        free(line);
+        free(frame);
+        return MP_API_ERR_IO;
+    }
+
+    /* Ersätt inaktuella ramar, och kasta fler ersättningsbara (äldst
+       först) om kön ändå är full. En ram som redan delvis skickats måste
+       gå ut hel. */
+    SendFrame *prev = NULL;
+    SendFrame *cur = api->send_head;
+    while (cur) {
+        SendFrame *next = cur->next;
+        int started = cur == api->send_head && api->send_offset > 0;
+        int superseded = (flags & MP_API_SEND_REPLACEABLE) && (cur->flags & MP_API_SEND_REPLACEABLE);
+        int over = api->send_bytes + len > api->send_max_bytes && (cur->flags & MP_API_SEND_REPLACEABLE);
+        if (!started && (superseded || over)) {
+            unlink_frame(api, prev, cur);
+        } else {
+            prev = cur;
+        }
+        cur = next;
+    }
+
+    if (api->send_bytes + len > api->send_max_bytes) {
+        api->send_dropped++;
+        pthread_mutex_unlock(&api->send_lock);
+        free(line);
+        free(frame);
+        return MP_API_ERR_BUSY;
+    }
+
+    int was_empty = api->send_head == NULL;
+    if (api->send_tail) {
+        api->send_tail->next = frame;
+    } else {
+        api->send_head = frame;
+    }
+    api->send_tail = frame;
+    api->send_frames++;
+    api->send_bytes += len;
+
+    if (!api->send_async) {
+        int rc = MP_API_OK;
+        if (flush_send_queue(api) != 0) {
+            api->send_failed = 1;
+            rc = MP_API_ERR_IO;
+        }
+        pthread_mutex_unlock(&api->send_lock);
+        return rc;
+    }
+    pthread_mutex_unlock(&api->send_lock);
+
+    /* Är kön inte tom har reaktorn redan en skrivning på gång: en FLUSH
+       i kö, eller EPOLLOUT efter en skrivning som fick EAGAIN */
+    if (was_empty) {
+        MpReactor *reactor = api->reactor;
+        pthread_mutex_lock(&reactor->lock);
+        int post = !api->flush_queued;
+        api->flush_queued = 1;
+        pthread_mutex_unlock(&reactor->lock);
+        if (post) {
+            api->flush_op.type = REACTOR_OP_FLUSH;
+            api->flush_op.api = api;
+            reactor_post(reactor, &api->flush_op);
+        }
+    }
+    return MP_API_OK;
+}
+
+/* Skriver så mycket av sändkön som socketen tar emot, med så få
+   sendmsg‑anrop som möjligt (writev‑semantik, men MSG_NOSIGNAL så en
+   stängd peer inte ger SIGPIPE). Anropas med send_lock. Returnerar 0 när
+   kön är tom eller socketen full, -1 vid fel. */
+static int flush_send_queue(MultiplayerApi *api) {
+    struct iovec iov[64];  /* under IOV_MAX överallt */
+
+    while (api->send_head) {
+        int count = 0;
+        size_t off = api->send_offset;
+        for (SendFrame *f = api->send_head; f && count < (int)(sizeof(iov) / sizeof(iov[0])); f = f->next) {
+            iov[count].iov_base = f->data + off;
+            iov[count].iov_len = f->len - off;
+            off = 0;
+            count++;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)count;
+
+        ssize_t n = sendmsg(api->sockfd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        if (n == 0) {
+            return -1;
+        }
+
+        /* Stega fram förbi det som skickats, även mitt i en ram */
+        size_t sent = (size_t)n;
+        while (api->send_head && sent >= api->send_head->len - api->send_offset) {
+            SendFrame *done = api->send_head;
+            sent -= done->len - api->send_offset;
+            api->send_offset = 0;
+            api->send_head = done->next;
+            if (!api->send_head) api->send_tail = NULL;
+            api->send_frames--;
+            api->send_bytes -= done->len;
+            free(done->data);
+            free(done);
+        }
+        api->send_offset += sent;
+    }
+    return 0;
+}
+
+/* Kör lyssnarna för ett event och släpper root och dess arena */
+static void deliver_event(MultiplayerApi *api, json_t *root) {
+    JsonArena *arena = json_arena_of(root);
+    const char *cmd = json_string_value(json_object_get(root, "cmd"));
+
+    json_int_t msgId = 0;
+    json_t *mid_val = json_object_get(root, "messageId");
+    if (json_is_integer(mid_val)) {
+        msgId = json_integer_value(mid_val);
+    }
+
+    const char *clientId = NULL;
+    json_t *cid_val = json_object_get(root, "clientId");
+    if (json_is_string(cid_val)) {
+        clientId = json_string_value(cid_val);
+    }
+
+    json_t *data_val = json_object_get(root, "data");
+    json_t *data_obj;
+    if (json_is_object(data_val)) {
+        data_obj = data_val;
+        json_incref(data_obj);
+    } else {
+        data_obj = json_object();
+    }
+
+    pthread_mutex_lock(&api->lock);
+    int count = 0;
+    ListenerNode *node = api->listeners;
+    while (node) {
+        if (node->cb) count++;
+        node = node->next;
+    }
+
+    if (count == 0) {
+        pthread_mutex_unlock(&api->lock);
+        json_decref(data_obj);
+        release_line(root, arena);
+        return;
+    }
+
+    ListenerSnapshot *snapshot = (ListenerSnapshot *)malloc(sizeof(ListenerSnapshot) * count);
+    if (!snapshot) {
+        pthread_mutex_unlock(&api->lock);
+        json_decref(data_obj);
+        release_line(root, arena);
+        return;
+    }
+
+    int idx = 0;
+    node = api->listeners;
+    while (node) {
+        if (node->cb) {
+            snapshot[idx].cb = node->cb;
+            snapshot[idx].user_data = node->user_data;
+            idx++;
+        }
+        node = node->next;
+    }
+    pthread_mutex_unlock(&api->lock);
+
+    for (int i = 0; i < count; ++i) {
+        snapshot[i].cb(cmd, (int64_t)msgId, clientId, data_obj, snapshot[i].user_data);
+    }
+
+    free(snapshot);
+    json_decref(data_obj);
+    release_line(root, arena);
+}
@@ -1,88 +1,238 @@
-#ifndef MULTIPLAYER_API_H
-#define MULTIPLAYER_API_H
-
-#include <stdint.h>
-#include "jansson/jansson.h"
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-typedef struct MultiplayerApi MultiplayerApi;
-
-/* Callback‑typ för inkommande events från servern. */
-typedef void (*MultiplayerListener)(
-    const char *event,      /* "joined", "leaved", "game" */
-    int64_t messageId,      /* sekventiellt meddelande‑ID (från host) */
-    const char *clientId,   /* avsändarens klient‑ID (eller NULL) */
-    json_t *data,           /* JSON‑objekt med godtycklig speldata */
-    void *user_data         /* godtycklig pekare som skickas vidare */
-);
-
-/* Returkoder */
-enum {
-    MP_API_OK = 0,
-    MP_API_ERR_ARGUMENT = 1,
-    MP_API_ERR_STATE = 2,
-    MP_API_ERR_CONNECT = 3,
-    MP_API_ERR_PROTOCOL = 4,
-    MP_API_ERR_IO = 5,
-    MP_API_ERR_REJECTED = 6  /* t.ex. ogiltigt sessions‑ID vid join */
-};
-
-/* Skapar en ny API‑instans. Returnerar NULL vid fel. */
-MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port);
-
-/* Stänger ner anslutning, stoppar mottagartråd och frigör minne. */
-void mp_api_destroy(MultiplayerApi *api);
-
-/* Hostar en ny session. Blockerar tills svar erhållits eller fel uppstår.
-   out_session / out_clientId pekar på nyallokerade strängar (malloc) som
-   anroparen ansvarar för att free:a. out_data (om ej NULL) får ett json_t*
-   med extra data från servern (anroparen ska json_decref när klart). */
-int mp_api_host(MultiplayerApi *api,
-                char **out_session,
-                char **out_clientId,
-                json_t **out_data);
-
-/*
-   Hämtar en lista över tillgängliga publika sessioner.
-   Returnerar MP_API_OK vid framgång, annan felkod vid fel.
-   Anroparen ansvarar för att json_decref:a out_list när klar. */
-int mp_api_list(MultiplayerApi *api,
-                  json_t **out_list);
-
-/* Går med i befintlig session.
-   sessionId: sessionskod (t.ex. "ABC123").
-   data: valfri JSON‑payload med spelarinformation (kan vara NULL).
-   out_* fungerar som i mp_api_host.
-
-   Returnerar:
-   - MP_API_OK        vid lyckad join
-   - MP_API_ERR_REJECTED om servern svarar med status:error (t.ex. ogiltigt ID)
-   - annan felkod vid nätverks/protokoll‑fel.
-*/
-int mp_api_join(MultiplayerApi *api,
-                const char *sessionId,
-                json_t *data,
-                char **out_session,
-                char **out_clientId,
-                json_t **out_data);
-
-/* Skickar ett "game"‑meddelande med godtycklig JSON‑data till sessionen. */
-int mp_api_game(MultiplayerApi *api, json_t *data);
-
-/* Registrerar en lyssnare för inkommande events.
-   Returnerar ett positivt listener‑ID, eller −1 vid fel. */
-int mp_api_listen(MultiplayerApi *api,
-                  MultiplayerListener cb,
-                  void *user_data);
-
-/* Avregistrerar lyssnare. Listener‑ID är värdet från mp_api_listen. */
-void mp_api_unlisten(MultiplayerApi *api, int listener_id);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif /* MULTIPLAYER_API_H */
+#ifndef MULTIPLAYER_API_H
+#define MULTIPLAYER_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "jansson/jansson.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MultiplayerApi MultiplayerApi;
+
+/* En epoll‑reaktor: en tråd som driver många anslutningars sockets
+   (icke‑blockerande, kantutlöst), läser in hela rader i varje anslutnings
+   buffert och kör lyssnare och timers. */
+typedef struct MpReactor MpReactor;
+
+/* Callback för mp_reactor_add_timer, körs på reaktortråden. */
+typedef void (*MpTimerCallback)(int timer_id, void *user_data);
+
+/* Callback‑typ för inkommande events från servern. */
+typedef void (*MultiplayerListener)(
+    const char *event,      /* "joined", "leaved", "game" */
+    int64_t messageId,      /* sekventiellt meddelande‑ID (från host) */
+    const char *clientId,   /* avsändarens klient‑ID (eller NULL) */
+    json_t *data,           /* JSON‑objekt med godtycklig speldata */
+    void *user_data         /* godtycklig pekare som skickas vidare */
+);
+
+/* Callback för mp_api_set_raw_listener: en "game"‑rad som den kom, med
+   "type" ur dess data. Returnerar 1 om den tog hand om raden; 0 låter den
+   tolkas och gå till de vanliga lyssnarna. */
+typedef int (*MultiplayerRawListener)(
+    const char *type,       /* "type" i game‑data, t.ex. "game_state" */
+    const char *line,       /* hela raden, utan radslut; gäller bara under anropet */
+    size_t len,
+    void *user_data
+);
+
+/* Callback för mp_api_set_traffic_hook: en rad på väg ut eller in. */
+typedef void (*MpTrafficHook)(
+    int outgoing,           /* 1 = skickad, 0 = mottagen */
+    const char *cmd,        /* radens "cmd", t.ex. "game" (eller NULL) */
+    const char *type,       /* "type" i game‑data, t.ex. "game_state" (eller NULL) */
+    size_t bytes,           /* radens längd inklusive radslut */
+    void *user_data
+);
+
+/* Returkoder */
+enum {
+    MP_API_OK = 0,
+    MP_API_ERR_ARGUMENT = 1,
+    MP_API_ERR_STATE = 2,
+    MP_API_ERR_CONNECT = 3,
+    MP_API_ERR_PROTOCOL = 4,
+    MP_API_ERR_IO = 5,
+    MP_API_ERR_REJECTED = 6, /* t.ex. ogiltigt sessions‑ID vid join */
+    MP_API_ERR_BUSY = 7      /* sändkön är full */
+};
+
+/* Flaggor för mp_api_game_ex */
+enum {
+    MP_API_SEND_REPLACEABLE = 1  /* ersätts av nästa sådan ram om den ännu ej skickats */
+};
+
+/* Skapar en reaktor och startar dess tråd. dispatch_workers = 0 kör
+   lyssnarna direkt på reaktortråden; annars fördelas anslutningarna över
+   så många dispatch‑trådar, och en anslutnings events levereras alltid i
+   ordning på samma tråd. Returnerar NULL vid fel. */
+MpReactor *mp_reactor_create(int dispatch_workers);
+
+/* Stoppar reaktorn. Alla anslutningar på den ska vara förstörda först. */
+void mp_reactor_destroy(MpReactor *reactor);
+
+/* Kör cb på reaktortråden efter delay_ms, och sedan var interval_ms
+   (0 = en gång). Returnerar ett positivt timer‑ID, eller −1 vid fel. */
+int mp_reactor_add_timer(MpReactor *reactor,
+                         uint32_t delay_ms,
+                         uint32_t interval_ms,
+                         MpTimerCallback cb,
+                         void *user_data);
+
+/* Tar bort en timer. Anropat från en annan tråd väntar det in en
+   callback som redan körs. */
+void mp_reactor_cancel_timer(MpReactor *reactor, int timer_id);
+
+/* Skapar en ny API‑instans på en processgemensam reaktor, som startas med
+   den första instansen och stoppas med den sista. Returnerar NULL vid fel. */
+MultiplayerApi *mp_api_create(const char *server_host, uint16_t server_port);
+
+/* Som mp_api_create, men på en egen reaktor (som ska leva längre än
+   instansen). */
+MultiplayerApi *mp_api_create_on(MpReactor *reactor, const char *server_host, uint16_t server_port);
+
+/* Tider för en anslutning till servern */
+typedef struct {
+    uint32_t resolve_ms;  /* getaddrinfo */
+    uint32_t connect_ms;  /* Från första connect tills en adress svarat */
+    int attempts;         /* Påbörjade connect, över alla adresser */
+    int ipv6;             /* Den vinnande adressen var IPv6 */
+} MpConnectStats;
+
+/* Slår upp och ansluter till servern i förväg, t.ex. på en egen tråd när
+   spelet startar. Blockerar (högst 10 s) och returnerar MP_API_OK när en
+   socket står redo; den första instansen som sedan ansluter till samma
+   host och port tar över den i stället för att ansluta själv, och väntar
+   in en förhandsanslutning som ännu pågår. Står en öppen socket redan
+   redo för samma server returnerar nästa anrop direkt (stats‑>attempts
+   0); MP_API_ERR_STATE medan ett annat pågår. stats får vara NULL. */
+int mp_api_preconnect(const char *server_host, uint16_t server_port, MpConnectStats *stats);
+
+/* Avbryter en pågående mp_api_preconnect och stänger en oanvänd socket */
+void mp_api_preconnect_cancel(void);
+
+/* Stänger ner anslutningen, tar bort den ur reaktorn och frigör minne.
+   När funktionen returnerat anropas inga fler lyssnare för instansen.
+   Får inte anropas från en lyssnare. */
+void mp_api_destroy(MultiplayerApi *api);
+
+/* host, list och join nedan blockerar anroparen tills reaktorn tagit emot
+   svaret, och får därför inte anropas från en lyssnare eller timer. Det
+   första anropet ansluter också (högst 10 s), och svaret väntas in högst
+   10 s till (annars MP_API_ERR_IO). Ett spel kör dem därför på
+   en egen tråd och avbryter med mp_api_cancel vid behov. */
+
+/* Avbryter ett pågående host/list/join (eller dess anslutning) från en
+   annan tråd: det returnerar MP_API_ERR_IO (eller MP_API_ERR_CONNECT)
+   inom en tiondels sekund. Anslutningen går inte att använda efteråt, bara
+   att förstöra med mp_api_destroy (när anropet returnerat). */
+void mp_api_cancel(MultiplayerApi *api);
+
+/* Hostar en ny session. Blockerar tills svar erhållits eller fel uppstår.
+   out_session / out_clientId pekar på nyallokerade strängar (malloc) som
+   anroparen ansvarar för att free:a. out_data (om ej NULL) får ett json_t*
+   med extra data från servern (anroparen ska json_decref när klart). */
+int mp_api_host(MultiplayerApi *api,
+                char **out_session,
+                char **out_clientId,
+                json_t **out_data);
+
+/*
+   Hämtar en lista över tillgängliga publika sessioner.
+   Returnerar MP_API_OK vid framgång, annan felkod vid fel.
+   Anroparen ansvarar för att json_decref:a out_list när klar. */
+int mp_api_list(MultiplayerApi *api,
+                  json_t **out_list);
+
+/* Går med i befintlig session.
+   sessionId: sessionskod (t.ex. "ABC123").
+   data: valfri JSON‑payload med spelarinformation (kan vara NULL).
+   out_* fungerar som i mp_api_host.
+
+   Returnerar:
+   - MP_API_OK        vid lyckad join
+   - MP_API_ERR_REJECTED om servern svarar med status:error (t.ex. ogiltigt ID)
+   - annan felkod vid nätverks/protokoll‑fel.
+*/
+int mp_api_join(MultiplayerApi *api,
+                const char *sessionId,
+                json_t *data,
+                char **out_session,
+                char **out_clientId,
+                json_t **out_data);
+
+/* 1 om anslutningen har brutits (eller avbrutits), annars 0. Pollas av
+   spelet, som då kan återuppta sessionen med mp_api_resume. */
+int mp_api_is_closed(MultiplayerApi *api);
+
+/* Återansluter efter ett avbrott och går med i samma session igen, med
+   växande paus mellan försöken (0,25 s upp till 2 s) tills timeout_ms
+   passerat. Blockerar som join, men mp_api_cancel avbryter. data skickas
+   med i join, kompletterad med "resume": det tidigare klient‑ID:t. Servern
+   ger ett nytt klient‑ID i out_clientId (free:as av anroparen); att
+   knyta det till den gamla spelaren är spelets sak. Meddelanden som låg i
+   sändkön kastas, och nya avvisas tills funktionen returnerat.
+
+   Returnerar MP_API_OK, MP_API_ERR_REJECTED om sessionen inte finns kvar,
+   MP_API_ERR_STATE utan session, eller felet från sista försöket. */
+int mp_api_resume(MultiplayerApi *api,
+                  uint32_t timeout_ms,
+                  json_t *data,
+                  char **out_clientId,
+                  json_t **out_data);
+
+/* Skickar ett "game"‑meddelande med godtycklig JSON‑data till sessionen. */
+int mp_api_game(MultiplayerApi *api, json_t *data);
+
+/* Som mp_api_game, med flaggor (MP_API_SEND_*). En REPLACEABLE‑ram som
+   fortfarande ligger i sändkön kastas när nästa REPLACEABLE‑ram köas,
+   t.ex. en game_state som redan blivit inaktuell. */
+int mp_api_game_ex(MultiplayerApi *api, json_t *data, int flags);
+
+/* Som mp_api_game_ex men tar över ägarskap av data (json_decref:as). */
+int mp_api_game_take(MultiplayerApi *api, json_t *data, int flags);
+
+/* Skickar redan serialiserad data: payload ska vara ett JSON‑objekt
+   (len bytes, utan radslut) och läggs oförändrad i ett cachat kuvert. */
+int mp_api_game_raw(MultiplayerApi *api, const char *payload, size_t len, int flags);
+
+/* Utan sändare skriver varje anrop icke‑blockerande på anroparens tråd,
+   och det socketen inte tar emot skrivs av reaktorn. Efter
+   mp_api_start_sender serialiseras meddelanden på anroparens tråd och köas;
+   reaktorn skickar allt som köats sedan förra skrivningen i ett enda
+   systemanrop. max_queued_bytes begränsar kön: är den full kastas först
+   ersättningsbara ramar, annars returneras MP_API_ERR_BUSY. */
+int mp_api_start_sender(MultiplayerApi *api, size_t max_queued_bytes);
+
+/* Antal ramar / bytes som väntar i sändkön, och antal kastade ramar. */
+size_t mp_api_send_queue_depth(MultiplayerApi *api);
+size_t mp_api_send_queue_bytes(MultiplayerApi *api);
+uint64_t mp_api_send_dropped(MultiplayerApi *api);
+
+/* Registrerar en lyssnare för inkommande events. Den körs på reaktortråden
+   eller på anslutningens dispatch‑tråd, se mp_reactor_create. Returnerar ett positivt listener‑ID, eller −1 vid fel. */
+int mp_api_listen(MultiplayerApi *api,
+                  MultiplayerListener cb,
+                  void *user_data);
+
+/* Avregistrerar lyssnare. Listener‑ID är värdet från mp_api_listen. */
+void mp_api_unlisten(MultiplayerApi *api, int listener_id);
+
+/* Anropas för varje rad som skickas (på den sändande tråden, när raden
+   köas) och tas emot (på reaktortråden, innan lyssnarna körs). Ska sättas
+   innan första host/join/list; NULL stänger av. */
+void mp_api_set_traffic_hook(MultiplayerApi *api, MpTrafficHook hook, void *user_data);
+
+/* Låter cb få "game"‑rader med en "type" innan de tolkas till json_t (bara
+   radens huvud läses), t.ex. för att avkoda dem direkt till egna strukturer.
+   Körs där lyssnarna körs och i samma ordning som övriga events. Ska sättas
+   innan första host/join/list; NULL stänger av. */
+void mp_api_set_raw_listener(MultiplayerApi *api, MultiplayerRawListener cb, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTIPLAYER_API_H */
@@ -374,6 +374,28 @@ json_t *json_loadfd(int input, size_t flags, json_error_t *error) JSON_ATTRS(war
 json_t *json_load_file(const char *path, size_t flags, json_error_t *error) JSON_ATTRS(warn_unused_result);
 json_t *json_load_callback(json_load_callback_t callback, void *data, size_t flags, json_error_t *error) JSON_ATTRS(warn_unused_result);
 
+/* Streaming decoding: the same grammar, reported as events in document
+   order without building any json_t. Keys and string values are
+   NUL-terminated, point into the parser's buffer and are only valid
+   during the call. A NULL
+   callback skips that event; a non-zero return stops the parse. */
+typedef struct json_sax_callbacks_t {
+    int (*object_start)(void *data);
+    int (*object_end)(void *data);
+    int (*array_start)(void *data);
+    int (*array_end)(void *data);
+    int (*key)(const char *key, size_t len, void *data);
+    int (*string)(const char *value, size_t len, void *data);
+    int (*integer)(json_int_t value, void *data);
+    int (*real)(double value, void *data);
+    int (*boolean)(int value, void *data);
+    int (*null)(void *data);
+} json_sax_callbacks_t;
+
+/* Returns 0, or -1 with error set. JSON_REJECT_DUPLICATES is ignored. */
+int json_sax_loadb(const char *buffer, size_t buflen, size_t flags,
+                   const json_sax_callbacks_t *callbacks, void *data, json_error_t *error);
+
 
 /* encoding */
 
@@ -67,6 +67,7 @@ typedef struct {
     strbuffer_t saved_text;
     size_t flags;
     size_t depth;
+    int in_place; /* strings decoded into saved_text, not allocated */
     int token;
     union {
         struct {
@@ -297,7 +298,8 @@ static void lex_save_cached(lex_t *lex)
 
 static void lex_free_string(lex_t *lex)
 {
-    jsonp_free(lex->value.string.val);
+    if(!lex->in_place)
+        jsonp_free(lex->value.string.val);
     lex->value.string.val = NULL;
     lex->value.string.len = 0;
 }
@@ -387,8 +389,13 @@ static void lex_scan_string(lex_t *lex, json_error_t *error)
          - a single \uXXXX escape (length 6) is converted to at most 3 bytes
          - two \uXXXX escapes (length 12) forming an UTF-16 surrogate pair
            are converted to 4 bytes
+       which also means it can be decoded over the saved text itself, the
+       write position never passing the read position.
     */
-    t = (char*)jsonp_malloc(lex->saved_text.length + 1);
+    if(lex->in_place)
+        t = lex->saved_text.value;
+    else
+        t = (char*)jsonp_malloc(lex->saved_text.length + 1);
     if(!t) {
         /* this is not very nice, since TOKEN_INVALID is returned */
         goto out;
@@ -681,6 +688,7 @@ static int lex_init(lex_t *lex, get_func get, size_t flags, void *data)
         return -1;
 
     lex->flags = flags;
+    lex->in_place = 0;
     lex->token = TOKEN_INVALID;
     return 0;
 }
@@ -921,6 +929,200 @@ static json_t *parse_json(lex_t *lex, size_t flags, json_error_t *error)
     return result;
 }
 
+
+/*** streaming parser ***/
+
+#define SAX_EMIT(cb, call) \
+    ((cb) && (call) != 0 ? sax_stopped(lex, error) : 0)
+
+static int sax_stopped(lex_t *lex, json_error_t *error)
+{
+    error_set(error, lex, json_error_unknown, "stopped by callback");
+    return -1;
+}
+
+static int sax_parse_value(lex_t *lex, size_t flags, const json_sax_callbacks_t *cb,
+                           void *data, json_error_t *error);
+
+static int sax_parse_object(lex_t *lex, size_t flags, const json_sax_callbacks_t *cb,
+                            void *data, json_error_t *error)
+{
+    if(SAX_EMIT(cb->object_start, cb->object_start(data)))
+        return -1;
+
+    lex_scan(lex, error);
+    if(lex->token != '}') {
+        while(1) {
+            if(lex->token != TOKEN_STRING) {
+                error_set(error, lex, json_error_invalid_syntax, "string or '}' expected");
+                return -1;
+            }
+            if(memchr(lex->value.string.val, '\0', lex->value.string.len)) {
+                error_set(error, lex, json_error_null_byte_in_key, "NUL byte in object key not supported");
+                return -1;
+            }
+
+            /* the key lives in saved_text until the next scan */
+            if(SAX_EMIT(cb->key, cb->key(lex->value.string.val, lex->value.string.len, data)))
+                return -1;
+
+            lex_scan(lex, error);
+            if(lex->token != ':') {
+                error_set(error, lex, json_error_invalid_syntax, "':' expected");
+                return -1;
+            }
+
+            lex_scan(lex, error);
+            if(sax_parse_value(lex, flags, cb, data, error))
+                return -1;
+
+            lex_scan(lex, error);
+            if(lex->token != ',')
+                break;
+
+            lex_scan(lex, error);
+        }
+
+        if(lex->token != '}') {
+            error_set(error, lex, json_error_invalid_syntax, "'}' expected");
+            return -1;
+        }
+    }
+
+    return SAX_EMIT(cb->object_end, cb->object_end(data));
+}
+
+static int sax_parse_array(lex_t *lex, size_t flags, const json_sax_callbacks_t *cb,
+                           void *data, json_error_t *error)
+{
+    if(SAX_EMIT(cb->array_start, cb->array_start(data)))
+        return -1;
+
+    lex_scan(lex, error);
+    if(lex->token != ']') {
+        while(lex->token) {
+            if(sax_parse_value(lex, flags, cb, data, error))
+                return -1;
+
+            lex_scan(lex, error);
+            if(lex->token != ',')
+                break;
+
+            lex_scan(lex, error);
+        }
+
+        if(lex->token != ']') {
+            error_set(error, lex, json_error_invalid_syntax, "']' expected");
+            return -1;
+        }
+    }
+
+    return SAX_EMIT(cb->array_end, cb->array_end(data));
+}
+
+static int sax_parse_value(lex_t *lex, size_t flags, const json_sax_callbacks_t *cb,
+                           void *data, json_error_t *error)
+{
+    int result;
+
+    lex->depth++;
+    if(lex->depth > JSON_PARSER_MAX_DEPTH) {
+        error_set(error, lex, json_error_stack_overflow, "maximum parsing depth reached");
+        return -1;
+    }
+
+    switch(lex->token) {
+        case TOKEN_STRING: {
+            const char *value = lex->value.string.val;
+            size_t len = lex->value.string.len;
+
+            if(!(flags & JSON_ALLOW_NUL)) {
+                if(memchr(value, '\0', len)) {
+                    error_set(error, lex, json_error_null_character, "\\u0000 is not allowed without JSON_ALLOW_NUL");
+                    return -1;
+                }
+            }
+
+            result = SAX_EMIT(cb->string, cb->string(value, len, data));
+            break;
+        }
+
+        case TOKEN_INTEGER:
+            result = SAX_EMIT(cb->integer, cb->integer(lex->value.integer, data));
+            break;
+
+        case TOKEN_REAL:
+            result = SAX_EMIT(cb->real, cb->real(lex->value.real, data));
+            break;
+
+        case TOKEN_TRUE:
+            result = SAX_EMIT(cb->boolean, cb->boolean(1, data));
+            break;
+
+        case TOKEN_FALSE:
+            result = SAX_EMIT(cb->boolean, cb->boolean(0, data));
+            break;
+
+        case TOKEN_NULL:
+            result = SAX_EMIT(cb->null, cb->null(data));
+            break;
+
+        case '{':
+            result = sax_parse_object(lex, flags, cb, data, error);
+            break;
+
+        case '[':
+            result = sax_parse_array(lex, flags, cb, data, error);
+            break;
+
+        case TOKEN_INVALID:
+            error_set(error, lex, json_error_invalid_syntax, "invalid token");
+            return -1;
+
+        default:
+            error_set(error, lex, json_error_invalid_syntax, "unexpected token");
+            return -1;
+    }
+
+    if(result)
+        return -1;
+
+    lex->depth--;
+    return 0;
+}
+
+static int sax_parse_json(lex_t *lex, size_t flags, const json_sax_callbacks_t *cb,
+                          void *data, json_error_t *error)
+{
+    lex->depth = 0;
+
+    lex_scan(lex, error);
+    if(!(flags & JSON_DECODE_ANY)) {
+        if(lex->token != '[' && lex->token != '{') {
+            error_set(error, lex, json_error_invalid_syntax, "'[' or '{' expected");
+            return -1;
+        }
+    }
+
+    if(sax_parse_value(lex, flags, cb, data, error))
+        return -1;
+
+    if(!(flags & JSON_DISABLE_EOF_CHECK)) {
+        lex_scan(lex, error);
+        if(lex->token != TOKEN_EOF) {
+            error_set(error, lex, json_error_end_of_input_expected, "end of file expected (%i)", lex->token);
+            return -1;
+        }
+    }
+
+    if(error) {
+        /* Save the position even though there was no error */
+        error->position = (int)lex->stream.position;
+    }
+
+    return 0;
+}
+
 typedef struct
 {
     const char *data;
@@ -1159,3 +1361,31 @@ json_t *json_load_callback(json_load_callback_t callback, void *arg, size_t flag
     lex_close(&lex);
     return result;
 }
+
+int json_sax_loadb(const char *buffer, size_t buflen, size_t flags,
+                   const json_sax_callbacks_t *callbacks, void *data, json_error_t *error)
+{
+    lex_t lex;
+    int result;
+    buffer_data_t stream_data;
+
+    jsonp_error_init(error, "<buffer>");
+
+    if (buffer == NULL || callbacks == NULL) {
+        error_set(error, NULL, json_error_invalid_argument, "wrong arguments");
+        return -1;
+    }
+
+    stream_data.data = buffer;
+    stream_data.pos = 0;
+    stream_data.len = buflen;
+
+    if(lex_init(&lex, buffer_get, flags, (void *)&stream_data))
+        return -1;
+    lex.in_place = 1;
+
+    result = sax_parse_json(&lex, flags, callbacks, data, error);
+
+    lex_close(&lex);
+    return result;
+}
@@ -0,0 +1,127 @@
+#include "broadcastscheduler.h"
+#include "config.h"
+#include <algorithm>
+
+BroadcastScheduler::BroadcastScheduler()
+{
+    reset();
+}
+
+void BroadcastScheduler::reset()
+{
+    dirty = 0;
+    pauseFramesLeft = 0;
+    lastSentMs = 0;
+    anySent = false;
+    bytesSent = 0;
+    avgFrameBytes = 0.0f;
+    uplinkIntervalMs = 0;
+    frames.fill(Frame{0, 0, 0});
+    clients.clear();
+}
+
+bool BroadcastScheduler::due(uint32_t nowMs, size_t sendQueueDepth)
+{
+    // A frame still queued means the uplink can't keep up; it would be
+    // replaced anyway, so space them out rather than serializing each tick
+    uplinkIntervalMs = nextInterval(uplinkIntervalMs, sendQueueDepth > 1, 0.0f);
+    
+    if (!dirty) return false;
+    if (dirty & (URGENT | PAUSE)) return true;
+    return !anySent || nowMs - lastSentMs >= intervalMs();
+}
+
+void BroadcastScheduler::sent(uint32_t seq, size_t bytes, uint32_t nowMs)
+{
+    if (dirty & PAUSE) {
+        pauseFramesLeft = PAUSE_REPEAT_FRAMES - 1;  // This one was the first
+    } else if (pauseFramesLeft > 0) {
+        pauseFramesLeft--;
+    }
+    dirty = 0;
+    lastSentMs = nowMs;
+    anySent = true;
+    
+    bytesSent += bytes;
+    if (bytes > 0) {
+        avgFrameBytes = avgFrameBytes == 0.0f ? (float)bytes : avgFrameBytes * 0.875f + (float)bytes * 0.125f;
+    }
+    frames[seq & (FRAME_HISTORY - 1)] = Frame{seq, nowMs, bytesSent};
+}
+
+const BroadcastScheduler::Frame* BroadcastScheduler::findFrame(uint32_t seq) const
+{
+    const Frame& frame = frames[seq & (FRAME_HISTORY - 1)];
+    return (seq != 0 && frame.seq == seq) ? &frame : nullptr;
+}
+
+void BroadcastScheduler::onAck(int slot, uint32_t seq, uint32_t nowMs)
+{
+    if (slot < 0) return;
+    const Frame* frame = findFrame(seq);
+    if (!frame) return;  // Older than the history
+    
+    if ((size_t)slot >= clients.size()) {
+        clients.resize(slot + 1, Link{0, 0, 0, 0, 0, 0.0f, 0});
+    }
+    Link& link = clients[slot];
+    if (link.lastAckSeq != 0 && seq <= link.lastAckSeq) return;
+    
+    uint32_t rtt = nowMs - frame->sentMs;
+    link.srttMs = link.srttMs == 0 ? rtt : (link.srttMs * 7 + rtt) / 8;
+    if (link.minRttMs == 0 || rtt < link.minRttMs ||
+        nowMs - link.minRttSince >= Config::Network::BROADCAST_MIN_RTT_WINDOW_MS) {
+        link.minRttMs = rtt;
+        link.minRttSince = nowMs;
+    }
+    
+    // Bytes delivered between two acks over the time between them
+    const Frame* previous = link.lastAckSeq != 0 ? findFrame(link.lastAckSeq) : nullptr;
+    if (previous && nowMs != link.lastAckMs && frame->bytesThrough > previous->bytesThrough) {
+        float sample = (float)(frame->bytesThrough - previous->bytesThrough) * 1000.0f / (float)(nowMs - link.lastAckMs);
+        link.goodputBytesPerSec = link.goodputBytesPerSec == 0.0f
+            ? sample : link.goodputBytesPerSec * 0.75f + sample * 0.25f;
+    }
+    link.lastAckSeq = seq;
+    link.lastAckMs = nowMs;
+    
+    bool congested = link.srttMs > link.minRttMs + Config::Network::BROADCAST_QUEUE_DELAY_MS;
+    link.intervalMs = nextInterval(link.intervalMs, congested, link.goodputBytesPerSec);
+}
+
+void BroadcastScheduler::removeClient(int slot)
+{
+    if (slot >= 0 && (size_t)slot < clients.size()) {
+        clients[slot] = Link{0, 0, 0, 0, 0, 0.0f, 0};
+    }
+}
+
+uint32_t BroadcastScheduler::nextInterval(uint32_t current, bool congested, float goodputBytesPerSec) const
+{
+    if (!congested) {
+        uint32_t step = std::max(current / 8, Config::Network::BROADCAST_RECOVERY_MS);
+        return current > step ? current - step : 0;
+    }
+    
+    // Every other tick at first, then half as often again each time,
+    // and no more often than the measured goodput carries a frame
+    uint32_t next = std::max(current, (uint32_t)Config::Game::INITIAL_SPEED_MS) * 3 / 2;
+    if (goodputBytesPerSec > 0.0f && avgFrameBytes > 0.0f) {
+        next = std::max(next, (uint32_t)(avgFrameBytes * 1000.0f / goodputBytesPerSec));
+    }
+    return std::min(next, Config::Network::BROADCAST_MAX_INTERVAL_MS);
+}
+
+uint32_t BroadcastScheduler::intervalMs() const
+{
+    uint32_t interval = uplinkIntervalMs;
+    for (const Link& link : clients) {
+        interval = std::max(interval, link.intervalMs);
+    }
+    return interval;
+}
+
+bool BroadcastScheduler::framesFlowing(uint32_t nowMs) const
+{
+    return anySent && nowMs - lastSentMs < 1000;
+}
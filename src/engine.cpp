@@ -0,0 +1,327 @@
+#include "engine.h"
+#include "logger.h"
+#include "profiler.h"
+#include <algorithm>
+#include <vector>
+
+ArenaSettings ArenaSettings::clamped() const
+{
+    ArenaSettings out;
+    out.width = std::max(Config::Grid::MIN_WIDTH, std::min(width, Config::Grid::MAX_WIDTH));
+    out.height = std::max(Config::Grid::MIN_HEIGHT, std::min(height, Config::Grid::MAX_HEIGHT));
+    out.maxPlayers = std::max(1, std::min(maxPlayers, Config::Game::PLAYER_LIMIT));
+    return out;
+}
+
+void PlayerManager::resize(int capacity)
+{
+    while (!activeSlots.empty() && activeSlots.back() >= capacity) {
+        deactivate(activeSlots.back());
+    }
+    slots.resize(capacity);
+    if (myIndex >= capacity) myIndex = -1;
+}
+
+void PlayerManager::activate(int i, const std::string& clientId)
+{
+    PlayerSlot& slot = slots[i];
+    if (slot.active) {
+        slotByClientId.erase(slot.clientId);
+    } else {
+        activeSlots.insert(std::lower_bound(activeSlots.begin(), activeSlots.end(), i), i);
+    }
+    slot.active = true;
+    slot.clientId = clientId;
+    slotByClientId[clientId] = i;
+}
+
+void PlayerManager::deactivate(int i)
+{
+    PlayerSlot& slot = slots[i];
+    if (!slot.active) return;
+    
+    auto it = slotByClientId.find(slot.clientId);
+    if (it != slotByClientId.end() && it->second == i) slotByClientId.erase(it);
+    activeSlots.erase(std::lower_bound(activeSlots.begin(), activeSlots.end(), i));
+    
+    slot.active = false;
+    slot.paused = false;
+    slot.disconnectedAt = 0;
+    slot.clientId.clear();
+    slot.resumeKey.clear();
+    slot.snake.reset();
+    slot.remote.clear();
+}
+
+void PlayerManager::clear()
+{
+    while (!activeSlots.empty()) {
+        deactivate(activeSlots.back());
+    }
+    myIndex = -1;
+}
+
+int PlayerManager::firstFreeSlot() const
+{
+    for (int i = 0; i < capacity(); i++) {
+        if (!slots[i].active) return i;
+    }
+    return -1;
+}
+
+void applyArena(const ArenaSettings& arena, PlayerManager& players, OccupancyGrid& occupancy)
+{
+    ArenaSettings a = arena.clamped();
+    players.resize(a.maxPlayers);
+    if (occupancy.getWidth() != a.width || occupancy.getHeight() != a.height) {
+        occupancy.resize(a.width, a.height);
+    }
+    
+    // Keep snakes that still fit, then respawn the rest around them
+    occupancy.clear();
+    std::vector<int> misplaced;
+    for (int i : players.activeIndices()) {
+        if (!players[i].snake) continue;
+        bool fits = true;
+        for (const auto& segment : players[i].snake->getBody()) {
+            fits = fits && occupancy.inBounds(segment);
+        }
+        if (fits) {
+            occupancy.occupyBody(*players[i].snake, i);
+        } else {
+            misplaced.push_back(i);
+        }
+    }
+    for (int i : misplaced) {
+        players[i].snake->reset(getRandomSpawnPositionUtil(occupancy));
+        occupancy.occupyBody(*players[i].snake, i);
+    }
+}
+
+SnakeEngine::SnakeEngine(PlayerManager& players, OccupancyGrid& occupancy, MatchState& match,
+                         Food& food, EngineClock clock)
+    : players(players), occupancy(occupancy), match(match), food(food), clock(std::move(clock))
+{
+}
+
+void SnakeEngine::tick()
+{
+    // Occupancy grid is maintained incrementally - no per-tick rebuild
+    const std::vector<int>& active = players.activeIndices();
+    moves.resize(players.capacity());
+    
+    // Ticks since each client's last applied input, echoed for prediction
+    for (int i : active) {
+        if (players[i].inputAge < 0xFF) players[i].inputAge++;
+    }
+    
+    // Phase 1: move, then detect collisions (the profiler's collision phase)
+    {
+        PROFILE_SCOPE(COLLISIONS);
+        for (int i : active)
+        {
+            moves[i].processed = false;
+            // Held for a resume: frozen in place, still an obstacle
+            if (!players[i].snake || !players[i].snake->isAlive() || players[i].disconnectedAt != 0)
+                continue;
+            moves[i].processed = true;
+            
+            const auto& body = players[i].snake->getBody();
+            if (body.empty())
+            {
+                Logger::error("Player ", (i+1), " has empty snake body!");
+                moves[i].processed = false;
+                continue;
+            }
+            
+            moves[i].oldHead = players[i].snake->getHead();
+            moves[i].oldTail = body.back();
+            moves[i].willGrow = (moves[i].oldHead == food.getPosition());
+            
+            players[i].snake->update();
+            moves[i].newHead = players[i].snake->getHead();
+            
+            // Skip collision check if snake didn't move (direction not set yet)
+            if (moves[i].oldHead.x == moves[i].newHead.x && moves[i].oldHead.y == moves[i].newHead.y) {
+                moves[i].processed = false;
+                continue;
+            }
+            
+            // Check collisions against UNCHANGED grid (all tails still present)
+            moves[i].collision = false;
+            
+            // Boundary collision
+            if (!occupancy.inBounds(moves[i].newHead)) {
+                moves[i].collision = true;
+            }
+            // Snake collision - check against original grid state
+            else if (occupancy.isOccupied(moves[i].newHead)) {
+                // Exception: if not growing, we can move into our own tail position
+                // because the tail will move away this frame
+                if (moves[i].willGrow || !(moves[i].newHead == moves[i].oldTail)) {
+                    moves[i].collision = true;
+                    Logger::debug("Player ", (i+1), " collision at (", 
+                              moves[i].newHead.x, ",", moves[i].newHead.y, ")");
+                }
+            }
+        }
+        
+        // Head-on: two snakes entering the same free cell both die, so a cell
+        // never has more than one owner in the grid
+        for (size_t a = 0; a < active.size(); a++) {
+            int i = active[a];
+            if (!moves[i].processed) continue;
+            for (size_t b = a + 1; b < active.size(); b++) {
+                int j = active[b];
+                if (moves[j].processed && moves[i].newHead == moves[j].newHead) {
+                    moves[i].collision = true;
+                    moves[j].collision = true;
+                    Logger::debug("Players ", (i+1), " and ", (j+1), " collided head-on");
+                }
+            }
+        }
+    }
+    
+    // Phase 2: Apply head/tail deltas of surviving snakes to the grid
+    for (int i : active) {
+        if (!moves[i].processed || moves[i].collision)
+            continue;
+        
+        Snake& snake = *players[i].snake;
+        
+        // Release the vacated tail first (the head may move into it).
+        // A tail duplicated by grow() is still part of the body.
+        if (!(snake.getBody().back() == moves[i].oldTail)) {
+            occupancy.release(moves[i].oldTail, i);
+        }
+        occupancy.occupy(moves[i].newHead, i);
+        
+        if (moves[i].willGrow) {
+            // Snake grew - the new tail cell is already occupied
+            snake.grow();
+            food.spawn(occupancy);
+            Logger::debug("Player ", (i+1), " ate food!");
+            
+            if (onFoodEaten) {
+                onFoodEaten();
+            }
+        }
+    }
+    
+    // Phase 3: Respawn dead snakes once all survivors are in the grid
+    for (int i : active) {
+        if (!moves[i].processed || !moves[i].collision)
+            continue;
+        
+        // The popped tail is no longer in the body but still owned by us
+        occupancy.release(moves[i].oldTail, i);
+        respawnPlayer(i);
+        Logger::info("Player ", (i+1), " died and respawned!");
+    }
+}
+
+void SnakeEngine::respawnPlayer(int playerIndex)
+{
+    Snake& snake = *players[playerIndex].snake;
+    occupancy.releaseBody(snake, playerIndex);
+    snake.reset(randomSpawnPosition());
+    occupancy.occupyBody(snake, playerIndex);
+}
+
+Position SnakeEngine::randomSpawnPosition() const
+{
+    return getRandomSpawnPositionUtil(occupancy);
+}
+
+void SnakeEngine::rebuildOccupancy()
+{
+    occupancy.rebuild(players.getSlots().data(), players.capacity());
+}
+
+void SnakeEngine::resetMatch()
+{
+    // Every snake respawns, so start from an empty grid
+    occupancy.clear();
+
+    for (int i : players.activeIndices())
+    {
+        if (players.isValid(i))
+        {
+            Position spawnPos = randomSpawnPosition();
+            players[i].snake->reset(spawnPos);
+            players[i].snake->setScore(0);
+            
+            // Update occupancy grid with new snake position
+            occupancy.occupyBody(*players[i].snake, i);
+        }
+    }
+    
+    match.winnerIndex = -1;
+    match.matchStartTime = now();
+    match.totalPausedTime = 0;
+    match.pauseStartTime = 0;
+    match.syncedElapsedMs = 0;
+
+    food.spawn(occupancy);
+}
+
+uint32_t SnakeEngine::updateMatchTime(bool paused)
+{
+    uint32_t currentTime = now();
+    
+    // Calculate elapsed time, subtracting paused time
+    uint32_t currentPausedTime = match.totalPausedTime;
+    if (paused && match.pauseStartTime > 0) {
+        currentPausedTime += (currentTime - match.pauseStartTime);
+    }
+    
+    match.syncedElapsedMs = currentTime - match.matchStartTime - currentPausedTime;
+    return match.syncedElapsedMs;
+}
+
+bool SnakeEngine::matchTimeUp() const
+{
+    return match.syncedElapsedMs / 1000 >= (uint32_t)Config::Game::MATCH_DURATION_SECONDS;
+}
+
+int SnakeEngine::decideWinner()
+{
+    // Find winner - longest snake
+    int maxLength = 0;
+    match.winnerIndex = -1;
+    std::vector<int> tiedPlayers;
+    
+    for (int i : players.activeIndices())
+    {
+        if (!players[i].snake || players[i].disconnectedAt != 0)
+            continue;
+
+        int length = players[i].snake->getBody().size();
+        
+        if (length > maxLength) {
+            maxLength = length;
+            match.winnerIndex = i;
+            tiedPlayers.clear();
+            tiedPlayers.push_back(i);
+        } else if (length == maxLength && maxLength > 0)
+        {
+            tiedPlayers.push_back(i);
+        }
+    }
+    
+    // Tie-breaker: score
+    if (tiedPlayers.size() > 1)
+    {
+        int maxScore = -1;
+        match.winnerIndex = -1;
+        for (int idx : tiedPlayers)
+        {
+            if (players[idx].snake->getScore() > maxScore)
+            {
+                maxScore = players[idx].snake->getScore();
+                match.winnerIndex = idx;
+            }
+        }
+    }
+    return match.winnerIndex;
+}
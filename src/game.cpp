@@ -1,15 +1,26 @@
 #include "game.h"
+#include "profiler.h"
+#include <algorithm>
 #include <iostream>
 #include <ctime>
 
-Game::Game() 
-    : state(GameState::MENU), quit(false),
+Game::Game(const ArenaSettings& arena, int bots, bool record)
+    : localArena(arena.clamped()), botCount(std::max(0, std::min(bots, localArena.maxPlayers - 1))),
+      recordMatches(record),
+      engine(ctx.players, ctx.occupancy, ctx.match, food, [] { return (uint32_t)SDL_GetTicks(); }),
+      recorder(Replay::MatchView{ctx.players, ctx.occupancy, ctx.match, food}),
+      state(GameState::MENU), quit(false),
       updateInterval(Config::Game::INITIAL_SPEED_MS), menuSelection(0), pauseMenuSelection(0),
-      sessionSelection(0), countdownStartTime(0), inputHandler(&Game::handleMenuInput)
+      sessionSelection(0), countdownStartTime(0), tickAccumulator(0), renderAlpha(1.0f),
+      showNetStats(false), showProfiler(false), launchTime(SDL_GetTicks()), firstFramePresented(false),
+      startupLogged(false), inputHandler(&Game::handleMenuInput)
 {
     // Initialize logger
-    Logger::init("hardcoresnake.log", LogLevel::INFO, true);
+    Logger::init("hardcoresnake.log", LogLevel::INFO, true, true);
     Logger::info("Game starting...");
+#if FRAME_PROFILER
+    Profiler::instance().enable();
+#endif
     
     // Initialize game context
     ctx.players.setMyPlayerIndex(-1);
@@ -29,15 +40,18 @@ Game::Game()
         }
     };
         networkManager = std::make_unique<NetworkManager>(&ctx);
+    // DNS and the TCP handshake run while the window and fonts load
+    networkManager->preconnect(Config::Network::DEFAULT_HOST, Config::Network::DEFAULT_PORT);
+    engine.onFoodEaten = [this] {
+        networkManager->markBroadcastDirty(BroadcastScheduler::URGENT);
+    };
         ui = std::make_unique<MenuRender>();
     
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-        ctx.players[i].active = false;
-        ctx.players[i].clientId = "";
-        ctx.players[i].snake = nullptr;
-        ctx.players[i].paused = false;
-    }
-    food.spawn(occupiedPositions);
+    // Our own arena for single player and hosting; joining adopts the host's
+    ctx.arena = localArena;
+    applyArena(ctx.arena, ctx.players, ctx.occupancy);
+    Logger::info("Arena ", ctx.arena.width, "x", ctx.arena.height, ", up to ", ctx.arena.maxPlayers, " players");
+    food.spawn(ctx.occupancy);
     lastUpdate = SDL_GetTicks();
 }
 
@@ -51,6 +65,15 @@ Game::~Game()
     networkManager.reset();
     // ui automatically cleaned up by unique_ptr
     
+#if FRAME_PROFILER
+    const Profiler& profiler = Profiler::instance();
+    if (profiler.writeCsv(Config::Profiler::CSV_FILE) && profiler.writeChromeTrace(Config::Profiler::TRACE_FILE)) {
+        Logger::info("Profile written to ", Config::Profiler::CSV_FILE, " and ", Config::Profiler::TRACE_FILE);
+    } else {
+        Logger::warn("Failed to write the profile");
+    }
+#endif
+    
     Logger::info("Game shutting down...");
     Logger::shutdown();
 }
@@ -58,35 +81,99 @@ Game::~Game()
 void Game::run()
 {
     while (!quit) {
-        handleInput();
-        update();
-        render();
+        Uint32 frameStart = SDL_GetTicks();
+        
+        {
+            PROFILE_SCOPE(FRAME);
+            handleInput();
+            update();
+            render();
+        }
+        
+        // Frame cap on top of vsync, for drivers that ignore it
+        Uint32 frameTime = SDL_GetTicks() - frameStart;
+        if (frameTime < (Uint32)Config::Render::FRAME_DELAY_MS) {
+            SDL_Delay(Config::Render::FRAME_DELAY_MS - frameTime);
+        }
     }
 }
 
+bool Game::isIdleState() const
+{
+    // Nothing animates here - frames only need to follow input and network
+    return !replay && (state == GameState::MENU || state == GameState::SINGLEPLAYER ||
+           state == GameState::MULTIPLAYER || state == GameState::LOBBY ||
+           state == GameState::MATCH_END);
+}
+
 void Game::handleInput()
 {
     SDL_Event e;
+    
+    // Menus sleep until input arrives (or the timeout, so network messages still get processed)
+    bool waited = isIdleState() && SDL_WaitEventTimeout(&e, Config::Render::IDLE_WAIT_MS);
+    
+    PROFILE_SCOPE(HANDLE_INPUT);  // Not the idle wait
+    if (waited) {
+        handleEvent(e);
+    }
+    
     while (SDL_PollEvent(&e) != 0)
     {
-        if (e.type == SDL_QUIT)
-        {
-            quit = true;
-            continue;
-        }
-        
-        if (e.type == SDL_KEYDOWN)
-        {
-            // Call through function pointer
-            if (inputHandler) {
-                (this->*inputHandler)(e.key.keysym.sym);
-            }
+        handleEvent(e);
+    }
+}
+
+void Game::handleEvent(const SDL_Event& e)
+{
+    if (e.type == SDL_QUIT)
+    {
+        quit = true;
+        return;
+    }
+    
+    // Cached render-target content doesn't survive these
+    if (e.type == SDL_WINDOWEVENT &&
+        (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || e.window.event == SDL_WINDOWEVENT_EXPOSED))
+    {
+        ui->invalidateRenderCaches();
+        return;
+    }
+    if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+    {
+        ui->invalidateRenderCaches(e.type == SDL_RENDER_DEVICE_RESET);
+        return;
+    }
+    
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3)
+    {
+        showNetStats = !showNetStats;
+        return;
+    }
+#if FRAME_PROFILER
+    if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4)
+    {
+        showProfiler = !showProfiler;
+        return;
+    }
+#endif
+    
+    if (e.type == SDL_KEYDOWN)
+    {
+        // Call through function pointer
+        if (inputHandler) {
+            (this->*inputHandler)(e.key.keysym.sym);
         }
     }
 }
 
 void Game::update()
 {
+    if (replay) {
+        updateReplay();
+        return;
+    }
+    
     // Process queued network messages (thread-safe)
     if (networkManager && networkManager->isConnected()) {
         networkManager->processMessages();
@@ -98,12 +185,22 @@ void Game::update()
         }
         
         if (networkManager->getNetworkContext().isHost) {
-            networkManager->sendPeriodicStateSync();  // Every 5 seconds
+            networkManager->sendPeriodicStateSync();  // Host, arena and roster
+        }
+        
+        // The browser shows the cached list at once and keeps it fresh
+        const NetworkContext& net = networkManager->getNetworkContext();
+        if (state == GameState::MULTIPLAYER && net.sessionId.empty() &&
+            networkManager->pendingRequest() == NetworkManager::RequestKind::NONE &&
+            (net.sessionsRequestedAt == 0 ||
+             SDL_GetTicks() - net.sessionsRequestedAt >= Config::Network::SESSION_LIST_REFRESH_MS)) {
+            refreshSessionList();
         }
     }
     
     // Handle countdown state transition
     if (state == GameState::COUNTDOWN) {
+        restartTickClock();
         Uint32 currentTime = SDL_GetTicks();
         Uint32 elapsed = currentTime - countdownStartTime;
         if (elapsed >= 3000) {  // 3 seconds countdown
@@ -113,8 +210,14 @@ void Game::update()
     }
     
     // Only update game logic when playing or paused
-    if (state != GameState::PLAYING && state != GameState::PAUSED)
+    if (state != GameState::PLAYING && state != GameState::PAUSED) {
+        restartTickClock();
         return;
+    }
+    
+    if (networkManager->isConnected() && !networkManager->getNetworkContext().isHost) {
+        networkManager->updateRemoteTracks(updateInterval);
+    }
     
     Uint32 currentTime = SDL_GetTicks();
     
@@ -123,73 +226,144 @@ void Game::update()
         checkMatchTimer(currentTime);
     }
     
-    // Update players when playing, or send keepalive updates when paused
-    if (currentTime - lastUpdate >= (Uint32)updateInterval)
+    // Fixed timestep: run as many simulation ticks as real time has
+    // accumulated, independent of the frame rate
+    tickAccumulator += currentTime - lastUpdate;
+    lastUpdate = currentTime;
+    
+    int ticks = 0;
+    while (tickAccumulator >= (Uint32)updateInterval)
     {
-        lastUpdate = currentTime;
-        
         if (state == GameState::PLAYING) {
+            // Lockstep: the host publishes this tick's inputs, clients hold
+            // at the end of the last tick until they arrive
+            if (!networkManager->beginLockstepTick()) {
+                tickAccumulator = updateInterval;
+                break;
+            }
             // Normal game update - move snakes, check collisions
             updatePlayers();
         }
-        // Note: Paused state doesn't send updates - relies on periodic state sync from host
+        tickAccumulator -= updateInterval;
+        // Paused: nothing ticks; the host sent the pause when it changed
+        
+        // After a long stall drop the backlog instead of fast-forwarding
+        if (++ticks == Config::Game::MAX_TICKS_PER_FRAME) {
+            tickAccumulator %= updateInterval;
+            break;
+        }
+    }
+    
+    // Lockstep client that fell behind the host: run the surplus ticks now
+    while (state == GameState::PLAYING && ticks < Config::Game::MAX_TICKS_PER_FRAME &&
+           networkManager->lockstepBacklog() > Config::Network::LOCKSTEP_BUFFER_TICKS &&
+           networkManager->beginLockstepTick())
+    {
+        updatePlayers();
+        ticks++;
     }
+    
+    // How far we are into the next tick, for render interpolation
+    renderAlpha = (state == GameState::PLAYING)
+        ? (float)tickAccumulator / (float)updateInterval
+        : 1.0f;
+}
+
+void Game::restartTickClock()
+{
+    lastUpdate = SDL_GetTicks();
+    tickAccumulator = 0;
+    renderAlpha = 1.0f;
 }
 
 void Game::render()
 {
-    switch (state)
-    {
-        case GameState::MENU:
-            ui->clearScreen();
-            ui->renderMenu(menuSelection);
-            break;
-            
-        case GameState::SINGLEPLAYER:
-            // Transition state - render menu
-            ui->clearScreen();
-            ui->renderMenu(menuSelection);
-            break;
+    PROFILE_SCOPE(RENDER);
+    
+    if (replay) {
+        renderReplay();
+    } else {
+        switch (state)
+        {
+            case GameState::MENU:
+                ui->clearScreen();
+                ui->renderMenu(menuSelection);
+                break;
+            
+            case GameState::SINGLEPLAYER:
+                // Transition state - render menu
+                ui->clearScreen();
+                ui->renderMenu(menuSelection);
+                break;
+            
+            case GameState::MULTIPLAYER:
+                ui->clearScreen();
+                ui->renderSessionBrowser(
+                    networkManager->getNetworkContext().availableSessions, 
+                    sessionSelection,
+                    networkManager->isConnected(),
+                    sessionBrowserStatus(),
+                    networkManager->getNetworkContext().sessionsUpdatedAt
+                );
+                break;
+            
+            case GameState::LOBBY:
+                ui->clearScreen();
+                ui->renderLobby(ctx.players, networkManager->getNetworkContext().isHost);
+                break;
+            
+            case GameState::COUNTDOWN: {
+                ui->renderGame(ctx, false, renderAlpha);
+                Uint32 elapsed = SDL_GetTicks() - countdownStartTime;
+                int remaining = 3 - (elapsed / 1000);
+                if (remaining < 0) remaining = 0;
+                ui->renderCountdown(remaining);
+                break;
+            }
             
-        case GameState::MULTIPLAYER:
-            ui->clearScreen();
-            ui->renderSessionBrowser(
-                networkManager->getNetworkContext().availableSessions, 
-                sessionSelection,
-                networkManager->isConnected()
-            );
-            break;
+            case GameState::PLAYING:
+                ui->renderGame(ctx, false, renderAlpha);
+                break;
             
-        case GameState::LOBBY:
-            ui->clearScreen();
-            ui->renderLobby(ctx.players.getSlots(), networkManager->getNetworkContext().isHost);
-            break;
+            case GameState::PAUSED:
+                ui->renderGame(ctx, false, renderAlpha);
+                ui->renderPauseMenu(pauseMenuSelection);
+                break;
             
-        case GameState::COUNTDOWN: {
-            ui->renderGame(ctx, false);
-            Uint32 elapsed = SDL_GetTicks() - countdownStartTime;
-            int remaining = 3 - (elapsed / 1000);
-            if (remaining < 0) remaining = 0;
-            ui->renderCountdown(remaining);
-            break;
+            case GameState::MATCH_END:
+                ui->renderGame(ctx, true, renderAlpha);
+                ui->renderMatchEnd(ctx.match.winnerIndex, ctx.players);
+                break;
         }
-            
-        case GameState::PLAYING:
-            ui->renderGame(ctx, false);
-            break;
-            
-        case GameState::PAUSED:
-            ui->renderGame(ctx, false);
-            ui->renderPauseMenu(pauseMenuSelection);
-            break;
-            
-        case GameState::MATCH_END:
-            ui->renderGame(ctx, true);
-            ui->renderMatchEnd(ctx.match.winnerIndex, ctx.players.getSlots());
-            break;
     }
+    
+    if (networkManager && networkManager->resuming()) {
+        ui->renderBanner("Connection lost - reconnecting...");
+    }
+    if (showNetStats && networkManager && networkManager->isConnected()) {
+        ui->renderNetStats(networkManager->getNetworkContext().telemetry.report(),
+                           networkManager->sendQueueDepth());
+    }
+#if FRAME_PROFILER
+    if (showProfiler) {
+        ui->renderProfiler(Profiler::instance());
+    }
+#endif
 
+    PROFILE_SCOPE(PRESENT);  // Includes the vsync wait
     ui->present();
+    
+    if (!startupLogged) {
+        Uint32 elapsed = SDL_GetTicks() - launchTime;
+        if (!firstFramePresented) {
+            Logger::info("Startup: first frame presented after ", elapsed, " ms");
+            firstFramePresented = true;
+        }
+        if (ui->textReady()) {
+            Logger::info("Startup: main menu ready after ", elapsed, " ms");
+            startupLogged = true;
+        }
+    }
 }
 
 void Game::changeState(GameState newState)
@@ -257,6 +431,7 @@ void Game::changeState(GameState newState, bool fromNetwork)
     exitState(oldState, fromNetwork);
     enterState(newState, fromNetwork);
     state = newState;
+    ctx.network.matchRunning = (state == GameState::PLAYING || state == GameState::PAUSED);
 }
 
 void Game::exitState(GameState oldState, bool fromNetwork)
@@ -292,6 +467,7 @@ void Game::enterState(GameState newState, bool fromNetwork)
     switch (newState) {
         case GameState::MENU:
             // Reset everything
+            recorder.stop();
             resetGameState();
             inputHandler = &Game::handleMenuInput;
             break;
@@ -336,8 +512,8 @@ void Game::enterState(GameState newState, bool fromNetwork)
                     ctx.match.pauseStartTime = 0;
                     
                     // Spawn food for multiplayer match
-                    buildCollisionMap();
-                    food.spawn(occupiedPositions);
+                    engine.rebuildOccupancy();
+                    food.spawn(ctx.occupancy);
                     
                     // Broadcast game start with food position
                     if (networkManager->isConnected()) {
@@ -351,6 +527,8 @@ void Game::enterState(GameState newState, bool fromNetwork)
                             .set("foodY", food.getPosition().y)
                             .buildPtr();
                         networkManager->sendGameMessage(startUpdate.get());
+                        networkManager->startLockstep();
+                        networkManager->markBroadcastDirty(BroadcastScheduler::URGENT);
                     }
                 } else {
                     // Client initializes to 0, will be synced by host
@@ -359,10 +537,14 @@ void Game::enterState(GameState newState, bool fromNetwork)
                     ctx.match.pauseStartTime = 0;
                 }
             }
+            if (state != GameState::PAUSED && !recorder.recording()) {
+                startRecording();
+            }
             inputHandler = &Game::handlePlayingInput;
             break;
             
         case GameState::MATCH_END:
+            recorder.stop();
             inputHandler = &Game::handleMatchEndInput;
             break;
             
@@ -386,22 +568,27 @@ void Game::handleMenuInput(SDL_Keycode key)
         case SDLK_SPACE:
             if (menuSelection == 0)
             {  // Single Player
-                Position startPos = getRandomSpawnPosition();
-                ctx.players[0].snake = std::make_unique<Snake>(Config::Render::PLAYER_COLORS[0], startPos);
-                ctx.players[0].active = true;
-                ctx.players[0].clientId = "local_player";
+                Position startPos = engine.randomSpawnPosition();
+                ctx.players.activate(0, "local_player");
+                ctx.players[0].snake = std::make_unique<Snake>(playerColor(0), startPos);
                 ctx.players.setMyPlayerIndex(0);
+                ctx.occupancy.occupyBody(*ctx.players[0].snake, 0);
+                for (int i = 1; i <= botCount; i++) {
+                    ctx.players.activate(i, SnakeBot::botClientId(i));
+                    ctx.players[i].snake = std::make_unique<Snake>(playerColor(i), engine.randomSpawnPosition());
+                    ctx.occupancy.occupyBody(*ctx.players[i].snake, i);
+                }
                 ctx.match.matchStartTime = SDL_GetTicks();
                 ctx.match.syncedElapsedMs = 0;
                 ctx.match.totalPausedTime = 0;
                 ctx.match.pauseStartTime = 0;
                 
                 // Spawn food for singleplayer
-                buildCollisionMap();
-                food.spawn(occupiedPositions);
+                engine.rebuildOccupancy();
+                food.spawn(ctx.occupancy);
                 
                 changeState(GameState::PLAYING);
-                Logger::info("Started singleplayer mode");
+                Logger::info("Started singleplayer mode, ", botCount, " bots");
             }
             else if (menuSelection == 1)
             {  // Multiplayer
@@ -425,49 +612,73 @@ void Game::handleMenuInput(SDL_Keycode key)
     }
 }
 
+const char* Game::sessionBrowserStatus() const
+{
+    switch (networkManager->pendingRequest()) {
+        case NetworkManager::RequestKind::HOST: return "Hosting session";
+        case NetworkManager::RequestKind::JOIN: return "Joining session";
+        case NetworkManager::RequestKind::LIST: return "Refreshing";
+        case NetworkManager::RequestKind::RESUME: return "Reconnecting";
+        case NetworkManager::RequestKind::NONE: break;
+    }
+    return nullptr;
+}
+
+void Game::refreshSessionList()
+{
+    networkManager->listSessionsAsync([this](bool ok) {
+        if (!ok) {
+            Logger::error("Failed to request session list");
+        }
+        // The list may have shrunk under the selection
+        int count = (int)networkManager->getNetworkContext().availableSessions.size();
+        sessionSelection = std::max(0, std::min(sessionSelection, count - 1));
+    });
+}
+
 void Game::handleMultiplayerInput(SDL_Keycode key)
 {
+    // The browser stays responsive while a request runs, but only ESC acts
+    bool idle = networkManager->isConnected() && networkManager->getNetworkContext().sessionId.empty() &&
+                networkManager->pendingRequest() == NetworkManager::RequestKind::NONE;
+    const auto& sessions = networkManager->getNetworkContext().availableSessions;
+    
     switch (key)
     {
         case SDLK_h:
-            if (networkManager->isConnected() && networkManager->getNetworkContext().sessionId.empty()) {
-                if (networkManager->hostSession()) {
-                    changeState(GameState::LOBBY);
-                    inputHandler = &Game::handleLobbyInput;
-                }
+            if (idle) {
+                networkManager->hostSessionAsync([this](bool ok) {
+                    if (ok) {
+                        changeState(GameState::LOBBY);
+                        inputHandler = &Game::handleLobbyInput;
+                    }
+                });
             }
             break;
         case SDLK_l:
-            if (networkManager->isConnected() && networkManager->getNetworkContext().sessionId.empty()) {
-                sessionSelection = 0;  // Reset selection when listing
-                if (!networkManager->listSessions()) {
-                    Logger::error("Failed to request session list");
-                }
+            if (idle) {
+                refreshSessionList();
             }
             break;
         case SDLK_UP:
-            if (!networkManager->getNetworkContext().availableSessions.empty()) {
-                navigateMenu(sessionSelection, networkManager->getNetworkContext().availableSessions.size(), true);
+            if (!sessions.empty()) {
+                navigateMenu(sessionSelection, sessions.size(), true);
             }
             break;
         case SDLK_DOWN:
-            if (!networkManager->getNetworkContext().availableSessions.empty()) {
-                navigateMenu(sessionSelection, networkManager->getNetworkContext().availableSessions.size(), false);
+            if (!sessions.empty()) {
+                navigateMenu(sessionSelection, sessions.size(), false);
             }
             break;
         case SDLK_RETURN:
-            if (networkManager->isConnected() && networkManager->getNetworkContext().sessionId.empty() && 
-                !networkManager->getNetworkContext().availableSessions.empty())
+            if (idle && sessionSelection < (int)sessions.size())
             {
-                const auto& sessions = networkManager->getNetworkContext().availableSessions;
-                if (sessionSelection < (int)sessions.size())
-                {
-                    Logger::info("Joining session: ", sessions[sessionSelection]);
-                    if (networkManager->joinSession(sessions[sessionSelection])) {
+                networkManager->joinSessionAsync(sessions[sessionSelection].id, [this](bool ok) {
+                    if (ok) {
                         changeState(GameState::LOBBY);
                         inputHandler = &Game::handleLobbyInput;
                     }
-                }
+                });
             }
             break;
         case SDLK_ESCAPE:
@@ -527,6 +738,12 @@ void Game::handlePlayingInput(SDL_Keycode key)
             return;
     }
 
+    // Lockstep: directions change only through the host's tick bundles
+    if (networkManager->lockstepActive()) {
+        networkManager->sendLockstepInput(dir);
+        return;
+    }
+    
     // Apply direction locally (immediate response for host, prediction for clients)
     mySnake->setDirection(dir);
     
@@ -590,34 +807,12 @@ void Game::checkMatchTimer(Uint32 currentTime)
     if (state == GameState::MATCH_END) return;
     
     // Singleplayer or multiplayer host: calculate timer locally
-    // Multiplayer clients: receive timer via time_sync messages (don't calculate)
+    // Multiplayer clients: take elapsedMs from each game_state (don't calculate)
     if (!networkManager->isConnected() || networkManager->getNetworkContext().isHost) {
-        // Calculate elapsed time, subtracting paused time
-        Uint32 currentPausedTime = ctx.match.totalPausedTime;
-        if (state == GameState::PAUSED && ctx.match.pauseStartTime > 0) {
-            currentPausedTime += (currentTime - ctx.match.pauseStartTime);
-        }
-        
-        Uint32 elapsedMs = currentTime - ctx.match.matchStartTime - currentPausedTime;
-        ctx.match.syncedElapsedMs = elapsedMs;
-        Uint32 elapsedSeconds = elapsedMs / 1000;
-        
-        // Broadcast timer update if multiplayer host
-        if (networkManager->getNetworkContext().isHost && networkManager->isConnected()) {
-            static Uint32 lastTimerBroadcast = 0;
-            if (currentTime - lastTimerBroadcast >= 1000) {
-                auto timerUpdate = JsonBuilder()
-                    .set("type", "time_sync")
-                    .set("elapsedMs", elapsedMs)
-                    .set("totalPausedTime", ctx.match.totalPausedTime)
-                    .buildPtr();
-                networkManager->sendGameMessage(timerUpdate.get());
-                lastTimerBroadcast = currentTime;
-            }
-        }
+        engine.updateMatchTime(state == GameState::PAUSED);
         
         // Check for match end (singleplayer or host)
-        if (elapsedSeconds >= Config::Game::MATCH_DURATION_SECONDS) {
+        if (engine.matchTimeUp()) {
             // Broadcast match end to clients if multiplayer host
             if (networkManager->getNetworkContext().isHost && networkManager->isConnected()) {
                 auto endUpdate = JsonBuilder()
@@ -628,49 +823,10 @@ void Game::checkMatchTimer(Uint32 currentTime)
             }
             
             changeState(GameState::MATCH_END);
-            
-            // Find winner - longest snake
-            int maxLength = 0;
-            ctx.match.winnerIndex = -1;
-            std::vector<int> tiedPlayers;
-            
-            for (int i = 0; i < Config::Game::MAX_PLAYERS; i++)
-            {
-                if (!ctx.players[i].active || !ctx.players[i].snake)
-                    continue;
-
-                int length = ctx.players[i].snake->getBody().size();
-                
-                if (length > maxLength) {
-                    maxLength = length;
-                    ctx.match.winnerIndex = i;
-                    tiedPlayers.clear();
-                    tiedPlayers.push_back(i);
-                } else if (length == maxLength && maxLength > 0)
-                {
-                    tiedPlayers.push_back(i);
-                }
-            }
-            
-            // Tie-breaker: score
-            if (tiedPlayers.size() > 1)
-            {
-                int maxScore = -1;
-                ctx.match.winnerIndex = -1;
-                for (int idx : tiedPlayers)
-                {
-                    if (ctx.players[idx].snake->getScore() > maxScore)
-                    {
-                        maxScore = ctx.players[idx].snake->getScore();
-                        ctx.match.winnerIndex = idx;
-                    }
-                }
-            }
+            engine.decideWinner();
             
             Logger::info("Match ended!");
-            if (ctx.match.winnerIndex >= 0 && 
-                ctx.match.winnerIndex < Config::Game::MAX_PLAYERS &&
-                ctx.players.isValid(ctx.match.winnerIndex))
+            if (ctx.players.isValid(ctx.match.winnerIndex))
             {
                 Logger::info("Winner: Player ", (ctx.match.winnerIndex + 1), 
                          " (Length: ", ctx.players[ctx.match.winnerIndex].snake->getBody().size(),
@@ -683,152 +839,29 @@ void Game::checkMatchTimer(Uint32 currentTime)
 }
 
 void Game::updatePlayers()
-{    
-    if (networkManager->getNetworkContext().isHost || !networkManager->isConnected())
+{
+    PROFILE_SCOPE(UPDATE_PLAYERS);
+    
+    // Lockstep clients run the same simulation as the host
+    if (networkManager->getNetworkContext().isHost || !networkManager->isConnected() ||
+        networkManager->lockstepActive())
     {
-        if (state == GameState::PAUSED)
-        {
-            if (networkManager->isConnected())
-            {
-                networkManager->broadcastGameState();
-            }
-            return;
-        }
-        // Always rebuild collision map at start of each update to ensure it's current
-        buildCollisionMap();
-        
-        struct MoveInfo {
-            Position oldHead;
-            Position oldTail;   
-            Position newHead;
-            bool willGrow;
-            bool collision;
-            bool processed;
-        };
-        MoveInfo moves[Config::Game::MAX_PLAYERS] = {};
-        bool needRebuild = false;
-        
-        for (int i = 0; i < Config::Game::MAX_PLAYERS; i++)
-        {
-            moves[i].processed = false;
-            if (!ctx.players.isValid(i) || !ctx.players[i].snake->isAlive())
-                continue;
-            moves[i].processed = true;
-            
-            const auto& body = ctx.players[i].snake->getBody();
-            if (body.empty())
-            {
-                Logger::error("Player ", (i+1), " has empty snake body!");
-                moves[i].processed = false;
-                continue;
-            }
-            
-            moves[i].oldHead = ctx.players[i].snake->getHead();
-            moves[i].oldTail = body.back();
-            moves[i].willGrow = (moves[i].oldHead == food.getPosition());
-            
-            ctx.players[i].snake->update();
-            moves[i].newHead = ctx.players[i].snake->getHead();
-            
-            // Skip collision check if snake didn't move (direction not set yet)
-            if (moves[i].oldHead.x == moves[i].newHead.x && moves[i].oldHead.y == moves[i].newHead.y) {
-                moves[i].processed = false;
-                continue;
-            }
-            
-            // Check collisions against UNCHANGED map (all tails still present)
-            moves[i].collision = false;
-            
-            // Boundary collision
-            if (moves[i].newHead.x < 0 || moves[i].newHead.x >= Config::Grid::WIDTH || 
-                moves[i].newHead.y < 0 || moves[i].newHead.y >= Config::Grid::HEIGHT) {
-                moves[i].collision = true;
-            }
-            // Snake collision - check against original map state
-            else {
-                int newHeadKey = moves[i].newHead.y * Config::Grid::WIDTH + moves[i].newHead.x;
-                
-                // Check if new head hits any occupied cell in the collision map
-                if (occupiedPositions.count(newHeadKey) > 0) {
-                    // Exception: if not growing, we can move into our own tail position
-                    // because the tail will move away this frame
-                    if (!moves[i].willGrow) {
-                        int oldTailKey = moves[i].oldTail.y * Config::Grid::WIDTH + moves[i].oldTail.x;
-                        if (newHeadKey == oldTailKey) {
-                            // Moving into our own tail - allowed, tail will move
-                        } else {
-                            moves[i].collision = true;
-                            Logger::debug("Player ", (i+1), " collision at (", 
-                                      moves[i].newHead.x, ",", moves[i].newHead.y, ")");
-                        }
-                    } else {
-                        // Growing: can't move into ANY occupied cell
-                        moves[i].collision = true;
-                        Logger::debug("Player ", (i+1), " collision at (", 
-                                  moves[i].newHead.x, ",", moves[i].newHead.y, ")");
-                    }
-                }
-            }
-        }
-        
-        // Phase 2: Apply results and update collision map incrementally
-        for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-            if (!moves[i].processed)
-                continue;
-            
-            if (moves[i].collision) {
-                respawnPlayer(i);
-                Logger::info("Player ", (i+1), " died and respawned!");
-                needRebuild = true;
-            } else {
-                // Update collision map incrementally
-                int newHeadKey = moves[i].newHead.y * Config::Grid::WIDTH + moves[i].newHead.x;
-                
-                // Add new head position
-                occupiedPositions[newHeadKey] = true;
-                
-                // Handle tail - only remove if not growing
-                if (!moves[i].willGrow) {
-                    // Snake moved: remove old tail (it advanced)
-                    int oldTailKey = moves[i].oldTail.y * Config::Grid::WIDTH + moves[i].oldTail.x;
-                    occupiedPositions.erase(oldTailKey);
-                }
-                else {
-                    // Snake grew - tail stays
-                    ctx.players[i].snake->grow();
-                    food.spawn(occupiedPositions);
-                    Logger::debug("Player ", (i+1), " ate food!");
-                    
-                    if (networkManager->isConnected()) {
-                        networkManager->broadcastGameState();
-                    }
-                }
-            }
-        }
-        if (needRebuild) {
-            buildCollisionMap();
+        if (!networkManager->isConnected()) {
+            bots.steer(ctx.players, ctx.occupancy, food.getPosition());
         }
+        recorder.beforeTick();
+        engine.tick();
+        recorder.afterTick();
         if (networkManager->isConnected()) {
-            networkManager->broadcastGameState();
+            networkManager->flushBroadcast();
         }
     } else {
-        // CLIENT: Do nothing - state updated by handleGameState()
-        // Snakes already moved by host, positions set via network
+        // CLIENT: only the local snake is simulated ahead; handleGameState()
+        // reconciles it and positions everything else
+        networkManager->predictLocalTick();
     }
 }
 
-void Game::respawnPlayer(int playerIndex)
-{
-    Position randomPos = getRandomSpawnPosition();
-    ctx.players[playerIndex].snake->reset(randomPos);
-}
-
-Position Game::getRandomSpawnPosition()
-{
-    buildCollisionMap();
-    return getRandomSpawnPositionUtil(occupiedPositions);
-}
-
 void Game::navigateMenu(int& selection, int maxItems, bool up)
 {
     if (up) {
@@ -840,49 +873,113 @@ void Game::navigateMenu(int& selection, int maxItems, bool up)
 
 void Game::resetMatch()
 {
-    buildCollisionMap();
+    recorder.stop();
+    engine.resetMatch();
+    updateInterval = Config::Game::INITIAL_SPEED_MS;
+    
+    changeState(GameState::PLAYING);
+    networkManager->startLockstep();
+    if (state == GameState::PLAYING && !recorder.recording()) {
+        startRecording();  // Restarted from the pause menu
+    }
+    
+    Logger::info("Game reset!");
+}
 
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++)
-    {
-        if (ctx.players.isValid(i))
-        {
-            Position spawnPos = getRandomSpawnPosition();
-            ctx.players[i].snake->reset(spawnPos);
-            ctx.players[i].snake->setScore(0);
-            
-            // Update collision map with new snake position
-            for (const auto& segment : ctx.players[i].snake->getBody()) {
-                occupiedPositions[segment.y * Config::Grid::WIDTH + segment.x] = true;
-            }
-        }
+void Game::startRecording()
+{
+    if (!recordMatches) return;
+    if (networkManager->isConnected() && !networkManager->getNetworkContext().isHost) return;
+    
+    char path[64];
+    time_t now = time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    strftime(path, sizeof(path), Config::Replay::FILE_PATTERN, &local);
+    recorder.start(path, (uint32_t)updateInterval);
+}
+
+bool Game::playReplay(const std::string& path, int speed)
+{
+    auto playback = std::make_unique<ReplayPlayback>(Replay::MatchView{ctx.players, ctx.occupancy, ctx.match, food});
+    if (!playback->file.open(path) || !playback->player.load(playback->file)) {
+        return false;
     }
+    playback->speed = std::max(1, std::min(speed, Config::Replay::MAX_SPEED));
+    ctx.arena = playback->file.arena();
+    Logger::info("Playing replay ", path, ": ", playback->file.endTick(), " ticks, ",
+                 ctx.arena.width, "x", ctx.arena.height);
     
-    ctx.match.winnerIndex = -1;
-    ctx.match.matchStartTime = SDL_GetTicks();
-    ctx.match.totalPausedTime = 0;
-    ctx.match.pauseStartTime = 0;
-    ctx.match.syncedElapsedMs = 0;
+    replay = std::move(playback);
+    inputHandler = &Game::handleReplayInput;
+    restartTickClock();
+    run();
+    
+    if (replay->player.mismatches() > 0) {
+        Logger::warn("Replay diverged from the recording ", replay->player.mismatches(), " times");
+    }
+    return true;
+}
 
-    food.spawn(occupiedPositions);
-    updateInterval = Config::Game::INITIAL_SPEED_MS;
+void Game::updateReplay()
+{
+    Uint32 currentTime = SDL_GetTicks();
+    Uint32 elapsed = currentTime - lastUpdate;
+    lastUpdate = currentTime;
     
-    changeState(GameState::PLAYING);
+    Replay::Player& player = replay->player;
+    uint32_t tickMs = replay->file.tickMs();
+    if (replay->paused || player.atEnd()) {
+        renderAlpha = 1.0f;
+        return;
+    }
     
-    Logger::info("Game reset!");
+    // Same fixed timestep as a match, on a clock running `speed` times faster
+    tickAccumulator += elapsed * (Uint32)replay->speed;
+    player.advance(tickAccumulator / tickMs);
+    tickAccumulator %= tickMs;
+    renderAlpha = player.atEnd() ? 1.0f : (float)tickAccumulator / (float)tickMs;
 }
 
-void Game::buildCollisionMap()
+void Game::renderReplay()
 {
-    occupiedPositions.clear();
-    for (int k = 0; k < Config::Game::MAX_PLAYERS; k++)
+    const Replay::Player& player = replay->player;
+    ui->renderGame(ctx, player.atEnd(), renderAlpha);
+    ui->renderReplayStatus(player.currentTick(), replay->file.endTick(), replay->file.tickMs(),
+                           replay->speed, replay->paused, player.mismatches());
+}
+
+void Game::handleReplayInput(SDL_Keycode key)
+{
+    Replay::Player& player = replay->player;
+    uint32_t seekTicks = Config::Replay::SEEK_SECONDS * 1000 / replay->file.tickMs();
+    switch (key)
     {
-        if (ctx.players.isValid(k))
-        {
-            for (const auto& segment : ctx.players[k].snake->getBody())
-            {
-                occupiedPositions[segment.y * Config::Grid::WIDTH + segment.x] = true;
-            }
-        }
+        case SDLK_SPACE:
+            replay->paused = !replay->paused;
+            break;
+        case SDLK_LEFT:
+            player.seek(player.currentTick() > seekTicks ? player.currentTick() - seekTicks : 0);
+            restartTickClock();
+            break;
+        case SDLK_RIGHT:
+            player.seek(player.currentTick() + seekTicks);
+            restartTickClock();
+            break;
+        case SDLK_HOME:
+            player.seek(0);
+            restartTickClock();
+            break;
+        case SDLK_UP:
+            replay->speed = std::min(replay->speed * 2, Config::Replay::MAX_SPEED);
+            break;
+        case SDLK_DOWN:
+            replay->speed = std::max(replay->speed / 2, 1);
+            break;
+        case SDLK_ESCAPE:
+        case SDLK_q:
+            quit = true;
+            break;
     }
 }
 
@@ -890,13 +987,14 @@ void Game::resetGameState()
 {
     if (networkManager) {
         networkManager->shutdown();
+        networkManager->preconnect(Config::Network::DEFAULT_HOST, Config::Network::DEFAULT_PORT);
     }
     
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-        ctx.players[i].active = false;
-        ctx.players[i].snake = nullptr;
-    }
-        ctx.players.setMyPlayerIndex(-1);
+    ctx.players.clear();
+    
+    // Back to our own arena after playing on a host's
+    ctx.arena = localArena;
+    applyArena(ctx.arena, ctx.players, ctx.occupancy);
     ctx.match.winnerIndex = -1;
     ctx.match.totalPausedTime = 0;
     ctx.match.pauseStartTime = 0;
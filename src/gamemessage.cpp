@@ -0,0 +1,282 @@
+#include "gamemessage.h"
+#include <array>
+#include <cstring>
+
+extern "C" {
+    #include "jansson.h"
+}
+
+namespace GameMessage {
+
+Decoded::Decoded()
+    : type(Type::OTHER), messageId(0), hasBin(false), binValid(false), hasFood(false),
+      hasPause(false), totalPausedTime(0), pauseStartTime(0), hasDirection(false),
+      direction(Direction::NONE), inputSeq(0)
+{
+}
+
+namespace {
+
+// Containers the decoder descends into; anything else is skipped whole
+enum class Scope { ROOT, ENVELOPE, DATA, PLAYERS, PLAYER, BODY, SEGMENT };
+
+enum class Field {
+    NONE,
+    CLIENT_ID, MESSAGE_ID, DATA,                                   // Envelope
+    TYPE, BIN, DIRECTION, SEQ, FOOD_X, FOOD_Y, MATCH_START_TIME,   // data
+    ELAPSED_MS, PLAYERS, PAUSED_BY, TOTAL_PAUSED_TIME, PAUSE_START_TIME,
+    INDEX, ALIVE, INPUT_SEQ, INPUT_AGE, HEADING, BODY,             // players[]
+    X, Y                                                           // body[]
+};
+
+struct Decoder {
+    Decoded& out;
+    WireFormat::StateSnapshot& snapshot;
+    std::array<Scope, 8> scopes;  // Deepest used is SEGMENT, at 7
+    int depth;
+    int skipDepth;  // > 0 inside a skipped container
+    Field field;  // Key the next value belongs to
+    bool sawEnvelope;
+    bool hasFoodX, hasFoodY;
+    int foodX, foodY;
+
+    Decoder(Decoded& out, WireFormat::StateSnapshot& snapshot)
+        : out(out), snapshot(snapshot), depth(0), skipDepth(0), field(Field::NONE),
+          sawEnvelope(false), hasFoodX(false), hasFoodY(false), foodX(0), foodY(0)
+    {
+        scopes[0] = Scope::ROOT;
+    }
+
+    Scope scope() const { return scopes[depth]; }
+};
+
+bool keyIs(const char* key, size_t len, const char* name)
+{
+    return strlen(name) == len && memcmp(key, name, len) == 0;
+}
+
+Field fieldFor(Scope scope, const char* key, size_t len)
+{
+    switch (scope) {
+        case Scope::ENVELOPE:
+            if (keyIs(key, len, "clientId")) return Field::CLIENT_ID;
+            if (keyIs(key, len, "messageId")) return Field::MESSAGE_ID;
+            if (keyIs(key, len, "data")) return Field::DATA;
+            break;
+        case Scope::DATA:
+            if (keyIs(key, len, "type")) return Field::TYPE;
+            if (keyIs(key, len, "bin")) return Field::BIN;
+            if (keyIs(key, len, "direction")) return Field::DIRECTION;
+            if (keyIs(key, len, "seq")) return Field::SEQ;
+            if (keyIs(key, len, "foodX")) return Field::FOOD_X;
+            if (keyIs(key, len, "foodY")) return Field::FOOD_Y;
+            if (keyIs(key, len, "matchStartTime")) return Field::MATCH_START_TIME;
+            if (keyIs(key, len, "elapsedMs")) return Field::ELAPSED_MS;
+            if (keyIs(key, len, "players")) return Field::PLAYERS;
+            if (keyIs(key, len, "pausedBy")) return Field::PAUSED_BY;
+            if (keyIs(key, len, "totalPausedTime")) return Field::TOTAL_PAUSED_TIME;
+            if (keyIs(key, len, "pauseStartTime")) return Field::PAUSE_START_TIME;
+            break;
+        case Scope::PLAYER:
+            if (keyIs(key, len, "index")) return Field::INDEX;
+            if (keyIs(key, len, "alive")) return Field::ALIVE;
+            if (keyIs(key, len, "inputSeq")) return Field::INPUT_SEQ;
+            if (keyIs(key, len, "inputAge")) return Field::INPUT_AGE;
+            if (keyIs(key, len, "heading")) return Field::HEADING;
+            if (keyIs(key, len, "body")) return Field::BODY;
+            break;
+        case Scope::SEGMENT:
+            if (keyIs(key, len, "x")) return Field::X;
+            if (keyIs(key, len, "y")) return Field::Y;
+            break;
+        default:
+            break;
+    }
+    return Field::NONE;
+}
+
+// The container opened under the current scope and key, or false to skip it
+bool enter(Decoder& d, bool isObject, Scope& child)
+{
+    switch (d.scope()) {
+        case Scope::ROOT:
+            child = Scope::ENVELOPE;
+            return isObject;
+        case Scope::ENVELOPE:
+            child = Scope::DATA;
+            return isObject && d.field == Field::DATA;
+        case Scope::DATA:
+            child = Scope::PLAYERS;
+            return !isObject && d.field == Field::PLAYERS;
+        case Scope::PLAYERS:
+            child = Scope::PLAYER;
+            return isObject;
+        case Scope::PLAYER:
+            child = Scope::BODY;
+            return !isObject && d.field == Field::BODY;
+        case Scope::BODY:
+            child = Scope::SEGMENT;
+            return isObject;
+        default:
+            return false;
+    }
+}
+
+int onStart(Decoder& d, bool isObject)
+{
+    Scope child;
+    if (d.skipDepth > 0 || !enter(d, isObject, child)) {
+        d.skipDepth++;
+    } else {
+        if (child == Scope::ENVELOPE) {
+            d.sawEnvelope = true;
+        } else if (child == Scope::PLAYER) {
+            WireFormat::PlayerState& player = d.snapshot.addPlayer();
+            player.index = 0;
+            player.alive = false;
+        } else if (child == Scope::SEGMENT) {
+            d.snapshot.players[d.snapshot.playerCount - 1].body.push_back(Position{0, 0});
+        }
+        d.scopes[++d.depth] = child;
+    }
+    d.field = Field::NONE;
+    return 0;
+}
+
+int onObjectStart(void* data) { return onStart(*static_cast<Decoder*>(data), true); }
+int onArrayStart(void* data) { return onStart(*static_cast<Decoder*>(data), false); }
+
+int onEnd(void* data)
+{
+    Decoder& d = *static_cast<Decoder*>(data);
+    if (d.skipDepth > 0) {
+        d.skipDepth--;
+    } else {
+        d.depth--;
+    }
+    d.field = Field::NONE;
+    return 0;
+}
+
+int onKey(const char* key, size_t len, void* data)
+{
+    Decoder& d = *static_cast<Decoder*>(data);
+    d.field = d.skipDepth > 0 ? Field::NONE : fieldFor(d.scope(), key, len);
+    return 0;
+}
+
+int onString(const char* value, size_t len, void* data)
+{
+    Decoder& d = *static_cast<Decoder*>(data);
+    Decoded& out = d.out;
+    switch (d.field) {
+        case Field::CLIENT_ID:
+            out.clientId.assign(value, len);
+            break;
+        case Field::TYPE:
+            if (keyIs(value, len, "game_state")) out.type = Type::GAME_STATE;
+            else if (keyIs(value, len, "player_input")) out.type = Type::PLAYER_INPUT;
+            break;
+        case Field::BIN:
+            out.hasBin = true;
+            out.binValid = WireFormat::base64Decode(value, len, out.bin);
+            break;
+        case Field::PAUSED_BY:
+            out.hasPause = true;
+            out.pausedBy.assign(value, len);
+            break;
+        case Field::DIRECTION:
+            out.hasDirection = true;
+            out.direction = stringToDirection(value);  // NUL-terminated by the parser
+            break;
+        default:
+            break;
+    }
+    d.field = Field::NONE;
+    return 0;
+}
+
+int onInteger(json_int_t value, void* data)
+{
+    Decoder& d = *static_cast<Decoder*>(data);
+    WireFormat::StateSnapshot& snapshot = d.snapshot;
+    WireFormat::PlayerState* player = snapshot.playerCount > 0 ? &snapshot.players[snapshot.playerCount - 1] : nullptr;
+    switch (d.field) {
+        case Field::MESSAGE_ID: d.out.messageId = (int64_t)value; break;
+        case Field::SEQ: d.out.inputSeq = (int64_t)value; break;
+        case Field::FOOD_X: d.foodX = (int)value; d.hasFoodX = true; break;
+        case Field::FOOD_Y: d.foodY = (int)value; d.hasFoodY = true; break;
+        case Field::MATCH_START_TIME: snapshot.matchStartTime = (uint32_t)value; break;
+        case Field::ELAPSED_MS: snapshot.elapsedMs = (uint32_t)value; break;
+        case Field::TOTAL_PAUSED_TIME: d.out.totalPausedTime = (uint32_t)value; break;
+        case Field::PAUSE_START_TIME: d.out.pauseStartTime = (uint32_t)value; break;
+        case Field::INDEX: player->index = (int)value; break;
+        case Field::INPUT_SEQ: player->inputSeq = (uint32_t)value; break;
+        case Field::INPUT_AGE: player->inputAge = (uint8_t)value; break;
+        case Field::HEADING: player->heading = (uint8_t)value; break;
+        case Field::X: player->body.back().x = (int)value; break;
+        case Field::Y: player->body.back().y = (int)value; break;
+        default: break;
+    }
+    d.field = Field::NONE;
+    return 0;
+}
+
+int onBoolean(int value, void* data)
+{
+    Decoder& d = *static_cast<Decoder*>(data);
+    if (d.field == Field::ALIVE) {
+        d.snapshot.players[d.snapshot.playerCount - 1].alive = value != 0;
+    }
+    d.field = Field::NONE;
+    return 0;
+}
+
+int onOther(void* data)
+{
+    static_cast<Decoder*>(data)->field = Field::NONE;
+    return 0;
+}
+
+int onReal(double, void* data) { return onOther(data); }
+
+const json_sax_callbacks_t CALLBACKS = {
+    onObjectStart, onEnd, onArrayStart, onEnd,
+    onKey, onString, onInteger, onReal, onBoolean, onOther
+};
+
+} // namespace
+
+bool decode(const char* line, size_t len, Decoded& out, WireFormat::StateSnapshot& snapshot)
+{
+    out.type = Type::OTHER;
+    out.clientId.clear();
+    out.messageId = 0;
+    out.hasBin = false;
+    out.binValid = false;
+    out.hasFood = false;
+    out.hasPause = false;
+    out.pausedBy.clear();
+    out.totalPausedTime = 0;
+    out.pauseStartTime = 0;
+    out.hasDirection = false;
+    out.direction = Direction::NONE;
+    out.inputSeq = 0;
+
+    snapshot.matchStartTime = 0;
+    snapshot.elapsedMs = 0;
+    snapshot.playerCount = 0;
+
+    Decoder decoder(out, snapshot);
+    json_error_t error;
+    if (json_sax_loadb(line, len, 0, &CALLBACKS, &decoder, &error) != 0 || !decoder.sawEnvelope)
+        return false;
+
+    if (decoder.hasFoodX && decoder.hasFoodY) {
+        out.hasFood = true;
+        snapshot.food = Position{decoder.foodX, decoder.foodY};
+    }
+    return true;
+}
+
+} // namespace GameMessage
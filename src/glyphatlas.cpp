@@ -0,0 +1,166 @@
+#include "glyphatlas.h"
+#include "logger.h"
+#include <algorithm>
+
+GlyphAtlas::GlyphAtlas()
+    : texture(nullptr), sheet(nullptr), sheetHeight(0), height(0), glyphs()
+{
+}
+
+GlyphAtlas::~GlyphAtlas()
+{
+    release();
+}
+
+void GlyphAtlas::release()
+{
+    if (texture) SDL_DestroyTexture(texture);
+    texture = nullptr;
+    if (sheet) SDL_FreeSurface(sheet);
+    sheet = nullptr;
+}
+
+bool GlyphAtlas::build(SDL_Renderer* renderer, TTF_Font* font)
+{
+    return renderer && rasterize(font) && upload(renderer);
+}
+
+bool GlyphAtlas::rasterize(TTF_Font* font)
+{
+    release();
+    if (!font) return false;
+
+    const SDL_Color white = {255, 255, 255, 255};
+    const int count = LAST_CHAR - FIRST_CHAR + 1;
+    SDL_Surface* rendered[count];
+
+    // Rasterize and shelf-pack: left to right, new row when the sheet is full
+    height = TTF_FontHeight(font);
+    int penX = 0, penY = 0, rowHeight = 0;
+    for (int i = 0; i < count; i++)
+    {
+        Uint16 ch = (Uint16)(FIRST_CHAR + i);
+        int advance = 0;
+        TTF_GlyphMetrics(font, ch, nullptr, nullptr, nullptr, nullptr, &advance);
+
+        rendered[i] = TTF_RenderGlyph_Blended(font, ch, white);
+        int w = rendered[i] ? rendered[i]->w : 0;
+        int h = rendered[i] ? rendered[i]->h : 0;
+        if (penX + w > SHEET_WIDTH) {
+            penX = 0;
+            penY += rowHeight + 1;
+            rowHeight = 0;
+        }
+        glyphs[i].src = SDL_Rect{penX, penY, w, h};
+        glyphs[i].advance = advance;
+        penX += w + 1;
+        rowHeight = std::max(rowHeight, h);
+    }
+    sheetHeight = penY + rowHeight;
+
+    sheet = sheetHeight > 0
+        ? SDL_CreateRGBSurfaceWithFormat(0, SHEET_WIDTH, sheetHeight, 32, SDL_PIXELFORMAT_RGBA32)
+        : nullptr;
+    if (sheet) {
+        SDL_FillRect(sheet, nullptr, 0);
+        for (int i = 0; i < count; i++)
+        {
+            if (!rendered[i]) continue;
+            // Copy coverage as-is instead of blending onto the empty sheet
+            SDL_SetSurfaceBlendMode(rendered[i], SDL_BLENDMODE_NONE);
+            SDL_Rect dst = glyphs[i].src;
+            SDL_BlitSurface(rendered[i], nullptr, sheet, &dst);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (rendered[i]) SDL_FreeSurface(rendered[i]);
+    }
+
+    if (!sheet) {
+        Logger::warn("Glyph atlas creation failed: ", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+bool GlyphAtlas::upload(SDL_Renderer* renderer)
+{
+    if (!sheet) return false;
+    texture = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_FreeSurface(sheet);
+    sheet = nullptr;
+
+    if (!texture) {
+        Logger::warn("Glyph atlas creation failed: ", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyphFor(char c) const
+{
+    unsigned char uc = (unsigned char)c;
+    if (uc < FIRST_CHAR || uc > LAST_CHAR) uc = '?';
+    return glyphs[uc - FIRST_CHAR];
+}
+
+int GlyphAtlas::measure(const char* text) const
+{
+    int width = 0;
+    for (const char* p = text; *p; p++) {
+        width += glyphFor(*p).advance;
+    }
+    return width;
+}
+
+void GlyphAtlas::draw(SDL_Renderer* renderer, const char* text, int x, int y, SDL_Color color)
+{
+    if (!texture) return;
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    // Whole string in one geometry submission, tinted through vertex color
+    vertices.clear();
+    indices.clear();
+    const float invW = 1.0f / SHEET_WIDTH;
+    const float invH = 1.0f / sheetHeight;
+    int penX = x;
+    for (const char* p = text; *p; p++)
+    {
+        const Glyph& g = glyphFor(*p);
+        if (g.src.w > 0 && g.src.h > 0) {
+            float x0 = (float)penX, y0 = (float)y;
+            float x1 = x0 + g.src.w, y1 = y0 + g.src.h;
+            float u0 = g.src.x * invW, v0 = g.src.y * invH;
+            float u1 = (g.src.x + g.src.w) * invW, v1 = (g.src.y + g.src.h) * invH;
+
+            int base = (int)vertices.size();
+            vertices.push_back(SDL_Vertex{{x0, y0}, color, {u0, v0}});
+            vertices.push_back(SDL_Vertex{{x1, y0}, color, {u1, v0}});
+            vertices.push_back(SDL_Vertex{{x1, y1}, color, {u1, v1}});
+            vertices.push_back(SDL_Vertex{{x0, y1}, color, {u0, v1}});
+            const int quad[6] = {base, base + 1, base + 2, base, base + 2, base + 3};
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+        penX += g.advance;
+    }
+    if (!vertices.empty()) {
+        SDL_RenderGeometry(renderer, texture, vertices.data(), (int)vertices.size(),
+                           indices.data(), (int)indices.size());
+    }
+#else
+    // No geometry API - one copy per glyph (still batched by the renderer)
+    SDL_SetTextureColorMod(texture, color.r, color.g, color.b);
+    SDL_SetTextureAlphaMod(texture, color.a);
+    int penX = x;
+    for (const char* p = text; *p; p++)
+    {
+        const Glyph& g = glyphFor(*p);
+        if (g.src.w > 0 && g.src.h > 0) {
+            SDL_Rect dst = {penX, y, g.src.w, g.src.h};
+            SDL_RenderCopy(renderer, texture, &g.src, &dst);
+        }
+        penX += g.advance;
+    }
+#endif
+}
@@ -1,6 +1,8 @@
 #include "hardcoresnake.h"
+#include "occupancygrid.h"
 #include "multiplayer.h"
 #include "logger.h"
+#include <cmath>
 #include <cstring>
 
 // Direction utility functions
@@ -25,30 +27,45 @@ Direction stringToDirection(const char* str) {
 }
 
 // Utility function for random spawn positions (shared by Game and Multiplayer)
-Position getRandomSpawnPositionUtil(const std::unordered_map<int, bool>& occupiedPositions) {
-    const int MAX_ATTEMPTS = Config::Game::MAX_FOOD_SPAWN_ATTEMPTS;
-    int attempts = 0;
+Position getRandomSpawnPositionUtil(const OccupancyGrid& occupancy) {
+    // Spawn anchor: the head cell plus the 2 cells to the left are empty,
+    // leaving room for a 3-segment snake extending left
+    Position spawnPos;
+    if (occupancy.randomSpawnAnchor(spawnPos)) {
+        return spawnPos;
+    }
     
-    Position randomPos;
-    do {
-        // Ensure spawn position has room for 3-segment snake extending left
-        randomPos.x = (rand() % (Config::Grid::WIDTH - 2)) + 2;  // Range: 2 to WIDTH-1
-        randomPos.y = rand() % Config::Grid::HEIGHT;
-        int key = randomPos.y * Config::Grid::WIDTH + randomPos.x;
-        
-        // Check that spawn position and the 2 cells to the left are all empty
-        int leftKey1 = randomPos.y * Config::Grid::WIDTH + (randomPos.x - 1);
-        int leftKey2 = randomPos.y * Config::Grid::WIDTH + (randomPos.x - 2);
-        
-        if (occupiedPositions.count(key) == 0 && 
-            occupiedPositions.count(leftKey1) == 0 && 
-            occupiedPositions.count(leftKey2) == 0) {
-            break;
-        }
-        attempts++;
-    } while (attempts < MAX_ATTEMPTS);
+    Logger::warn("No free 3-cell row for spawn - grid is crowded");
+    if (occupancy.randomFreeCell(spawnPos) && spawnPos.x >= OccupancyGrid::SPAWN_LENGTH - 1) {
+        return spawnPos;
+    }
+    return Position{OccupancyGrid::SPAWN_LENGTH - 1, 0};
+}
+
+SDL_Color playerColor(int playerIndex) {
+    if (playerIndex >= 0 && playerIndex < Config::Render::PLAYER_COLOR_COUNT) {
+        return Config::Render::PLAYER_COLORS[playerIndex];
+    }
+    
+    // HSV with full value; saturation alternates so neighbours differ in
+    // more than hue. Hues near the red food color are pushed aside.
+    float hue = std::fmod(playerIndex * 137.508f, 360.0f);
+    if (hue < 20.0f || hue > 340.0f) hue = std::fmod(hue + 40.0f, 360.0f);
+    float sat = (playerIndex % 2) ? 0.65f : 0.9f;
     
-    return randomPos;
+    float c = sat;
+    float x = c * (1.0f - std::fabs(std::fmod(hue / 60.0f, 2.0f) - 1.0f));
+    float m = 1.0f - c;
+    float r = 0, g = 0, b = 0;
+    switch ((int)(hue / 60.0f)) {
+        case 0:  r = c; g = x; break;
+        case 1:  r = x; g = c; break;
+        case 2:  g = c; b = x; break;
+        case 3:  g = x; b = c; break;
+        case 4:  r = x; b = c; break;
+        default: r = c; b = x; break;
+    }
+    return SDL_Color{(Uint8)((r + m) * 255), (Uint8)((g + m) * 255), (Uint8)((b + m) * 255), 255};
 }
 
 Snake::Snake(SDL_Color snakeColor, Position startPos)
@@ -56,11 +73,13 @@ Snake::Snake(SDL_Color snakeColor, Position startPos)
     nextDirection(Direction::NONE),
         color(snakeColor),
         alive(true),
-        score(0) {
+        score(0),
+        prevTail(startPos),
+        moved(false) {
     
-    body.push_back(startPos);
-    body.push_back({startPos.x - 1, startPos.y});
-    body.push_back({startPos.x - 2, startPos.y});
+    body.pushBack(startPos);
+    body.pushBack({startPos.x - 1, startPos.y});
+    body.pushBack({startPos.x - 2, startPos.y});
 }
 
 void Snake::setDirection(Direction dir)
@@ -77,11 +96,11 @@ void Snake::setDirection(Direction dir)
         
         if ((dir == Direction::LEFT && facingRight) || (dir == Direction::RIGHT && facingLeft))
             {
-            std::reverse(body.begin(), body.end());
+            body.reverse();
         } 
         else if ((dir == Direction::UP && facingDown) || (dir == Direction::DOWN && facingUp))
         {
-            std::reverse(body.begin(), body.end());
+            body.reverse();
         }
         
         nextDirection = dir;
@@ -96,8 +115,23 @@ void Snake::setDirection(Direction dir)
     }
 }
 
+Position Snake::peekNextHead() const
+{
+    Position next = body.front();
+    switch (alive ? nextDirection : Direction::NONE)
+    {
+        case Direction::UP:    next.y--; break;
+        case Direction::DOWN:  next.y++; break;
+        case Direction::LEFT:  next.x--; break;
+        case Direction::RIGHT: next.x++; break;
+        case Direction::NONE:  break;
+    }
+    return next;
+}
+
 void Snake::update()
 {
+    moved = false;
     if (!alive) return;
     
     direction = nextDirection;
@@ -115,8 +149,10 @@ void Snake::update()
         case Direction::NONE:  break;
     }
     
-    body.push_front(newHead);
-    body.pop_back();
+    prevTail = body.back();
+    body.pushFront(newHead);
+    body.popBack();
+    moved = true;
 }
 
 void Snake::grow()
@@ -124,28 +160,30 @@ void Snake::grow()
     if (body.empty()) return;
     
     Position tail = body.back();
-    body.push_back(tail);
+    body.pushBack(tail);
     score += 10;
 }
 
 void Snake::reset(const Position& startPos)
 {
     body.clear();
-    body.push_back(startPos);
-    body.push_back({startPos.x - 1, startPos.y});
-    body.push_back({startPos.x - 2, startPos.y});
+    body.pushBack(startPos);
+    body.pushBack({startPos.x - 1, startPos.y});
+    body.pushBack({startPos.x - 2, startPos.y});
     
     direction = Direction::NONE;
     nextDirection = Direction::NONE;
     alive = true;
+    moved = false;
     score -= 10;  // Death penalty: subtract 10 points
 }
 
-void Snake::setBody(const std::deque<Position>& newBody)
+void Snake::setBody(const Position* segments, size_t count)
 {
-    if (!newBody.empty())
+    if (count > 0)
     {
-        body = newBody;
+        body.assign(segments, count);
+        moved = false;
     }
 }
 
@@ -155,27 +193,13 @@ Food::Food() : pos{0, 0}
 }
 
 
-void Food::spawn(const std::unordered_map<int, bool>& occupiedPositions)
+void Food::spawn(const OccupancyGrid& occupancy)
 {
-    bool validPosition = false;
-    int attempts = 0;
-    const int MAX_ATTEMPTS = Config::Game::MAX_FOOD_SPAWN_ATTEMPTS;
-    
-    while (!validPosition && attempts < MAX_ATTEMPTS)
-    {
-        pos.x = std::rand() % Config::Grid::WIDTH;
-        pos.y = std::rand() % Config::Grid::HEIGHT;
-        
-        int key = pos.y * Config::Grid::WIDTH + pos.x;
-        validPosition = (occupiedPositions.count(key) == 0);  // O(1) lookup!
-        attempts++;
-    }
-    
-    if (!validPosition)
-    {
-        Logger::warn("Could not find empty spot for food after ", 
-                  MAX_ATTEMPTS, " attempts. Grid may be full.");
-        pos.x = std::rand() % Config::Grid::WIDTH;
-        pos.y = std::rand() % Config::Grid::HEIGHT;
+    // Constant-time pick from the free-cell index; only fails on a full grid
+    Position freePos;
+    if (occupancy.randomFreeCell(freePos)) {
+        pos = freePos;
+    } else {
+        Logger::warn("Could not find empty spot for food. Grid is full.");
     }
 }
@@ -0,0 +1,107 @@
+#include "lockstep.h"
+#include "multiplayer.h"
+#include <cstring>
+
+namespace Lockstep {
+
+namespace {
+
+struct Fnv1a {
+    uint32_t value = 2166136261u;
+
+    void add(uint32_t v) {
+        for (int i = 0; i < 4; i++) {
+            value ^= (v >> (i * 8)) & 0xFF;
+            value *= 16777619u;
+        }
+    }
+    void add(int v) { add((uint32_t)v); }
+    void add(uint64_t v) { add((uint32_t)v); add((uint32_t)(v >> 32)); }
+};
+
+const char PLAYER_CODES[] =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz+/";
+static_assert(sizeof(PLAYER_CODES) - 1 >= Config::Game::PLAYER_LIMIT,
+              "one code character per player slot");
+
+int playerFromCode(char c)
+{
+    const char* p = c ? std::strchr(PLAYER_CODES, c) : nullptr;
+    return p ? (int)(p - PLAYER_CODES) : -1;
+}
+
+char directionCode(Direction dir)
+{
+    switch (dir) {
+        case Direction::UP:    return 'U';
+        case Direction::DOWN:  return 'D';
+        case Direction::LEFT:  return 'L';
+        case Direction::RIGHT: return 'R';
+        default:               return 0;
+    }
+}
+
+Direction directionFromCode(char c)
+{
+    switch (c) {
+        case 'U': return Direction::UP;
+        case 'D': return Direction::DOWN;
+        case 'L': return Direction::LEFT;
+        case 'R': return Direction::RIGHT;
+        default:  return Direction::NONE;
+    }
+}
+
+} // namespace
+
+void encodeInputs(const TickBundle& bundle, std::string& out)
+{
+    out.clear();
+    for (int i = 0; i < bundle.count; i++) {
+        out += PLAYER_CODES[bundle.inputs[i].player];
+        out += directionCode(bundle.inputs[i].dir);
+    }
+}
+
+bool decodeInputs(const char* text, TickBundle& bundle)
+{
+    bundle.count = 0;
+    for (const char* p = text; *p; p += 2) {
+        int player = playerFromCode(p[0]);
+        Direction dir = directionFromCode(p[1]);
+        if (player < 0 || player >= Config::Game::PLAYER_LIMIT || dir == Direction::NONE ||
+            bundle.count == MAX_INPUTS_PER_TICK) {
+            return false;
+        }
+        bundle.inputs[bundle.count++] = Input{(uint8_t)player, dir};
+    }
+    return true;
+}
+
+uint32_t stateHash(const GameContext& ctx, uint32_t tick)
+{
+    Fnv1a h;
+    h.add(tick);
+    h.add(ctx.occupancy.randomState());
+    if (ctx.food) {
+        h.add(ctx.food->getPosition().x);
+        h.add(ctx.food->getPosition().y);
+    }
+
+    for (int i : ctx.players.activeIndices()) {
+        if (!ctx.players.isValid(i)) continue;
+        const Snake& snake = *ctx.players[i].snake;
+        h.add(i);
+        h.add(snake.isAlive() ? 1 : 0);
+        h.add((int)snake.getDirection() | ((int)snake.getNextDirection() << 4));
+        h.add(snake.getScore());
+        h.add((uint32_t)snake.getBody().size());
+        for (const auto& segment : snake.getBody()) {
+            h.add(segment.x);
+            h.add(segment.y);
+        }
+    }
+    return h.value;
+}
+
+} // namespace Lockstep
@@ -0,0 +1,279 @@
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Bounded MPMC ring (per-slot sequence numbers), used with one consumer.
+// A slot is free for the producer at position p when seq == p and ready
+// for the consumer when seq == p + 1.
+struct Slot {
+    std::atomic<size_t> seq;
+    int64_t timeMs;
+    LogLevel level;
+    size_t len;
+    bool truncated;
+    char text[Logger::MESSAGE_MAX];
+};
+
+std::unique_ptr<Slot[]> slots;
+alignas(64) std::atomic<size_t> ringTail(0);  // Next position to claim (producers)
+alignas(64) std::atomic<size_t> ringHead(0);  // Next position to read (writer only)
+std::atomic<size_t> droppedCount(0);
+
+std::ofstream logFile;
+bool consoleOutput = true;
+std::mutex syncMutex;  // Sync mode output, and async file/console setup
+
+std::thread writerThread;
+std::atomic<bool> asyncRunning(false);
+std::mutex wakeMutex;
+std::condition_variable wakeCond;   // Writer: flush requested or ring filling up
+std::condition_variable flushedCond;  // flush() callers: a batch was written
+std::atomic<bool> ringFilling(false);  // Producer hint: drain now
+bool stopRequested = false;
+uint64_t flushRequests = 0;
+uint64_t flushesDone = 0;
+
+const char* levelToString(LogLevel level)
+{
+    switch (level) {
+        case LogLevel::DEBUG: return "DEBUG";
+        case LogLevel::INFO:  return "INFO ";
+        case LogLevel::WARN:  return "WARN ";
+        case LogLevel::ERROR: return "ERROR";
+        case LogLevel::FATAL: return "FATAL";
+        default: return "UNKNOWN";
+    }
+}
+
+int64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// "YYYY-mm-dd HH:MM:SS.mmm [LEVEL] text\n"
+void formatLine(std::string& out, int64_t timeMs, LogLevel level,
+                const char* text, size_t len, bool truncated)
+{
+    time_t secs = (time_t)(timeMs / 1000);
+    struct tm local;
+    localtime_r(&secs, &local);
+
+    char prefix[48];
+    size_t n = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &local);
+    n += snprintf(prefix + n, sizeof(prefix) - n, ".%03d [%s] ", (int)(timeMs % 1000), levelToString(level));
+
+    out.append(prefix, n);
+    out.append(text, len);
+    if (truncated) out.append("...");
+    out += '\n';
+}
+
+// Console errors go to stderr, everything else to stdout; file gets both
+struct Batch {
+    std::string out;
+    std::string err;
+    std::string file;
+
+    void add(int64_t timeMs, LogLevel level, const char* text, size_t len, bool truncated) {
+        size_t start = file.size();
+        formatLine(file, timeMs, level, text, len, truncated);
+        if (consoleOutput) {
+            (level >= LogLevel::ERROR ? err : out).append(file, start, std::string::npos);
+        }
+    }
+
+    void write() {
+        if (!out.empty()) { fwrite(out.data(), 1, out.size(), stdout); fflush(stdout); }
+        if (!err.empty()) { fwrite(err.data(), 1, err.size(), stderr); fflush(stderr); }
+        if (!file.empty() && logFile.is_open()) {
+            logFile.write(file.data(), (std::streamsize)file.size());
+            logFile.flush();
+        }
+        out.clear();
+        err.clear();
+        file.clear();
+    }
+};
+
+bool tryPush(LogLevel level, const Logger::LineBuffer& buf, int64_t timeMs)
+{
+    size_t pos = ringTail.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &slots[pos & (Logger::RING_CAPACITY - 1)];
+        size_t seq = slot->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (ringTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false;  // Full
+        } else {
+            pos = ringTail.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->timeMs = timeMs;
+    slot->level = level;
+    slot->len = buf.len;
+    slot->truncated = buf.truncated || !buf.spill.empty();  // Formatted before an init(async)
+    memcpy(slot->text, buf.data, buf.len);
+    slot->seq.store(pos + 1, std::memory_order_release);
+
+    // Wake the writer early rather than dropping when the ring fills up
+    if (pos - ringHead.load(std::memory_order_relaxed) >= Logger::RING_CAPACITY * 3 / 4 &&
+        !ringFilling.exchange(true, std::memory_order_relaxed)) {
+        wakeCond.notify_one();
+    }
+    return true;
+}
+
+// Writer thread only; returns messages moved into the batch
+size_t drainRing(Batch& batch)
+{
+    size_t count = 0;
+    size_t head = ringHead.load(std::memory_order_relaxed);
+    for (;;) {
+        Slot& slot = slots[head & (Logger::RING_CAPACITY - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != head + 1) break;
+        batch.add(slot.timeMs, slot.level, slot.text, slot.len, slot.truncated);
+        slot.seq.store(head + Logger::RING_CAPACITY, std::memory_order_release);
+        head++;
+        count++;
+    }
+    ringHead.store(head, std::memory_order_relaxed);
+
+    size_t dropped = droppedCount.exchange(0, std::memory_order_relaxed);
+    if (dropped > 0) {
+        char text[64];
+        int n = snprintf(text, sizeof(text), "Logger: %zu messages dropped (ring full)", dropped);
+        batch.add(nowMs(), LogLevel::WARN, text, (size_t)n, false);
+    }
+    return count;
+}
+
+void writerMain()
+{
+    Batch batch;
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    for (;;) {
+        wakeCond.wait_for(lock, std::chrono::milliseconds(Logger::FLUSH_INTERVAL_MS),
+                          [] { return stopRequested || flushRequests != flushesDone ||
+                                      ringFilling.load(std::memory_order_relaxed); });
+        bool stopping = stopRequested;
+        uint64_t requested = flushRequests;
+        lock.unlock();
+
+        ringFilling.store(false, std::memory_order_relaxed);
+
+        drainRing(batch);
+        batch.write();
+
+        lock.lock();
+        flushesDone = requested;
+        flushedCond.notify_all();
+        if (stopping) break;
+    }
+}
+
+// Logger destroyed without shutdown(): still join the writer and write the tail
+struct ShutdownAtExit {
+    ~ShutdownAtExit() { Logger::shutdown(); }
+} shutdownAtExit;
+
+} // namespace
+
+void Logger::init(const std::string& filename, LogLevel level, bool console, bool async)
+{
+    shutdown();
+
+    minLevel = level;
+    consoleOutput = console;
+
+    if (!filename.empty()) {
+        logFile.open(filename, std::ios::app);
+    }
+
+    if (async) {
+        slots.reset(new Slot[RING_CAPACITY]);
+        for (size_t i = 0; i < RING_CAPACITY; i++) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+        ringTail.store(0, std::memory_order_relaxed);
+        ringHead.store(0, std::memory_order_relaxed);
+        stopRequested = false;
+        flushRequests = flushesDone = 0;
+        writerThread = std::thread(writerMain);
+        asyncRunning.store(true, std::memory_order_release);
+    }
+}
+
+void Logger::shutdown()
+{
+    if (asyncRunning.exchange(false, std::memory_order_acq_rel)) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            stopRequested = true;
+        }
+        wakeCond.notify_one();
+        writerThread.join();
+
+        // Messages that raced with the stop
+        Batch batch;
+        drainRing(batch);
+        batch.write();
+    }
+
+    if (logFile.is_open()) {
+        logFile.close();
+    }
+}
+
+void Logger::flush()
+{
+    if (!asyncRunning.load(std::memory_order_acquire)) return;
+
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    uint64_t ticket = ++flushRequests;
+    wakeCond.notify_one();
+    flushedCond.wait(lock, [ticket] { return flushesDone >= ticket || stopRequested; });
+}
+
+bool Logger::asyncActive()
+{
+    return asyncRunning.load(std::memory_order_acquire);
+}
+
+void Logger::submit(LogLevel level, const LineBuffer& buf)
+{
+    int64_t timeMs = nowMs();
+
+    if (asyncRunning.load(std::memory_order_acquire)) {
+        if (!tryPush(level, buf, timeMs)) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Fatal messages are usually followed by exit
+        if (level == LogLevel::FATAL) flush();
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(syncMutex);
+    Batch batch;
+    if (buf.spill.empty()) {
+        batch.add(timeMs, level, buf.data, buf.len, buf.truncated);
+    } else {
+        std::string text(buf.data, buf.len);
+        text += buf.spill;
+        batch.add(timeMs, level, text.data(), text.size(), false);
+    }
+    batch.write();
+}
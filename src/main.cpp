@@ -1,13 +1,99 @@
 #include "../include/game.h"
+#include "../include/replay.h"
+#include <chrono>
 #include <iostream>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
 
-int main() {
+static void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--arena WIDTHxHEIGHT] [--players N] [--bots N] [--record]\n"
+              << "       " << program << " --replay FILE [--speed N] [--verify]\n"
+              << "  Arena when hosting or playing alone, " << Config::Grid::MIN_WIDTH << "x" << Config::Grid::MIN_HEIGHT
+              << " to " << Config::Grid::MAX_WIDTH << "x" << Config::Grid::MAX_HEIGHT
+              << ", up to " << Config::Game::PLAYER_LIMIT << " players\n"
+              << "  --bots fills up to N of the other single player slots with computer players\n"
+              << "  --record saves each match played alone or hosted to replay_*.hsr in the working directory\n"
+              << "  --replay plays a recorded match at N times real time (up to " << Config::Replay::MAX_SPEED << ");\n"
+              << "  --verify runs it headless as fast as possible and checks it against its keyframes\n";
+}
+
+// Whole replay without a window; exit status 2 if it diverged from the recording
+static int verifyReplay(const std::string& path)
+{
+    Replay::File file;
+    if (!file.open(path)) return 1;
+    
+    PlayerManager players;
+    OccupancyGrid occupancy;
+    MatchState match;
+    Food food;
+    Replay::Player player(Replay::MatchView{players, occupancy, match, food});
+    if (!player.load(file)) return 1;
+    
+    auto start = std::chrono::steady_clock::now();
+    uint32_t ticks = player.advance(file.endTick());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    double matchSeconds = (double)ticks * file.tickMs() / 1000.0;
+    printf("%s: %u ticks (%.0f s of play) in %.3f s, %.0fx real time, %u keyframe mismatches%s\n",
+           path.c_str(), ticks, matchSeconds, seconds, seconds > 0 ? matchSeconds / seconds : 0.0,
+           player.mismatches(), file.complete() ? "" : " (incomplete recording)");
+    return player.mismatches() > 0 ? 2 : 0;
+}
+
+int main(int argc, char* argv[]) {
     
     srand(time(nullptr));
     
+    ArenaSettings arena;
+    int bots = 0;
+    bool record = false;
+    std::string replayPath;
+    int replaySpeed = 1;
+    bool verify = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--arena") == 0 && i + 1 < argc &&
+            sscanf(argv[i + 1], "%dx%d", &arena.width, &arena.height) == 2) {
+            i++;
+        } else if (strcmp(argv[i], "--players") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%d", &arena.maxPlayers) == 1) {
+            i++;
+        } else if (strcmp(argv[i], "--bots") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%d", &bots) == 1) {
+            i++;
+        } else if (strcmp(argv[i], "--record") == 0) {
+            record = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%d", &replaySpeed) == 1) {
+            i++;
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (verify) {
+        if (replayPath.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        Logger::init("", LogLevel::WARN, true);
+        int status = verifyReplay(replayPath);
+        Logger::shutdown();
+        return status;
+    }
+    
     try {
-        Game game;
+        Game game(arena, bots, record);
+        if (!replayPath.empty()) {
+            return game.playReplay(replayPath, replaySpeed) ? 0 : 1;
+        }
         game.run();
     } catch (const std::exception& e) {
         Logger::fatal("Error: ", e.what());
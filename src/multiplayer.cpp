@@ -2,97 +2,177 @@
 #include "config.h"
 #include "game.h"
 #include "logger.h"
+#include "profiler.h"
+#include "sha256.h"
 #include <iostream>
+#include <random>
+#include <thread>
 
 // ========== INTERNAL FORWARD DECLARATIONS ==========
 // These are implementation details not exposed in the header
 
-// Network input validation
-static bool isValidPosition(int x, int y) {
-    return x >= 0 && x < Config::Grid::WIDTH && y >= 0 && y < Config::Grid::HEIGHT;
+// Network input validation, against the session's arena
+static bool isValidPosition(const GameContext& ctx, int x, int y) {
+    return ctx.occupancy.inBounds(Position{x, y});
 }
 
 static void on_multiplayer_event(const char *event, int64_t messageId, const char *clientId, json_t *data, void *user_data);
+static int on_raw_game_line(const char *type, const char *line, size_t len, void *user_data);
 static void processNetworkMessages(GameContext& ctx);
 static void handlePlayerJoined(GameContext& ctx, const std::string& clientId);
 static void handlePlayerLeft(GameContext& ctx, const std::string& clientId);
 static void handleStateSync(GameContext& ctx, json_t* data);
 static void handlePlayerInput(GameContext& ctx, const std::string& clientId, json_t* data);
-static void handleGameState(GameContext& ctx, json_t* data);
+static void handleGameState(GameContext& ctx, json_t* data, int64_t messageId);
+static void handleGameLine(GameContext& ctx, const std::string& line);
+static void applyPlayerInput(GameContext& ctx, const std::string& clientId, Direction dir, json_int_t seq);
+static bool acceptBinaryGameState(GameContext& ctx, const std::vector<uint8_t>* bytes, WireFormat::StateSnapshot& snapshot);
+static void applyGameState(GameContext& ctx, WireFormat::StateSnapshot& snapshot, int64_t messageId);
+static void handleStateAck(GameContext& ctx, const std::string& clientId, json_t* data);
 static void sendGlobalPauseState(GameContext& ctx, bool paused, const std::string& pauserClientId);
-static void add_player(GameContext& ctx, const std::string& clientId);
+static void applyPauseState(GameContext& ctx, bool isPaused, const std::string& pauserClientId,
+                            bool hasTotal, Uint32 totalPausedTime, bool hasStart, Uint32 pauseStartTime);
+static void applyFramePause(GameContext& ctx, const std::string& pausedBy, Uint32 totalPausedTime,
+                            Uint32 pauseStartTime);
+static void add_player(GameContext& ctx, const std::string& clientId, int slot = -1);
 static void remove_player(GameContext& ctx, const std::string& clientId);
+static json_t* buildArenaJson(const GameContext& ctx);
+static void applyArenaJson(GameContext& ctx, json_t* arenaVal);
 static void sendFullStateSync(GameContext& ctx);
 static void handleHostDisconnect(GameContext& ctx);
+static void queueLockstepInput(NetworkContext& net, int playerIdx, Direction dir);
+static void sendLockstepState(GameContext& ctx);
+static void handleLockstepTick(GameContext& ctx, json_t* data);
+static void handleLockstepState(GameContext& ctx, json_t* data);
+static void handleLockstepDesync(GameContext& ctx, const std::string& clientId, json_t* data);
+static void queueNetworkMessage(GameContext& ctx, NetworkMessage&& msg);
+static void handlePing(GameContext& ctx, const std::string& clientId, json_t* data);
+static void handlePong(GameContext& ctx, json_t* data);
+static void updateTelemetry(GameContext& ctx);
+static void handlePlayerLeaving(GameContext& ctx, const std::string& clientId);
+static std::string newResumeToken();
+static void sendResumeKey(NetworkContext& net);
+static void handleResumeKey(GameContext& ctx, const std::string& clientId, json_t* data);
+static void handleResume(GameContext& ctx, const std::string& clientId, json_t* data);
+static void handleResumed(GameContext& ctx, json_t* data);
+static void expireDisconnectedPlayers(GameContext& ctx);
 
 // ========== CONSTANTS ==========
 
 
 
-// Helper to build collision map from game context
-static std::unordered_map<int, bool> buildCollisionMap(const GameContext& ctx) {
-    std::unordered_map<int, bool> occupiedPositions;
-    for (int k = 0; k < Config::Game::MAX_PLAYERS; k++) {
-        if (ctx.players.isValid(k)) {
-            for (const auto& segment : ctx.players[k].snake->getBody()) {
-                occupiedPositions[segment.y * Config::Grid::WIDTH + segment.x] = true;
-            }
-        }
-    }
-    return occupiedPositions;
-}
-
 // Helper to build JSON array of player client IDs
 static json_t* buildPlayerClientIdList(const GameContext& ctx) {
     json_t* playersArray = json_array();
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-        if (ctx.players[i].active && !ctx.players[i].clientId.empty()) {
+    for (int i : ctx.players.activeIndices()) {
+        if (!ctx.players[i].clientId.empty()) {
             json_array_append_new(playersArray, json_string(ctx.players[i].clientId.c_str()));
         }
     }
     return playersArray;
 }
 
-// Positions: Config::Spawn::PLAYER_SPAWN_X/Y[i]
-// Colors: Config::Render::PLAYER_COLORS[i]
+// Colors: playerColor(i)
 
 // ========== NETWORK MANAGER IMPLEMENTATION ==========
 
+NetworkManager::NetworkManager(GameContext* context) : ctx(context), preconnectDone(false) {}
+
 NetworkManager::~NetworkManager() {
     shutdown();
+    if (preconnectThread.joinable()) {
+        mp_api_preconnect_cancel();
+        preconnectThread.join();
+    }
+}
+
+void NetworkManager::preconnect(const std::string& host, int port) {
+    if (!Config::Network::PRECONNECT) return;
+    if (preconnectThread.joinable()) {
+        if (!preconnectDone.load()) return;
+        preconnectThread.join();
+    }
+    
+    preconnectDone = false;
+    preconnectThread = std::thread([this, host, port] {
+        MpConnectStats stats;
+        int rc = mp_api_preconnect(host.c_str(), (uint16_t)port, &stats);
+        if (rc == MP_API_OK && stats.attempts > 0) {
+            Logger::info("Startup: ", host, " resolved in ", stats.resolve_ms, " ms, connected in ",
+                         stats.connect_ms, " ms over ", stats.ipv6 ? "IPv6" : "IPv4", " (",
+                         stats.attempts, " attempts, background)");
+        } else if (rc == MP_API_ERR_CONNECT) {
+            Logger::warn("Pre-connect to ", host, ":", port, " failed - connecting on demand");
+        }
+        preconnectDone = true;
+    });
 }
 
-bool NetworkManager::initialize(const std::string& host, int port) {
+bool NetworkManager::initialize(const std::string& host, int port, MpReactor* reactor) {
     if (ctx->network.api) {
         Logger::error("Network already initialized");
         return false;
     }
     
-    ctx->network.api = mp_api_create(host.c_str(), port);
+    ctx->network.api = reactor ? mp_api_create_on(reactor, host.c_str(), port)
+                               : mp_api_create(host.c_str(), port);
     if (!ctx->network.api) {
         Logger::error("Failed to create multiplayer API");
         return false;
     }
     
+    // Sends are queued and written by the API's reactor thread so the game loop never touches the socket
+    if (mp_api_start_sender(ctx->network.api, Config::Network::SEND_QUEUE_MAX_BYTES) != MP_API_OK) {
+        Logger::warn("Failed to enable queued sending - writing on the game thread");
+    }
+    
     // Initialize connection timing
     ctx->network.lastMessageReceived = SDL_GetTicks();
     
-    // Set up event listener
+    // Counted from the first request on
+    ctx->network.telemetry.reset();
+    ctx->network.lastPingSent = 0;
+    ctx->network.lastTelemetrySample = 0;
+    ctx->network.lastTelemetryLog = ctx->network.lastMessageReceived;
+    mp_api_set_traffic_hook(ctx->network.api, NetTelemetry::trafficHook, &ctx->network.telemetry);
+    
+    // Set up event listeners; game_state and player_input skip the json_t tree
     mp_api_listen(ctx->network.api, on_multiplayer_event, ctx);
+    mp_api_set_raw_listener(ctx->network.api, on_raw_game_line, ctx);
     Logger::info("Network initialized: ", host, ":", port);
     return true;
 }
 
 void NetworkManager::shutdown() {
     if (ctx->network.api) {
+        // A request still in flight returns once cancelled; its result and
+        // callback are dropped
+        if (pending) {
+            mp_api_cancel(ctx->network.api);
+            pending.reset();
+        }
+        // Leaving on purpose: peers free our slot instead of holding it
+        if (!ctx->network.sessionId.empty() && !mp_api_is_closed(ctx->network.api)) {
+            json_t* leave = JsonBuilder().set("type", "leave").build();
+            if (mp_api_game_take(ctx->network.api, leave, 0) == MP_API_OK) {
+                Uint32 start = SDL_GetTicks();
+                while (mp_api_send_queue_depth(ctx->network.api) > 0 &&
+                       SDL_GetTicks() - start < Config::Network::LEAVE_FLUSH_MS) {
+                    SDL_Delay(5);
+                }
+            }
+        }
         mp_api_destroy(ctx->network.api);
         ctx->network.api = nullptr;
         ctx->network.sessionId.clear();
         ctx->network.myClientId.clear();
         ctx->network.hostClientId.clear();
+        ctx->network.resumeFrom.clear();
+        ctx->network.resumeToken.clear();
         ctx->network.isHost = false;
         ctx->network.lastMessageReceived = 0;
         ctx->network.connectionWarningTime = 0;
+        ctx->network.sessionsRequestedAt = 0;
     }
 }
 
@@ -100,42 +180,126 @@ bool NetworkManager::isConnected() const {
     return ctx->network.api != nullptr;
 }
 
-bool NetworkManager::hostSession() {
-    if (!ctx->network.api) {
-        Logger::error("Network not initialized");
+size_t NetworkManager::sendQueueDepth() const {
+    return ctx->network.api ? mp_api_send_queue_depth(ctx->network.api) : 0;
+}
+
+bool NetworkManager::applyHost(int rc, const char* session, const char* clientId) {
+    if (rc != MP_API_OK) {
+        Logger::error("Failed to host session: ", rc);
         return false;
     }
     
-    char* session = nullptr;
-    char* clientId = nullptr;
-    json_t* hostData = nullptr;
+    ctx->network.sessionId = session;
+    ctx->network.myClientId = clientId;
+    ctx->network.isHost = true;
+    ctx->network.hostClientId = clientId;
+    ctx->network.lastStateSyncSent = SDL_GetTicks();
+    ctx->network.resetSnapshotSync();
     
-    Logger::info("Attempting to host session...");
-    int rc = mp_api_host(ctx->network.api, &session, &clientId, &hostData);
+    Logger::info("Hosting session: ", session, " (clientId: ", clientId, ")");
     
+    if (!ctx->network.dedicatedHost) {
+        add_player(*ctx, clientId);
+        ctx->players.setMyPlayerIndex(ctx->players.findByClientId(clientId));
+    }
+    
+    ctx->match.matchStartTime = SDL_GetTicks();
+    return true;
+}
+
+// Relay list entries carry "id"; player count, capacity and state are
+// shown when present ("players" may be a count or the member list)
+static void parseSessionList(json_t* sessionList, std::vector<SessionInfo>& sessions)
+{
+    sessions.clear();
+    size_t index;
+    json_t* value;
+    json_array_foreach(sessionList, index, value) {
+        json_t* sessVal = json_object_get(value, "id");
+        if (!json_is_string(sessVal)) continue;
+        
+        SessionInfo info;
+        info.id = json_string_value(sessVal);
+        json_t* players = json_object_get(value, "players");
+        if (json_is_integer(players)) {
+            info.players = (int)json_integer_value(players);
+        } else if (json_is_array(players)) {
+            info.players = (int)json_array_size(players);
+        }
+        json_t* maxPlayers = json_object_get(value, "maxPlayers");
+        if (json_is_integer(maxPlayers)) {
+            info.maxPlayers = (int)json_integer_value(maxPlayers);
+        }
+        json_t* state = json_object_get(value, "state");
+        if (json_is_string(state)) {
+            info.state = json_string_value(state);
+        }
+        sessions.push_back(std::move(info));
+    }
+}
+
+bool NetworkManager::applyList(int rc, json_t* sessionList) {
     if (rc != MP_API_OK) {
-        Logger::error("Failed to host session: ", rc);
+        Logger::error("Failed to list sessions: ", rc);
         return false;
     }
     
-    JsonPtr hostDataPtr(hostData);
+    parseSessionList(sessionList, ctx->network.availableSessions);
+    ctx->network.sessionsUpdatedAt = SDL_GetTicks();
+    
+    if (ctx->network.availableSessions.empty()) {
+        Logger::info("No public sessions available.");
+    } else {
+        Logger::info("Available sessions (total: ", ctx->network.availableSessions.size(), "):");
+        for (size_t i = 0; i < ctx->network.availableSessions.size(); i++) {
+            Logger::info(" [", (i + 1), "] ", ctx->network.availableSessions[i].id);
+        }
+    }
+    return true;
+}
+
+bool NetworkManager::applyJoin(int rc, const char* session, const char* clientId) {
+    if (rc != MP_API_OK) {
+        Logger::error("Failed to join session: ", rc);
+        return false;
+    }
     
+    // Store session info
     ctx->network.sessionId = session;
     ctx->network.myClientId = clientId;
-    ctx->network.isHost = true;
-    ctx->network.lastStateSyncSent = SDL_GetTicks();
+    ctx->network.isHost = false;
+    ctx->network.resetSnapshotSync();
     
-    Logger::info("Hosting session: ", session, " (clientId: ", clientId, ")");
+    Logger::info("Joined session: ", session, " (clientId: ", clientId, ")");
+    
+    // Will be assigned player index when host sends state_sync
+    ctx->players.setMyPlayerIndex(-1);
+    return true;
+}
+
+bool NetworkManager::hostSession() {
+    if (!ctx->network.api) {
+        Logger::error("Network not initialized");
+        return false;
+    }
+    if (pending) {
+        Logger::error("Another request is still pending");
+        return false;
+    }
     
-    add_player(*ctx, clientId);
-    ctx->players.setMyPlayerIndex(ctx->players.findByClientId(clientId));
+    char* session = nullptr;
+    char* clientId = nullptr;
+    json_t* hostData = nullptr;
     
-    ctx->match.matchStartTime = SDL_GetTicks();
+    Logger::info("Attempting to host session...");
+    int rc = mp_api_host(ctx->network.api, &session, &clientId, &hostData);
+    JsonPtr hostDataPtr(hostData);
     
+    bool ok = applyHost(rc, session, clientId);
     free(session);
     free(clientId);
-    
-    return true;
+    return ok;
 }
 
 bool NetworkManager::listSessions() {
@@ -143,38 +307,25 @@ bool NetworkManager::listSessions() {
         Logger::error("Network not initialized");
         return false;
     }
+    if (pending) {
+        Logger::error("Another request is still pending");
+        return false;
+    }
     
+    ctx->network.sessionsRequestedAt = SDL_GetTicks();
     json_t* sessionList = nullptr;
     int rc = mp_api_list(ctx->network.api, &sessionList);
     
-    if (rc != MP_API_OK) {
-        Logger::error("Failed to list sessions: ", rc);
-        return false;
-    }
-    
     // Use RAII wrapper
     JsonPtr sessionListPtr(sessionList);
-    
-    ctx->network.availableSessions.clear();
-    
-    if (json_array_size(sessionList) == 0) {
-        Logger::info("No public sessions available.");
-    } else {
-        Logger::info("Available sessions (total: ", json_array_size(sessionList), "):");
-        
-        size_t index;
-        json_t* value;
-        json_array_foreach(sessionList, index, value) {
-            json_t* sessVal = json_object_get(value, "id");
-            if (json_is_string(sessVal)) {
-                const char* sessionId = json_string_value(sessVal);
-                ctx->network.availableSessions.push_back(sessionId);
-                Logger::info(" [", (index + 1), "] ", sessionId);
-            }
-        }
-    }
-    
-    return true;
+    return applyList(rc, sessionList);
+}
+
+static json_t* buildJoinPayload()
+{
+    json_t* joinPayload = json_object();
+    json_object_set_new(joinPayload, "name", json_string("Player"));
+    return joinPayload;
 }
 
 bool NetworkManager::joinSession(const std::string& sessionId) {
@@ -182,11 +333,14 @@ bool NetworkManager::joinSession(const std::string& sessionId) {
         Logger::error("Network not initialized");
         return false;
     }
+    if (pending) {
+        Logger::error("Another request is still pending");
+        return false;
+    }
     
     char* joinedSession = nullptr;
     char* joinedClientId = nullptr;
-    json_t* joinPayload = json_object();
-    json_object_set_new(joinPayload, "name", json_string("Player"));
+    json_t* joinPayload = buildJoinPayload();
     json_t* joinData = nullptr;
     
     int rc = mp_api_join(ctx->network.api, sessionId.c_str(), joinPayload, 
@@ -197,33 +351,212 @@ bool NetworkManager::joinSession(const std::string& sessionId) {
     // Use RAII wrapper
     JsonPtr joinDataPtr(joinData);
     
-    if (rc != MP_API_OK) {
-        Logger::error("Failed to join session: ", rc);
-        return false;
+    bool ok = applyJoin(rc, joinedSession, joinedClientId);
+    free(joinedSession);
+    free(joinedClientId);
+    return ok;
+}
+
+// ========== BACKGROUND REQUESTS ==========
+// The worker only calls the API and fills in the result; everything that
+// touches the game context happens in finishRequest() on the game thread
+
+struct NetworkManager::PendingRequest {
+    RequestKind kind;
+    std::string sessionId;  // JOIN
+    RequestDone onComplete;
+    
+    std::atomic<bool> done;
+    int rc;
+    char* session;
+    char* clientId;
+    json_t* data;  // Session list, or the host/join reply payload
+    std::thread worker;
+    
+    PendingRequest(RequestKind k, const std::string& id, RequestDone callback)
+        : kind(k), sessionId(id), onComplete(std::move(callback)), done(false), rc(MP_API_ERR_IO),
+          session(nullptr), clientId(nullptr), data(nullptr) {}
+    
+    ~PendingRequest() {
+        if (worker.joinable()) worker.join();
+        free(session);
+        free(clientId);
+        if (data) json_decref(data);
     }
     
-    // Store session info
-    ctx->network.sessionId = joinedSession;
-    ctx->network.myClientId = joinedClientId;
-    ctx->network.isHost = false;
-    
-    Logger::info("Joined session: ", joinedSession, " (clientId: ", joinedClientId, ")");
+    void run(MultiplayerApi* api) {
+        switch (kind) {
+            case RequestKind::HOST:
+                rc = mp_api_host(api, &session, &clientId, &data);
+                break;
+            case RequestKind::LIST:
+                rc = mp_api_list(api, &data);
+                break;
+            case RequestKind::JOIN: {
+                json_t* joinPayload = buildJoinPayload();
+                rc = mp_api_join(api, sessionId.c_str(), joinPayload, &session, &clientId, &data);
+                json_decref(joinPayload);
+                break;
+            }
+            case RequestKind::RESUME: {
+                json_t* joinPayload = buildJoinPayload();
+                rc = mp_api_resume(api, Config::Network::RESUME_TIMEOUT_MS, joinPayload, &clientId, &data);
+                json_decref(joinPayload);
+                break;
+            }
+            case RequestKind::NONE:
+                break;
+        }
+        done.store(true, std::memory_order_release);
+    }
+};
+
+bool NetworkManager::startRequest(RequestKind kind, const std::string& sessionId, RequestDone onComplete) {
+    if (!ctx->network.api) {
+        Logger::error("Network not initialized");
+        return false;
+    }
+    if (pending) {
+        return false;
+    }
     
-    // Will be assigned player index when host sends state_sync
-    ctx->players.setMyPlayerIndex(-1);
+    pending = std::make_unique<PendingRequest>(kind, sessionId, std::move(onComplete));
+    PendingRequest* request = pending.get();
+    MultiplayerApi* api = ctx->network.api;
+    pending->worker = std::thread([request, api] { request->run(api); });
+    return true;
+}
+
+void NetworkManager::finishRequest() {
+    std::unique_ptr<PendingRequest> request = std::move(pending);
+    request->worker.join();
+    
+    bool ok = false;
+    switch (request->kind) {
+        case RequestKind::HOST:
+            ok = applyHost(request->rc, request->session, request->clientId);
+            break;
+        case RequestKind::LIST:
+            ok = applyList(request->rc, request->data);
+            break;
+        case RequestKind::JOIN:
+            ok = applyJoin(request->rc, request->session, request->clientId);
+            break;
+        case RequestKind::RESUME:
+            ok = applyResume(request->rc, request->clientId);
+            break;
+        case RequestKind::NONE:
+            break;
+    }
     
-    // Cleanup
-    free(joinedSession);
-    free(joinedClientId);
+    // The wait for the reply doesn't count towards the connection timeout
+    ctx->network.lastMessageReceived = SDL_GetTicks();
+    if (request->onComplete) {
+        request->onComplete(ok);
+    }
+}
+
+bool NetworkManager::hostSessionAsync(RequestDone onComplete) {
+    Logger::info("Attempting to host session...");
+    return startRequest(RequestKind::HOST, std::string(), std::move(onComplete));
+}
+
+bool NetworkManager::listSessionsAsync(RequestDone onComplete) {
+    if (!startRequest(RequestKind::LIST, std::string(), std::move(onComplete))) {
+        return false;
+    }
+    ctx->network.sessionsRequestedAt = SDL_GetTicks();
+    return true;
+}
+
+bool NetworkManager::joinSessionAsync(const std::string& sessionId, RequestDone onComplete) {
+    Logger::info("Joining session: ", sessionId);
+    return startRequest(RequestKind::JOIN, sessionId, std::move(onComplete));
+}
+
+// The relay hands out a new clientId on every join, so the resume message
+// names the old one and reveals the token behind the key the host holds;
+// the host moves the new id into the held slot and sends a keyframe
+bool NetworkManager::applyResume(int rc, const char* clientId) {
+    NetworkContext& net = ctx->network;
+    if (rc != MP_API_OK || !clientId) {
+        Logger::error("Failed to resume session ", net.sessionId, ": ", rc);
+        net.connectionLost = true;
+        if (ctx->onStateChange) {
+            ctx->onStateChange(static_cast<int>(GameState::MENU));
+        }
+        return false;
+    }
     
+    net.resumeFrom = net.myClientId;
+    net.myClientId = clientId;
+    net.resyncPending = true;  // Ack the keyframe at once
+    Logger::info("Resumed session ", net.sessionId, " as ", clientId, " (was ", net.resumeFrom, ")");
+    
+    // Every peer sees this token, so it is spent: the next resume needs a new one
+    std::string token = net.resumeToken;
+    net.resumeToken = newResumeToken();
+    json_t* resume = JsonBuilder()
+        .set("type", "resume")
+        .set("from", net.resumeFrom)
+        .set("token", token)
+        .set("key", Sha256::hex(net.resumeToken))
+        .set("seq", (json_int_t)net.lastAppliedSeq)
+        .build();
+    mp_api_game_take(net.api, resume, 0);
     return true;
 }
 
+void NetworkManager::connectionClosed() {
+    NetworkContext& net = ctx->network;
+    if (!net.isHost && !net.dedicatedHost && !net.sessionId.empty() && Config::Network::RESUME_TIMEOUT_MS > 0) {
+        Logger::warn("Connection lost - resuming session ", net.sessionId);
+        startRequest(RequestKind::RESUME, std::string(), nullptr);
+        return;
+    }
+    
+    Logger::error("Connection to the server lost");
+    net.connectionLost = true;
+    if (ctx->onStateChange) {
+        ctx->onStateChange(static_cast<int>(GameState::MENU));
+    }
+}
+
+NetworkManager::RequestKind NetworkManager::pendingRequest() const {
+    return pending ? pending->kind : RequestKind::NONE;
+}
+
 void NetworkManager::processMessages() {
     if (!ctx || !ctx->network.api)
         return;
     
+    PROFILE_SCOPE(PROCESS_MESSAGES);
+    
+    // Events queued during a request belong to its outcome (the join's
+    // state_sync, say), so they wait until the reply has been applied
+    if (pending) {
+        if (!pending->done.load(std::memory_order_acquire)) {
+            return;
+        }
+        finishRequest();
+        if (!ctx->network.api || ctx->network.connectionLost) {
+            return;  // The callback left multiplayer
+        }
+    }
+    
+    // A dropped socket is noticed here rather than by the timeout below
+    if (mp_api_is_closed(ctx->network.api)) {
+        connectionClosed();
+        return;
+    }
+    
     processNetworkMessages(*ctx);
+    // A client paused or resumed: repeat it in a frame at once
+    if (ctx->network.broadcast.pausePending()) {
+        flushBroadcast();
+    }
+    expireDisconnectedPlayers(*ctx);
+    updateTelemetry(*ctx);
     
     // Check for connection timeout (30 seconds without any message)
     if (ctx->network.lastMessageReceived > 0) {
@@ -252,88 +585,260 @@ void NetworkManager::processMessages() {
 }
 
 void NetworkManager::sendPauseState(bool paused, const std::string& clientId) {
+    // The host's game_state frames carry pause state; lockstep has no frames.
+    // Nothing ticks while paused, so send the frame now.
+    if (ctx->network.isHost && !ctx->network.lockstep) {
+        markBroadcastDirty(BroadcastScheduler::PAUSE);
+        flushBroadcast();
+        return;
+    }
     sendGlobalPauseState(*ctx, paused, clientId);
 }
 
 void NetworkManager::sendPlayerInput(Direction direction) {
-    if (!ctx->network.api || ctx->network.sessionId.empty())
+    NetworkContext& net = ctx->network;
+    if (!net.api || net.sessionId.empty())
         return;
     
+    // Kept for replay until the host echoes this seq (or a newer one)
+    uint32_t seq = net.nextInputSeq++;
+    net.pendingInputs[seq % NetworkContext::PENDING_INPUT_CAPACITY] = {seq, direction, 0};
+    
+    JsonArenaScope arena;
     auto inputMsg = JsonBuilder()
         .set("type", "player_input")
         .set("direction", directionToString(direction))
-        .buildPtr();
+        .set("seq", (json_int_t)seq)
+        .build();
     
-    mp_api_game(ctx->network.api, inputMsg.get());
+    mp_api_game_take(ctx->network.api, inputMsg, 0);
+}
+
+void NetworkManager::markBroadcastDirty(uint8_t flags) {
+    ctx->network.broadcast.mark(flags);
 }
 
-void NetworkManager::broadcastGameState(bool critical) {
-    if (!ctx->network.api || !ctx->network.isHost)
+void NetworkManager::flushBroadcast() {
+    PROFILE_SCOPE(BROADCAST);
+    
+    // Lockstep peers simulate the bodies themselves
+    NetworkContext& net = ctx->network;
+    if (!net.api || !net.isHost || net.lockstep)
         return;
     
-    static Uint32 lastBroadcast = 0;
-    Uint32 now = SDL_GetTicks();
-    // The caller can force immediate broadcast by calling this directly after important events
+    net.broadcast.mark(BroadcastScheduler::STATE);
+    if (!net.broadcast.due(SDL_GetTicks(), sendQueueDepth()))
+        return;
     
-    if (now - lastBroadcast < 100) {
-        // Don't skip if last broadcast was very recent (< 10ms) - likely a critical update
-        if (now - lastBroadcast > 10) {
-            return;  // Too soon for regular update, skip
-        }
+    // Packed snapshot; falls back to the JSON layout if a body can't be step-encoded
+    if (Config::Network::BINARY_GAME_STATE && sendBinaryGameState()) {
+        return;
     }
-    lastBroadcast = now;
-    
-    // Build complete state message
-    JsonBuilder stateMsg;
-    stateMsg.set("type", "game_state");
-    
-    // Food position
-    if (ctx->food) {
-        stateMsg.set("foodX", ctx->food->getPosition().x);
-        stateMsg.set("foodY", ctx->food->getPosition().y);
+    sendJsonGameState();
+}
+
+// Pause state riding on a game_state frame, in place of a separate
+// state_sync: while paused and for a few frames after any change
+static bool carriesPause(const GameContext& ctx)
+{
+    return ctx.network.broadcast.carriesPause() || !ctx.match.pausedByClientId.empty();
+}
+
+// ,"pausedBy":..,"totalPausedTime":..,"pauseStartTime":.. for a spliced payload
+static void appendPauseFields(const GameContext& ctx, std::string& payload)
+{
+    payload.append(",\"pausedBy\":\"");
+    for (char c : ctx.match.pausedByClientId) {
+        if (c == '"' || c == '\\') payload.push_back('\\');
+        if ((unsigned char)c >= 0x20) payload.push_back(c);
     }
+    payload.append("\",\"totalPausedTime\":");
+    payload.append(std::to_string(ctx.match.totalPausedTime));
+    payload.append(",\"pauseStartTime\":");
+    payload.append(std::to_string(ctx.match.pauseStartTime));
+}
+
+// Snake direction state for the snapshot input block
+static uint8_t packHeading(const Snake& snake)
+{
+    return (uint8_t)((int)snake.getDirection() | ((int)snake.getNextDirection() << 4));
+}
+
+static void unpackHeading(uint8_t heading, Direction& current, Direction& next)
+{
+    auto toDirection = [](int v) {
+        return (v >= 0 && v <= (int)Direction::NONE) ? (Direction)v : Direction::NONE;
+    };
+    current = toDirection(heading & 0x0F);
+    next = toDirection(heading >> 4);
+}
+
+// Copy the live game state into a snapshot record
+static void captureSnapshot(const GameContext& ctx, WireFormat::StateSnapshot& snapshot)
+{
+    snapshot.food = ctx.food ? ctx.food->getPosition() : Position{0, 0};
+    snapshot.matchStartTime = ctx.match.matchStartTime;
+    snapshot.elapsedMs = ctx.match.syncedElapsedMs;
+    snapshot.playerCount = 0;
     
-    // All player positions
-    JsonPtr playersArray(json_array());
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-        if (!ctx->players[i].active || !ctx->players[i].snake)
+    for (int i : ctx.players.activeIndices()) {
+        if (!ctx.players[i].snake)
             continue;
         
-        // Get const reference to body first and check if empty
-        const auto& body = ctx->players[i].snake->getBody();
+        const auto& body = ctx.players[i].snake->getBody();
         if (body.empty()) {
-            Logger::warn("WARNING: Skipping player ", (i+1), " with empty body in broadcastGameState");
+            Logger::warn("WARNING: Skipping player ", (i+1), " with empty body in game_state");
             continue;
         }
         
-        JsonPtr playerObj(json_object());
-        json_object_set_new(playerObj.get(), "index", json_integer(i));
-        json_object_set_new(playerObj.get(), "alive", json_boolean(ctx->players[i].snake->isAlive()));
-        
-        // Snake body
-        JsonPtr bodyArray(json_array());
+        WireFormat::PlayerState& player = snapshot.addPlayer();
+        player.index = i;
+        player.alive = ctx.players[i].snake->isAlive();
+        player.inputSeq = ctx.players[i].lastInputSeq;
+        player.inputAge = ctx.players[i].inputAge;
+        player.heading = packHeading(*ctx.players[i].snake);
+        player.body.reserve(body.size());
         for (const auto& segment : body) {
-            JsonPtr segmentObj(json_object());
-            json_object_set_new(segmentObj.get(), "x", json_integer(segment.x));
-            json_object_set_new(segmentObj.get(), "y", json_integer(segment.y));
-            json_array_append_new(bodyArray.get(), segmentObj.release());
+            player.body.push_back(segment);
         }
-        json_object_set_new(playerObj.get(), "body", bodyArray.release());
-        
-        json_array_append_new(playersArray.get(), playerObj.release());
     }
+}
+
+// Oldest snapshot every remote client has acked, or nullptr when a keyframe is needed
+static const WireFormat::StateSnapshot* selectBaseline(const GameContext& ctx, uint32_t seq)
+{
+    if (ctx.network.forceKeyframe)
+        return nullptr;
     
-    stateMsg.set("players", playersArray.release());
-    
-    // Sync timer information
-    stateMsg.set("matchStartTime", ctx->match.matchStartTime);
-    stateMsg.set("elapsedMs", ctx->match.syncedElapsedMs);
-    
-    // Send to all clients
-    int result = mp_api_game(ctx->network.api, stateMsg.buildPtr().get());
-    if (result != 0) {
-        Logger::error("ERROR: Failed to broadcast game state, result=", result);
+    uint32_t baseSeq = 0;
+    for (int i : ctx.players.activeIndices()) {
+        const PlayerSlot& slot = ctx.players[i];
+        if (slot.clientId == ctx.network.myClientId || slot.disconnectedAt != 0)
+            continue;
+        if (slot.ackedSnapshot == 0)
+            return nullptr;  // Someone hasn't applied anything yet
+        if (baseSeq == 0 || slot.ackedSnapshot < baseSeq)
+            baseSeq = slot.ackedSnapshot;
     }
+    
+    if (baseSeq == 0 || seq - baseSeq >= WireFormat::SnapshotHistory::CAPACITY)
+        return nullptr;
+    return ctx.network.snapshotHistory.find(baseSeq);
+}
+
+bool NetworkManager::sendBinaryGameState() {
+    NetworkContext& net = ctx->network;
+    uint32_t seq = net.nextSnapshotSeq;
+    
+    WireFormat::StateSnapshot& current = net.snapshotHistory.store(seq);
+    captureSnapshot(*ctx, current);
+    
+    const WireFormat::StateSnapshot* base = selectBaseline(*ctx, seq);
+    if (!WireFormat::encodeSnapshot(current, base, snapshotBytes)) {
+        Logger::warn("Game state not step-encodable, sending JSON game_state");
+        return false;
+    }
+    net.nextSnapshotSeq++;
+    if (!base) {
+        net.forceKeyframe = false;
+    }
+    
+    WireFormat::base64Encode(snapshotBytes.data(), snapshotBytes.size(), snapshotText);
+    
+    // Base64 needs no escaping, so the payload is spliced as text
+    snapshotPayload.assign("{\"type\":\"game_state\",\"bin\":\"");
+    snapshotPayload.append(snapshotText);
+    snapshotPayload.push_back('"');
+    if (carriesPause(*ctx)) {
+        appendPauseFields(*ctx, snapshotPayload);
+    }
+    snapshotPayload.push_back('}');
+    
+    // A newer game_state supersedes one still waiting in the send queue
+    int result = mp_api_game_raw(net.api, snapshotPayload.data(), snapshotPayload.size(), MP_API_SEND_REPLACEABLE);
+    if (result != 0) {
+        Logger::error("ERROR: Failed to broadcast game state, result=", result);
+    }
+    net.broadcast.sent(seq, snapshotPayload.size(), SDL_GetTicks());
+    return true;
+}
+
+// Per-segment JSON player list of game_state. withHeading (lockstep_state)
+// adds direction and score for every player so peers can simulate on.
+static json_t* buildJsonPlayerStates(const GameContext& ctx, bool withHeading)
+{
+    JsonPtr playersArray(json_array());
+    for (int i : ctx.players.activeIndices()) {
+        if (!ctx.players[i].snake)
+            continue;
+        
+        // Get const reference to body first and check if empty
+        const auto& body = ctx.players[i].snake->getBody();
+        if (body.empty()) {
+            Logger::warn("WARNING: Skipping player ", (i+1), " with empty body in game_state");
+            continue;
+        }
+        
+        JsonPtr playerObj(json_object());
+        json_object_set_new(playerObj.get(), "index", json_integer(i));
+        json_object_set_new(playerObj.get(), "alive", json_boolean(ctx.players[i].snake->isAlive()));
+        if (withHeading) {
+            json_object_set_new(playerObj.get(), "heading", json_integer(packHeading(*ctx.players[i].snake)));
+            json_object_set_new(playerObj.get(), "score", json_integer(ctx.players[i].snake->getScore()));
+        } else if (ctx.players[i].lastInputSeq != 0) {
+            json_object_set_new(playerObj.get(), "inputSeq", json_integer(ctx.players[i].lastInputSeq));
+            json_object_set_new(playerObj.get(), "inputAge", json_integer(ctx.players[i].inputAge));
+            json_object_set_new(playerObj.get(), "heading", json_integer(packHeading(*ctx.players[i].snake)));
+        }
+        
+        // Snake body
+        JsonPtr bodyArray(json_array());
+        for (const auto& segment : body) {
+            JsonPtr segmentObj(json_object());
+            json_object_set_new(segmentObj.get(), "x", json_integer(segment.x));
+            json_object_set_new(segmentObj.get(), "y", json_integer(segment.y));
+            json_array_append_new(bodyArray.get(), segmentObj.release());
+        }
+        json_object_set_new(playerObj.get(), "body", bodyArray.release());
+        
+        json_array_append_new(playersArray.get(), playerObj.release());
+    }
+    return playersArray.release();
+}
+
+void NetworkManager::sendJsonGameState() {
+    // Hundreds of nodes per tick; built, dumped and dropped in one arena
+    JsonArenaScope arena;
+    
+    // Build complete state message
+    JsonBuilder stateMsg;
+    stateMsg.set("type", "game_state");
+    
+    // Food position
+    if (ctx->food) {
+        stateMsg.set("foodX", ctx->food->getPosition().x);
+        stateMsg.set("foodY", ctx->food->getPosition().y);
+    }
+    
+    // All player positions
+    stateMsg.set("players", buildJsonPlayerStates(*ctx, false));
+    
+    // Sync timer information
+    stateMsg.set("matchStartTime", ctx->match.matchStartTime);
+    stateMsg.set("elapsedMs", ctx->match.syncedElapsedMs);
+    if (carriesPause(*ctx)) {
+        stateMsg.set("pausedBy", ctx->match.pausedByClientId);
+        stateMsg.set("totalPausedTime", ctx->match.totalPausedTime);
+        stateMsg.set("pauseStartTime", ctx->match.pauseStartTime);
+    }
+    
+    // Send to all clients
+    int result = mp_api_game_take(ctx->network.api, stateMsg.build(), MP_API_SEND_REPLACEABLE);
+    if (result != 0) {
+        Logger::error("ERROR: Failed to broadcast game state, result=", result);
+    }
+    // Unnumbered and unacked: paced by the uplink alone
+    ctx->network.broadcast.sent(0, 0, SDL_GetTicks());
 }
 
 // ========== INTERNAL IMPLEMENTATION ==========
@@ -344,17 +849,16 @@ static void on_multiplayer_event( const char *event, int64_t messageId, const ch
     
     // Thread-safe: Just queue the message, don't process it here
     NetworkMessage msg;
+    msg.messageId = messageId;
     
     if (strcmp(event, "joined") == 0) {
         msg.type = NetworkMessageType::PLAYER_JOINED;
         msg.clientId = clientId ? clientId : "";
-        msg.jsonData = "";  // No data for joined event
-        ctx->network.messageQueue.push(msg);
+        queueNetworkMessage(*ctx, std::move(msg));
         
     } else if (strcmp(event, "leaved") == 0) {
         msg.type = NetworkMessageType::PLAYER_LEFT;
         msg.clientId = clientId ? clientId : "";
-        msg.jsonData = "";  // No data for left event
         
         // Check if host left (critical for clients)
         if (ctx->network.isHost == false && !ctx->network.hostClientId.empty()) {
@@ -365,36 +869,65 @@ static void on_multiplayer_event( const char *event, int64_t messageId, const ch
             }
         }
         
-        ctx->network.messageQueue.push(msg);
+        queueNetworkMessage(*ctx, std::move(msg));
         
     } else if (strcmp(event, "game") == 0) {
         if (clientId && data) {
-            // Serialize JSON to string for thread-safe transfer
-            // Note: json_dumps allocates memory, must be freed
-            char* jsonStr = json_dumps(data, JSON_COMPACT);
-            if (jsonStr) {
-                msg.type = NetworkMessageType::GAME_UPDATE;
-                msg.clientId = clientId;
-                msg.jsonData = jsonStr;
-                free(jsonStr);  // Free immediately after copying to std::string
-                ctx->network.messageQueue.push(msg);
-            }
+            // Hand the parsed object itself to the game thread. The API drops
+            // its own reference after we return (refcounts are atomic).
+            json_incref(data);
+            msg.type = NetworkMessageType::GAME_UPDATE;
+            msg.clientId = clientId;
+            msg.arena.retainFor(data);  // Reset once the game thread drops msg
+            msg.data.reset(data);
+            queueNetworkMessage(*ctx, std::move(msg));
         }
     }
 }
 
+// The hot messages go to the game thread as text and are decoded there
+// straight into its preallocated snapshot; everything else is parsed as usual
+static int on_raw_game_line(const char *type, const char *line, size_t len, void *user_data)
+{
+    if (strcmp(type, "game_state") != 0 && strcmp(type, "player_input") != 0)
+        return 0;
+    
+    GameContext* ctx = (GameContext*)user_data;
+    NetworkMessage msg;
+    msg.type = NetworkMessageType::GAME_LINE;
+    msg.line.assign(line, len);
+    queueNetworkMessage(*ctx, std::move(msg));
+    return 1;
+}
+
+// Listener side: stamp for the dispatch delay, then track the ring's depth
+static void queueNetworkMessage(GameContext& ctx, NetworkMessage&& msg)
+{
+    msg.queuedAtMicros = NetTelemetry::nowMicros();
+    if (ctx.network.messageQueue.push(std::move(msg))) {
+        ctx.network.telemetry.recordQueueDepth(ctx.network.messageQueue.size());
+    }
+}
+
 // Process network messages in main thread (thread-safe)
 static void processNetworkMessages(GameContext& ctx)
 {
     NetworkMessage msg;
     
     // Update last message received time if we have messages
-    if (ctx.network.messageQueue.size() > 0) {
+    if (!ctx.network.messageQueue.empty()) {
         ctx.network.lastMessageReceived = SDL_GetTicks();
     }
     
+    size_t dropped = ctx.network.messageQueue.takeDropped();
+    if (dropped > 0) {
+        Logger::warn("Network message queue full - dropped ", dropped, " messages");
+    }
+    
     // Process all queued messages
     while (ctx.network.messageQueue.pop(msg)) {
+        ctx.network.telemetry.recordDispatch(msg.queuedAtMicros);
+        
         switch (msg.type) {
             case NetworkMessageType::HOST_DISCONNECT:
                 handleHostDisconnect(ctx);
@@ -409,14 +942,10 @@ static void processNetworkMessages(GameContext& ctx)
                 break;
                 
             case NetworkMessageType::GAME_UPDATE: {
-                // Parse JSON from string
-                json_error_t error;
-                json_t* data = json_loads(msg.jsonData.c_str(), 0, &error);
+                // Already parsed by the API; msg owns the reference
+                json_t* data = msg.data.get();
                 if (!data) continue;
                 
-                // Use RAII wrapper for automatic cleanup
-                JsonPtr dataPtr(data);
-                
                 // Check message sub-type
                 json_t *type_val = json_object_get(data, "type");
                 const char* messageType = json_is_string(type_val) ? json_string_value(type_val) : "";
@@ -426,10 +955,38 @@ static void processNetworkMessages(GameContext& ctx)
                 } else if (strcmp(messageType, "player_input") == 0) {
                     handlePlayerInput(ctx, msg.clientId, data);
                 } else if (strcmp(messageType, "game_state") == 0) {
-                    handleGameState(ctx, data);
+                    handleGameState(ctx, data, msg.messageId);
+                } else if (strcmp(messageType, "state_ack") == 0) {
+                    handleStateAck(ctx, msg.clientId, data);
+                } else if (strcmp(messageType, "state_resync") == 0) {
+                    if (ctx.network.isHost) {
+                        ctx.network.forceKeyframe = true;
+                    }
+                } else if (strcmp(messageType, "lockstep_tick") == 0) {
+                    handleLockstepTick(ctx, data);
+                } else if (strcmp(messageType, "lockstep_state") == 0) {
+                    handleLockstepState(ctx, data);
+                } else if (strcmp(messageType, "lockstep_desync") == 0) {
+                    handleLockstepDesync(ctx, msg.clientId, data);
+                } else if (strcmp(messageType, "ping") == 0) {
+                    handlePing(ctx, msg.clientId, data);
+                } else if (strcmp(messageType, "pong") == 0) {
+                    handlePong(ctx, data);
+                } else if (strcmp(messageType, "leave") == 0) {
+                    handlePlayerLeaving(ctx, msg.clientId);
+                } else if (strcmp(messageType, "resume_key") == 0) {
+                    handleResumeKey(ctx, msg.clientId, data);
+                } else if (strcmp(messageType, "resume") == 0) {
+                    handleResume(ctx, msg.clientId, data);
+                } else if (strcmp(messageType, "resumed") == 0) {
+                    handleResumed(ctx, data);
                 }
                 break;
             }
+            
+            case NetworkMessageType::GAME_LINE:
+                handleGameLine(ctx, msg.line);
+                break;
                 
             default:
                 break;
@@ -444,11 +1001,18 @@ static void handlePlayerJoined(GameContext& ctx, const std::string& clientId)
     // Check if this is me joining
     bool isMe = (clientId == ctx.network.myClientId);
     
-    if (isMe) {
+    if (isMe && ctx.network.dedicatedHost) {
+        // A dedicated host only relays and simulates
+    } else if (isMe && !ctx.network.resumeFrom.empty()) {
+        // Rejoined after a drop: the host's "resumed" maps us to our slot
+    } else if (isMe) {
         // I'm joining - add myself immediately
         add_player(ctx, clientId);
         ctx.players.setMyPlayerIndex(ctx.players.findByClientId(clientId));
         Logger::info("I joined as player ", (ctx.players.myPlayerIndex() + 1));
+        if (!ctx.network.isHost) {
+            sendResumeKey(ctx.network);
+        }
         
         // If I'm the first player and not explicitly host, I'm likely the host
         // (Server makes first joiner the host)
@@ -475,21 +1039,115 @@ static void handlePlayerJoined(GameContext& ctx, const std::string& clientId)
         json_object_set_new(gameUpdate.get(), "foodY", json_integer(ctx.food->getPosition().y));
         json_object_set_new(gameUpdate.get(), "matchStartTime", json_integer(ctx.match.matchStartTime));
         
-        // Add existing players info
+        // Host, arena and existing players info
+        json_object_set_new(gameUpdate.get(), "host", json_string(ctx.network.myClientId.c_str()));
+        json_object_set_new(gameUpdate.get(), "arena", buildArenaJson(ctx));
         json_object_set_new(gameUpdate.get(), "players", buildPlayerClientIdList(ctx));
         
         mp_api_game(ctx.network.api, gameUpdate.get());
     }
+    
+    // The new snake took a spawn pick only the host made
+    if (ctx.network.isHost && ctx.network.lockstep) {
+        sendLockstepState(ctx);
+    }
 }
 
 static void handlePlayerLeft(GameContext& ctx, const std::string& clientId)
 {
+    // Dropped mid-match: the player may rejoin (resume), so its snake stays,
+    // frozen, until the grace period is over
+    int i = ctx.players.findByClientId(clientId);
+    if (i >= 0 && ctx.network.matchRunning && Config::Network::RESUME_GRACE_MS > 0 &&
+        ctx.players[i].disconnectedAt == 0) {
+        ctx.players[i].disconnectedAt = std::max<Uint32>(SDL_GetTicks(), 1);
+        ctx.network.broadcast.removeClient(i);
+        Logger::info("Player ", (i+1), " disconnected, holding the slot for a resume");
+        // Peers froze it at different ticks
+        if (ctx.network.isHost && ctx.network.lockstep) {
+            sendLockstepState(ctx);
+        }
+        return;
+    }
+    
     remove_player(ctx, clientId);
+    
+    if (ctx.network.isHost && ctx.network.lockstep) {
+        sendLockstepState(ctx);
+    }
+}
+
+// Pause state from a state_sync or, on clients, a game_state frame.
+// Timing is only taken when present.
+static void applyPauseState(GameContext& ctx, bool isPaused, const std::string& pauserClientId,
+                            bool hasTotal, Uint32 totalPausedTime, bool hasStart, Uint32 pauseStartTime)
+{
+    // Sync pause timing
+    if (hasTotal) {
+        ctx.match.totalPausedTime = totalPausedTime;
+    }
+    if (hasStart) {
+        ctx.match.pauseStartTime = pauseStartTime;
+    }
+    
+    // Apply pause state to all players
+    for (int i : ctx.players.activeIndices()) {
+        ctx.players[i].paused = isPaused;
+    }
+    
+    // Update game state using callback
+    // The callback will handle the state change with fromNetwork=true
+    if (ctx.onStateChange) {
+        if (isPaused) {
+            ctx.onStateChange(static_cast<int>(GameState::PAUSED));
+        } else {
+            ctx.onStateChange(static_cast<int>(GameState::PLAYING));
+        }
+    }
+    
+    // Update who paused
+    std::string pausedBy = isPaused ? pauserClientId : "";
+    if (ctx.network.isHost && !ctx.network.lockstep && pausedBy != ctx.match.pausedByClientId) {
+        ctx.network.broadcast.mark(BroadcastScheduler::PAUSE);
+    }
+    ctx.match.pausedByClientId = pausedBy;
+    
+    // Find player name for message
+    int pauserIdx = ctx.players.findByClientId(pauserClientId);
+    std::string playerName = pauserIdx >= 0 ? "Player " + std::to_string(pauserIdx + 1) : "Someone";
+    Logger::info((isPaused ? (playerName + " paused the game") : (playerName + " resumed the game")));
+}
+
+// Pause fields of a game_state frame; applied only when they change
+// something, as every frame sent while paused repeats them
+static void applyFramePause(GameContext& ctx, const std::string& pausedBy, Uint32 totalPausedTime,
+                            Uint32 pauseStartTime)
+{
+    if (pausedBy == ctx.match.pausedByClientId) {
+        ctx.match.totalPausedTime = totalPausedTime;
+        return;
+    }
+    bool isPaused = !pausedBy.empty();
+    applyPauseState(ctx, isPaused, isPaused ? pausedBy : ctx.match.pausedByClientId,
+                    true, totalPausedTime, true, pauseStartTime);
 }
 
 static void handleStateSync(GameContext& ctx, json_t* data)
 {
     // Sync game state from host
+    // Arena first: food, players and every later position refer to it
+    json_t *arenaVal = json_object_get(data, "arena");
+    if (json_is_object(arenaVal) && !ctx.network.isHost) {
+        applyArenaJson(ctx, arenaVal);
+    }
+    
+    // The host names itself; guessing from join order fails when it has
+    // no snake (dedicated server)
+    json_t *hostVal = json_object_get(data, "host");
+    if (json_is_string(hostVal) && !ctx.network.isHost) {
+        ctx.network.hostClientId = json_string_value(hostVal);
+    }
+    
     // Sync food position
     json_t *foodX = json_object_get(data, "foodX");
     json_t *foodY = json_object_get(data, "foodY");
@@ -531,43 +1189,11 @@ static void handleStateSync(GameContext& ctx, json_t* data)
     json_t *pausedVal = json_object_get(data, "globalPaused");
     json_t *pausedBy = json_object_get(data, "pausedBy");
     if (json_is_boolean(pausedVal) && json_is_string(pausedBy)) {
-        bool isPaused = json_boolean_value(pausedVal);
-        std::string pauserClientId = json_string_value(pausedBy);
-        
-        // Sync pause timing
         json_t *totalPausedVal = json_object_get(data, "totalPausedTime");
         json_t *pauseStartVal = json_object_get(data, "pauseStartTime");
-        if (json_is_integer(totalPausedVal)) {
-            ctx.match.totalPausedTime = json_integer_value(totalPausedVal);
-        }
-        if (json_is_integer(pauseStartVal)) {
-            ctx.match.pauseStartTime = json_integer_value(pauseStartVal);
-        }
-        
-        // Apply pause state to all players
-        for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-            if (ctx.players[i].active) {
-                ctx.players[i].paused = isPaused;
-            }
-        }
-        
-        // Update game state using callback
-        // The callback will handle the state change with fromNetwork=true
-        if (ctx.onStateChange) {
-            if (isPaused) {
-                ctx.onStateChange(static_cast<int>(GameState::PAUSED));
-            } else {
-                ctx.onStateChange(static_cast<int>(GameState::PLAYING));
-            }
-        }
-        
-        // Update who paused
-        ctx.match.pausedByClientId = isPaused ? pauserClientId : "";
-        
-        // Find player name for message
-        int pauserIdx = ctx.players.findByClientId(pauserClientId);
-        std::string playerName = pauserIdx >= 0 ? "Player " + std::to_string(pauserIdx + 1) : "Someone";
-        Logger::info((isPaused ? (playerName + " paused the game") : (playerName + " resumed the game")));
+        applyPauseState(ctx, json_boolean_value(pausedVal), json_string_value(pausedBy),
+                        json_is_integer(totalPausedVal), (Uint32)json_integer_value(totalPausedVal),
+                        json_is_integer(pauseStartVal), (Uint32)json_integer_value(pauseStartVal));
     }
     
     // Sync player list
@@ -621,150 +1247,503 @@ static void sendGlobalPauseState(GameContext& ctx, bool paused, const std::strin
 }
 
 static void handlePlayerInput(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    json_t* dirVal = json_object_get(data, "direction");
+    if (!json_is_string(dirVal)) return;
+    
+    json_t* seqVal = json_object_get(data, "seq");
+    json_int_t seq = json_is_integer(seqVal) ? json_integer_value(seqVal) : 0;
+    applyPlayerInput(ctx, clientId, stringToDirection(json_string_value(dirVal)), seq);
+}
+
+static void applyPlayerInput(GameContext& ctx, const std::string& clientId, Direction dir, json_int_t seq)
 {
     // Only host processes inputs!
     if (!ctx.network.isHost) return;
     
     int playerIdx = ctx.players.findByClientId(clientId);
     if (playerIdx < 0 || !ctx.players[playerIdx].snake) return;
+    PlayerSlot& slot = ctx.players[playerIdx];
     
-    json_t* dirVal = json_object_get(data, "direction");
-    if (!json_is_string(dirVal)) return;
+    // seq is echoed in game_state so the client can replay what we haven't seen
+    if (seq < 0 || (seq != 0 && seq <= (json_int_t)slot.lastInputSeq))
+        return;  // Stale
     
-    Direction dir = stringToDirection(json_string_value(dirVal));
+    if (ctx.network.lockstep) {
+        // Applied with the next tick bundle, on every peer alike
+        if (dir != Direction::NONE) {
+            queueLockstepInput(ctx.network, playerIdx, dir);
+        }
+        return;
+    }
     
     if (dir != Direction::NONE)
     {
-        ctx.players[playerIdx].snake->setDirection(dir);
+        slot.snake->setDirection(dir);
+    }
+    if (seq != 0) {
+        slot.lastInputSeq = (uint32_t)seq;
+        slot.inputAge = 0;
     }
 }
 
-static void handleGameState(GameContext& ctx, json_t* data)
+// Ask the host for a keyframe (throttled)
+static void requestKeyframe(GameContext& ctx)
 {
-    if (ctx.network.isHost)
-    return;
+    Uint32 now = SDL_GetTicks();
+    if (ctx.network.resyncPending && now - ctx.network.lastResyncRequest < Config::Network::STATE_ACK_INTERVAL_MS)
+        return;
     
+    auto resyncMsg = JsonBuilder()
+        .set("type", "state_resync")
+        .buildPtr();
+    mp_api_game(ctx.network.api, resyncMsg.get());
+    
+    ctx.network.lastResyncRequest = now;
+    ctx.network.resyncPending = true;
+}
+
+// Tell the host which snapshot it can delta against (throttled)
+static void sendStateAck(GameContext& ctx, uint32_t seq)
+{
+    Uint32 now = SDL_GetTicks();
+    if (!ctx.network.resyncPending && ctx.network.lastAckSent != 0 &&
+        now - ctx.network.lastAckSent < Config::Network::STATE_ACK_INTERVAL_MS)
+        return;
+    
+    auto ackMsg = JsonBuilder()
+        .set("type", "state_ack")
+        .set("seq", (json_int_t)seq)
+        .build();
+    mp_api_game_take(ctx.network.api, ackMsg, 0);
+    
+    ctx.network.lastAckSent = now;
+    ctx.network.resyncPending = false;
+}
+
+// Decode the legacy per-segment JSON layout of a game_state message
+static bool decodeJsonGameState(GameContext& ctx, json_t* data, WireFormat::StateSnapshot& snapshot)
+{
     json_t* foodX = json_object_get(data, "foodX");
     json_t* foodY = json_object_get(data, "foodY");
-    if (foodX && foodY && ctx.food)
-    {
-        int x = (int)json_integer_value(foodX);
-        int y = (int)json_integer_value(foodY);
-        
-        if (isValidPosition(x, y)) {
-            ctx.food->setPosition(Position{x, y});
-        } else {
-            Logger::warn("Invalid food position from network: ", x, ",", y);
-        }
+    if (foodX && foodY) {
+        snapshot.food = Position{(int)json_integer_value(foodX), (int)json_integer_value(foodY)};
+    } else {
+        snapshot.food = ctx.food ? ctx.food->getPosition() : Position{0, 0};
     }
+    snapshot.matchStartTime = (uint32_t)json_integer_value(json_object_get(data, "matchStartTime"));
+    snapshot.elapsedMs = (uint32_t)json_integer_value(json_object_get(data, "elapsedMs"));
+    snapshot.playerCount = 0;
     
     json_t* playersArray = json_object_get(data, "players");
-    if (json_is_array(playersArray))
+    if (!json_is_array(playersArray))
+        return true;
+    
+    size_t index;
+    json_t* playerObj;
+    json_array_foreach(playersArray, index, playerObj)
     {
-        size_t index;
-        json_t* playerObj;
+        WireFormat::PlayerState& player = snapshot.addPlayer();
+        player.index = (int)json_integer_value(json_object_get(playerObj, "index"));
+        player.alive = json_boolean_value(json_object_get(playerObj, "alive"));
+        player.inputSeq = (uint32_t)json_integer_value(json_object_get(playerObj, "inputSeq"));
+        player.inputAge = (uint8_t)json_integer_value(json_object_get(playerObj, "inputAge"));
+        player.heading = (uint8_t)json_integer_value(json_object_get(playerObj, "heading"));
         
-        json_array_foreach(playersArray, index, playerObj)
+        json_t* bodyArray = json_object_get(playerObj, "body");
+        size_t i;
+        json_t* segment;
+        json_array_foreach(bodyArray, i, segment) 
         {
-            int playerIdx = (int)json_integer_value(json_object_get(playerObj, "index"));
-            bool alive = json_boolean_value(json_object_get(playerObj, "alive"));
-            
-            if (playerIdx < 0 || playerIdx >= Config::Game::MAX_PLAYERS)
-            continue;
-            if (!ctx.players[playerIdx].snake)
-            continue;
-            
-            json_t* bodyArray = json_object_get(playerObj, "body");
-            if (json_is_array(bodyArray)) 
-            {
-                std::deque<Position> newBody;
-                
-                size_t i;
-                json_t* segment;
-                json_array_foreach(bodyArray, i, segment) 
-                {
-                    int x = (int)json_integer_value(json_object_get(segment, "x"));
-                    int y = (int)json_integer_value(json_object_get(segment, "y"));
-                    
-                    if (!isValidPosition(x, y)) {
-                        Logger::warn("Invalid snake position from network: ", x, ",", y, " - skipping segment");
-                        continue;
-                    }
-                    
-                    newBody.push_back(Position{x, y});
-                }
-                
-                if (!newBody.empty())
-                {
-                    ctx.players[playerIdx].snake->setBody(newBody);
+            player.body.push_back(Position{
+                (int)json_integer_value(json_object_get(segment, "x")),
+                (int)json_integer_value(json_object_get(segment, "y"))
+            });
+        }
+    }
+    return true;
+}
+
+// One predicted tick of the local snake; walls are left for the host to judge
+static void stepPredictedSnake(GameContext& ctx, Snake& snake)
+{
+    if (!ctx.occupancy.inBounds(snake.peekNextHead()))
+        return;
+    snake.update();
+}
+
+void NetworkManager::predictLocalTick() {
+    NetworkContext& net = ctx->network;
+    if (!Config::Network::CLIENT_PREDICTION || net.isHost || !ctx->players.isValid(ctx->players.myPlayerIndex()))
+        return;
+    
+    net.predictionTick++;
+    for (auto& input : net.pendingInputs) {
+        if (input.seq != 0 && input.tick == 0) {
+            input.tick = net.predictionTick;
+        }
+    }
+    
+    int myIdx = ctx->players.myPlayerIndex();
+    Snake& snake = *ctx->players[myIdx].snake;
+    ctx->occupancy.releaseBody(snake, myIdx);
+    stepPredictedSnake(*ctx, snake);
+    ctx->occupancy.occupyBody(snake, myIdx);
+}
+
+// Rewind the local snake to the host's body and direction, then replay
+// the ticks and inputs the host hadn't simulated yet
+static void reconcileLocalSnake(GameContext& ctx, int playerIdx, const WireFormat::PlayerState& player)
+{
+    NetworkContext& net = ctx.network;
+    constexpr uint32_t CAP = NetworkContext::PENDING_INPUT_CAPACITY;
+    Snake& snake = *ctx.players[playerIdx].snake;
+    
+    // Prediction tick the host state corresponds to. The host counts ticks
+    // from the one that first applied inputSeq, we recorded that input's tick.
+    uint32_t acked = player.inputSeq;
+    uint32_t hostTick = net.predictionTick;
+    bool aligned = true;
+    if (acked != 0) {
+        const NetworkContext::PendingInput& input = net.pendingInputs[acked % CAP];
+        if (input.seq != acked) {
+            aligned = false;  // Too old to replay from
+        } else if (input.tick != 0) {
+            hostTick = std::min(input.tick - 1 + player.inputAge, net.predictionTick);
+        }
+    } else {
+        // Host hasn't applied any input: its snake is still where we started
+        const NetworkContext::PendingInput& first = net.pendingInputs[1 % CAP];
+        if (first.seq == 1 && first.tick != 0) {
+            hostTick = first.tick - 1;
+        }
+    }
+    
+    Direction current, next;
+    unpackHeading(player.heading, current, next);
+    
+    ctx.occupancy.releaseBody(snake, playerIdx);
+    snake.setBody(player.body.data(), player.body.size());
+    snake.setHeading(current, next);
+    
+    uint32_t firstSeq = acked + 1;
+    if (net.nextInputSeq > CAP && firstSeq < net.nextInputSeq - CAP) {
+        firstSeq = net.nextInputSeq - CAP;
+    }
+    
+    if (aligned && net.predictionTick - hostTick <= (uint32_t)Config::Network::MAX_PREDICTION_TICKS) {
+        for (uint32_t t = hostTick + 1; t <= net.predictionTick; t++) {
+            for (uint32_t seq = firstSeq; seq < net.nextInputSeq; seq++) {
+                const NetworkContext::PendingInput& input = net.pendingInputs[seq % CAP];
+                if (input.seq != seq || input.tick == 0)
+                    continue;
+                // Simulated locally but not yet by the host: it lands on the first replayed tick
+                if (std::max(input.tick, hostTick + 1) == t) {
+                    snake.setDirection(input.dir);
                 }
             }
-            if (!alive && ctx.players[playerIdx].snake->isAlive())
-            {
-                ctx.players[playerIdx].snake->setAlive(false);
-            }
+            stepPredictedSnake(ctx, snake);
         }
     }
+    
+    // Pressed since the last local tick
+    for (uint32_t seq = firstSeq; seq < net.nextInputSeq; seq++) {
+        const NetworkContext::PendingInput& input = net.pendingInputs[seq % CAP];
+        if (input.seq == seq && input.tick == 0) {
+            snake.setDirection(input.dir);
+        }
+    }
+    ctx.occupancy.occupyBody(snake, playerIdx);
 }
 
-static void add_player(GameContext& ctx, const std::string& clientId)
+// Track host match time against the local clock. The least delayed packet
+// gives the best estimate; a much later one means the host was paused.
+static void updateHostClock(NetworkContext& net, uint32_t hostTimeMs)
 {
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++)
+    constexpr int64_t RESET_MS = 500;
+    int64_t estimate = (int64_t)hostTimeMs - (int64_t)SDL_GetTicks();
+    if (!net.hostClockValid || estimate > net.hostClockOffset || estimate < net.hostClockOffset - RESET_MS) {
+        net.hostClockOffset = estimate;
+        net.hostClockValid = true;
+    } else {
+        net.hostClockOffset--;  // Drift slowly towards later packets
+    }
+}
+
+void NetworkManager::updateRemoteTracks(Uint32 tickMs) {
+    NetworkContext& net = ctx->network;
+    if (net.isHost || !net.hostClockValid)
+        return;
+    
+    int64_t renderTime = (int64_t)SDL_GetTicks() + net.hostClockOffset - Config::Network::INTERPOLATION_DELAY_MS;
+    for (int i : ctx->players.activeIndices()) {
+        PlayerSlot& slot = ctx->players[i];
+        if (i == ctx->players.myPlayerIndex())
+            continue;
+        slot.remote.sample(renderTime, tickMs, Config::Network::MAX_EXTRAPOLATION_MS,
+                           ctx->occupancy.getWidth(), ctx->occupancy.getHeight());
+    }
+}
+
+// Decode a packed snapshot (null: the "bin" text wasn't valid base64) and
+// keep it for later deltas. False, after asking for a keyframe if one is
+// needed, when there's nothing new to apply.
+static bool acceptBinaryGameState(GameContext& ctx, const std::vector<uint8_t>* bytes,
+                                  WireFormat::StateSnapshot& snapshot)
+{
+    WireFormat::DecodeResult result = bytes
+        ? WireFormat::decodeSnapshot(bytes->data(), bytes->size(), ctx.network.snapshotHistory, snapshot)
+        : WireFormat::DecodeResult::MALFORMED;
+    if (result == WireFormat::DecodeResult::MISSING_BASE) {
+        Logger::debug("game_state delta against unknown snapshot - requesting keyframe");
+        requestKeyframe(ctx);
+        return false;
+    }
+    if (result != WireFormat::DecodeResult::OK) {
+        Logger::warn("Malformed game_state from network - requesting keyframe");
+        requestKeyframe(ctx);
+        return false;
+    }
+    if (snapshot.seq <= ctx.network.lastAppliedSeq)
+        return false;  // Stale or duplicate
+    
+    // Keep the snapshot as decoded so later deltas resolve against exactly what the host sent
+    ctx.network.snapshotHistory.store(snapshot.seq).copyFrom(snapshot);
+    ctx.network.lastAppliedSeq = snapshot.seq;
+    sendStateAck(ctx, snapshot.seq);
+    return true;
+}
+
+static void handleGameState(GameContext& ctx, json_t* data, int64_t messageId)
+{
+    if (ctx.network.isHost)
+    return;
+    
+    WireFormat::StateSnapshot& snapshot = ctx.network.receivedSnapshot;
+    
+    json_t* binVal = json_object_get(data, "bin");
+    if (json_is_string(binVal))
     {
-        if (!ctx.players[i].active)
-        {
-            // Build collision map and get random spawn position
-            auto occupiedPositions = buildCollisionMap(ctx);
-            Position spawnPos = getRandomSpawnPositionUtil(occupiedPositions);
-            
-            ctx.players[i].snake = std::make_unique<Snake>(Config::Render::PLAYER_COLORS[i], spawnPos);
-            ctx.players[i].clientId = clientId;
-            ctx.players[i].active = true;
-            ctx.players[i].lastMpSent = 0;
-            
-            Logger::info("Player ", (i+1), " joined: ", clientId);
-            break;
+        std::vector<uint8_t>& bytes = ctx.network.receivedBytes;
+        bool valid = WireFormat::base64Decode(json_string_value(binVal), json_string_length(binVal), bytes);
+        if (!acceptBinaryGameState(ctx, valid ? &bytes : nullptr, snapshot))
+            return;
+    }
+    else if (!decodeJsonGameState(ctx, data, snapshot))
+    {
+        Logger::warn("Malformed game_state from network - ignoring");
+        return;
+    }
+    
+    applyGameState(ctx, snapshot, messageId);
+    
+    json_t* pausedBy = json_object_get(data, "pausedBy");
+    if (json_is_string(pausedBy)) {
+        applyFramePause(ctx, json_string_value(pausedBy),
+                        (Uint32)json_integer_value(json_object_get(data, "totalPausedTime")),
+                        (Uint32)json_integer_value(json_object_get(data, "pauseStartTime")));
+    }
+}
+
+// A game_state or player_input line from on_raw_game_line
+static void handleGameLine(GameContext& ctx, const std::string& line)
+{
+    NetworkContext& net = ctx.network;
+    GameMessage::Decoded& decoded = net.decodedLine;
+    if (!GameMessage::decode(line.data(), line.size(), decoded, net.receivedSnapshot)) {
+        Logger::warn("Malformed game message from network - ignoring");
+        return;
+    }
+    
+    if (decoded.type == GameMessage::Type::PLAYER_INPUT) {
+        if (decoded.hasDirection) {
+            applyPlayerInput(ctx, decoded.clientId, decoded.direction, (json_int_t)decoded.inputSeq);
         }
+        return;
+    }
+    if (decoded.type != GameMessage::Type::GAME_STATE || net.isHost)
+        return;
+    
+    WireFormat::StateSnapshot& snapshot = net.receivedSnapshot;
+    if (decoded.hasBin) {
+        if (!acceptBinaryGameState(ctx, decoded.binValid ? &decoded.bin : nullptr, snapshot))
+            return;
+    } else if (!decoded.hasFood) {
+        snapshot.food = ctx.food ? ctx.food->getPosition() : Position{0, 0};
+    }
+    applyGameState(ctx, snapshot, decoded.messageId);
+    if (decoded.hasPause) {
+        applyFramePause(ctx, decoded.pausedBy, decoded.totalPausedTime, decoded.pauseStartTime);
     }
 }
 
-static void remove_player(GameContext& ctx, const std::string& clientId)
+// Food, match time and snakes from a decoded game_state
+static void applyGameState(GameContext& ctx, WireFormat::StateSnapshot& snapshot, int64_t messageId)
 {
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++)
+    if (ctx.food)
+    {
+        if (isValidPosition(ctx, snapshot.food.x, snapshot.food.y)) {
+            ctx.food->setPosition(snapshot.food);
+        } else {
+            Logger::warn("Invalid food position from network: ", snapshot.food.x, ",", snapshot.food.y);
+        }
+    }
+    
+    ctx.match.matchStartTime = snapshot.matchStartTime;
+    ctx.match.syncedElapsedMs = snapshot.elapsedMs;
+    updateHostClock(ctx.network, snapshot.elapsedMs);
+    
+    for (int p = 0; p < snapshot.playerCount; p++)
     {
-        if (ctx.players[i].active && ctx.players[i].clientId == clientId)
+        WireFormat::PlayerState& player = snapshot.players[p];
+        int playerIdx = player.index;
+        
+        if (playerIdx < 0 || playerIdx >= ctx.players.capacity())
+        continue;
+        if (!ctx.players[playerIdx].snake)
+        continue;
+        
+        auto& newBody = player.body;
+        newBody.erase(std::remove_if(newBody.begin(), newBody.end(), [&ctx](const Position& pos) {
+            if (isValidPosition(ctx, pos.x, pos.y)) return false;
+            Logger::warn("Invalid snake position from network: ", pos.x, ",", pos.y, " - skipping segment");
+            return true;
+        }), newBody.end());
+        
+        if (!newBody.empty() && Config::Network::CLIENT_PREDICTION && player.alive &&
+            playerIdx == ctx.players.myPlayerIndex())
         {
-            ctx.players[i].active = false;
-            ctx.players[i].snake = nullptr;
-            ctx.players[i].clientId = "";
-            Logger::info("Player ", (i+1), " left");
-            break;
+            reconcileLocalSnake(ctx, playerIdx, player);
+        }
+        else if (!newBody.empty())
+        {
+            ctx.occupancy.releaseBody(*ctx.players[playerIdx].snake, playerIdx);
+            ctx.players[playerIdx].snake->setBody(newBody.data(), newBody.size());
+            ctx.occupancy.occupyBody(*ctx.players[playerIdx].snake, playerIdx);
+        }
+        if (!player.alive && ctx.players[playerIdx].snake->isAlive())
+        {
+            ctx.players[playerIdx].snake->setAlive(false);
+        }
+        if (!newBody.empty() && playerIdx != ctx.players.myPlayerIndex())
+        {
+            ctx.players[playerIdx].remote.push(messageId, snapshot.elapsedMs, newBody, player.alive);
         }
     }
 }
 
+static void handleStateAck(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    if (!ctx.network.isHost)
+    return;
+    
+    int playerIdx = ctx.players.findByClientId(clientId);
+    json_t* seqVal = json_object_get(data, "seq");
+    if (playerIdx < 0 || !json_is_integer(seqVal))
+    return;
+    
+    json_int_t seq = json_integer_value(seqVal);
+    if (seq <= 0 || seq >= (json_int_t)ctx.network.nextSnapshotSeq)
+    return;  // Not a snapshot we sent
+    
+    if ((uint32_t)seq > ctx.players[playerIdx].ackedSnapshot) {
+        ctx.players[playerIdx].ackedSnapshot = (uint32_t)seq;
+    }
+    ctx.network.broadcast.onAck(playerIdx, (uint32_t)seq, SDL_GetTicks());
+}
+
+static void add_player(GameContext& ctx, const std::string& clientId, int slot)
+{
+    if (ctx.players.findByClientId(clientId) >= 0) {
+        return;  // Already here (a resume raced the roster)
+    }
+    int i = slot >= 0 ? slot : ctx.players.firstFreeSlot();
+    if (i < 0) {
+        Logger::warn("Arena full (", ctx.players.capacity(), " players), not adding ", clientId);
+        return;
+    }
+    
+    // Spawn into a free spot of the shared occupancy grid
+    Position spawnPos = getRandomSpawnPositionUtil(ctx.occupancy);
+    
+    ctx.players.activate(i, clientId);
+    ctx.players[i].snake = std::make_unique<Snake>(playerColor(i), spawnPos);
+    ctx.occupancy.occupyBody(*ctx.players[i].snake, i);
+    ctx.players[i].lastMpSent = 0;
+    ctx.players[i].ackedSnapshot = 0;
+    ctx.network.broadcast.removeClient(i);
+    ctx.players[i].lastInputSeq = 0;
+    ctx.players[i].inputAge = 0;
+    ctx.players[i].remote.clear();
+    
+    Logger::info("Player ", (i+1), " joined: ", clientId);
+}
+
+static void remove_player(GameContext& ctx, const std::string& clientId)
+{
+    int i = ctx.players.findByClientId(clientId);
+    if (i < 0) return;
+    
+    if (ctx.players[i].snake) {
+        ctx.occupancy.releaseBody(*ctx.players[i].snake, i);
+    }
+    ctx.players.deactivate(i);
+    ctx.network.broadcast.removeClient(i);
+    Logger::info("Player ", (i+1), " left");
+}
+
+// Session arena of state_sync: {"w", "h", "players"}
+static json_t* buildArenaJson(const GameContext& ctx)
+{
+    return JsonBuilder()
+        .set("w", ctx.arena.width)
+        .set("h", ctx.arena.height)
+        .set("players", ctx.arena.maxPlayers)
+        .build();
+}
+
+// Client: adopt the host's arena before anything is placed on it
+static void applyArenaJson(GameContext& ctx, json_t* arenaVal)
+{
+    json_t* w = json_object_get(arenaVal, "w");
+    json_t* h = json_object_get(arenaVal, "h");
+    json_t* n = json_object_get(arenaVal, "players");
+    if (!json_is_integer(w) || !json_is_integer(h) || !json_is_integer(n)) {
+        Logger::warn("Ignoring malformed arena in state_sync");
+        return;
+    }
+    
+    ArenaSettings arena;
+    arena.width = (int)json_integer_value(w);
+    arena.height = (int)json_integer_value(h);
+    arena.maxPlayers = (int)json_integer_value(n);
+    arena = arena.clamped();
+    if (arena == ctx.arena) return;
+    
+    ctx.arena = arena;
+    applyArena(arena, ctx.players, ctx.occupancy);
+    Logger::info("Arena ", arena.width, "x", arena.height, ", up to ", arena.maxPlayers, " players");
+}
+
 static void sendFullStateSync(GameContext& ctx)
 {
     if (!ctx.network.api || ctx.network.sessionId.empty() || !ctx.network.isHost)
         return;
     
+    // Food and elapsed time ride along with every game_state, so only
+    // session-level state is repeated here
+    JsonArenaScope arena;
     JsonPtr gameUpdate(json_object());
     json_object_set_new(gameUpdate.get(), "type", json_string("state_sync"));
-    
-    if (ctx.food)
-    {
-        json_object_set_new(gameUpdate.get(), "foodX", json_integer(ctx.food->getPosition().x));
-        json_object_set_new(gameUpdate.get(), "foodY", json_integer(ctx.food->getPosition().y));
-    }
-    
     json_object_set_new(gameUpdate.get(), "matchStartTime", json_integer(ctx.match.matchStartTime));
-    json_object_set_new(gameUpdate.get(), "elapsedMs", json_integer(ctx.match.syncedElapsedMs));
     
     json_object_set_new(gameUpdate.get(), "globalPaused", json_boolean(!ctx.match.pausedByClientId.empty()));
     json_object_set_new(gameUpdate.get(), "pausedBy", json_string(ctx.match.pausedByClientId.c_str()));
     json_object_set_new(gameUpdate.get(), "totalPausedTime", json_integer(ctx.match.totalPausedTime));
     json_object_set_new(gameUpdate.get(), "pauseStartTime", json_integer(ctx.match.pauseStartTime));
     
+    json_object_set_new(gameUpdate.get(), "host", json_string(ctx.network.myClientId.c_str()));
+    json_object_set_new(gameUpdate.get(), "arena", buildArenaJson(ctx));
     json_object_set_new(gameUpdate.get(), "players", buildPlayerClientIdList(ctx));
     
     mp_api_game(ctx.network.api, gameUpdate.get());
@@ -786,9 +1765,507 @@ void NetworkManager::sendPeriodicStateSync()
     if (!ctx || !ctx->network.isHost)
     return;
     
+    // Match clock and pause state already ride on every game_state
     Uint32 currentTime = SDL_GetTicks();
-    if (currentTime - ctx->network.lastStateSyncSent >= 1000)
+    Uint32 interval = ctx->network.broadcast.framesFlowing(currentTime)
+        ? Config::Network::STATE_SYNC_MATCH_INTERVAL_MS
+        : Config::Network::STATE_SYNC_INTERVAL_MS;
+    if (currentTime - ctx->network.lastStateSyncSent >= interval)
     {
         sendFullStateSync(*ctx);
     }
 }
+
+// ========== TELEMETRY ==========
+
+// Host: echo the client's timestamp. The relay broadcasts game messages,
+// so the pong names its addressee
+static void handlePing(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    json_t* sentVal = json_object_get(data, "t");
+    if (!ctx.network.isHost || !json_is_integer(sentVal))
+        return;
+    
+    auto pong = JsonBuilder()
+        .set("type", "pong")
+        .set("to", clientId.c_str())
+        .set("t", json_integer_value(sentVal))
+        .build();
+    mp_api_game_take(ctx.network.api, pong, 0);
+}
+
+static void handlePong(GameContext& ctx, json_t* data)
+{
+    json_t* toVal = json_object_get(data, "to");
+    json_t* sentVal = json_object_get(data, "t");
+    if (!json_is_string(toVal) || !json_is_integer(sentVal) ||
+        ctx.network.myClientId != json_string_value(toVal))
+        return;
+    
+    // Relay both ways plus the host's own dispatch delay
+    Uint32 rtt = SDL_GetTicks() - (Uint32)json_integer_value(sentVal);
+    ctx.network.telemetry.recordRtt(rtt);
+}
+
+// Game thread, after each processNetworkMessages(): ping, sample, log
+static void updateTelemetry(GameContext& ctx)
+{
+    NetworkContext& net = ctx.network;
+    Uint32 now = SDL_GetTicks();
+    
+    if (!net.isHost && !net.sessionId.empty() &&
+        now - net.lastPingSent >= Config::Network::PING_INTERVAL_MS) {
+        net.lastPingSent = now;
+        auto ping = JsonBuilder()
+            .set("type", "ping")
+            .set("t", (json_int_t)now)
+            .build();
+        mp_api_game_take(net.api, ping, 0);
+    }
+    
+    if (net.lastTelemetrySample == 0 || now - net.lastTelemetrySample >= Config::Network::TELEMETRY_SAMPLE_MS) {
+        net.lastTelemetrySample = now;
+        net.telemetry.sample(now);
+    }
+    
+    if (Config::Network::TELEMETRY_LOG_INTERVAL_MS > 0 &&
+        now - net.lastTelemetryLog >= Config::Network::TELEMETRY_LOG_INTERVAL_MS) {
+        net.lastTelemetryLog = now;
+        // A dedicated host runs many sessions; its per-session lines are debug output
+        std::string pacing = net.isHost ? ", game_state every " + std::to_string(net.broadcast.intervalMs()) + " ms" : "";
+        if (net.dedicatedHost) {
+            Logger::debug("Network ", net.sessionId, ": ", net.telemetry.describe());
+            Logger::debug("Network ", net.sessionId, ": ", net.telemetry.describeRates(), pacing);
+        } else {
+            Logger::info("Network: ", net.telemetry.describe());
+            Logger::info("Network: ", net.telemetry.describeRates(), pacing);
+        }
+    }
+}
+
+// ========== LOCKSTEP ==========
+
+// Host: an input for the next tick bundle; like the clients, the host
+// applies it only once that tick begins
+static void queueLockstepInput(NetworkContext& net, int playerIdx, Direction dir)
+{
+    Lockstep::TickBundle& bundle = net.pendingBundle;
+    if (bundle.count == Lockstep::MAX_INPUTS_PER_TICK)
+        return;  // Dropped on every peer
+    bundle.inputs[bundle.count++] = Lockstep::Input{(uint8_t)playerIdx, dir};
+}
+
+// Ask the host for a lockstep_state (throttled)
+static void requestLockstepResync(GameContext& ctx, uint32_t tick)
+{
+    Uint32 now = SDL_GetTicks();
+    if (ctx.network.lastDesyncReport != 0 &&
+        now - ctx.network.lastDesyncReport < Config::Network::LOCKSTEP_RESYNC_INTERVAL_MS)
+        return;
+    
+    auto desyncMsg = JsonBuilder()
+        .set("type", "lockstep_desync")
+        .set("tick", (json_int_t)tick)
+        .build();
+    mp_api_game_take(ctx.network.api, desyncMsg, 0);
+    ctx.network.lastDesyncReport = now;
+}
+
+// Host: everything a peer needs to simulate on from the current tick. The
+// grid is rebuilt first so its free-cell order matches the clients' rebuild.
+static void sendLockstepState(GameContext& ctx)
+{
+    if (!ctx.network.api || ctx.network.sessionId.empty() || !ctx.network.isHost)
+        return;
+    
+    ctx.occupancy.rebuild(ctx.players.getSlots().data(), ctx.players.capacity());
+    
+    char rngText[17];
+    snprintf(rngText, sizeof(rngText), "%016llx", (unsigned long long)ctx.occupancy.randomState());
+    
+    JsonBuilder stateMsg;
+    stateMsg.set("type", "lockstep_state")
+        .set("tick", (json_int_t)ctx.network.lockstepTick)
+        .set("rng", rngText)
+        .set("matchStartTime", ctx.match.matchStartTime)
+        .set("elapsedMs", ctx.match.syncedElapsedMs)
+        .set("players", buildJsonPlayerStates(ctx, true));
+    if (ctx.food) {
+        stateMsg.set("foodX", ctx.food->getPosition().x);
+        stateMsg.set("foodY", ctx.food->getPosition().y);
+    }
+    
+    int result = mp_api_game_take(ctx.network.api, stateMsg.build(), 0);
+    if (result != 0) {
+        Logger::error("ERROR: Failed to send lockstep state, result=", result);
+    }
+}
+
+static void handleLockstepState(GameContext& ctx, json_t* data)
+{
+    NetworkContext& net = ctx.network;
+    if (net.isHost)
+        return;
+    
+    json_t* tickVal = json_object_get(data, "tick");
+    json_t* rngVal = json_object_get(data, "rng");
+    if (!json_is_integer(tickVal) || !json_is_string(rngVal)) {
+        Logger::warn("Malformed lockstep_state from network - ignoring");
+        return;
+    }
+    
+    WireFormat::StateSnapshot& snapshot = ctx.network.receivedSnapshot;
+    decodeJsonGameState(ctx, data, snapshot);
+    
+    if (ctx.food && isValidPosition(ctx, snapshot.food.x, snapshot.food.y)) {
+        ctx.food->setPosition(snapshot.food);
+    }
+    ctx.match.matchStartTime = snapshot.matchStartTime;
+    ctx.match.syncedElapsedMs = snapshot.elapsedMs;
+    
+    json_t* playersArray = json_object_get(data, "players");
+    for (int p = 0; p < snapshot.playerCount; p++)
+    {
+        const WireFormat::PlayerState& player = snapshot.players[p];
+        if (!ctx.players.isValid(player.index) || player.body.empty())
+            continue;
+        bool valid = std::all_of(player.body.begin(), player.body.end(), [&ctx](const Position& pos) {
+            return isValidPosition(ctx, pos.x, pos.y);
+        });
+        if (!valid) {
+            Logger::warn("Invalid snake position in lockstep_state for player ", (player.index+1));
+            continue;
+        }
+        
+        Snake& snake = *ctx.players[player.index].snake;
+        Direction current, next;
+        unpackHeading(player.heading, current, next);
+        snake.setBody(player.body.data(), player.body.size());
+        snake.setHeading(current, next);
+        snake.setAlive(player.alive);
+        snake.setScore((int)json_integer_value(json_object_get(json_array_get(playersArray, p), "score")));
+        ctx.players[player.index].remote.clear();
+    }
+    
+    // Same rebuild as the host did before sending, then its rng stream
+    ctx.occupancy.rebuild(ctx.players.getSlots().data(), ctx.players.capacity());
+    ctx.occupancy.setRandomState(strtoull(json_string_value(rngVal), nullptr, 16));
+    
+    net.lockstep = true;
+    net.lockstepTick = (uint32_t)json_integer_value(tickVal);
+    net.lockstepQueuedTick = net.lockstepTick;
+    net.receivedBundles.clear();
+    Logger::info("Lockstep state applied at tick ", net.lockstepTick);
+}
+
+static void handleLockstepTick(GameContext& ctx, json_t* data)
+{
+    NetworkContext& net = ctx.network;
+    if (net.isHost || !net.lockstep)
+        return;  // Meaningless before the first lockstep_state
+    
+    json_t* tickVal = json_object_get(data, "t");
+    if (!json_is_integer(tickVal))
+        return;
+    json_int_t tick = json_integer_value(tickVal);
+    if (tick <= (json_int_t)net.lockstepQueuedTick)
+        return;  // Covered by a newer lockstep_state
+    
+    Lockstep::TickBundle bundle;
+    bundle.clear((uint32_t)tick);
+    json_t* inputsVal = json_object_get(data, "in");
+    json_t* hashVal = json_object_get(data, "h");
+    bool valid = tick == (json_int_t)net.lockstepQueuedTick + 1 &&
+                 (!inputsVal || (json_is_string(inputsVal) &&
+                                 Lockstep::decodeInputs(json_string_value(inputsVal), bundle)));
+    if (valid && json_is_integer(hashVal)) {
+        bundle.hasHash = true;
+        bundle.hash = (uint32_t)json_integer_value(hashVal);
+    }
+    
+    // A lost or unusable tick can't be simulated past - start over from a fresh state
+    if (!valid || !net.receivedBundles.push(bundle)) {
+        Logger::warn("Lockstep tick ", tick, " out of sequence (expected ", (net.lockstepQueuedTick + 1), ")");
+        requestLockstepResync(ctx, (uint32_t)tick);
+        return;
+    }
+    net.lockstepQueuedTick = bundle.tick;
+}
+
+static void handleLockstepDesync(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    if (!ctx.network.isHost || !ctx.network.lockstep)
+        return;
+    
+    Logger::info("Lockstep desync reported by ", clientId, " at tick ",
+                 json_integer_value(json_object_get(data, "tick")), " - resyncing");
+    sendFullStateSync(ctx);
+    sendLockstepState(ctx);
+}
+
+void NetworkManager::startLockstep() {
+    NetworkContext& net = ctx->network;
+    if (!Config::Network::LOCKSTEP || !net.isHost || !isConnected())
+        return;
+    
+    // Inputs given before now are already part of the state sent below
+    net.lockstep = true;
+    net.lockstepTick = 0;
+    net.pendingBundle.clear(1);
+    sendLockstepState(*ctx);
+    Logger::info("Lockstep match started");
+}
+
+void NetworkManager::sendLockstepInput(Direction direction) {
+    NetworkContext& net = ctx->network;
+    if (net.isHost) {
+        int myIdx = ctx->players.myPlayerIndex();
+        if (ctx->players.isValid(myIdx)) {
+            queueLockstepInput(net, myIdx, direction);
+        }
+        return;
+    }
+    
+    if (!net.api || net.sessionId.empty())
+        return;
+    
+    // Takes effect when it comes back in a tick bundle
+    auto inputMsg = JsonBuilder()
+        .set("type", "player_input")
+        .set("direction", directionToString(direction))
+        .build();
+    mp_api_game_take(net.api, inputMsg, 0);
+}
+
+// Every peer hashes the state first, then applies the bundle's inputs in order
+static void applyLockstepInputs(GameContext& ctx, const Lockstep::TickBundle& bundle)
+{
+    for (int i = 0; i < bundle.count; i++) {
+        const Lockstep::Input& input = bundle.inputs[i];
+        if (ctx.players.isValid(input.player)) {
+            ctx.players[input.player].snake->setDirection(input.dir);
+        }
+    }
+}
+
+bool NetworkManager::beginLockstepTick() {
+    if (!lockstepActive())
+        return true;
+    NetworkContext& net = ctx->network;
+    
+    if (net.isHost) {
+        // {"type":"lockstep_tick","t":N[,"in":"0L2U"][,"h":H]}
+        Lockstep::TickBundle& bundle = net.pendingBundle;
+        bundle.tick = net.lockstepTick + 1;
+        bundle.hasHash = (bundle.tick % Config::Network::LOCKSTEP_HASH_INTERVAL) == 0;
+        if (bundle.hasHash) {
+            bundle.hash = Lockstep::stateHash(*ctx, net.lockstepTick);
+        }
+        
+        Lockstep::encodeInputs(bundle, snapshotText);
+        snapshotPayload.assign("{\"type\":\"lockstep_tick\",\"t\":");
+        snapshotPayload.append(std::to_string(bundle.tick));
+        if (!snapshotText.empty()) {
+            snapshotPayload.append(",\"in\":\"").append(snapshotText).append("\"");
+        }
+        if (bundle.hasHash) {
+            snapshotPayload.append(",\"h\":").append(std::to_string(bundle.hash));
+        }
+        snapshotPayload.append("}");
+        
+        // Every bundle is needed, so never replaceable
+        int result = mp_api_game_raw(net.api, snapshotPayload.data(), snapshotPayload.size(), 0);
+        if (result != 0) {
+            Logger::error("ERROR: Failed to send lockstep tick, result=", result);
+        }
+        applyLockstepInputs(*ctx, bundle);
+        net.lockstepTick = bundle.tick;
+        bundle.clear(bundle.tick + 1);
+        return true;
+    }
+    
+    if (net.receivedBundles.empty())
+        return false;
+    
+    const Lockstep::TickBundle& bundle = net.receivedBundles.front();
+    if (bundle.hasHash) {
+        uint32_t local = Lockstep::stateHash(*ctx, net.lockstepTick);
+        if (local != bundle.hash) {
+            Logger::warn("Lockstep desync before tick ", bundle.tick, " (hash ", local,
+                         ", host ", bundle.hash, ") - requesting resync");
+            requestLockstepResync(*ctx, bundle.tick);
+        }
+    }
+    applyLockstepInputs(*ctx, bundle);
+    net.lockstepTick = bundle.tick;
+    net.receivedBundles.pop();
+    return true;
+}
+
+uint32_t NetworkManager::lockstepBacklog() const {
+    if (!lockstepActive() || ctx->network.isHost)
+        return 0;
+    return ctx->network.receivedBundles.size();
+}
+
+// ========== SESSION RESUMPTION ==========
+
+// Resume messages are broadcast, so the key is published and only the
+// token behind it is kept secret until it is used
+static std::string newResumeToken()
+{
+    std::random_device rd;
+    static const char digits[] = "0123456789abcdef";
+    std::string token;
+    for (int i = 0; i < 8; i++) {
+        uint32_t word = rd();
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            token.push_back(digits[(word >> shift) & 0xF]);
+        }
+    }
+    return token;
+}
+
+// Client: right after joining, commit to a resume token by its hash
+static void sendResumeKey(NetworkContext& net)
+{
+    net.resumeToken = newResumeToken();
+    json_t* key = JsonBuilder()
+        .set("type", "resume_key")
+        .set("key", Sha256::hex(net.resumeToken))
+        .build();
+    mp_api_game_take(net.api, key, 0);
+}
+
+// Host: remember the key of the slot the sender plays in; the relay stamps
+// the sender, so nobody can set another player's key
+static void handleResumeKey(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    if (!ctx.network.isHost) return;
+    
+    int slot = ctx.players.findByClientId(clientId);
+    json_t* keyVal = json_object_get(data, "key");
+    if (slot < 0 || ctx.players[slot].disconnectedAt != 0 || !json_is_string(keyVal)) return;
+    ctx.players[slot].resumeKey = json_string_value(keyVal);
+}
+
+// Host: a client that rejoined after a drop names its old clientId and
+// shows the token whose hash it sent when it joined
+static void handleResume(GameContext& ctx, const std::string& clientId, json_t* data)
+{
+    if (!ctx.network.isHost) return;
+    
+    json_t* fromVal = json_object_get(data, "from");
+    json_t* tokenVal = json_object_get(data, "token");
+    json_t* keyVal = json_object_get(data, "key");
+    std::string from = json_is_string(fromVal) ? json_string_value(fromVal) : "";
+    int slot = from.empty() ? -1 : ctx.players.findByClientId(from);
+    bool held = slot >= 0 && ctx.players[slot].disconnectedAt != 0;
+    bool proven = held && !ctx.players[slot].resumeKey.empty() && json_is_string(tokenVal) &&
+                  Sha256::hex(json_string_value(tokenVal)) == ctx.players[slot].resumeKey;
+    if (proven) {
+        // Drop the snake its join just got, then hand it the held one
+        remove_player(ctx, clientId);
+        ctx.players.activate(slot, clientId);
+        ctx.players[slot].disconnectedAt = 0;
+        ctx.players[slot].resumeKey = json_is_string(keyVal) ? json_string_value(keyVal) : "";
+        json_t* seqVal = json_object_get(data, "seq");
+        ctx.players[slot].ackedSnapshot = json_is_integer(seqVal) ? (uint32_t)json_integer_value(seqVal) : 0;
+        ctx.network.broadcast.removeClient(slot);
+        Logger::info("Player ", (slot+1), " resumed as ", clientId);
+    } else {
+        slot = ctx.players.findByClientId(clientId);
+        if (held) {
+            Logger::warn("Resume of ", from, " by ", clientId, " refused: wrong token");
+        } else {
+            Logger::info("Resume of ", from, " came too late, ", clientId, " plays on as a new player");
+        }
+        // Its key went to the old slot; the new one still needs a key
+        if (slot >= 0 && json_is_string(keyVal)) {
+            ctx.players[slot].resumeKey = json_string_value(keyVal);
+        }
+    }
+    if (slot < 0) return;
+    
+    // Everyone, the resumed client included, learns which slot the new id has
+    json_t* resumed = JsonBuilder()
+        .set("type", "resumed")
+        .set("from", from)
+        .set("to", clientId)
+        .set("slot", slot)
+        .build();
+    mp_api_game_take(ctx.network.api, resumed, 0);
+    
+    ctx.network.forceKeyframe = true;
+    ctx.network.broadcast.mark(BroadcastScheduler::URGENT);
+    if (ctx.network.lockstep) {
+        sendLockstepState(ctx);
+    }
+}
+
+// Clients: move a resumed player's new clientId into the host's slot
+static void handleResumed(GameContext& ctx, json_t* data)
+{
+    if (ctx.network.isHost) return;
+    
+    json_t* fromVal = json_object_get(data, "from");
+    json_t* toVal = json_object_get(data, "to");
+    json_t* slotVal = json_object_get(data, "slot");
+    if (!json_is_string(toVal) || !json_is_integer(slotVal)) return;
+    std::string from = json_is_string(fromVal) ? json_string_value(fromVal) : "";
+    std::string to = json_string_value(toVal);
+    int slot = (int)json_integer_value(slotVal);
+    if (slot < 0 || slot >= ctx.players.capacity()) return;
+    
+    // Either id may sit in another slot here (held, or added by a roster)
+    int stale = from.empty() ? -1 : ctx.players.findByClientId(from);
+    if (stale >= 0 && stale != slot) remove_player(ctx, from);
+    int fresh = ctx.players.findByClientId(to);
+    if (fresh >= 0 && fresh != slot) remove_player(ctx, to);
+    
+    if (ctx.players[slot].active) {
+        ctx.players.activate(slot, to);
+        ctx.players[slot].disconnectedAt = 0;
+    } else {
+        add_player(ctx, to, slot);  // Placed by the next game_state
+    }
+    
+    if (to == ctx.network.myClientId) {
+        ctx.players.setMyPlayerIndex(slot);
+        ctx.network.resumeFrom.clear();
+        Logger::info("Resumed as player ", (slot+1));
+    }
+}
+
+// A player quitting on purpose: no resume will come, free the slot now
+static void handlePlayerLeaving(GameContext& ctx, const std::string& clientId)
+{
+    int i = ctx.players.findByClientId(clientId);
+    if (i < 0) return;
+    Logger::info("Player ", (i+1), " left the session");
+    remove_player(ctx, clientId);
+    
+    if (ctx.network.isHost && ctx.network.lockstep) {
+        sendLockstepState(ctx);
+    }
+}
+
+// Players that left and didn't resume within the grace period, or before
+// the match ended
+static void expireDisconnectedPlayers(GameContext& ctx)
+{
+    Uint32 now = SDL_GetTicks();
+    std::vector<std::string> expired;
+    for (int i : ctx.players.activeIndices()) {
+        Uint32 since = ctx.players[i].disconnectedAt;
+        if (since != 0 && (!ctx.network.matchRunning || now - since >= Config::Network::RESUME_GRACE_MS)) {
+            expired.push_back(ctx.players[i].clientId);
+        }
+    }
+    for (const std::string& clientId : expired) {
+        remove_player(ctx, clientId);
+    }
+    if (!expired.empty() && ctx.network.isHost && ctx.network.lockstep) {
+        sendLockstepState(ctx);
+    }
+}
@@ -0,0 +1,178 @@
+#include "nettelemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+NetTelemetry::NetTelemetry()
+    : queueHighWater(0), queueIntervalPeak(0)
+{
+    reset();
+}
+
+NetTelemetry::Kind NetTelemetry::classify(const char* gameType)
+{
+    if (!gameType) return Kind::OTHER;
+    if (strcmp(gameType, "game_state") == 0) return Kind::GAME_STATE;
+    if (strcmp(gameType, "player_input") == 0) return Kind::PLAYER_INPUT;
+    if (strcmp(gameType, "time_sync") == 0) return Kind::TIME_SYNC;
+    if (strcmp(gameType, "state_sync") == 0) return Kind::STATE_SYNC;
+    if (strcmp(gameType, "ping") == 0 || strcmp(gameType, "pong") == 0) return Kind::PING;
+    return Kind::OTHER;
+}
+
+const char* NetTelemetry::kindName(Kind kind)
+{
+    switch (kind) {
+        case Kind::STATE_SYNC: return "state_sync";
+        case Kind::GAME_STATE: return "game_state";
+        case Kind::TIME_SYNC: return "time_sync";
+        case Kind::PLAYER_INPUT: return "player_input";
+        case Kind::PING: return "ping";
+        default: return "other";
+    }
+}
+
+uint64_t NetTelemetry::nowMicros()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void NetTelemetry::trafficHook(int outgoing, const char* cmd, const char* type, size_t bytes, void* user_data)
+{
+    // Only game messages carry a type; host/join/list and joined/leaved count as other
+    Kind kind = (cmd && strcmp(cmd, "game") == 0) ? classify(type) : Kind::OTHER;
+    static_cast<NetTelemetry*>(user_data)->recordTraffic(outgoing ? OUT : IN, kind, bytes);
+}
+
+void NetTelemetry::recordTraffic(Direction dir, Kind kind, size_t bytes)
+{
+    Counter& c = counters[dir][(size_t)kind];
+    c.messages.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+static void raiseTo(std::atomic<size_t>& peak, size_t value)
+{
+    size_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+void NetTelemetry::recordQueueDepth(size_t depth)
+{
+    raiseTo(queueHighWater, depth);
+    raiseTo(queueIntervalPeak, depth);
+}
+
+void NetTelemetry::recordDispatch(uint64_t queuedAtMicros)
+{
+    uint64_t now = nowMicros();
+    uint64_t delay = now > queuedAtMicros ? now - queuedAtMicros : 0;
+    dispatchCount++;
+    dispatchTotalMicros += delay;
+    if (delay > dispatchMaxMicros) dispatchMaxMicros = delay;
+}
+
+void NetTelemetry::recordRtt(uint32_t rttMs)
+{
+    // Same smoothing as TCP's SRTT (RFC 6298), seeded by the first sample
+    current.rttSmoothedMs = current.rttMs == 0 ? (float)rttMs
+                                               : current.rttSmoothedMs + ((float)rttMs - current.rttSmoothedMs) / 8.0f;
+    current.rttMs = rttMs > 0 ? rttMs : 1;
+    if (rttMs > current.rttMaxMs) current.rttMaxMs = rttMs;
+}
+
+void NetTelemetry::sample(uint32_t nowMs)
+{
+    // The first call after reset() only starts the interval
+    if (lastSampleMs == 0) {
+        lastSampleMs = nowMs ? nowMs : 1;
+        return;
+    }
+    float seconds = (float)(nowMs - lastSampleMs) / 1000.0f;
+    if (seconds <= 0.0f) return;
+    lastSampleMs = nowMs;
+
+    for (size_t dir = 0; dir < 2; dir++) {
+        for (size_t kind = 0; kind < KIND_COUNT; kind++) {
+            uint64_t messages = counters[dir][kind].messages.load(std::memory_order_relaxed);
+            uint64_t bytes = counters[dir][kind].bytes.load(std::memory_order_relaxed);
+            Report::Traffic& t = current.traffic[dir][kind];
+            t.messages = messages;
+            t.bytes = bytes;
+            t.messagesPerSec = (float)(messages - lastMessages[dir][kind]) / seconds;
+            t.kbPerSec = (float)(bytes - lastBytes[dir][kind]) / 1024.0f / seconds;
+            lastMessages[dir][kind] = messages;
+            lastBytes[dir][kind] = bytes;
+        }
+    }
+
+    current.queueHighWater = queueHighWater.load(std::memory_order_relaxed);
+    current.queueIntervalPeak = queueIntervalPeak.exchange(0, std::memory_order_relaxed);
+
+    current.dispatchAvgMs = dispatchCount > 0 ? (float)dispatchTotalMicros / (float)dispatchCount / 1000.0f : 0.0f;
+    current.dispatchMaxMs = (float)dispatchMaxMicros / 1000.0f;
+    dispatchCount = 0;
+    dispatchTotalMicros = 0;
+    dispatchMaxMicros = 0;
+}
+
+std::string NetTelemetry::describe() const
+{
+    const Report& r = current;
+    float inKb = 0.0f, outKb = 0.0f;
+    for (size_t kind = 0; kind < KIND_COUNT; kind++) {
+        inKb += r.traffic[IN][kind].kbPerSec;
+        outKb += r.traffic[OUT][kind].kbPerSec;
+    }
+
+    char text[512];
+    int len = snprintf(text, sizeof(text),
+                       "rtt %u ms (avg %.0f, max %u), dispatch avg %.2f max %.2f ms, queue peak %zu (max %zu),"
+                       " in %.1f KB/s, out %.1f KB/s",
+                       r.rttMs, r.rttSmoothedMs, r.rttMaxMs, r.dispatchAvgMs, r.dispatchMaxMs,
+                       r.queueIntervalPeak, r.queueHighWater, inKb, outKb);
+    return std::string(text, len > 0 ? std::min((size_t)len, sizeof(text) - 1) : 0);
+}
+
+std::string NetTelemetry::describeRates() const
+{
+    const Report& r = current;
+    std::string out = "msg/s in/out";
+    char text[64];
+    const char* separator = ": ";
+    for (size_t kind = 0; kind < KIND_COUNT; kind++) {
+        const Report::Traffic& in = r.traffic[IN][kind];
+        const Report::Traffic& sent = r.traffic[OUT][kind];
+        if (in.messages == 0 && sent.messages == 0) continue;
+        snprintf(text, sizeof(text), "%s%s %.1f/%.1f", separator, kindName((Kind)kind),
+                 in.messagesPerSec, sent.messagesPerSec);
+        out += text;
+        separator = ", ";
+    }
+    return out;
+}
+
+void NetTelemetry::reset()
+{
+    for (auto& direction : counters) {
+        for (Counter& c : direction) {
+            c.messages.store(0, std::memory_order_relaxed);
+            c.bytes.store(0, std::memory_order_relaxed);
+        }
+    }
+    queueHighWater.store(0, std::memory_order_relaxed);
+    queueIntervalPeak.store(0, std::memory_order_relaxed);
+
+    dispatchCount = 0;
+    dispatchTotalMicros = 0;
+    dispatchMaxMicros = 0;
+    for (size_t dir = 0; dir < 2; dir++) {
+        lastMessages[dir].fill(0);
+        lastBytes[dir].fill(0);
+    }
+    lastSampleMs = 0;
+    current = Report();
+}
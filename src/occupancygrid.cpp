@@ -0,0 +1,128 @@
+#include "occupancygrid.h"
+#include <chrono>
+
+OccupancyGrid::OccupancyGrid(int width, int height)
+    : width(width), height(height), cells(width * height, EMPTY),
+      freeCells(width * height), spawnAnchors(width * height), clears(0),
+      rng((uint64_t)std::chrono::steady_clock::now().time_since_epoch().count())
+{
+    clear();
+}
+
+void OccupancyGrid::resize(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    cells.assign(width * height, EMPTY);
+    freeCells.resize(width * height);
+    spawnAnchors.resize(width * height);
+    clear();
+}
+
+void OccupancyGrid::occupy(const Position& p, int playerIndex)
+{
+    if (!inBounds(p)) return;
+    uint8_t& cell = cells[index(p)];
+    bool wasEmpty = (cell == EMPTY);
+    cell = (uint8_t)(playerIndex + 1);
+    if (wasEmpty) {
+        onCellTaken(p);
+    }
+}
+
+void OccupancyGrid::release(const Position& p, int playerIndex)
+{
+    if (!inBounds(p)) return;
+    uint8_t& cell = cells[index(p)];
+    if (cell == (uint8_t)(playerIndex + 1)) {
+        cell = EMPTY;
+        onCellFreed(p);
+    }
+}
+
+void OccupancyGrid::occupyBody(const Snake& snake, int playerIndex)
+{
+    for (const auto& segment : snake.getBody()) {
+        occupy(segment, playerIndex);
+    }
+}
+
+void OccupancyGrid::releaseBody(const Snake& snake, int playerIndex)
+{
+    for (const auto& segment : snake.getBody()) {
+        release(segment, playerIndex);
+    }
+}
+
+void OccupancyGrid::clear()
+{
+    clears++;
+    std::fill(cells.begin(), cells.end(), EMPTY);
+    freeCells.clear();
+    spawnAnchors.clear();
+    for (int cell = 0; cell < width * height; cell++) {
+        freeCells.insert(cell);
+        if (cell % width >= SPAWN_LENGTH - 1) {
+            spawnAnchors.insert(cell);
+        }
+    }
+}
+
+void OccupancyGrid::rebuild(const PlayerSlot* slots, int slotCount)
+{
+    clear();
+    for (int i = 0; i < slotCount; i++) {
+        if (slots[i].active && slots[i].snake) {
+            occupyBody(*slots[i].snake, i);
+        }
+    }
+}
+
+bool OccupancyGrid::randomFreeCell(Position& out) const
+{
+    if (freeCells.empty()) return false;
+    out = positionOf(freeCells.at((int)rng.below((uint32_t)freeCells.size())));
+    return true;
+}
+
+bool OccupancyGrid::randomSpawnAnchor(Position& out) const
+{
+    if (spawnAnchors.empty()) return false;
+    out = positionOf(spawnAnchors.at((int)rng.below((uint32_t)spawnAnchors.size())));
+    return true;
+}
+
+bool OccupancyGrid::isAnchor(int x, int y) const
+{
+    if (x < SPAWN_LENGTH - 1 || x >= width) return false;
+    const uint8_t* row = &cells[y * width];
+    for (int k = 0; k < SPAWN_LENGTH; k++) {
+        if (row[x - k] != EMPTY) return false;
+    }
+    return true;
+}
+
+// A cell belongs to the anchor windows of itself and the next
+// SPAWN_LENGTH-1 cells to the right, so only those need re-evaluating.
+
+void OccupancyGrid::onCellTaken(const Position& p)
+{
+    freeCells.erase(index(p));
+    for (int k = 0; k < SPAWN_LENGTH; k++) {
+        int x = p.x + k;
+        if (x >= width) break;
+        spawnAnchors.erase(p.y * width + x);
+    }
+}
+
+void OccupancyGrid::onCellFreed(const Position& p)
+{
+    freeCells.insert(index(p));
+    for (int k = 0; k < SPAWN_LENGTH; k++) {
+        int x = p.x + k;
+        if (x >= width) break;
+        if (isAnchor(x, p.y)) {
+            spawnAnchors.insert(p.y * width + x);
+        }
+    }
+}
@@ -0,0 +1,165 @@
+#include "profiler.h"
+#include <chrono>
+#include <cstdio>
+
+// ========== HISTOGRAM ==========
+
+Profiler::Histogram::Histogram()
+{
+    clear();
+}
+
+void Profiler::Histogram::clear()
+{
+    buckets.fill(0);
+    samples = 0;
+    total = 0;
+    max = 0;
+}
+
+int Profiler::Histogram::bucketFor(uint64_t micros)
+{
+    if (micros < 8) return (int)micros;
+    int exponent = 63 - __builtin_clzll(micros);  // >= 3
+    int sub = (int)(micros >> (exponent - 2)) & (SUB_BUCKETS - 1);
+    int bucket = 8 + (exponent - 3) * SUB_BUCKETS + sub;
+    return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint64_t Profiler::Histogram::bucketUpperBound(int bucket)
+{
+    if (bucket < 8) return (uint64_t)bucket;
+    int exponent = 3 + (bucket - 8) / SUB_BUCKETS;
+    uint64_t sub = (uint64_t)((bucket - 8) % SUB_BUCKETS);
+    return ((SUB_BUCKETS + sub + 1) << (exponent - 2)) - 1;
+}
+
+void Profiler::Histogram::record(uint64_t micros)
+{
+    buckets[bucketFor(micros)]++;
+    samples++;
+    total += micros;
+    if (micros > max) max = micros;
+}
+
+uint64_t Profiler::Histogram::percentileMicros(double fraction) const
+{
+    if (samples == 0) return 0;
+    uint64_t rank = (uint64_t)(fraction * (double)samples);
+    if (rank >= samples) rank = samples - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t bound = bucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+// ========== PROFILER ==========
+
+Profiler::Profiler()
+    : enabled(false), epochMicros(0), framesRecorded(0), traceRecorded(0)
+{
+    frameHistory.fill(0.0f);
+}
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+const char* Profiler::phaseName(Phase phase)
+{
+    switch (phase) {
+        case Phase::FRAME: return "frame";
+        case Phase::HANDLE_INPUT: return "handleInput";
+        case Phase::PROCESS_MESSAGES: return "processMessages";
+        case Phase::UPDATE_PLAYERS: return "updatePlayers";
+        case Phase::COLLISIONS: return "collisions";
+        case Phase::BROADCAST: return "flushBroadcast";
+        case Phase::RENDER: return "render";
+        case Phase::PRESENT: return "present";
+        default: return "unknown";
+    }
+}
+
+uint64_t Profiler::nowMicros()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::enable()
+{
+    if (enabled) return;
+    trace.resize(TRACE_CAPACITY);
+    epochMicros = nowMicros();
+    enabled = true;
+}
+
+void Profiler::record(Phase phase, uint64_t startMicros, uint64_t endMicros)
+{
+    uint64_t duration = endMicros - startMicros;
+    histograms[(size_t)phase].record(duration);
+
+    if (phase == Phase::FRAME) {
+        frameHistory[framesRecorded % HISTORY_FRAMES] = (float)duration / 1000.0f;
+        framesRecorded++;
+    }
+
+    TraceEvent& event = trace[traceRecorded % TRACE_CAPACITY];
+    event.startMicros = startMicros - epochMicros;
+    event.durationMicros = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    event.phase = phase;
+    traceRecorded++;
+}
+
+size_t Profiler::frameHistorySize() const
+{
+    return framesRecorded < HISTORY_FRAMES ? framesRecorded : HISTORY_FRAMES;
+}
+
+float Profiler::frameHistoryMs(size_t index) const
+{
+    size_t oldest = framesRecorded - frameHistorySize();
+    return frameHistory[(oldest + index) % HISTORY_FRAMES];
+}
+
+bool Profiler::writeCsv(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "phase,count,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        const Histogram& h = histograms[i];
+        fprintf(file, "%s,%llu,%.1f,%llu,%llu,%llu,%llu,%llu\n", phaseName((Phase)i),
+                (unsigned long long)h.count(), h.meanMicros(),
+                (unsigned long long)h.percentileMicros(0.50), (unsigned long long)h.percentileMicros(0.90),
+                (unsigned long long)h.percentileMicros(0.99), (unsigned long long)h.percentileMicros(0.999),
+                (unsigned long long)h.maxMicros());
+    }
+    return fclose(file) == 0;
+}
+
+bool Profiler::writeChromeTrace(const char* path) const
+{
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    // Complete ("X") events, oldest first; nesting comes from the timestamps
+    size_t count = traceRecorded < TRACE_CAPACITY ? traceRecorded : TRACE_CAPACITY;
+    size_t first = traceRecorded - count;
+    fprintf(file, "{\"traceEvents\":[");
+    for (size_t i = 0; i < count; i++) {
+        const TraceEvent& event = trace[(first + i) % TRACE_CAPACITY];
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%u,\"pid\":1,\"tid\":1}",
+                i ? "," : "", phaseName(event.phase), (unsigned long long)event.startMicros, event.durationMicros);
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file) == 0;
+}
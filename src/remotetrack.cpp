@@ -0,0 +1,148 @@
+#include "remotetrack.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+RemoteTrack::RemoteTrack()
+    : samples(), count(0), prevTail{0, 0}, alpha(1.0f), hasDisplay(false)
+{
+}
+
+void RemoteTrack::clear()
+{
+    count = 0;
+    hasDisplay = false;
+}
+
+void RemoteTrack::push(int64_t messageId, uint32_t hostTimeMs, const std::vector<Position>& body, bool alive)
+{
+    if (body.empty()) return;
+
+    // Newer message with an earlier match time: the host restarted the match
+    if (count > 0 && messageId > samples[count - 1].messageId &&
+        hostTimeMs < samples[count - 1].hostTimeMs) {
+        clear();
+    }
+
+    int pos = 0;
+    while (pos < count && samples[pos].messageId < messageId) pos++;
+    if (pos < count && samples[pos].messageId == messageId) return;  // Duplicate
+    if (count == CAPACITY) {
+        if (pos == 0) return;  // Older than everything we keep
+        std::rotate(samples.begin(), samples.begin() + 1, samples.begin() + count);
+        count--;
+        pos--;
+    }
+
+    // Open a slot at pos, reusing the storage of the one past the end
+    std::rotate(samples.begin() + pos, samples.begin() + count, samples.begin() + count + 1);
+    count++;
+
+    Sample& sample = samples[pos];
+    sample.messageId = messageId;
+    sample.hostTimeMs = hostTimeMs;
+    sample.alive = alive;
+    sample.body.assign(body.begin(), body.end());
+}
+
+void RemoteTrack::show(const std::vector<Position>& body)
+{
+    display.assign(body.begin(), body.end());
+    prevTail = display.back();
+    alpha = 1.0f;
+}
+
+void RemoteTrack::walk(size_t advance, float progress, size_t startLength, const std::vector<Position>* endBody)
+{
+    progress = std::min(std::max(progress, 0.0f), (float)advance);
+    size_t whole = (size_t)progress;
+    size_t steps = std::min(whole + 1, advance);  // Cells entered by the displayed body
+    size_t start = advance - steps;
+
+    if (steps == advance && endBody) {
+        display.assign(endBody->begin(), endBody->end());
+    } else {
+        size_t end = std::min(start + startLength, path.size());
+        display.assign(path.begin() + start, path.begin() + end);
+    }
+    size_t behind = start + display.size();
+    prevTail = behind < path.size() ? path[behind] : display.back();
+
+    // The renderer slides the head in from display[1] and the tail out of prevTail
+    alpha = (whole < advance) ? progress - (float)whole : 1.0f;
+}
+
+bool RemoteTrack::sample(int64_t renderTimeMs, uint32_t tickMs, uint32_t maxExtrapolationMs,
+                         int gridWidth, int gridHeight)
+{
+    hasDisplay = false;
+    if (count == 0 || !samples[count - 1].alive) return false;
+
+    int next = 0;
+    while (next < count && (int64_t)samples[next].hostTimeMs <= renderTimeMs) next++;
+
+    if (next == 0) {
+        // Older than anything buffered - hold the oldest
+        show(samples[0].body);
+    }
+    else if (next == count) {
+        // Past the newest snapshot - keep going along its heading for a while,
+        // if its head moved since the snapshot before (not paused or idle)
+        const Sample& last = samples[count - 1];
+        int64_t ahead = std::min<int64_t>(renderTimeMs - last.hostTimeMs, maxExtrapolationMs);
+        Position step{0, 0};
+        if (count >= 2 && last.body.size() >= 2 && !(samples[count - 2].body.front() == last.body.front())) {
+            step = Position{last.body[0].x - last.body[1].x, last.body[0].y - last.body[1].y};
+        }
+        bool moving = std::abs(step.x) + std::abs(step.y) == 1;
+        if (tickMs == 0 || !moving || ahead <= 0) {
+            show(last.body);
+        } else {
+            float cells = (float)ahead / (float)tickMs;
+            size_t wanted = std::min((size_t)std::ceil(cells), MAX_ADVANCE);
+            size_t advance = 0;
+            Position head = last.body.front();
+            path.clear();
+            while (advance < wanted) {
+                Position cell{head.x + step.x * (int)(advance + 1), head.y + step.y * (int)(advance + 1)};
+                if (cell.x < 0 || cell.y < 0 || cell.x >= gridWidth || cell.y >= gridHeight) break;
+                path.push_back(cell);
+                advance++;
+            }
+            std::reverse(path.begin(), path.end());
+            path.insert(path.end(), last.body.begin(), last.body.end());
+            walk(advance, std::min(cells, (float)advance), last.body.size(), nullptr);
+        }
+    }
+    else {
+        const Sample& from = samples[next - 1];
+        const Sample& to = samples[next];
+        float u = (to.hostTimeMs > from.hostTimeMs)
+            ? (float)(renderTimeMs - from.hostTimeMs) / (float)(to.hostTimeMs - from.hostTimeMs)
+            : 1.0f;
+
+        // `to` should be the cells entered since `from`, followed by `from`
+        size_t advance = 0;
+        size_t limit = std::min(to.body.size() - 1, MAX_ADVANCE);
+        bool found = false;
+        for (; advance <= limit; advance++) {
+            if (to.body[advance] == from.body[0] &&
+                (from.body.size() < 2 || advance + 1 >= to.body.size() || to.body[advance + 1] == from.body[1])) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!from.alive || !found) {
+            // Respawn or reversal - no path between them, switch over at `to`
+            show(from.body);
+        } else {
+            path.assign(to.body.begin(), to.body.begin() + advance);
+            path.insert(path.end(), from.body.begin(), from.body.end());
+            walk(advance, u * (float)advance, from.body.size(), &to.body);
+        }
+    }
+
+    hasDisplay = !display.empty();
+    return hasDisplay;
+}
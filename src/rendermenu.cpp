@@ -2,17 +2,44 @@
 #include "multiplayer.h"
 #include "config.h"
 #include "logger.h"
-#include <sstream>
 #include <iomanip>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 
 std::atomic<bool> MenuRender::sdlInitialized(false);
 std::mutex MenuRender::sdlInitMutex;
 
+// FNV-1a, for the screen and text cache keys
+static constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t len)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashValue(uint64_t hash, uint64_t value)
+{
+    return hashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t hashString(uint64_t hash, const std::string& text)
+{
+    return hashValue(hashBytes(hash, text.data(), text.size()), text.size());
+}
+
 MenuRender::MenuRender()
-    : window(nullptr), renderer(nullptr), font(nullptr), titleFont(nullptr)
+    : window(nullptr), renderer(nullptr), font(nullptr), titleFont(nullptr),
+      fontsLoaded(false), fontsPending(false), loadedFont(nullptr), loadedTitleFont(nullptr),
+      screenTargetsFailed(false), backgroundTexture(nullptr), backgroundDirty(true),
+      gridWidth(Config::Grid::WIDTH), gridHeight(Config::Grid::HEIGHT), cellSize(Config::Grid::CELL_SIZE)
 {
+    Uint32 started = SDL_GetTicks();
+    
     // Initialize SDL subsystems (thread-safe, safe to call multiple times)
     if (!sdlInitialized.load()) {
         std::lock_guard<std::mutex> lock(sdlInitMutex);
@@ -31,6 +58,7 @@ MenuRender::MenuRender()
             sdlInitialized.store(true);
         }
     }
+    Uint32 initialized = SDL_GetTicks();
     
     window = SDL_CreateWindow(
         "Hardcore Snake",
@@ -48,7 +76,11 @@ MenuRender::MenuRender()
         throw std::runtime_error("Window creation failed");
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (Config::Render::VSYNC) {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    renderer = SDL_CreateRenderer(window, -1, rendererFlags);
     if (!renderer) {
         Logger::error("Renderer creation failed: ", SDL_GetError());
         SDL_DestroyWindow(window);
@@ -58,26 +90,71 @@ MenuRender::MenuRender()
     }
     
     SDL_RenderSetLogicalSize(renderer, Config::Window::WIDTH, Config::Window::HEIGHT);
+    Logger::info("Startup: SDL init ", initialized - started, " ms, window and renderer ",
+                 SDL_GetTicks() - initialized, " ms");
+    
+    screens.fill(CachedScreen{nullptr, 0, false});
+    fontsPending = true;
+    fontLoader = std::thread(&MenuRender::loadFonts, this);
+}
 
-    font = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 24);
-    titleFont = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf", 36);
+// Font loader thread: touches only the fonts it opens and the atlases,
+// which the render thread leaves alone until fontsLoaded
+void MenuRender::loadFonts()
+{
+    Uint32 started = SDL_GetTicks();
+    TTF_Font* text = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 24);
+    TTF_Font* title = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans-Bold.ttf", 36);
     
-    if (!font) {
+    if (!text) {
         Logger::error("Font load failed: ", TTF_GetError());
-        font = nullptr;
     }
-    if (!titleFont) titleFont = font;
+    if (!title) title = text;
+    Uint32 opened = SDL_GetTicks();
+    
+    textAtlas.rasterize(text);
+    if (title && title != text) {
+        titleAtlas.rasterize(title);
+    }
+    Logger::info("Startup: fonts opened in ", opened - started, " ms, glyph atlases rasterized in ",
+                 SDL_GetTicks() - opened, " ms (background)");
+    
+    loadedFont = text;
+    loadedTitleFont = title;
+    fontsLoaded.store(true, std::memory_order_release);
+}
+
+void MenuRender::adoptFonts()
+{
+    if (!fontsPending || !fontsLoaded.load(std::memory_order_acquire)) return;
+    
+    fontLoader.join();
+    fontsPending = false;
+    font = loadedFont;
+    titleFont = loadedTitleFont;
+    textAtlas.upload(renderer);
+    if (titleFont && titleFont != font) {
+        titleAtlas.upload(renderer);
+    }
+    // Screens cached so far went without text
+    invalidateRenderCaches();
 }
 
 MenuRender::~MenuRender()
 {
-    // Clean up all cached textures
-    for (auto& pair : textureCache) {
-        if (pair.second) {
-            SDL_DestroyTexture(pair.second);
-        }
+    if (fontLoader.joinable()) {
+        fontLoader.join();
+        font = loadedFont;
+        titleFont = loadedTitleFont;
     }
-    textureCache.clear();
+    
+    // Clean up all cached textures
+    clearTextCache();
+    releaseScreens();
+    
+    if (backgroundTexture) SDL_DestroyTexture(backgroundTexture);
+    textAtlas.release();
+    titleAtlas.release();
     
     // Cleanup SDL resources
     if (font) TTF_CloseFont(font);
@@ -94,38 +171,231 @@ MenuRender::~MenuRender()
 
 void MenuRender::clearScreen()
 {
+    adoptFonts();
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 }
 
-void MenuRender::renderPlayers(const std::array<PlayerSlot, Config::Game::MAX_PLAYERS>& players)
+// Background color plus 1px grid lines in the gaps between cells
+void MenuRender::drawPlayfield()
+{
+    const SDL_Color& bg = Config::Render::BACKGROUND_COLOR;
+    SDL_SetRenderDrawColor(renderer, bg.r, bg.g, bg.b, bg.a);
+    SDL_RenderClear(renderer);
+    
+    // Lines span the board only; cells too small for a gap just get the border
+    const int cell = cellSize;
+    const int boardWidth = gridWidth * cell;
+    const int boardHeight = gridHeight * cell;
+    rectBatch.clear();
+    if (cell >= 4) {
+        for (int x = 0; x < gridWidth; x++) {
+            rectBatch.push_back(SDL_Rect{x * cell + cell - 1, 0, 1, boardHeight});
+        }
+        for (int y = 0; y < gridHeight; y++) {
+            rectBatch.push_back(SDL_Rect{0, y * cell + cell - 1, boardWidth, 1});
+        }
+    } else {
+        rectBatch.push_back(SDL_Rect{boardWidth, 0, 1, boardHeight});
+        rectBatch.push_back(SDL_Rect{0, boardHeight, boardWidth, 1});
+    }
+    const SDL_Color& line = Config::Render::GRID_LINE_COLOR;
+    SDL_SetRenderDrawColor(renderer, line.r, line.g, line.b, line.a);
+    SDL_RenderFillRects(renderer, rectBatch.data(), (int)rectBatch.size());
+}
+
+void MenuRender::renderBackground()
+{
+    if (!backgroundTexture && backgroundDirty && SDL_RenderTargetSupported(renderer)) {
+        backgroundTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                              Config::Window::WIDTH, Config::Window::HEIGHT);
+        if (!backgroundTexture) {
+            Logger::warn("Background texture unavailable, drawing grid every frame: ", SDL_GetError());
+        }
+    }
+    
+    // No render targets - draw it directly
+    if (!backgroundTexture) {
+        drawPlayfield();
+        backgroundDirty = false;
+        return;
+    }
+    
+    if (backgroundDirty) {
+        SDL_SetRenderTarget(renderer, backgroundTexture);
+        drawPlayfield();
+        SDL_SetRenderTarget(renderer, nullptr);
+        backgroundDirty = false;
+    }
+    SDL_RenderCopy(renderer, backgroundTexture, nullptr, nullptr);
+}
+
+void MenuRender::invalidateRenderCaches(bool texturesLost)
 {
-    for (int p = 0; p < Config::Game::MAX_PLAYERS; p++)
+    backgroundDirty = true;
+    for (CachedScreen& screen : screens) {
+        screen.valid = false;
+    }
+    if (!texturesLost) return;
+    
+    if (backgroundTexture) {
+        SDL_DestroyTexture(backgroundTexture);
+        backgroundTexture = nullptr;
+    }
+    releaseScreens();
+    clearTextCache();
+    buildGlyphAtlases();
+}
+
+void MenuRender::releaseScreens()
+{
+    for (CachedScreen& screen : screens) {
+        if (screen.texture) SDL_DestroyTexture(screen.texture);
+        screen = CachedScreen{nullptr, 0, false};
+    }
+}
+
+template <typename Draw>
+void MenuRender::drawScreen(ScreenId id, uint64_t inputs, bool overlay, Draw draw)
+{
+    CachedScreen& screen = screens[id];
+    if (!screen.texture && !screenTargetsFailed && SDL_RenderTargetSupported(renderer)) {
+        screen.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                           Config::Window::WIDTH, Config::Window::HEIGHT);
+        if (screen.texture) {
+            SDL_SetTextureBlendMode(screen.texture, overlay ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+        } else {
+            Logger::warn("Screen cache unavailable, drawing menus every frame: ", SDL_GetError());
+            screenTargetsFailed = true;
+        }
+        screen.valid = false;
+    }
+    
+    // No render targets - draw it directly
+    if (!screen.texture) {
+        draw();
+        return;
+    }
+    
+    if (!screen.valid || screen.inputs != inputs) {
+        SDL_SetRenderTarget(renderer, screen.texture);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, overlay ? 0 : 255);
+        SDL_RenderClear(renderer);
+        draw();
+        SDL_SetRenderTarget(renderer, nullptr);
+        screen.inputs = inputs;
+        screen.valid = true;
+    }
+    SDL_RenderCopy(renderer, screen.texture, nullptr, nullptr);
+}
+
+void MenuRender::setGridLayout(int width, int height)
+{
+    if (width == gridWidth && height == gridHeight) return;
+    gridWidth = width;
+    gridHeight = height;
+    cellSize = std::max(2, std::min(Config::Window::WIDTH / width, Config::Window::HEIGHT / height));
+    backgroundDirty = true;
+}
+
+// Cell rect at a fractional grid position between two cells
+static SDL_Rect lerpCellRect(const Position& from, const Position& to, float alpha, int cell)
+{
+    float x = from.x + (to.x - from.x) * alpha;
+    float y = from.y + (to.y - from.y) * alpha;
+    return SDL_Rect{
+        (int)(x * cell + 0.5f),
+        (int)(y * cell + 0.5f),
+        cell - 1,
+        cell - 1
+    };
+}
+
+static SDL_Rect cellRect(const Position& p, int cell)
+{
+    return SDL_Rect{
+        p.x * cell,
+        p.y * cell,
+        cell - 1,
+        cell - 1
+    };
+}
+
+void MenuRender::renderPlayers(const PlayerManager& players, float alpha)
+{
+    // One FillRects call per snake body, heads collected and drawn last
+    headBatch.clear();
+    
+    for (int p : players.activeIndices())
     {
-        if (!players[p].active || !players[p].snake) continue;
+        if (!players[p].snake) continue;
         
-        const auto& body = players[p].snake->getBody();
-        SDL_Color color = players[p].snake->getColor();
+        const Snake& snake = *players[p].snake;
+        const auto& body = snake.getBody();
+        if (body.empty()) continue;
+        SDL_Color color = snake.getColor();
         
-        for (size_t i = 0; i < body.size(); i++)
+        // Between ticks the head slides in from the neck cell and the tail
+        // slides out of the cell it vacated. Remote snakes on clients are
+        // drawn from their interpolation track with its own progress.
+        const RemoteTrack& track = players[p].remote;
+        SnakeBody::Run runs[2];
+        int runCount;
+        Position head, neck, tail, prevTail;
+        const Position* headCell;  // Skipped in the body batch when interpolating
+        float snakeAlpha;
+        bool interpolate;
+        if (track.active()) {
+            const auto& cells = track.displayBody();
+            runs[0] = SnakeBody::Run{cells.data(), cells.size()};
+            runCount = 1;
+            headCell = cells.data();
+            head = cells.front();
+            neck = cells.size() >= 2 ? cells[1] : head;
+            tail = cells.back();
+            prevTail = track.displayPrevTail();
+            snakeAlpha = track.displayAlpha();
+            interpolate = cells.size() >= 2 && snakeAlpha < 1.0f;
+        } else {
+            runCount = body.runs(runs);
+            headCell = &body.front();
+            head = body.front();
+            neck = body.size() >= 2 ? body[1] : head;
+            tail = body.back();
+            prevTail = snake.getPrevTail();
+            snakeAlpha = alpha;
+            interpolate = snake.hasMoved() && body.size() >= 2 && alpha < 1.0f;
+        }
+
+        // Body segments straight from storage (order doesn't matter)
+        rectBatch.clear();
+        for (int r = 0; r < runCount; r++)
         {
-            SDL_Rect rect = {
-                body[i].x * Config::Grid::CELL_SIZE,
-                body[i].y * Config::Grid::CELL_SIZE,
-                Config::Grid::CELL_SIZE - 1,
-                Config::Grid::CELL_SIZE - 1
-            };
-            
-            if (i == 0) {  // Head - brighter
-                SDL_SetRenderDrawColor(renderer, 
-                    std::min(255, color.r + 50),
-                    std::min(255, color.g + 50),
-                    std::min(255, color.b + 50), 255);
-            } else {
-                SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+            for (size_t i = 0; i < runs[r].size; i++)
+            {
+                if (interpolate && &runs[r].data[i] == headCell) continue;
+                rectBatch.push_back(cellRect(runs[r].data[i], cellSize));
             }
-            SDL_RenderFillRect(renderer, &rect);
         }
+        if (interpolate) {
+            rectBatch.push_back(lerpCellRect(prevTail, tail, snakeAlpha, cellSize));
+        }
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+        SDL_RenderFillRects(renderer, rectBatch.data(), (int)rectBatch.size());
+        
+        // Head - brighter, drawn over the bodies
+        headBatch.push_back(HeadRect{
+            interpolate ? lerpCellRect(neck, head, snakeAlpha, cellSize) : cellRect(head, cellSize),
+            SDL_Color{
+                (Uint8)std::min(255, color.r + 50),
+                (Uint8)std::min(255, color.g + 50),
+                (Uint8)std::min(255, color.b + 50), 255}});
+    }
+    
+    for (const HeadRect& h : headBatch)
+    {
+        SDL_SetRenderDrawColor(renderer, h.color.r, h.color.g, h.color.b, 255);
+        SDL_RenderFillRect(renderer, &h.rect);
     }
 }
 
@@ -133,12 +403,7 @@ void MenuRender::renderFood(const Food& food)
 {
     SDL_Color foodColor = food.getColor();
     Position foodPos = food.getPosition();
-    SDL_Rect rect = {
-        foodPos.x * Config::Grid::CELL_SIZE,
-        foodPos.y * Config::Grid::CELL_SIZE,
-        Config::Grid::CELL_SIZE - 1,
-        Config::Grid::CELL_SIZE - 1
-    };
+    SDL_Rect rect = cellRect(foodPos, cellSize);
     SDL_SetRenderDrawColor(renderer, foodColor.r, foodColor.g, foodColor.b, 255);
     SDL_RenderFillRect(renderer, &rect);
 }
@@ -160,10 +425,12 @@ void MenuRender::renderHUD(int score, int remainingSeconds, const std::string& s
     }
 }
 
-void MenuRender::renderGame(const GameContext& ctx, bool matchEnded)
+void MenuRender::renderGame(const GameContext& ctx, bool matchEnded, float alpha)
 {
-    clearScreen();
-    renderPlayers(ctx.players.getSlots());
+    adoptFonts();
+    setGridLayout(ctx.occupancy.getWidth(), ctx.occupancy.getHeight());
+    renderBackground();
+    renderPlayers(ctx.players, alpha);
     renderFood(*ctx.food);
     
     int myScore = 0;
@@ -188,6 +455,34 @@ void MenuRender::present()
 
 // ========== TEXT RENDERING HELPERS ==========
 
+void MenuRender::buildGlyphAtlases()
+{
+    if (fontsPending) return;  // The loader owns the atlases until adoptFonts()
+    textAtlas.build(renderer, font);
+    if (titleFont && titleFont != font) {
+        titleAtlas.build(renderer, titleFont);
+    }
+}
+
+GlyphAtlas* MenuRender::atlasFor(TTF_Font* textFont)
+{
+    GlyphAtlas* atlas = (textFont == font) ? &textAtlas : &titleAtlas;
+    return atlas->ready() ? atlas : nullptr;
+}
+
+int MenuRender::measureText(const char* text, TTF_Font* textFont)
+{
+    if (!textFont) textFont = font;
+    if (!textFont) return 0;
+    
+    if (GlyphAtlas* atlas = atlasFor(textFont)) {
+        return atlas->measure(text);
+    }
+    int w = 0;
+    TTF_SizeText(textFont, text, &w, nullptr);
+    return w;
+}
+
 SDL_Texture* MenuRender::createTextTexture(const char* text, SDL_Color color, TTF_Font* textFont)
 {
     if (!textFont) textFont = font;
@@ -204,31 +499,55 @@ SDL_Texture* MenuRender::createTextTexture(const char* text, SDL_Color color, TT
 
 SDL_Texture* MenuRender::getCachedTexture(const char* text, SDL_Color color, TTF_Font* textFont)
 {
-    // Create unique key: text + color + font
-    std::stringstream ss;
-    ss << text << "_" << (int)color.r << "_" << (int)color.g << "_" << (int)color.b 
-       << "_" << (textFont == titleFont ? "title" : "normal");
-    std::string key = ss.str();
-    
-    // Check if already cached
-    auto it = textureCache.find(key);
-    if (it != textureCache.end()) {
-        return it->second;
+    TextKey key{hashBytes(HASH_SEED, text, strlen(text)),
+                (uint32_t)color.r << 24 | (uint32_t)color.g << 16 | (uint32_t)color.b << 8 | color.a,
+                textFont == titleFont && titleFont != font};
+    
+    auto it = textIndex.find(key);
+    if (it != textIndex.end()) {
+        if (it->second->text == text) {
+            textLru.splice(textLru.begin(), textLru, it->second);  // Now the most recent
+            return it->second->texture;
+        }
+        // Same hash, other text: replace the entry
+        SDL_DestroyTexture(it->second->texture);
+        textLru.erase(it->second);
+        textIndex.erase(it);
     }
     
-    // Create and cache new texture
     SDL_Texture* texture = createTextTexture(text, color, textFont);
-    if (texture) {
-        textureCache[key] = texture;
+    if (!texture) return nullptr;
+    
+    if (textLru.size() >= Config::Render::TEXT_CACHE_ENTRIES) {
+        SDL_DestroyTexture(textLru.back().texture);
+        textIndex.erase(textLru.back().key);
+        textLru.pop_back();
     }
+    textLru.push_front(CachedText{key, text, texture});
+    textIndex[key] = textLru.begin();
     return texture;
 }
 
+void MenuRender::clearTextCache()
+{
+    for (CachedText& entry : textLru) {
+        SDL_DestroyTexture(entry.texture);
+    }
+    textLru.clear();
+    textIndex.clear();
+}
+
 void MenuRender::renderText(const char* text, int x, int y, SDL_Color color, TTF_Font* textFont, bool cache)
 {
     if (!textFont) textFont = font;
     if (!textFont) return;
     
+    if (GlyphAtlas* atlas = atlasFor(textFont)) {
+        atlas->draw(renderer, text, x, y, color);
+        return;
+    }
+    
+    // Fallback: whole-string textures
     SDL_Texture* texture;
     int w, h;
     
@@ -260,31 +579,60 @@ void MenuRender::renderText(const char* text, int x, int y, SDL_Color color, TTF
 
 void MenuRender::renderMenu(int menuSelection)
 {
-    // Draw title
-    SDL_Rect titleRect = {Config::Window::WIDTH / 2 - 150, 100, 300, 60};
-    SDL_RenderFillRect(renderer, &titleRect);
+    drawScreen(SCREEN_MENU, hashValue(HASH_SEED, (uint64_t)menuSelection), false, [&] {
+        // Draw title
+        SDL_Rect titleRect = {Config::Window::WIDTH / 2 - 150, 100, 300, 60};
+        SDL_RenderFillRect(renderer, &titleRect);
 
-    renderText("HARDCORE SNAKE", Config::Window::WIDTH / 2 - 180, 100, {0, 255, 0, 255}, titleFont, true);
-    // Menu options
-    const char* options[] = {"Single Player", "Multiplayer", "Quit"};
-    int startY = 250;
-    int spacing = 80;
-    
-    for (int i = 0; i < 3; i++) {
-        SDL_Color textColor = (i == menuSelection) ? SDL_Color{255, 255, 255, 255} : SDL_Color{150, 150, 150, 255};
+        renderText("HARDCORE SNAKE", Config::Window::WIDTH / 2 - 180, 100, {0, 255, 0, 255}, titleFont, true);
+        // Menu options
+        const char* options[] = {"Single Player", "Multiplayer", "Quit"};
+        int startY = 250;
+        int spacing = 80;
+    
+        for (int i = 0; i < 3; i++) {
+            SDL_Color textColor = (i == menuSelection) ? SDL_Color{255, 255, 255, 255} : SDL_Color{150, 150, 150, 255};
         
-        // Draw option box
-        SDL_Rect optionRect = {Config::Window::WIDTH / 2 - 120, startY + i * spacing, 240, 50};
-        //SDL_SetRenderDrawColor(renderer, i == menuSelection ? 0 : 40, i == menuSelection ? 200 : 40, 0, 255);
-        SDL_RenderFillRect(renderer, &optionRect);
+            // Draw option box
+            SDL_Rect optionRect = {Config::Window::WIDTH / 2 - 120, startY + i * spacing, 240, 50};
+            //SDL_SetRenderDrawColor(renderer, i == menuSelection ? 0 : 40, i == menuSelection ? 200 : 40, 0, 255);
+            SDL_RenderFillRect(renderer, &optionRect);
         
-        // Draw text (cached)
-        renderText(options[i], Config::Window::WIDTH / 2 - 80, startY + i * spacing + 12, textColor, nullptr, true);
+            // Draw text (cached)
+            renderText(options[i], Config::Window::WIDTH / 2 - 80, startY + i * spacing + 12, textColor, nullptr, true);
+        }
+            renderText("Use Arrow Keys/WASD  -  Enter to Select", Config::Window::WIDTH / 2 - 240, Config::Window::HEIGHT - 60, {150, 150, 150, 255}, nullptr, true);
+    });
+}
+
+void MenuRender::renderSessionBrowser(const std::vector<SessionInfo>& sessions, int selectedIndex, bool isConnected,
+                                      const char* busy, Uint32 updatedAt)
+{
+    uint64_t inputs = hashValue(HASH_SEED, (uint64_t)isConnected << 32 | (uint32_t)selectedIndex);
+    inputs = hashValue(inputs, (uint64_t)(updatedAt == 0) << 32 | sessions.size());
+    for (const SessionInfo& session : sessions) {
+        inputs = hashString(inputs, session.id);
+        inputs = hashValue(inputs, (uint64_t)(uint32_t)session.players << 32 | (uint32_t)session.maxPlayers);
+        inputs = hashString(inputs, session.state);
+    }
+    drawScreen(SCREEN_SESSIONS, inputs, false, [&] { drawSessionList(sessions, selectedIndex, isConnected, updatedAt); });
+    if (!isConnected) return;
+    
+    // Request in flight, else the age of the list; idle frames come at
+    // least every IDLE_WAIT_MS, which keeps the spinner turning
+    char status[64];
+    if (busy) {
+        static const char spinner[] = "|/-\\";
+        snprintf(status, sizeof(status), "%c %s...", spinner[(SDL_GetTicks() / 125) % 4], busy);
+        renderText(status, 30, Config::Window::HEIGHT - 40, {255, 255, 0, 255});
+    } else if (updatedAt != 0) {
+        snprintf(status, sizeof(status), "Updated %u s ago", (unsigned)((SDL_GetTicks() - updatedAt) / 1000));
+        renderText(status, 30, Config::Window::HEIGHT - 40, {100, 100, 100, 255});
     }
-        renderText("Use Arrow Keys/WASD  -  Enter to Select", Config::Window::WIDTH / 2 - 240, Config::Window::HEIGHT - 60, {150, 150, 150, 255}, nullptr, true);
 }
 
-void MenuRender::renderSessionBrowser(const std::vector<std::string>& sessions, int selectedIndex, bool isConnected)
+void MenuRender::drawSessionList(const std::vector<SessionInfo>& sessions, int selectedIndex, bool isConnected,
+                                 Uint32 updatedAt)
 {
     // Title
     renderText("MULTIPLAYER - SESSION BROWSER", Config::Window::WIDTH / 2 - 270, 50, {0, 255, 0, 255}, titleFont, true);
@@ -292,14 +640,16 @@ void MenuRender::renderSessionBrowser(const std::vector<std::string>& sessions,
     if (!isConnected) {
         renderText("Connecting to server...", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT / 2 - 50, {255, 255, 0, 255});
         renderText("Press ESC to return", Config::Window::WIDTH / 2 - 120, Config::Window::HEIGHT / 2 + 50, {200, 200, 200, 255});
-        SDL_RenderPresent(renderer);
         return;
     }
     
     // Instructions
     renderText("H - Host Session   |   L - List Sessions   |   ESC - Back", 30, 120, {200, 200, 200, 255});
     
-    if (sessions.empty()) {
+    if (sessions.empty() && updatedAt == 0) {
+        renderText("Looking for sessions...", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT / 2 - 50, {255, 255, 0, 255});
+        renderText("Press H to host a new session", Config::Window::WIDTH / 2 - 170, Config::Window::HEIGHT / 2, {200, 200, 200, 255});
+    } else if (sessions.empty()) {
         renderText("No sessions available", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT / 2 - 50, {255, 255, 0, 255});
         renderText("Press H to host a new session", Config::Window::WIDTH / 2 - 170, Config::Window::HEIGHT / 2, {200, 200, 200, 255});
         renderText("Press L to refresh list", Config::Window::WIDTH / 2 - 140, Config::Window::HEIGHT / 2 + 50, {200, 200, 200, 255});
@@ -327,9 +677,21 @@ void MenuRender::renderSessionBrowser(const std::vector<std::string>& sessions,
                 renderText(">", 80, startY + (i - startIdx) * spacing, {255, 255, 0, 255});
             }
             
-            // Session number and ID
-            char sessionText[128];
-            snprintf(sessionText, sizeof(sessionText), "[%d] %s", i + 1, sessions[i].c_str());
+            // Session number and ID, then whatever the relay told about it
+            const SessionInfo& session = sessions[i];
+            char sessionText[160];
+            int len = snprintf(sessionText, sizeof(sessionText), "[%d] %s", i + 1, session.id.c_str());
+            if (session.players >= 0 && len > 0 && (size_t)len < sizeof(sessionText)) {
+                if (session.maxPlayers > 0) {
+                    len += snprintf(sessionText + len, sizeof(sessionText) - len, "  %d/%d players",
+                                    session.players, session.maxPlayers);
+                } else {
+                    len += snprintf(sessionText + len, sizeof(sessionText) - len, "  %d players", session.players);
+                }
+            }
+            if (!session.state.empty() && len > 0 && (size_t)len < sizeof(sessionText)) {
+                snprintf(sessionText + len, sizeof(sessionText) - len, "  %s", session.state.c_str());
+            }
             renderText(sessionText, 120, startY + (i - startIdx) * spacing, color);
         }
         
@@ -341,36 +703,63 @@ void MenuRender::renderSessionBrowser(const std::vector<std::string>& sessions,
             renderText(scrollInfo, Config::Window::WIDTH / 2 - 120, startY + (int)maxVisible * spacing + 20, {100, 100, 100, 255});
         }
     }
-    
-    SDL_RenderPresent(renderer);
 }
 
-void MenuRender::renderLobby(const std::array<PlayerSlot, 4>& players, bool isHost)
+void MenuRender::renderLobby(const PlayerManager& players, bool isHost)
 {
-    // Draw title
-    renderText("WAITING FOR PLAYERS", Config::Window::WIDTH / 2 - 200, 80, {0, 255, 0, 255}, titleFont, true);
-    
-    // Draw player list
-    int startY = 180;
-    int spacing = 60;
-    
-    for (int i = 0; i < Config::Game::MAX_PLAYERS; i++) {
-        char text[64];
-        if (players[i].active && players[i].snake) {
-            snprintf(text, sizeof(text), "Player %d: Ready", i + 1);
-            renderText(text, Config::Window::WIDTH / 2 - 100, startY + i * spacing, {0, 255, 0, 255}, nullptr, true);
-        } else {
-            snprintf(text, sizeof(text), "Player %d: Waiting...", i + 1);
-            renderText(text, Config::Window::WIDTH / 2 - 100, startY + i * spacing, {150, 150, 150, 255}, nullptr, true);
+    uint64_t inputs = hashValue(HASH_SEED, (uint64_t)players.capacity() << 1 | isHost);
+    uint64_t occupied = 0;
+    for (int i = 0; i < players.capacity(); i++) {
+        occupied |= (uint64_t)players.isValid(i) << (i & 63);
+        if ((i & 63) == 63 || i + 1 == players.capacity()) {
+            inputs = hashValue(inputs, occupied);
+            occupied = 0;
         }
     }
+    drawScreen(SCREEN_LOBBY, inputs, false, [&] {
+        // Draw title
+        renderText("WAITING FOR PLAYERS", Config::Window::WIDTH / 2 - 200, 80, {0, 255, 0, 255}, titleFont, true);
+    
+        // Draw player list
+        int startY = 180;
+        int spacing = 60;
+    
+        if (players.capacity() <= Config::Render::PLAYER_COLOR_COUNT) {
+            for (int i = 0; i < players.capacity(); i++) {
+                char text[64];
+                if (players.isValid(i)) {
+                    snprintf(text, sizeof(text), "Player %d: Ready", i + 1);
+                    renderText(text, Config::Window::WIDTH / 2 - 100, startY + i * spacing, {0, 255, 0, 255}, nullptr, true);
+                } else {
+                    snprintf(text, sizeof(text), "Player %d: Waiting...", i + 1);
+                    renderText(text, Config::Window::WIDTH / 2 - 100, startY + i * spacing, {150, 150, 150, 255}, nullptr, true);
+                }
+            }
+        } else {
+            // Large arenas: a count plus a grid of slot labels, joined players
+            // in their snake color
+            char text[64];
+            snprintf(text, sizeof(text), "%d / %d players", players.activeCount(), players.capacity());
+            renderText(text, Config::Window::WIDTH / 2 - 100, startY, {0, 255, 0, 255});
+        
+            const int columns = 8;
+            const int columnWidth = Config::Window::WIDTH / (columns + 2);
+            const int rowSpacing = 34;
+            for (int i = 0; i < players.capacity(); i++) {
+                snprintf(text, sizeof(text), "P%d", i + 1);
+                SDL_Color color = players.isValid(i) ? playerColor(i) : SDL_Color{80, 80, 80, 255};
+                renderText(text, columnWidth * (1 + i % columns), startY + 50 + (i / columns) * rowSpacing,
+                           color, nullptr, true);
+            }
+        }
     
-    // Instructions
-    if (isHost) {
-        renderText("Press SPACE to start match", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT - 80, {255, 255, 0, 255}, nullptr, true);
-    } else {
-        renderText("Waiting for host to start...", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT - 80, {255, 255, 0, 255}, nullptr, true);
-    }
+        // Instructions
+        if (isHost) {
+            renderText("Press SPACE to start match", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT - 80, {255, 255, 0, 255}, nullptr, true);
+        } else {
+            renderText("Waiting for host to start...", Config::Window::WIDTH / 2 - 150, Config::Window::HEIGHT - 80, {255, 255, 0, 255}, nullptr, true);
+        }
+    });
 }
 
 void MenuRender::renderCountdown(int seconds)
@@ -395,47 +784,213 @@ void MenuRender::renderCountdown(int seconds)
 
 void MenuRender::renderPauseMenu(int selection)
 {
-    // Semi-transparent overlay
+    drawScreen(SCREEN_PAUSE, hashValue(HASH_SEED, (uint64_t)selection), true, [&] {
+        // Semi-transparent overlay
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
+        SDL_Rect overlay = {0, 0, Config::Window::WIDTH, Config::Window::HEIGHT};
+        SDL_RenderFillRect(renderer, &overlay);
+    
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+
+        renderText("PAUSED", Config::Window::WIDTH / 2 - 80, Config::Window::HEIGHT / 2 - 100, {0, 255, 0, 255}, titleFont, true);
+    
+        // Menu options with highlight
+        SDL_Color normalColor = {255, 215, 0, 255};
+        SDL_Color selectedColor = {0, 255, 0, 255};
+    
+        renderText("Resume", Config::Window::WIDTH / 2 - 50, Config::Window::HEIGHT / 2, 
+                         selection == 0 ? selectedColor : normalColor);
+        renderText("Restart", Config::Window::WIDTH / 2 - 45, Config::Window::HEIGHT / 2 + 50, 
+                         selection == 1 ? selectedColor : normalColor);
+        renderText("Menu", Config::Window::WIDTH / 2 - 35, Config::Window::HEIGHT / 2 + 100, 
+                         selection == 2 ? selectedColor : normalColor);
+    });
+}
+
+void MenuRender::renderBanner(const char* text)
+{
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 180);
-    SDL_Rect overlay = {0, 0, Config::Window::WIDTH, Config::Window::HEIGHT};
-    SDL_RenderFillRect(renderer, &overlay);
+    SDL_Rect panel = {0, 0, Config::Window::WIDTH, 40};
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    
+    renderText(text, (Config::Window::WIDTH - measureText(text)) / 2, 8, {255, 255, 0, 255}, nullptr, true);
+}
+
+void MenuRender::renderNetStats(const NetTelemetry::Report& report, size_t sendQueueDepth)
+{
+    static const NetTelemetry::Kind shownKinds[] = {
+        NetTelemetry::Kind::GAME_STATE, NetTelemetry::Kind::PLAYER_INPUT,
+        NetTelemetry::Kind::STATE_SYNC, NetTelemetry::Kind::TIME_SYNC
+    };
+    constexpr int lineHeight = 28;
+    constexpr int lineCount = 4 + sizeof(shownKinds) / sizeof(shownKinds[0]);
+    const int x = 10;
+    int y = 80;
     
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_Rect panel = {0, y - 6, 440, lineCount * lineHeight + 12};
+    SDL_RenderFillRect(renderer, &panel);
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    
+    SDL_Color color = {180, 255, 180, 255};
+    char text[96];
+    
+    if (report.rttMs > 0) {
+        snprintf(text, sizeof(text), "RTT %u ms (avg %.0f, max %u)", report.rttMs, report.rttSmoothedMs, report.rttMaxMs);
+    } else {
+        snprintf(text, sizeof(text), "RTT -");
+    }
+    renderText(text, x, y, color);
+    y += lineHeight;
+    
+    snprintf(text, sizeof(text), "Dispatch %.1f ms (max %.1f)", report.dispatchAvgMs, report.dispatchMaxMs);
+    renderText(text, x, y, color);
+    y += lineHeight;
+    
+    snprintf(text, sizeof(text), "Queue %zu (max %zu), send %zu", report.queueIntervalPeak, report.queueHighWater,
+             sendQueueDepth);
+    renderText(text, x, y, color);
+    y += lineHeight;
+    
+    float inKb = 0.0f, outKb = 0.0f;
+    for (size_t kind = 0; kind < NetTelemetry::KIND_COUNT; kind++) {
+        inKb += report.traffic[NetTelemetry::IN][kind].kbPerSec;
+        outKb += report.traffic[NetTelemetry::OUT][kind].kbPerSec;
+    }
+    snprintf(text, sizeof(text), "In %.1f KB/s  Out %.1f KB/s", inKb, outKb);
+    renderText(text, x, y, color);
+    y += lineHeight;
+    
+    // msgs/s received / sent
+    for (NetTelemetry::Kind kind : shownKinds) {
+        snprintf(text, sizeof(text), "%s %.1f / %.1f", NetTelemetry::kindName(kind),
+                 report.traffic[NetTelemetry::IN][(size_t)kind].messagesPerSec,
+                 report.traffic[NetTelemetry::OUT][(size_t)kind].messagesPerSec);
+        renderText(text, x, y, color);
+        y += lineHeight;
+    }
+}
 
-    renderText("PAUSED", Config::Window::WIDTH / 2 - 80, Config::Window::HEIGHT / 2 - 100, {0, 255, 0, 255}, titleFont, true);
+void MenuRender::renderReplayStatus(uint32_t tick, uint32_t endTick, uint32_t tickMs, int speed, bool paused,
+                                    uint32_t mismatches)
+{
+    constexpr int lineHeight = 28;
+    const int x = 10;
+    int y = Config::Window::HEIGHT - 2 * lineHeight - 10;
     
-    // Menu options with highlight
-    SDL_Color normalColor = {255, 215, 0, 255};
-    SDL_Color selectedColor = {0, 255, 0, 255};
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_Rect panel = {0, y - 6, Config::Window::WIDTH, 2 * lineHeight + 16};
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    
+    SDL_Color color = {255, 220, 140, 255};
+    char text[96];
+    uint32_t seconds = tick * tickMs / 1000;
+    uint32_t totalSeconds = endTick * tickMs / 1000;
+    snprintf(text, sizeof(text), "REPLAY %u:%02u / %u:%02u  %dx%s", seconds / 60, seconds % 60,
+             totalSeconds / 60, totalSeconds % 60, speed, tick >= endTick ? "  END" : paused ? "  PAUSED" : "");
+    renderText(text, x, y, color);
+    if (mismatches > 0) {
+        snprintf(text, sizeof(text), "%u DESYNCS", mismatches);
+        SDL_Color red = {255, 90, 90, 255};
+        renderText(text, Config::Window::WIDTH - 10 - measureText(text), y, red);
+    }
+    y += lineHeight;
     
-    renderText("Resume", Config::Window::WIDTH / 2 - 50, Config::Window::HEIGHT / 2, 
-                     selection == 0 ? selectedColor : normalColor);
-    renderText("Restart", Config::Window::WIDTH / 2 - 45, Config::Window::HEIGHT / 2 + 50, 
-                     selection == 1 ? selectedColor : normalColor);
-    renderText("Menu", Config::Window::WIDTH / 2 - 35, Config::Window::HEIGHT / 2 + 100, 
-                     selection == 2 ? selectedColor : normalColor);
+    renderText("Space pause  Left/Right seek  Up/Down speed  Home restart  Esc quit", x, y, color, nullptr, true);
 }
 
-void MenuRender::renderMatchEnd(int winnerIndex, const std::array<PlayerSlot, 4>& players)
+void MenuRender::renderProfiler(const Profiler& profiler)
 {
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
-    SDL_Rect overlay = {0, 0, Config::Window::WIDTH, Config::Window::HEIGHT};
-    SDL_RenderFillRect(renderer, &overlay);
+    constexpr int lineHeight = 28;
+    constexpr int panelWidth = 360;
+    const int x = Config::Window::WIDTH - panelWidth;
+    int y = 80;
     
-    char text[128];
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_Rect panel = {x - 10, y - 6, panelWidth + 10, (int)(Profiler::PHASE_COUNT + 1) * lineHeight + 12};
+    SDL_RenderFillRect(renderer, &panel);
+    
+    SDL_Color color = {180, 220, 255, 255};
+    char text[64];
+    
+    renderText("p50 / p99 ms", x + panelWidth - 10 - measureText("p50 / p99 ms"), y, color);
+    y += lineHeight;
+    for (size_t i = 0; i < Profiler::PHASE_COUNT; i++) {
+        const Profiler::Histogram& h = profiler.histogram((Profiler::Phase)i);
+        renderText(Profiler::phaseName((Profiler::Phase)i), x, y, color);
+        snprintf(text, sizeof(text), "%.2f / %.2f", h.percentileMicros(0.50) / 1000.0, h.percentileMicros(0.99) / 1000.0);
+        renderText(text, x + panelWidth - 10 - measureText(text), y, color);
+        y += lineHeight;
+    }
+    
+    // Frame times, newest on the right, against the frame budget
+    constexpr int barWidth = 3;
+    constexpr int graphHeight = 90;
+    constexpr float pixelsPerMs = 3.0f;
+    const int graphWidth = (int)Profiler::HISTORY_FRAMES * barWidth;
+    const int graphX = (Config::Window::WIDTH - graphWidth) / 2;
+    const int graphBottom = Config::Window::HEIGHT - 10;
+    
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_Rect graph = {graphX, graphBottom - graphHeight, graphWidth, graphHeight};
+    SDL_RenderFillRect(renderer, &graph);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    
+    const float budgetMs = Config::Render::FRAME_DELAY_MS > 0 ? (float)Config::Render::FRAME_DELAY_MS : 16.7f;
+    size_t frames = profiler.frameHistorySize();
+    int barX = graphX + graphWidth - (int)frames * barWidth;
+    for (size_t i = 0; i < frames; i++, barX += barWidth) {
+        float ms = profiler.frameHistoryMs(i);
+        int height = std::min(graphHeight, std::max(1, (int)(ms * pixelsPerMs)));
+        if (ms <= budgetMs) {
+            SDL_SetRenderDrawColor(renderer, 0, 200, 0, 255);
+        } else if (ms <= 2.0f * budgetMs) {
+            SDL_SetRenderDrawColor(renderer, 230, 200, 0, 255);
+        } else {
+            SDL_SetRenderDrawColor(renderer, 230, 40, 40, 255);
+        }
+        SDL_Rect bar = {barX, graphBottom - height, barWidth - 1, height};
+        SDL_RenderFillRect(renderer, &bar);
+    }
+    
+    SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+    int budgetY = graphBottom - (int)(budgetMs * pixelsPerMs);
+    SDL_RenderDrawLine(renderer, graphX, budgetY, graphX + graphWidth - 1, budgetY);
+}
 
-    if (winnerIndex >= 0 && winnerIndex < Config::Game::MAX_PLAYERS && players.at(winnerIndex).snake)
-    {
-        snprintf(text, sizeof(text), "MATCH ENDED - Player %d WINS!", winnerIndex + 1);
-        renderText(text, Config::Window::WIDTH/2 - 150, Config::Window::HEIGHT/2 - 60, {0, 255, 0, 255});
+void MenuRender::renderMatchEnd(int winnerIndex, const PlayerManager& players)
+{
+    bool hasWinner = players.isValid(winnerIndex);
+    uint64_t inputs = hashValue(HASH_SEED, (uint64_t)(uint32_t)winnerIndex << 1 | hasWinner);
+    if (hasWinner) {
+        inputs = hashValue(inputs, (uint64_t)players[winnerIndex].snake->getScore());
+    }
+    drawScreen(SCREEN_MATCH_END, inputs, false, [&] {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 200);
+        SDL_Rect overlay = {0, 0, Config::Window::WIDTH, Config::Window::HEIGHT};
+        SDL_RenderFillRect(renderer, &overlay);
+    
+        char text[128];
+
+        if (players.isValid(winnerIndex))
+        {
+            snprintf(text, sizeof(text), "MATCH ENDED - Player %d WINS!", winnerIndex + 1);
+            renderText(text, Config::Window::WIDTH/2 - 150, Config::Window::HEIGHT/2 - 60, {0, 255, 0, 255});
         
-        snprintf(text, sizeof(text), "SCORE - %d", players.at(winnerIndex).snake->getScore());
+            snprintf(text, sizeof(text), "SCORE - %d", players[winnerIndex].snake->getScore());
         
-        renderText(text, Config::Window::WIDTH/2 - 100, Config::Window::HEIGHT/2 - 20, {255, 255, 255, 255});
-    } else {
-        renderText("MATCH ENDED - NO WINNER", Config::Window::WIDTH/2 - 120, Config::Window::HEIGHT/2 - 30, {255, 0, 0, 255}, nullptr, true);
-    }
+            renderText(text, Config::Window::WIDTH/2 - 100, Config::Window::HEIGHT/2 - 20, {255, 255, 255, 255});
+        } else {
+            renderText("MATCH ENDED - NO WINNER", Config::Window::WIDTH/2 - 120, Config::Window::HEIGHT/2 - 30, {255, 0, 0, 255}, nullptr, true);
+        }
     
-    renderText("Press R to start new match", Config::Window::WIDTH/2 - 120, Config::Window::HEIGHT/2 + 30, {200, 200, 200, 255}, nullptr, true);
+        renderText("Press R to start new match", Config::Window::WIDTH/2 - 120, Config::Window::HEIGHT/2 + 30, {200, 200, 200, 255}, nullptr, true);
+    });
 }
\ No newline at end of file
@@ -0,0 +1,565 @@
+#include "replay.h"
+#include "logger.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Replay {
+
+namespace {
+
+constexpr uint8_t FLAG_REVERSED = 1;  // INPUTS
+constexpr uint8_t FLAG_RESYNC = 1;    // KEYFRAME
+
+void put16(std::vector<uint8_t>& out, uint32_t v)
+{
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t v)
+{
+    put16(out, v);
+    put16(out, v >> 16);
+}
+
+void put64(std::vector<uint8_t>& out, uint64_t v)
+{
+    put32(out, (uint32_t)v);
+    put32(out, (uint32_t)(v >> 32));
+}
+
+uint32_t get16(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8); }
+uint32_t get32(const uint8_t* p) { return get16(p) | (get16(p + 2) << 16); }
+uint64_t get64(const uint8_t* p) { return (uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32); }
+
+uint8_t packHeading(const Snake& snake)
+{
+    return (uint8_t)((int)snake.getDirection() | ((int)snake.getNextDirection() << 4));
+}
+
+// Grid cells as u16, or u32 for arenas past 65536 cells
+bool wideCells(const OccupancyGrid& grid)
+{
+    return grid.getWidth() * grid.getHeight() > 0x10000;
+}
+
+void putCells(std::vector<uint8_t>& out, const std::vector<int>& cells, bool wide)
+{
+    put32(out, (uint32_t)cells.size());
+    for (int cell : cells) {
+        if (wide) put32(out, (uint32_t)cell);
+        else put16(out, (uint32_t)cell);
+    }
+}
+
+// Bytes read, 0 if the list runs past `length`
+size_t getCells(const uint8_t* p, size_t length, bool wide, std::vector<int>& cells)
+{
+    size_t cellSize = wide ? 4 : 2;
+    if (length < 4) return 0;
+    size_t count = get32(p);
+    if (count > (length - 4) / cellSize) return 0;
+    cells.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        cells[i] = wide ? (int)get32(p + 4 + i * 4) : (int)get16(p + 4 + i * 2);
+    }
+    return 4 + count * cellSize;
+}
+
+// Keyframe payload offsets, ahead of the per-player scores
+constexpr size_t KEYFRAME_RNG = 0;
+constexpr size_t KEYFRAME_ELAPSED = 8;
+constexpr size_t KEYFRAME_FLAGS = 12;
+constexpr size_t KEYFRAME_SCORES = 14;  // After the u8 playerCount
+
+} // namespace
+
+bool encodeKeyframe(const MatchView& view, bool resync, WireFormat::StateSnapshot& snapshot,
+                    std::vector<uint8_t>& out)
+{
+    snapshot.seq = 1;
+    snapshot.food = view.food.getPosition();
+    snapshot.matchStartTime = 0;  // Playback runs its own clock
+    snapshot.elapsedMs = 0;
+    snapshot.playerCount = 0;
+    for (int i : view.players.activeIndices()) {
+        if (!view.players.isValid(i)) continue;
+        const Snake& snake = *view.players[i].snake;
+        WireFormat::PlayerState& player = snapshot.addPlayer();
+        player.index = i;
+        player.alive = snake.isAlive();
+        player.inputSeq = 1;  // Nonzero so the heading is encoded
+        player.inputAge = 0;
+        player.heading = packHeading(snake);
+        player.body.clear();
+        for (const Position& segment : snake.getBody()) player.body.push_back(segment);
+    }
+    if (!WireFormat::encodeSnapshot(snapshot, nullptr, out)) return false;
+
+    bool wide = wideCells(view.occupancy);
+    std::vector<uint8_t> prefix;
+    prefix.reserve(KEYFRAME_SCORES + 5 * snapshot.playerCount + 8 +
+                   (wide ? 4 : 2) * (view.occupancy.freeCellOrder().size() + view.occupancy.spawnAnchorOrder().size()));
+    put64(prefix, view.occupancy.randomState());
+    put32(prefix, view.match.syncedElapsedMs);
+    prefix.push_back(resync ? FLAG_RESYNC : 0);
+    prefix.push_back((uint8_t)snapshot.playerCount);
+    for (int p = 0; p < snapshot.playerCount; p++) {
+        int index = snapshot.players[p].index;
+        prefix.push_back((uint8_t)index);
+        put32(prefix, (uint32_t)view.players[index].snake->getScore());
+    }
+    putCells(prefix, view.occupancy.freeCellOrder(), wide);
+    putCells(prefix, view.occupancy.spawnAnchorOrder(), wide);
+    out.insert(out.begin(), prefix.begin(), prefix.end());
+    return true;
+}
+
+// ========== Recorder ==========
+
+Recorder::Recorder(const MatchView& view)
+    : view(view), tick(0), lastKeyframe(0), lastClearCount(0), file(nullptr), stopping(false)
+{
+}
+
+Recorder::~Recorder()
+{
+    stop();
+}
+
+bool Recorder::start(const std::string& path, uint32_t tickMs)
+{
+    stop();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        Logger::error("Cannot create replay file ", path, ": ", strerror(errno));
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    put32(header, MAGIC);
+    header.push_back(VERSION);
+    header.push_back((uint8_t)view.players.capacity());
+    put16(header, (uint32_t)view.occupancy.getWidth());
+    put16(header, (uint32_t)view.occupancy.getHeight());
+    put16(header, tickMs);
+    put32(header, (uint32_t)time(nullptr));
+    fwrite(header.data(), 1, header.size(), file);
+
+    tick = 0;
+    lastKeyframe = 0;
+    lastActive.clear();
+    headings.clear();
+    staged.clear();
+    pending.clear();
+    stopping = false;
+    writer = std::thread(&Recorder::writerMain, this);
+
+    Logger::info("Recording replay to ", path);
+    return true;
+}
+
+void Recorder::stop()
+{
+    if (!file) return;
+
+    beginRecord(END, 0);
+    submit();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    fclose(file);
+    file = nullptr;
+    Logger::info("Replay saved (", tick, " ticks)");
+}
+
+void Recorder::beforeTick()
+{
+    if (!file) return;
+
+    // Directions set since the last tick, by whichever input path. Snakes
+    // that weren't there at the end of the last tick are in the keyframe.
+    const std::vector<int>& active = view.players.activeIndices();
+    size_t recordStart = staged.size();
+    beginRecord(INPUTS, 0);
+    for (int i : active) {
+        if (!view.players.isValid(i) || i >= (int)headings.size() || !headings[i].known) continue;
+        const Snake& snake = *view.players[i].snake;
+        uint8_t heading = packHeading(snake);
+        bool reversed = !(snake.getHead() == headings[i].head);
+        if (heading == headings[i].packed && !reversed) continue;
+        staged.push_back((uint8_t)i);
+        staged.push_back(heading);
+        staged.push_back(reversed ? FLAG_REVERSED : 0);
+    }
+    size_t length = staged.size() - recordStart - RECORD_HEADER_SIZE;
+    if (length == 0) {
+        staged.resize(recordStart);
+    } else {
+        uint8_t* lengthField = staged.data() + recordStart + 5;
+        for (int b = 0; b < 4; b++) lengthField[b] = (uint8_t)(length >> (8 * b));
+    }
+
+    bool resync = tick == 0 || active != lastActive || view.occupancy.clearCount() != lastClearCount;
+    if (resync || tick - lastKeyframe >= Config::Replay::KEYFRAME_INTERVAL_TICKS) {
+        writeKeyframe(resync);
+    }
+}
+
+void Recorder::afterTick()
+{
+    if (!file) return;
+
+    headings.assign(view.players.capacity(), Heading{0, Position{0, 0}, false});
+    for (int i : view.players.activeIndices()) {
+        if (!view.players.isValid(i)) continue;
+        const Snake& snake = *view.players[i].snake;
+        headings[i] = Heading{packHeading(snake), snake.getHead(), true};
+    }
+    lastActive = view.players.activeIndices();
+    lastClearCount = view.occupancy.clearCount();
+    tick++;
+    submit();
+}
+
+void Recorder::writeKeyframe(bool resync)
+{
+    if (!encodeKeyframe(view, resync, snapshot, snapshotBytes)) {
+        Logger::warn("Replay keyframe at tick ", tick, " could not be encoded");
+        return;
+    }
+    beginRecord(KEYFRAME, snapshotBytes.size());
+    staged.insert(staged.end(), snapshotBytes.begin(), snapshotBytes.end());
+    lastKeyframe = tick;
+}
+
+void Recorder::beginRecord(RecordKind kind, size_t length)
+{
+    staged.push_back(kind);
+    put32(staged, tick);
+    put32(staged, (uint32_t)length);
+}
+
+void Recorder::submit()
+{
+    if (staged.empty()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.insert(pending.end(), staged.begin(), staged.end());
+    }
+    staged.clear();
+}
+
+void Recorder::writerMain()
+{
+    std::vector<uint8_t> batch;
+    bool failed = false;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait_for(lock, std::chrono::milliseconds(Config::Replay::FLUSH_INTERVAL_MS),
+                      [this] { return stopping; });
+        bool done = stopping;
+        batch.clear();
+        batch.swap(pending);
+        lock.unlock();
+
+        if (!batch.empty() && !failed &&
+            (fwrite(batch.data(), 1, batch.size(), file) != batch.size() || fflush(file) != 0)) {
+            Logger::error("Replay write failed: ", strerror(errno));
+            failed = true;  // A gap would desync the rest; keep what was written
+        }
+
+        lock.lock();
+        if (done) break;
+    }
+}
+
+// ========== File ==========
+
+File::File()
+    : base(nullptr), mappedSize(0), validSize(0), tickInterval(0), startUnix(0), lastTick(0),
+      hasEnd(false)
+{
+}
+
+File::~File()
+{
+    close();
+}
+
+bool File::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Logger::error("Cannot open replay ", path, ": ", strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE) {
+        Logger::error("Replay ", path, " is too short");
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        Logger::error("Cannot map replay ", path, ": ", strerror(errno));
+        return false;
+    }
+    base = static_cast<const uint8_t*>(mapped);
+    mappedSize = (size_t)st.st_size;
+    madvise(mapped, mappedSize, MADV_WILLNEED);
+
+    if (get32(base) != MAGIC || base[4] != VERSION) {
+        Logger::error("Replay ", path, " has an unknown format");
+        close();
+        return false;
+    }
+    settings.maxPlayers = base[5];
+    settings.width = (int)get16(base + 6);
+    settings.height = (int)get16(base + 8);
+    tickInterval = get16(base + 10);
+    startUnix = get32(base + 12);
+    if (settings.clamped() != settings || tickInterval == 0) {
+        Logger::error("Replay ", path, " has an invalid header");
+        close();
+        return false;
+    }
+
+    // Index keyframes; records must not go back in time
+    size_t offset = HEADER_SIZE;
+    while (offset + RECORD_HEADER_SIZE <= mappedSize) {
+        uint8_t kind = base[offset];
+        uint32_t recordTick = get32(base + offset + 1);
+        size_t length = get32(base + offset + 5);
+        if (length > mappedSize - offset - RECORD_HEADER_SIZE || recordTick + 1 < lastTick ||
+            (index.empty() && kind != KEYFRAME)) {
+            break;
+        }
+        offset += RECORD_HEADER_SIZE + length;
+        if (kind == END) {
+            lastTick = recordTick;
+            hasEnd = true;
+            break;
+        }
+        if (kind == KEYFRAME) {
+            index.push_back(Keyframe{recordTick, offset - RECORD_HEADER_SIZE - length});
+        }
+        lastTick = recordTick + 1;  // Its records are applied before it is simulated
+    }
+    validSize = offset;
+
+    if (index.empty()) {
+        Logger::error("Replay ", path, " has no keyframe");
+        close();
+        return false;
+    }
+    if (!hasEnd) {
+        Logger::warn("Replay ", path, " is incomplete, playing ", lastTick, " ticks");
+    }
+    return true;
+}
+
+void File::close()
+{
+    if (base) {
+        munmap(const_cast<uint8_t*>(base), mappedSize);
+    }
+    base = nullptr;
+    mappedSize = validSize = 0;
+    lastTick = 0;
+    hasEnd = false;
+    index.clear();
+}
+
+// ========== Player ==========
+
+Player::Player(const MatchView& view)
+    : view(view),
+      engine(view.players, view.occupancy, view.match, view.food,
+             [this] { return this->view.match.matchStartTime + this->view.match.syncedElapsedMs; }),
+      file(nullptr), cursor(0), tick(0), keyTick(0), keyElapsedMs(0), mismatchCount(0)
+{
+}
+
+bool Player::load(const File& replay)
+{
+    file = &replay;
+    mismatchCount = 0;
+    view.players.clear();
+    applyArena(replay.arena(), view.players, view.occupancy);
+    view.match = MatchState();
+
+    const File::Keyframe& first = replay.keyframes().front();
+    const uint8_t* record = replay.data() + first.offset;
+    if (!applyKeyframe(record + RECORD_HEADER_SIZE, get32(record + 5), first.tick)) {
+        file = nullptr;
+        return false;
+    }
+    cursor = first.offset + RECORD_HEADER_SIZE + get32(record + 5);
+    tick = first.tick;
+    return true;
+}
+
+bool Player::seek(uint32_t target)
+{
+    if (!file) return false;
+    target = std::min(target, file->endTick());
+
+    // Nearest keyframe at or before the target, unless we're already past it
+    const std::vector<File::Keyframe>& keyframes = file->keyframes();
+    auto it = std::upper_bound(keyframes.begin(), keyframes.end(), target,
+                               [](uint32_t t, const File::Keyframe& k) { return t < k.tick; });
+    if (it == keyframes.begin()) return false;
+    const File::Keyframe& key = *(it - 1);
+
+    if (target < tick || key.tick > tick) {
+        const uint8_t* record = file->data() + key.offset;
+        size_t length = get32(record + 5);
+        if (!applyKeyframe(record + RECORD_HEADER_SIZE, length, key.tick)) return false;
+        cursor = key.offset + RECORD_HEADER_SIZE + length;
+        tick = key.tick;
+    }
+    while (tick < target && step()) {
+    }
+    return true;
+}
+
+bool Player::step()
+{
+    if (atEnd()) return false;
+
+    applyRecordsOfTick();
+    engine.tick();
+    tick++;
+    view.match.syncedElapsedMs = keyElapsedMs + (tick - keyTick) * file->tickMs();
+    return true;
+}
+
+uint32_t Player::advance(uint32_t ticks)
+{
+    uint32_t played = 0;
+    while (played < ticks && step()) {
+        played++;
+    }
+    return played;
+}
+
+void Player::applyRecordsOfTick()
+{
+    const uint8_t* data = file->data();
+    while (cursor + RECORD_HEADER_SIZE <= file->size()) {
+        const uint8_t* record = data + cursor;
+        uint32_t recordTick = get32(record + 1);
+        size_t length = get32(record + 5);
+        if (recordTick > tick) break;
+        cursor += RECORD_HEADER_SIZE + length;
+
+        const uint8_t* payload = record + RECORD_HEADER_SIZE;
+        if (record[0] == INPUTS) {
+            for (size_t p = 0; p + 3 <= length; p += 3) {
+                int index = payload[p];
+                if (!view.players.isValid(index)) continue;
+                Snake& snake = *view.players[index].snake;
+                if (payload[p + 2] & FLAG_REVERSED) {
+                    reversedBody.clear();
+                    for (const Position& segment : snake.getBody()) reversedBody.push_back(segment);
+                    std::reverse(reversedBody.begin(), reversedBody.end());
+                    snake.setBody(reversedBody.data(), reversedBody.size());
+                }
+                snake.setHeading((Direction)(payload[p + 1] & 0x0F), (Direction)(payload[p + 1] >> 4));
+            }
+        } else if (record[0] == KEYFRAME) {
+            // A periodic keyframe must match the simulation; compare all
+            // but the clock, which followed real time
+            bool checked = length > KEYFRAME_FLAGS && !(payload[KEYFRAME_FLAGS] & FLAG_RESYNC);
+            bool same = !checked ||
+                        (encodeKeyframe(view, false, snapshot, encoded) && encoded.size() == length &&
+                         memcmp(encoded.data() + KEYFRAME_RNG, payload + KEYFRAME_RNG, KEYFRAME_ELAPSED) == 0 &&
+                         memcmp(encoded.data() + KEYFRAME_SCORES - 1, payload + KEYFRAME_SCORES - 1,
+                                length - (KEYFRAME_SCORES - 1)) == 0);
+            if (!same) {
+                mismatchCount++;
+                Logger::warn("Replay diverged from the recording at tick ", tick);
+            }
+            applyKeyframe(payload, length, tick);
+        }
+    }
+}
+
+bool Player::applyKeyframe(const uint8_t* payload, size_t length, uint32_t atTick)
+{
+    if (length < KEYFRAME_SCORES) return false;
+    uint64_t rng = get64(payload + KEYFRAME_RNG);
+    uint32_t elapsedMs = get32(payload + KEYFRAME_ELAPSED);
+    int scoreCount = payload[KEYFRAME_SCORES - 1];
+    size_t ordersStart = KEYFRAME_SCORES + 5 * (size_t)scoreCount;
+    bool wide = wideCells(view.occupancy);
+    size_t freeBytes = length < ordersStart ? 0 : getCells(payload + ordersStart, length - ordersStart, wide, freeOrder);
+    size_t anchorBytes = freeBytes == 0 ? 0 :
+        getCells(payload + ordersStart + freeBytes, length - ordersStart - freeBytes, wide, anchorOrder);
+    size_t wireStart = ordersStart + freeBytes + anchorBytes;
+    if (anchorBytes == 0 ||
+        WireFormat::decodeSnapshot(payload + wireStart, length - wireStart, noHistory, snapshot) !=
+            WireFormat::DecodeResult::OK) {
+        Logger::warn("Malformed replay keyframe at tick ", atTick);
+        return false;
+    }
+
+    std::array<int, Config::Game::PLAYER_LIMIT> scores{};
+    for (int s = 0; s < scoreCount; s++) {
+        const uint8_t* entry = payload + KEYFRAME_SCORES + 5 * s;
+        if (entry[0] < scores.size()) scores[entry[0]] = (int)(int32_t)get32(entry + 1);
+    }
+
+    // Players in the keyframe, and no one else
+    std::array<bool, Config::Game::PLAYER_LIMIT> present{};
+    for (int p = 0; p < snapshot.playerCount; p++) {
+        const WireFormat::PlayerState& player = snapshot.players[p];
+        if (player.index >= view.players.capacity() || player.body.empty()) continue;
+        present[player.index] = true;
+        if (!view.players.isValid(player.index)) {
+            view.players.activate(player.index, "replay_" + std::to_string(player.index));
+            view.players[player.index].snake = std::make_unique<Snake>(playerColor(player.index), player.body[0]);
+        }
+        Snake& snake = *view.players[player.index].snake;
+        snake.setBody(player.body.data(), player.body.size());
+        snake.setHeading((Direction)(player.heading & 0x0F), (Direction)(player.heading >> 4));
+        snake.setAlive(player.alive);
+        snake.setScore(scores[player.index]);
+    }
+    std::vector<int> leaving;
+    for (int i : view.players.activeIndices()) {
+        if (!present[i]) leaving.push_back(i);
+    }
+    for (int i : leaving) view.players.deactivate(i);
+
+    view.food.setPosition(snapshot.food);
+    view.occupancy.rebuild(view.players.getSlots().data(), view.players.capacity());
+    if (!view.occupancy.setIndexOrder(freeOrder, anchorOrder)) {
+        Logger::warn("Replay keyframe at tick ", atTick, " doesn't match its grid");
+        return false;
+    }
+    view.occupancy.setRandomState(rng);
+    view.match.syncedElapsedMs = elapsedMs;
+    keyTick = atTick;
+    keyElapsedMs = elapsedMs;
+    return true;
+}
+
+} // namespace Replay
@@ -0,0 +1,106 @@
+#include "sessionpool.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// HardcoreSnakeServer: hosts many sessions on the relay as a dedicated,
+// headless host so no player's machine has to be the authority.
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int)
+{
+    stopRequested = true;
+}
+
+static void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " [--host HOST] [--port PORT] [--sessions N] [--workers N]"
+              << " [--arena WIDTHxHEIGHT] [--players N]\n"
+              << "  Defaults: " << Config::Network::DEFAULT_HOST << ":" << Config::Network::DEFAULT_PORT
+              << ", " << Config::Server::DEFAULT_SESSIONS << " sessions, one worker per core\n";
+}
+
+int main(int argc, char* argv[])
+{
+    std::string host = Config::Network::DEFAULT_HOST;
+    int port = Config::Network::DEFAULT_PORT;
+    int sessions = Config::Server::DEFAULT_SESSIONS;
+    int workers = (int)std::max(1u, std::thread::hardware_concurrency());
+    ArenaSettings arena;
+
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (ok && strcmp(argv[i], "--host") == 0) {
+            host = value;
+        } else if (ok && strcmp(argv[i], "--port") == 0) {
+            ok = sscanf(value, "%d", &port) == 1;
+        } else if (ok && strcmp(argv[i], "--sessions") == 0) {
+            ok = sscanf(value, "%d", &sessions) == 1 && sessions > 0;
+        } else if (ok && strcmp(argv[i], "--workers") == 0) {
+            ok = sscanf(value, "%d", &workers) == 1 && workers > 0;
+        } else if (ok && strcmp(argv[i], "--arena") == 0) {
+            ok = sscanf(value, "%dx%d", &arena.width, &arena.height) == 2;
+        } else if (ok && strcmp(argv[i], "--players") == 0) {
+            ok = sscanf(value, "%d", &arena.maxPlayers) == 1;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    Logger::init("hardcoresnake_server.log", LogLevel::INFO, true, true);
+    Logger::info("HardcoreSnakeServer starting: ", sessions, " sessions on ", host, ":", port);
+
+    // Process-wide setup before any worker runs: jansson's hash seed and
+    // SDL's tick counter initialise lazily and not thread-safely
+    json_object_seed(0);
+    SDL_GetTicks();
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    // One reactor thread does the socket I/O for every session; listeners
+    // only queue messages, so dispatching them inline is cheap
+    MpReactor* reactor = mp_reactor_create(0);
+    if (!reactor) {
+        Logger::error("Failed to start the network reactor");
+        Logger::shutdown();
+        return 1;
+    }
+
+    {
+        SessionPool pool(std::min(workers, sessions));
+        for (int i = 0; i < sessions; i++) {
+            pool.add(std::make_unique<ServerSession>(i + 1, host, port, arena, reactor));
+        }
+        pool.start();
+        
+        Uint32 lastStatus = SDL_GetTicks();
+        while (!stopRequested) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (SDL_GetTicks() - lastStatus >= Config::Server::STATUS_INTERVAL_MS) {
+                SessionPool::Status s = pool.status();
+                Logger::info("Status: ", s.sessions, "/", sessions, " sessions hosted, ", s.playing,
+                             " playing, ", s.players, " players, ", s.ticks, " ticks");
+                lastStatus = SDL_GetTicks();
+            }
+        }
+        
+        Logger::info("Shutting down...");
+    }  // Workers joined, then every session leaves the relay
+    mp_reactor_destroy(reactor);
+    Logger::shutdown();
+    return 0;
+}
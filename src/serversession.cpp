@@ -0,0 +1,244 @@
+#include "serversession.h"
+#include "game.h"
+#include "logger.h"
+
+ServerSession::ServerSession(int id, const std::string& host, int port, const ArenaSettings& arena,
+                             MpReactor* reactor)
+    : sessionNumber(id), serverHost(host), serverPort(port), reactor(reactor),
+      engine(ctx.players, ctx.occupancy, ctx.match, food, [] { return (uint32_t)SDL_GetTicks(); }),
+      currentPhase(Phase::CLOSED), paused(false), reopenAt(0), lobbyReadyAt(0), matchEndedAt(0),
+      lastTick(0), tickAccumulator(0), ticks(0)
+{
+    ctx.food = &food;
+    ctx.arena = arena.clamped();
+    ctx.network.dedicatedHost = true;
+    applyArena(ctx.arena, ctx.players, ctx.occupancy);
+    food.spawn(ctx.occupancy);
+
+    ctx.onStateChange = [this](int state) { onNetworkState(state); };
+    network = std::make_unique<NetworkManager>(&ctx);
+
+    // An ate-food tick sends its game_state whatever the pacing, as on a player host
+    engine.onFoodEaten = [this] { network->markBroadcastDirty(BroadcastScheduler::URGENT); };
+}
+
+ServerSession::~ServerSession()
+{
+    network.reset();
+}
+
+uint32_t ServerSession::poll(uint32_t now)
+{
+    if (currentPhase == Phase::CLOSED) {
+        bool waiting = network->pendingRequest() != NetworkManager::RequestKind::NONE;
+        if (!waiting) {
+            if ((int32_t)(now - reopenAt) < 0) return reopenAt;
+            if (!open(now)) return reopenAt;
+        }
+        // Applies the host reply once it is in, calling opened()
+        network->processMessages();
+        if (currentPhase == Phase::CLOSED) {
+            waiting = network->pendingRequest() != NetworkManager::RequestKind::NONE;
+            return waiting ? now + Config::Server::POLL_INTERVAL_MS : reopenAt;
+        }
+    }
+
+    ctx.network.matchRunning = currentPhase == Phase::PLAYING;
+    network->processMessages();
+    if (ctx.network.connectionLost || !network->isConnected()) {
+        close(now);
+        return reopenAt;
+    }
+    network->sendPeriodicStateSync();
+
+    switch (currentPhase) {
+        case Phase::LOBBY:
+            updateLobby(now);
+            break;
+        case Phase::PLAYING:
+            updatePlaying(now);
+            break;
+        case Phase::MATCH_END:
+            if (now - matchEndedAt >= Config::Server::RESULTS_MS) {
+                sendPhase("LOBBY");
+                currentPhase = Phase::LOBBY;
+                lobbyReadyAt = 0;
+            }
+            break;
+        case Phase::CLOSED:
+            break;
+    }
+
+    uint32_t next = now + Config::Server::POLL_INTERVAL_MS;
+    if (currentPhase == Phase::PLAYING) {
+        uint32_t tickDue = now + (uint32_t)Config::Game::INITIAL_SPEED_MS - tickAccumulator;
+        if ((int32_t)(tickDue - next) < 0) next = tickDue;
+    }
+    return next;
+}
+
+// The connect and the host reply run on a helper thread, so a relay that
+// is down or slow never holds up the other sessions on this worker
+bool ServerSession::open(uint32_t now)
+{
+    if (!network->initialize(serverHost, serverPort, reactor) ||
+        !network->hostSessionAsync([this](bool ok) { opened(ok); })) {
+        retryOpen(now);
+        return false;
+    }
+    return true;
+}
+
+void ServerSession::opened(bool ok)
+{
+    if (!ok) {
+        retryOpen(SDL_GetTicks());
+        return;
+    }
+
+    currentPhase = Phase::LOBBY;
+    paused = false;
+    lobbyReadyAt = 0;
+    ctx.match = MatchState();
+    Logger::info("Session #", sessionNumber, " hosting ", ctx.network.sessionId, " (",
+                 ctx.arena.width, "x", ctx.arena.height, ", up to ", ctx.arena.maxPlayers, " players)");
+}
+
+void ServerSession::retryOpen(uint32_t now)
+{
+    Logger::warn("Session #", sessionNumber, ": could not host on ", serverHost, ":", serverPort,
+                 ", retrying in ", Config::Server::REOPEN_DELAY_MS / 1000, "s");
+    network->shutdown();
+    reopenAt = now + Config::Server::REOPEN_DELAY_MS;
+}
+
+void ServerSession::close(uint32_t now)
+{
+    Logger::warn("Session #", sessionNumber, " lost its relay connection");
+    network->shutdown();
+    ctx.network.connectionLost = false;
+    ctx.network.resetSnapshotSync();
+    ctx.players.clear();
+    ctx.occupancy.clear();
+    currentPhase = Phase::CLOSED;
+    reopenAt = now + Config::Server::REOPEN_DELAY_MS;
+}
+
+// ctx.onStateChange: transitions the network layer asks for. Only pause
+// toggles from players and the connection timeout apply to a server.
+void ServerSession::onNetworkState(int state)
+{
+    switch (static_cast<GameState>(state)) {
+        case GameState::MENU:
+            ctx.network.connectionLost = true;
+            break;
+        case GameState::PAUSED:
+            if (currentPhase == Phase::PLAYING) paused = true;
+            break;
+        case GameState::PLAYING:
+            if (currentPhase == Phase::PLAYING) paused = false;
+            break;
+        default:
+            break;
+    }
+}
+
+void ServerSession::updateLobby(uint32_t now)
+{
+    if (ctx.players.activeCount() < Config::Server::MIN_PLAYERS) {
+        lobbyReadyAt = 0;
+        return;
+    }
+    if (lobbyReadyAt == 0) {
+        lobbyReadyAt = now + Config::Server::LOBBY_START_DELAY_MS;
+    }
+    if ((int32_t)(now - lobbyReadyAt) >= 0) {
+        startMatch(now);
+    }
+}
+
+void ServerSession::startMatch(uint32_t now)
+{
+    engine.resetMatch();
+    paused = false;
+    lastTick = now;
+    tickAccumulator = 0;
+
+    auto startUpdate = JsonBuilder()
+        .set("type", "state_sync")
+        .set("gameState", "PLAYING")
+        .set("matchStartTime", ctx.match.matchStartTime)
+        .set("elapsedMs", 0)
+        .set("totalPausedTime", 0)
+        .set("foodX", food.getPosition().x)
+        .set("foodY", food.getPosition().y)
+        .buildPtr();
+    network->sendGameMessage(startUpdate.get());
+    network->startLockstep();
+    network->markBroadcastDirty(BroadcastScheduler::URGENT);
+    network->flushBroadcast();
+
+    currentPhase = Phase::PLAYING;
+    Logger::info("Session #", sessionNumber, ": match started with ", ctx.players.activeCount(), " players");
+}
+
+void ServerSession::updatePlaying(uint32_t now)
+{
+    // Everyone left: no match to finish
+    if (ctx.players.activeCount() == 0) {
+        sendPhase("LOBBY");
+        currentPhase = Phase::LOBBY;
+        lobbyReadyAt = 0;
+        return;
+    }
+
+    // The match clock rides on every game_state
+    engine.updateMatchTime(paused);
+    if (engine.matchTimeUp()) {
+        endMatch(now);
+        return;
+    }
+
+    // Same fixed timestep as Game::update; while paused only the periodic
+    // state_sync goes out
+    tickAccumulator += now - lastTick;
+    lastTick = now;
+    int steps = 0;
+    while (tickAccumulator >= (uint32_t)Config::Game::INITIAL_SPEED_MS) {
+        tickAccumulator -= Config::Game::INITIAL_SPEED_MS;
+        if (!paused) {
+            network->beginLockstepTick();
+            engine.tick();
+            network->flushBroadcast();
+            ticks++;
+        }
+
+        if (++steps == Config::Game::MAX_TICKS_PER_FRAME) {
+            tickAccumulator %= Config::Game::INITIAL_SPEED_MS;
+            break;
+        }
+    }
+}
+
+void ServerSession::endMatch(uint32_t now)
+{
+    sendPhase("MATCH_END");
+    int winner = engine.decideWinner();
+    if (ctx.players.isValid(winner)) {
+        Logger::info("Session #", sessionNumber, ": match ended, player ", (winner + 1), " wins (length ",
+                     ctx.players[winner].snake->getBody().size(), ")");
+    } else {
+        Logger::info("Session #", sessionNumber, ": match ended without a winner");
+    }
+    currentPhase = Phase::MATCH_END;
+    matchEndedAt = now;
+}
+
+void ServerSession::sendPhase(const char* gameState)
+{
+    auto update = JsonBuilder()
+        .set("type", "state_sync")
+        .set("gameState", gameState)
+        .buildPtr();
+    network->sendGameMessage(update.get());
+}
@@ -0,0 +1,120 @@
+#include "sessionpool.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+
+SessionPool::SessionPool(int workerCount)
+    : nextShard(0), running(false)
+{
+    for (int i = 0; i < std::max(1, workerCount); i++) {
+        shards.push_back(std::make_unique<Shard>());
+    }
+}
+
+SessionPool::~SessionPool()
+{
+    stop();
+}
+
+void SessionPool::add(std::unique_ptr<ServerSession> session)
+{
+    Shard& shard = *shards[nextShard++ % shards.size()];
+    shard.sessions.push_back(std::move(session));
+    shard.due.push_back(0);
+}
+
+void SessionPool::start()
+{
+    if (running.exchange(true)) return;
+    for (auto& shard : shards) {
+        Shard* s = shard.get();
+        s->worker = std::thread([this, s] { run(*s); });
+    }
+    Logger::info("Session pool: ", shards.size(), " workers");
+}
+
+void SessionPool::stop()
+{
+    if (!running.exchange(false)) return;
+    for (auto& shard : shards) {
+        if (shard->worker.joinable()) shard->worker.join();
+    }
+}
+
+SessionPool::Status SessionPool::status() const
+{
+    Status total{0, 0, 0, 0};
+    for (const auto& shard : shards) {
+        total.sessions += shard->hosting.load(std::memory_order_relaxed);
+        total.playing += shard->playing.load(std::memory_order_relaxed);
+        total.players += shard->players.load(std::memory_order_relaxed);
+        total.ticks += shard->ticks.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::vector<std::string> SessionPool::hostedSessions() const
+{
+    std::vector<std::string> all;
+    for (const auto& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->idsLock);
+        all.insert(all.end(), shard->ids.begin(), shard->ids.end());
+    }
+    return all;
+}
+
+// Worker side of hostedSessions(): compare first so the lock and the
+// string copies only happen on (re)connects
+static void publishSessionIds(const std::vector<std::unique_ptr<ServerSession>>& sessions,
+                              std::vector<std::string>& ids, std::mutex& lock)
+{
+    size_t count = 0;
+    bool changed = false;
+    for (const auto& session : sessions) {
+        if (session->phase() == ServerSession::Phase::CLOSED) continue;
+        changed = changed || count >= ids.size() || ids[count] != session->sessionId();
+        count++;
+    }
+    if (!changed && count == ids.size()) return;
+
+    std::lock_guard<std::mutex> guard(lock);
+    ids.clear();
+    for (const auto& session : sessions) {
+        if (session->phase() != ServerSession::Phase::CLOSED) ids.push_back(session->sessionId());
+    }
+}
+
+void SessionPool::run(Shard& shard)
+{
+    while (running.load(std::memory_order_relaxed)) {
+        uint32_t now = SDL_GetTicks();
+        uint32_t wake = now + Config::Server::POLL_INTERVAL_MS;
+        int hosting = 0, playing = 0, players = 0;
+        uint64_t ticks = 0;
+
+        for (size_t i = 0; i < shard.sessions.size(); i++) {
+            ServerSession& session = *shard.sessions[i];
+            if ((int32_t)(now - shard.due[i]) >= 0) {
+                shard.due[i] = session.poll(now);
+                now = SDL_GetTicks();  // Ticks of a busy session take time too
+            }
+            if ((int32_t)(shard.due[i] - wake) < 0) wake = shard.due[i];
+
+            if (session.phase() != ServerSession::Phase::CLOSED) hosting++;
+            if (session.phase() == ServerSession::Phase::PLAYING) playing++;
+            players += session.playerCount();
+            ticks += session.tickCount();
+        }
+
+        shard.hosting.store(hosting, std::memory_order_relaxed);
+        shard.playing.store(playing, std::memory_order_relaxed);
+        shard.players.store(players, std::memory_order_relaxed);
+        shard.ticks.store(ticks, std::memory_order_relaxed);
+        publishSessionIds(shard.sessions, shard.ids, shard.idsLock);
+
+        int32_t wait = (int32_t)(wake - SDL_GetTicks());
+        if (wait > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+        }
+    }
+}
@@ -0,0 +1,264 @@
+#include "snakebot.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+static int popcount64(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+static Position stepFrom(Position p, Direction dir)
+{
+    switch (dir) {
+        case Direction::UP:    p.y--; break;
+        case Direction::DOWN:  p.y++; break;
+        case Direction::LEFT:  p.x--; break;
+        case Direction::RIGHT: p.x++; break;
+        case Direction::NONE:  break;
+    }
+    return p;
+}
+
+void BotBoard::reset(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    stride = (width + 63) / 64 + 2;
+    free.assign((size_t)(height + 2) * stride, 0);
+
+    int fullWords = width / 64;
+    uint64_t lastWord = (width & 63) ? (1ull << (width & 63)) - 1 : 0;
+    for (int y = 0; y < height; y++) {
+        uint64_t* words = free.data() + (size_t)(y + 1) * stride + 1;
+        for (int w = 0; w < fullWords; w++) words[w] = ~0ull;
+        if (lastWord) words[fullWords] = lastWord;
+    }
+}
+
+void BotBoard::build(const OccupancyGrid& occupancy)
+{
+    width = occupancy.getWidth();
+    height = occupancy.getHeight();
+    stride = (width + 63) / 64 + 2;
+    free.assign((size_t)(height + 2) * stride, 0);
+
+    for (int y = 0; y < height; y++) {
+        uint64_t* words = free.data() + (size_t)(y + 1) * stride + 1;
+        const uint8_t* owners = occupancy.row(y);
+        for (int x0 = 0; x0 < width; x0 += 64) {
+            int cellsInWord = std::min(64, width - x0);
+            uint64_t word = 0;
+            for (int b = 0; b < cellsInWord; b++) {
+                word |= (uint64_t)(owners[x0 + b] == OccupancyGrid::EMPTY) << b;
+            }
+            words[x0 >> 6] = word;
+        }
+    }
+}
+
+void BotBoard::block(const Position& p)
+{
+    if (p.x < 0 || p.x >= width || p.y < 0 || p.y >= height) return;
+    free[wordIndex(p)] &= ~(1ull << (p.x & 63));
+}
+
+void SnakeBot::fitScratch(const BotBoard& board)
+{
+    // Floods clear what they touched, so the buffers stay zero in between
+    size_t words = (size_t)(board.getHeight() + 2) * board.wordsPerRow();
+    if (visited.size() != words) {
+        visited.assign(words, 0);
+        frontier.assign(words, 0);
+        next.assign(words, 0);
+    }
+}
+
+SnakeBot::Flood SnakeBot::flood(const BotBoard& board, const Position& start, int minArea,
+                                const Position* probes, int probeCount, int* probeSteps)
+{
+    fitScratch(board);
+    const int stride = board.wordsPerRow();
+    const int lastRow = board.getHeight();  // Padded rows 1..height are the board
+
+    int unreached = 0;
+    for (int i = 0; i < probeCount; i++) {
+        probeSteps[i] = probes[i] == start ? 0 : -1;
+        unreached += probeSteps[i] < 0 ? 1 : 0;
+    }
+    size_t startWord = board.wordIndex(start);
+    frontier[startWord] = visited[startWord] = 1ull << (start.x & 63);
+
+    // Rows and columns the frontier may occupy; they grow by one cell each
+    // way per layer, so early layers only touch a few words
+    Flood result{0, false};
+    int lo = start.y + 1;
+    int hi = start.y + 1;
+    int left = start.x;
+    int right = start.x;
+    uint64_t* current = frontier.data();
+    uint64_t* spread = next.data();
+    uint64_t* seen = visited.data();
+    for (int step = 1; step <= Config::Bots::SEARCH_DEPTH; step++) {
+        lo = std::max(1, lo - 1);
+        hi = std::min(lastRow, hi + 1);
+        left = std::max(0, left - 1);
+        right = std::min(board.getWidth() - 1, right + 1);
+        const int firstWord = 1 + (left >> 6);
+        const int lastWord = 1 + (right >> 6);
+
+        uint64_t any = 0;
+        for (int r = lo; r <= hi; r++) {
+            const size_t base = (size_t)r * stride;
+            const uint64_t* f = current + base;
+            const uint64_t* up = f - stride;
+            const uint64_t* down = f + stride;
+            const uint64_t* open = board.row(r);
+            uint64_t* out = spread + base;
+            uint64_t* reached = seen + base;
+            // Words left and right of the band are zero (padding included)
+            for (int w = firstWord; w <= lastWord; w++) {
+                uint64_t grown = f[w] | (f[w] << 1) | (f[w - 1] >> 63) | (f[w] >> 1) | (f[w + 1] << 63) |
+                                 up[w] | down[w];
+                uint64_t fresh = grown & open[w] & ~reached[w];
+                out[w] = fresh;
+                reached[w] |= fresh;
+                any |= fresh;
+            }
+        }
+        std::swap(current, spread);
+
+        if (!any) {
+            result.enclosed = true;
+            break;
+        }
+        for (int i = 0; unreached > 0 && i < probeCount; i++) {
+            if (probeSteps[i] < 0 && board.isFree(probes[i]) &&
+                (current[board.wordIndex(probes[i])] >> (probes[i].x & 63) & 1)) {
+                probeSteps[i] = step;
+                unreached--;
+            }
+        }
+        // Every layer added at least one cell
+        if (unreached == 0 && step + 1 >= minArea) break;
+    }
+
+    // Count if it matters, then leave the scratch zeroed for the next flood
+    const int firstWord = 1 + (left >> 6);
+    const int wordCount = (right >> 6) + 1 - (left >> 6);
+    const size_t bytes = (size_t)wordCount * sizeof(uint64_t);
+    for (int r = lo; r <= hi; r++) {
+        const size_t offset = (size_t)r * stride + firstWord;
+        if (result.enclosed) {
+            for (int w = 0; w < wordCount; w++) result.area += popcount64(seen[offset + w]);
+        }
+        std::memset(seen + offset, 0, bytes);
+        std::memset(current + offset, 0, bytes);
+        std::memset(spread + offset, 0, bytes);
+    }
+    return result;
+}
+
+Direction SnakeBot::choose(const BotBoard& board, const Position& head, Direction heading, int length,
+                           const Position& food, const std::vector<Position>& rivalHeads)
+{
+    static const Direction moves[4] = {Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT};
+
+    Direction dirs[4];
+    Position cells[4];
+    int count = 0;
+    for (Direction dir : moves) {
+        Position cell = stepFrom(head, dir);
+        if (board.isFree(cell)) {
+            dirs[count] = dir;
+            cells[count] = cell;
+            count++;
+        }
+    }
+    if (count == 0) return Direction::NONE;
+
+    // Food distance of every candidate from one flood out of the food
+    int foodSteps[4] = {-1, -1, -1, -1};
+    if (board.isFree(food)) {
+        flood(board, food, 0, cells, count, foodSteps);
+    }
+
+    Direction best = Direction::NONE;
+    int bestTier = -1;
+    int bestRank = 0;  // Within a tier: room if trapped, else food distance (lower is better)
+    bool bestStraight = false;
+    for (int c = 0; c < count; c++) {
+        const Position& cell = cells[c];
+        Flood room = flood(board, cell, length, nullptr, 0, nullptr);
+        bool trapped = room.enclosed && room.area < length;
+        bool contested = false;
+        for (const Position& rival : rivalHeads) {
+            if (rival == head) continue;
+            if (std::abs(rival.x - cell.x) + std::abs(rival.y - cell.y) == 1) {
+                contested = true;
+                break;
+            }
+        }
+
+        int tier = trapped ? 0 : (contested ? 1 : 2);
+        int rank;
+        if (trapped) {
+            rank = -room.area;
+        } else if (foodSteps[c] >= 0) {
+            rank = foodSteps[c];
+        } else {
+            rank = Config::Bots::SEARCH_DEPTH + std::abs(food.x - cell.x) + std::abs(food.y - cell.y);
+        }
+        bool straight = dirs[c] == heading;
+
+        if (tier > bestTier || (tier == bestTier && (rank < bestRank || (rank == bestRank && straight && !bestStraight)))) {
+            best = dirs[c];
+            bestTier = tier;
+            bestRank = rank;
+            bestStraight = straight;
+        }
+    }
+    return best;
+}
+
+void SnakeBot::steer(PlayerManager& players, const OccupancyGrid& occupancy, const Position& food)
+{
+    const std::vector<int>& active = players.activeIndices();
+    bool anyBot = false;
+    heads.clear();
+    for (int i : active) {
+        if (!players.isValid(i) || !players[i].snake->isAlive()) continue;
+        heads.push_back(players[i].snake->getHead());
+        anyBot = anyBot || isBot(players[i]);
+    }
+    if (!anyBot) return;
+
+    board.build(occupancy);
+    for (int i : active) {
+        if (!players.isValid(i) || !isBot(players[i])) continue;
+        Snake& snake = *players[i].snake;
+        if (!snake.isAlive()) continue;
+        Direction dir = choose(board, snake.getHead(), snake.getNextDirection(), (int)snake.getBody().size(),
+                               food, heads);
+        if (dir != Direction::NONE) {
+            snake.setDirection(dir);
+        }
+    }
+}
+
+bool SnakeBot::isBot(const PlayerSlot& slot)
+{
+    return slot.clientId.compare(0, std::strlen(Config::Bots::CLIENT_ID_PREFIX), Config::Bots::CLIENT_ID_PREFIX) == 0;
+}
+
+std::string SnakeBot::botClientId(int slot)
+{
+    return Config::Bots::CLIENT_ID_PREFIX + std::to_string(slot);
+}
@@ -0,0 +1,447 @@
+#include "wireformat.h"
+#include <algorithm>
+
+namespace WireFormat {
+
+// 2-bit step codes: direction from one segment to the next
+enum StepCode : uint8_t { STEP_UP = 0, STEP_DOWN = 1, STEP_LEFT = 2, STEP_RIGHT = 3 };
+
+static constexpr size_t HEADER_SIZE = 23;
+static constexpr size_t PLAYER_PREFIX_SIZE = 2;   // index, flags
+static constexpr size_t FULL_RECORD_SIZE = 7;     // chainLength, tailRepeat, head
+static constexpr size_t DELTA_RECORD_SIZE = 4;    // headAdvance, tailTrim, tailRepeat
+static constexpr size_t INPUT_BLOCK_SIZE = 6;     // inputSeq, inputAge, heading
+
+static constexpr uint8_t FLAG_ALIVE = 1 << 0;
+static constexpr uint8_t FLAG_DELTA = 1 << 1;
+static constexpr uint8_t FLAG_INPUT = 1 << 2;
+
+static void put16(std::vector<uint8_t>& buf, uint32_t v) {
+    buf.push_back((uint8_t)(v & 0xFF));
+    buf.push_back((uint8_t)((v >> 8) & 0xFF));
+}
+
+static void put32(std::vector<uint8_t>& buf, uint32_t v) {
+    put16(buf, v & 0xFFFF);
+    put16(buf, v >> 16);
+}
+
+static uint32_t get16(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+static bool stepBetween(const Position& from, const Position& to, uint8_t& code) {
+    int dx = to.x - from.x;
+    int dy = to.y - from.y;
+    if (dx == 0 && dy == -1) { code = STEP_UP; return true; }
+    if (dx == 0 && dy == 1)  { code = STEP_DOWN; return true; }
+    if (dx == -1 && dy == 0) { code = STEP_LEFT; return true; }
+    if (dx == 1 && dy == 0)  { code = STEP_RIGHT; return true; }
+    return false;
+}
+
+static Position applyStep(const Position& from, uint8_t code) {
+    switch (code) {
+        case STEP_UP:    return Position{from.x, from.y - 1};
+        case STEP_DOWN:  return Position{from.x, from.y + 1};
+        case STEP_LEFT:  return Position{from.x - 1, from.y};
+        default:         return Position{from.x + 1, from.y};
+    }
+}
+
+// Packs 2-bit step codes four to a byte, lowest bits first
+class StepPacker {
+public:
+    explicit StepPacker(std::vector<uint8_t>& buf) : buf(buf), packed(0), shift(0) {}
+
+    void push(uint8_t code) {
+        packed |= (uint8_t)(code << shift);
+        shift += 2;
+        if (shift == 8) {
+            buf.push_back(packed);
+            packed = 0;
+            shift = 0;
+        }
+    }
+
+    void flush() {
+        if (shift > 0) buf.push_back(packed);
+    }
+
+private:
+    std::vector<uint8_t>& buf;
+    uint8_t packed;
+    int shift;
+};
+
+static uint8_t stepAt(const uint8_t* steps, size_t i) {
+    size_t bit = i * 2;
+    return (steps[bit / 8] >> (bit % 8)) & 0x3;
+}
+
+static size_t stepBytes(size_t steps) {
+    return (steps + 3) / 4;
+}
+
+PlayerState& StateSnapshot::addPlayer()
+{
+    if ((int)players.size() <= playerCount) {
+        players.emplace_back();
+    }
+    PlayerState& player = players[playerCount++];
+    player.inputSeq = 0;
+    player.inputAge = 0;
+    player.heading = 0;
+    player.body.clear();
+    return player;
+}
+
+const PlayerState* StateSnapshot::findPlayer(int index) const
+{
+    for (int p = 0; p < playerCount; p++) {
+        if (players[p].index == index) return &players[p];
+    }
+    return nullptr;
+}
+
+void StateSnapshot::copyFrom(const StateSnapshot& other)
+{
+    seq = other.seq;
+    food = other.food;
+    matchStartTime = other.matchStartTime;
+    elapsedMs = other.elapsedMs;
+    playerCount = 0;
+    for (int p = 0; p < other.playerCount; p++) {
+        const PlayerState& src = other.players[p];
+        PlayerState& dst = addPlayer();
+        dst.index = src.index;
+        dst.alive = src.alive;
+        dst.inputSeq = src.inputSeq;
+        dst.inputAge = src.inputAge;
+        dst.heading = src.heading;
+        dst.body.assign(src.body.begin(), src.body.end());
+    }
+}
+
+StateSnapshot& SnapshotHistory::store(uint32_t seq)
+{
+    StateSnapshot& slot = slots[seq % CAPACITY];
+    slot.seq = seq;
+    return slot;
+}
+
+const StateSnapshot* SnapshotHistory::find(uint32_t seq) const
+{
+    const StateSnapshot& slot = slots[seq % CAPACITY];
+    return (seq != 0 && slot.seq == seq) ? &slot : nullptr;
+}
+
+void SnapshotHistory::clear()
+{
+    for (auto& slot : slots) {
+        slot.seq = 0;
+    }
+}
+
+// ========== ENCODING ==========
+
+static bool writeFullPlayer(const std::vector<Position>& body, std::vector<uint8_t>& buf)
+{
+    const Position& head = body.front();
+    if (head.x < 0 || head.y < 0 || head.x > 0xFFFF || head.y > 0xFFFF) return false;
+
+    // Trailing duplicates left by grow()
+    size_t chainLength = body.size();
+    while (chainLength > 1 && body[chainLength - 1] == body[chainLength - 2]) {
+        chainLength--;
+    }
+    size_t tailRepeat = body.size() - chainLength;
+    if (chainLength > 0xFFFF || tailRepeat > 0xFF) return false;
+
+    put16(buf, (uint32_t)chainLength);
+    buf.push_back((uint8_t)tailRepeat);
+    put16(buf, (uint32_t)head.x);
+    put16(buf, (uint32_t)head.y);
+
+    StepPacker packer(buf);
+    for (size_t i = 1; i < chainLength; i++) {
+        uint8_t code;
+        if (!stepBetween(body[i - 1], body[i], code)) return false;
+        packer.push(code);
+    }
+    packer.flush();
+    return true;
+}
+
+// Describes cur as: advance new head cells + the first kept cells of base
+// + repeat copies of the last kept cell. Snakes move one cell per tick, so
+// the old head is normally found within the first few cells.
+static bool matchDelta(const std::vector<Position>& base, const std::vector<Position>& cur,
+                       size_t& advance, size_t& kept, size_t& repeat)
+{
+    if (base.empty() || cur.empty()) return false;
+
+    size_t maxAdvance = std::min(cur.size() - 1, (size_t)0xFF);
+    for (size_t k = 0; k <= maxAdvance; k++) {
+        if (!(cur[k] == base[0])) continue;
+
+        size_t m = 1;
+        while (k + m < cur.size() && m < base.size() && cur[k + m] == base[m]) {
+            m++;
+        }
+        size_t end = k + m;
+        while (end < cur.size() && cur[end] == cur[k + m - 1]) {
+            end++;
+        }
+        if (end != cur.size()) continue;
+
+        size_t rep = cur.size() - k - m;
+        if (rep > 0xFF || base.size() - m > 0xFFFF) continue;
+
+        advance = k;
+        kept = m;
+        repeat = rep;
+        return true;
+    }
+    return false;
+}
+
+static bool writeDeltaPlayer(const std::vector<Position>& base, const std::vector<Position>& body,
+                             std::vector<uint8_t>& buf)
+{
+    size_t advance, kept, repeat;
+    if (!matchDelta(base, body, advance, kept, repeat)) return false;
+
+    buf.push_back((uint8_t)advance);
+    put16(buf, (uint32_t)(base.size() - kept));
+    buf.push_back((uint8_t)repeat);
+
+    // New head cells, stepping outwards from the old head (body[advance])
+    StepPacker packer(buf);
+    for (size_t j = advance; j > 0; j--) {
+        uint8_t code;
+        if (!stepBetween(body[j], body[j - 1], code)) return false;
+        packer.push(code);
+    }
+    packer.flush();
+    return true;
+}
+
+bool encodeSnapshot(const StateSnapshot& current, const StateSnapshot* base,
+                    std::vector<uint8_t>& out)
+{
+    if (current.playerCount > 0xFF) return false;
+
+    out.clear();
+    out.push_back(VERSION);
+    out.push_back(base ? DELTA : KEYFRAME);
+    put32(out, current.seq);
+    put32(out, base ? base->seq : 0);
+    out.push_back((uint8_t)current.playerCount);
+    put16(out, (uint32_t)current.food.x);
+    put16(out, (uint32_t)current.food.y);
+    put32(out, current.matchStartTime);
+    put32(out, current.elapsedMs);
+
+    for (int p = 0; p < current.playerCount; p++) {
+        const PlayerState& player = current.players[p];
+        if (player.body.empty() || player.index < 0 || player.index > 0xFF) return false;
+
+        size_t recordStart = out.size();
+        uint8_t flags = player.alive ? FLAG_ALIVE : 0;
+        if (player.inputSeq != 0) flags |= FLAG_INPUT;
+        out.push_back((uint8_t)player.index);
+        out.push_back(flags | FLAG_DELTA);
+        if (flags & FLAG_INPUT) {
+            put32(out, player.inputSeq);
+            out.push_back(player.inputAge);
+            out.push_back(player.heading);
+        }
+        size_t bodyStart = out.size();
+
+        const PlayerState* basePlayer = base ? base->findPlayer(player.index) : nullptr;
+        if (basePlayer && writeDeltaPlayer(basePlayer->body, player.body, out)) {
+            continue;
+        }
+
+        // No usable baseline for this snake - send it in full
+        out.resize(bodyStart);
+        out[recordStart + 1] = flags;
+        if (!writeFullPlayer(player.body, out)) return false;
+    }
+    return true;
+}
+
+// ========== DECODING ==========
+
+static bool readFullPlayer(const uint8_t* data, size_t length, size_t& offset, PlayerState& player)
+{
+    if (length - offset < FULL_RECORD_SIZE) return false;
+    const uint8_t* rec = data + offset;
+    size_t chainLength = get16(rec);
+    size_t tailRepeat = rec[2];
+    offset += FULL_RECORD_SIZE;
+    if (chainLength == 0) return false;
+    size_t bytes = stepBytes(chainLength - 1);
+    if (length - offset < bytes) return false;
+
+    const uint8_t* steps = data + offset;
+    Position cur{(int)get16(rec + 3), (int)get16(rec + 5)};
+    player.body.push_back(cur);
+    for (size_t i = 1; i < chainLength; i++) {
+        cur = applyStep(cur, stepAt(steps, i - 1));
+        player.body.push_back(cur);
+    }
+    player.body.insert(player.body.end(), tailRepeat, cur);
+    offset += bytes;
+    return true;
+}
+
+static bool readDeltaPlayer(const uint8_t* data, size_t length, size_t& offset,
+                            const PlayerState& basePlayer, PlayerState& player)
+{
+    if (length - offset < DELTA_RECORD_SIZE) return false;
+    const uint8_t* rec = data + offset;
+    size_t advance = rec[0];
+    size_t trim = get16(rec + 1);
+    size_t tailRepeat = rec[3];
+    offset += DELTA_RECORD_SIZE;
+    const auto& base = basePlayer.body;
+    if (trim >= base.size()) return false;
+    size_t bytes = stepBytes(advance);
+    if (length - offset < bytes) return false;
+
+    const uint8_t* steps = data + offset;
+    player.body.resize(advance);
+    Position cur = base.front();
+    for (size_t i = 0; i < advance; i++) {
+        cur = applyStep(cur, stepAt(steps, i));
+        player.body[advance - 1 - i] = cur;
+    }
+    size_t kept = base.size() - trim;
+    player.body.insert(player.body.end(), base.begin(), base.begin() + kept);
+    player.body.insert(player.body.end(), tailRepeat, base[kept - 1]);
+    offset += bytes;
+    return true;
+}
+
+DecodeResult decodeSnapshot(const uint8_t* data, size_t length,
+                            const SnapshotHistory& history, StateSnapshot& out)
+{
+    if (length < HEADER_SIZE || data[0] != VERSION) return DecodeResult::MALFORMED;
+
+    uint8_t kind = data[1];
+    out.seq = get32(data + 2);
+    uint32_t baseSeq = get32(data + 6);
+    int count = data[10];
+    out.food = Position{(int)get16(data + 11), (int)get16(data + 13)};
+    out.matchStartTime = get32(data + 15);
+    out.elapsedMs = get32(data + 19);
+    out.playerCount = 0;
+
+    const StateSnapshot* base = nullptr;
+    if (kind == DELTA) {
+        base = history.find(baseSeq);
+        if (!base) return DecodeResult::MISSING_BASE;
+    } else if (kind != KEYFRAME) {
+        return DecodeResult::MALFORMED;
+    }
+
+    size_t offset = HEADER_SIZE;
+    for (int p = 0; p < count; p++) {
+        if (length - offset < PLAYER_PREFIX_SIZE) return DecodeResult::MALFORMED;
+        int index = data[offset];
+        uint8_t flags = data[offset + 1];
+        offset += PLAYER_PREFIX_SIZE;
+
+        PlayerState& player = out.addPlayer();
+        player.index = index;
+        player.alive = (flags & FLAG_ALIVE) != 0;
+        player.inputSeq = 0;
+        player.inputAge = 0;
+        player.heading = 0;
+        if (flags & FLAG_INPUT) {
+            if (length - offset < INPUT_BLOCK_SIZE) return DecodeResult::MALFORMED;
+            player.inputSeq = get32(data + offset);
+            player.inputAge = data[offset + 4];
+            player.heading = data[offset + 5];
+            offset += INPUT_BLOCK_SIZE;
+        }
+
+        bool ok;
+        if (flags & FLAG_DELTA) {
+            const PlayerState* basePlayer = base ? base->findPlayer(index) : nullptr;
+            ok = basePlayer && readDeltaPlayer(data, length, offset, *basePlayer, player);
+        } else {
+            ok = readFullPlayer(data, length, offset, player);
+        }
+        if (!ok) return DecodeResult::MALFORMED;
+    }
+    return offset == length ? DecodeResult::OK : DecodeResult::MALFORMED;
+}
+
+// ========== BASE64 ==========
+
+static const char BASE64_CHARS[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void base64Encode(const uint8_t* data, size_t length, std::string& out)
+{
+    out.clear();
+    out.reserve((length + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < length; i += 3) {
+        uint32_t v = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        out.push_back(BASE64_CHARS[(v >> 18) & 0x3F]);
+        out.push_back(BASE64_CHARS[(v >> 12) & 0x3F]);
+        out.push_back(BASE64_CHARS[(v >> 6) & 0x3F]);
+        out.push_back(BASE64_CHARS[v & 0x3F]);
+    }
+    if (i < length) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < length) v |= (uint32_t)data[i + 1] << 8;
+        out.push_back(BASE64_CHARS[(v >> 18) & 0x3F]);
+        out.push_back(BASE64_CHARS[(v >> 12) & 0x3F]);
+        out.push_back(i + 1 < length ? BASE64_CHARS[(v >> 6) & 0x3F] : '=');
+        out.push_back('=');
+    }
+}
+
+static int base64Value(char c)
+{
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+bool base64Decode(const char* text, size_t length, std::vector<uint8_t>& out)
+{
+    out.clear();
+    if (length % 4 != 0) return false;
+    out.reserve(length / 4 * 3);
+    for (size_t i = 0; i < length; i += 4) {
+        int a = base64Value(text[i]);
+        int b = base64Value(text[i + 1]);
+        if (a < 0 || b < 0) return false;
+        bool last = (i + 4 == length);
+        bool pad2 = last && text[i + 2] == '=';
+        bool pad1 = last && text[i + 3] == '=';
+        int c = pad2 ? 0 : base64Value(text[i + 2]);
+        int d = pad1 ? 0 : base64Value(text[i + 3]);
+        if (c < 0 || d < 0 || (pad2 && !pad1)) return false;
+        uint32_t v = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+        out.push_back((uint8_t)(v >> 16));
+        if (!pad2) out.push_back((uint8_t)(v >> 8));
+        if (!pad1) out.push_back((uint8_t)v);
+    }
+    return true;
+}
+
+} // namespace WireFormat